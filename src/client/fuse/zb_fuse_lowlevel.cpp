@@ -0,0 +1,551 @@
+#define FUSE_USE_VERSION 29
+#include "zb_fuse_lowlevel.h"
+
+#include <fuse.h>
+#include <fuse_lowlevel.h>
+
+#include <butil/iobuf.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+#include "client/mount/DfsClient.h"
+#include "zb_fuse_session.h"
+
+namespace {
+
+// Same lifetime the high-level API uses by default.
+constexpr double kAttrTimeoutSec = 1.0;
+
+// FUSE inode number <-> path. The MDS is path based, so metadata requests still
+// resolve through here; reads and writes only use the file handle. Numbers are
+// handed out on lookup and dropped when the kernel forgets them.
+class NodeTable {
+public:
+    NodeTable() {
+        nodes_[FUSE_ROOT_ID] = Node{"/", 1};
+        by_path_["/"] = FUSE_ROOT_ID;
+    }
+
+    bool Path(fuse_ino_t ino, std::string& out) const {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = nodes_.find(ino);
+        if (it == nodes_.end()) {
+            return false;
+        }
+        out = it->second.path;
+        return true;
+    }
+
+    bool ChildPath(fuse_ino_t parent, const char* name, std::string& out) const {
+        if (!Path(parent, out)) {
+            return false;
+        }
+        if (out.back() != '/') {
+            out.push_back('/');
+        }
+        out.append(name);
+        return true;
+    }
+
+    // Returns the number for path and counts one kernel lookup against it.
+    fuse_ino_t Lookup(const std::string& path) {
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = by_path_.find(path);
+        if (it != by_path_.end()) {
+            ++nodes_[it->second].nlookup;
+            return it->second;
+        }
+        const fuse_ino_t ino = next_ino_++;
+        nodes_[ino] = Node{path, 1};
+        by_path_[path] = ino;
+        return ino;
+    }
+
+    void Forget(fuse_ino_t ino, uint64_t nlookup) {
+        if (ino == FUSE_ROOT_ID) {
+            return;
+        }
+        std::lock_guard<std::mutex> lk(mu_);
+        auto it = nodes_.find(ino);
+        if (it == nodes_.end()) {
+            return;
+        }
+        if (it->second.nlookup > nlookup) {
+            it->second.nlookup -= nlookup;
+            return;
+        }
+        auto p = by_path_.find(it->second.path);
+        if (p != by_path_.end() && p->second == ino) {
+            by_path_.erase(p);
+        }
+        nodes_.erase(it);
+    }
+
+    // path was unlinked: a file created there later gets a new number, while
+    // the kernel may keep using the old one until it forgets it.
+    void Removed(const std::string& path) {
+        std::lock_guard<std::mutex> lk(mu_);
+        by_path_.erase(path);
+    }
+
+private:
+    struct Node {
+        std::string path;
+        uint64_t nlookup{0};
+    };
+
+    mutable std::mutex mu_;
+    std::unordered_map<fuse_ino_t, Node> nodes_;
+    std::unordered_map<std::string, fuse_ino_t> by_path_;
+    fuse_ino_t next_ino_{FUSE_ROOT_ID + 1};
+};
+
+struct LowLevelContext {
+    DfsClient* client{nullptr};
+    NodeTable nodes;
+};
+
+struct DirHandle {
+    std::vector<std::string> names;
+};
+
+LowLevelContext* Ctx(fuse_req_t req) {
+    return static_cast<LowLevelContext*>(fuse_req_userdata(req));
+}
+
+// DfsClient returns -errno; fuse_reply_err wants errno.
+void ReplyStatus(fuse_req_t req, int rc) {
+    fuse_reply_err(req, rc < 0 ? -rc : rc);
+}
+
+// Stats path and fills an entry with a lookup counted against it.
+int MakeEntry(LowLevelContext* ctx, const std::string& path, struct fuse_entry_param& e) {
+    std::memset(&e, 0, sizeof(e));
+    int rc = ctx->client->GetAttr(path, &e.attr);
+    if (rc != 0) {
+        return rc;
+    }
+    e.ino = ctx->nodes.Lookup(path);
+    e.attr.st_ino = e.ino;
+    e.attr_timeout = kAttrTimeoutSec;
+    e.entry_timeout = kAttrTimeoutSec;
+    return 0;
+}
+
+void ReplyEntry(fuse_req_t req, const std::string& path) {
+    auto* ctx = Ctx(req);
+    struct fuse_entry_param e;
+    int rc = MakeEntry(ctx, path, e);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    if (fuse_reply_entry(req, &e) != 0) {
+        ctx->nodes.Forget(e.ino, 1);
+    }
+}
+
+// Hands the IOBuf's blocks to the kernel as-is. With splice enabled libfuse
+// moves them through a pipe; otherwise a single block goes out with writev
+// and only multi-block replies are gathered by libfuse.
+void ReplyIOBuf(fuse_req_t req, const butil::IOBuf& data) {
+    const size_t n = data.backing_block_num();
+    if (n == 0) {
+        fuse_reply_buf(req, nullptr, 0);
+        return;
+    }
+    std::vector<char> raw(sizeof(struct fuse_bufvec) + (n - 1) * sizeof(struct fuse_buf));
+    auto* bufv = new (raw.data()) fuse_bufvec();
+    bufv->count = n;
+    bufv->idx = 0;
+    bufv->off = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto block = data.backing_block(i);
+        struct fuse_buf& b = bufv->buf[i];
+        std::memset(&b, 0, sizeof(b));
+        b.mem = const_cast<char*>(block.data());
+        b.size = block.size();
+        b.fd = -1;
+    }
+    // No FUSE_BUF_SPLICE_MOVE: IOBuf blocks are recycled once data is released.
+    fuse_reply_data(req, bufv, static_cast<enum fuse_buf_copy_flags>(0));
+}
+
+int CollectName(void* buf, const char* name, const struct stat* stbuf, off_t off) {
+    (void)stbuf;
+    (void)off;
+    static_cast<DirHandle*>(buf)->names.emplace_back(name);
+    return 0;
+}
+
+void ll_init(void* userdata, struct fuse_conn_info* conn) {
+    (void)userdata;
+    // Splice replies to /dev/fuse. Splice for requests is left off: write data
+    // has to be in user memory for the RPC anyway, so a pipe would add a copy.
+    if (conn->capable & FUSE_CAP_SPLICE_WRITE) {
+        conn->want |= FUSE_CAP_SPLICE_WRITE;
+    }
+}
+
+void ll_lookup(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    std::string path;
+    if (!Ctx(req)->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    ReplyEntry(req, path);
+}
+
+void ll_forget(fuse_req_t req, fuse_ino_t ino, unsigned long nlookup) {
+    Ctx(req)->nodes.Forget(ino, nlookup);
+    fuse_reply_none(req);
+}
+
+void ll_forget_multi(fuse_req_t req, size_t count, struct fuse_forget_data* forgets) {
+    auto* ctx = Ctx(req);
+    for (size_t i = 0; i < count; ++i) {
+        ctx->nodes.Forget(static_cast<fuse_ino_t>(forgets[i].ino), forgets[i].nlookup);
+    }
+    fuse_reply_none(req);
+}
+
+void ll_getattr(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    (void)fi;
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.Path(ino, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    struct stat st;
+    int rc = ctx->client->GetAttr(path, &st);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    st.st_ino = ino;
+    fuse_reply_attr(req, &st, kAttrTimeoutSec);
+}
+
+void ll_setattr(fuse_req_t req, fuse_ino_t ino, struct stat* attr, int to_set,
+                struct fuse_file_info* fi) {
+    (void)fi;
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.Path(ino, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    // Only size changes are stored; times and ownership are accepted and
+    // ignored, as in the high-level client.
+    if (to_set & FUSE_SET_ATTR_SIZE) {
+        int rc = ctx->client->Truncate(path, attr->st_size);
+        if (rc != 0) {
+            ReplyStatus(req, rc);
+            return;
+        }
+    }
+    struct stat st;
+    int rc = ctx->client->GetAttr(path, &st);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    st.st_ino = ino;
+    fuse_reply_attr(req, &st, kAttrTimeoutSec);
+}
+
+void ll_mknod(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t mode, dev_t rdev) {
+    (void)rdev;
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    if (!S_ISREG(mode)) {
+        fuse_reply_err(req, ENOTSUP);
+        return;
+    }
+    uint64_t fh = 0;
+    int rc = ctx->client->Create(path, O_CREAT | O_WRONLY, mode, fh);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    ctx->client->Close(fh);
+    ReplyEntry(req, path);
+}
+
+void ll_mkdir(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t mode) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    int rc = ctx->client->Mkdir(path, mode);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    ReplyEntry(req, path);
+}
+
+void ll_unlink(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    int rc = ctx->client->Unlink(path);
+    if (rc == 0) {
+        ctx->nodes.Removed(path);
+    }
+    ReplyStatus(req, rc);
+}
+
+void ll_rmdir(fuse_req_t req, fuse_ino_t parent, const char* name) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    int rc = ctx->client->Rmdir(path);
+    if (rc == 0) {
+        ctx->nodes.Removed(path);
+    }
+    ReplyStatus(req, rc);
+}
+
+void ll_open(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.Path(ino, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    uint64_t fh = 0;
+    int rc = ctx->client->Open(path, fi->flags, fh);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    fi->fh = fh;
+    // The open was interrupted: the kernel will never release this handle.
+    if (fuse_reply_open(req, fi) == -ENOENT) {
+        ctx->client->Close(fh);
+    }
+}
+
+void ll_create(fuse_req_t req, fuse_ino_t parent, const char* name, mode_t mode,
+               struct fuse_file_info* fi) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.ChildPath(parent, name, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    uint64_t fh = 0;
+    int rc = ctx->client->Create(path, fi->flags, mode, fh);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    struct fuse_entry_param e;
+    rc = MakeEntry(ctx, path, e);
+    if (rc != 0) {
+        ctx->client->Close(fh);
+        ReplyStatus(req, rc);
+        return;
+    }
+    fi->fh = fh;
+    if (fuse_reply_create(req, &e, fi) == -ENOENT) {
+        ctx->client->Close(fh);
+        ctx->nodes.Forget(e.ino, 1);
+    }
+}
+
+void ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi) {
+    (void)ino;
+    butil::IOBuf data;
+    int rc = Ctx(req)->client->ReadBuf(fi->fh, size, off, &data);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    ReplyIOBuf(req, data);
+}
+
+void ll_write_buf(fuse_req_t req, fuse_ino_t ino, struct fuse_bufvec* bufv, off_t off,
+                  struct fuse_file_info* fi) {
+    (void)ino;
+    const size_t len = fuse_buf_size(bufv);
+    const char* src = nullptr;
+    size_t n = len;
+    const struct fuse_buf& first = bufv->buf[bufv->idx];
+    if (bufv->count == 1 && bufv->off == 0 && !(first.flags & FUSE_BUF_IS_FD)) {
+        // Common case: the request was read into memory; write straight from it.
+        src = static_cast<const char*>(first.mem);
+    } else {
+        thread_local std::vector<char> scratch;
+        scratch.resize(len);
+        struct fuse_bufvec dst = FUSE_BUFVEC_INIT(len);
+        dst.buf[0].mem = scratch.data();
+        ssize_t copied = fuse_buf_copy(&dst, bufv, static_cast<enum fuse_buf_copy_flags>(0));
+        if (copied < 0) {
+            fuse_reply_err(req, static_cast<int>(-copied));
+            return;
+        }
+        src = scratch.data();
+        n = static_cast<size_t>(copied);
+    }
+    ssize_t written = 0;
+    int rc = Ctx(req)->client->Write(fi->fh, src, n, off, written);
+    if (rc != 0) {
+        ReplyStatus(req, rc);
+        return;
+    }
+    fuse_reply_write(req, static_cast<size_t>(written));
+}
+
+void ll_flush(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    (void)ino;
+    ReplyStatus(req, Ctx(req)->client->Flush(fi->fh));
+}
+
+void ll_fsync(fuse_req_t req, fuse_ino_t ino, int datasync, struct fuse_file_info* fi) {
+    (void)ino;
+    (void)datasync;
+    ReplyStatus(req, Ctx(req)->client->Flush(fi->fh));
+}
+
+void ll_release(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    (void)ino;
+    ReplyStatus(req, Ctx(req)->client->Close(fi->fh));
+}
+
+void ll_opendir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    auto* ctx = Ctx(req);
+    std::string path;
+    if (!ctx->nodes.Path(ino, path)) {
+        fuse_reply_err(req, ENOENT);
+        return;
+    }
+    // The listing is taken once per opendir so readdir offsets stay stable.
+    auto* dir = new DirHandle();
+    int rc = ctx->client->ReadDir(path, dir, CollectName);
+    if (rc != 0) {
+        delete dir;
+        ReplyStatus(req, rc);
+        return;
+    }
+    fi->fh = reinterpret_cast<uint64_t>(dir);
+    if (fuse_reply_open(req, fi) == -ENOENT) {
+        delete dir;
+    }
+}
+
+void ll_readdir(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off, struct fuse_file_info* fi) {
+    (void)ino;
+    auto* dir = reinterpret_cast<DirHandle*>(fi->fh);
+    std::vector<char> buf(size);
+    size_t used = 0;
+    struct stat st;
+    std::memset(&st, 0, sizeof(st));
+    st.st_ino = static_cast<ino_t>(0xffffffffu);  // unknown; the kernel looks it up
+    for (size_t i = static_cast<size_t>(off); i < dir->names.size(); ++i) {
+        size_t need = fuse_add_direntry(req, buf.data() + used, size - used, dir->names[i].c_str(),
+                                        &st, static_cast<off_t>(i + 1));
+        if (need > size - used) {
+            break;
+        }
+        used += need;
+    }
+    fuse_reply_buf(req, buf.data(), used);
+}
+
+void ll_releasedir(fuse_req_t req, fuse_ino_t ino, struct fuse_file_info* fi) {
+    (void)ino;
+    delete reinterpret_cast<DirHandle*>(fi->fh);
+    fuse_reply_err(req, 0);
+}
+
+struct fuse_lowlevel_ops BuildLowLevelOps() {
+    struct fuse_lowlevel_ops ops {};
+    ops.init = ll_init;
+    ops.lookup = ll_lookup;
+    ops.forget = ll_forget;
+    ops.forget_multi = ll_forget_multi;
+    ops.getattr = ll_getattr;
+    ops.setattr = ll_setattr;
+    ops.mknod = ll_mknod;
+    ops.mkdir = ll_mkdir;
+    ops.unlink = ll_unlink;
+    ops.rmdir = ll_rmdir;
+    ops.open = ll_open;
+    ops.create = ll_create;
+    ops.read = ll_read;
+    ops.write_buf = ll_write_buf;
+    ops.flush = ll_flush;
+    ops.fsync = ll_fsync;
+    ops.release = ll_release;
+    ops.opendir = ll_opendir;
+    ops.readdir = ll_readdir;
+    ops.releasedir = ll_releasedir;
+    return ops;
+}
+
+} // namespace
+
+int RunLowLevelMount(int argc, char* argv[], DfsClient* client, int threads) {
+    struct fuse_args args = FUSE_ARGS_INIT(argc, argv);
+    char* mountpoint = nullptr;
+    int multithreaded = 0;
+    int foreground = 0;
+    if (fuse_parse_cmdline(&args, &mountpoint, &multithreaded, &foreground) == -1) {
+        fuse_opt_free_args(&args);
+        return 1;
+    }
+    struct fuse_chan* ch = fuse_mount(mountpoint, &args);
+    if (!ch) {
+        std::fprintf(stderr, "[Fuse] mount failed at %s\n", mountpoint ? mountpoint : "(null)");
+        std::free(mountpoint);
+        fuse_opt_free_args(&args);
+        return 1;
+    }
+
+    LowLevelContext ctx;
+    ctx.client = client;
+    struct fuse_lowlevel_ops ops = BuildLowLevelOps();
+    int rc = -1;
+    struct fuse_session* se = fuse_lowlevel_new(&args, &ops, sizeof(ops), &ctx);
+    if (se) {
+        if (fuse_set_signal_handlers(se) == 0) {
+            fuse_session_add_chan(se, ch);
+            if (fuse_daemonize(foreground) == 0) {
+                // "-s" on the command line still forces a single thread.
+                rc = RunFuseSession(se, multithreaded ? threads : 1);
+            }
+            fuse_remove_signal_handlers(se);
+            fuse_session_remove_chan(ch);
+        }
+        fuse_session_destroy(se);
+    }
+    fuse_unmount(mountpoint, ch);
+    std::free(mountpoint);
+    fuse_opt_free_args(&args);
+    return rc == 0 ? 0 : 1;
+}
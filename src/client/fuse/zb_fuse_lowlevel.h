@@ -0,0 +1,8 @@
+#pragma once
+
+class DfsClient;
+
+// Mounts with the inode-based low-level FUSE API and serves requests with
+// `threads` workers until unmount. argv holds the usual FUSE command line
+// (program name, mount point, -o options, -f/-s). Returns the process exit code.
+int RunLowLevelMount(int argc, char* argv[], DfsClient* client, int threads);
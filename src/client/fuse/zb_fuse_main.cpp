@@ -14,6 +14,8 @@
 #include "client/mount/DfsClient.h"
 #include "client/mount/MountConfig.h"
 #include "common/LogRedirect.h"
+#include "zb_fuse_lowlevel.h"
+#include "zb_fuse_session.h"
 
 DEFINE_string(mds_addr, "127.0.0.1:9000", "MDS service address");
 DEFINE_string(srm_addr, "127.0.0.1:9100", "SRM Gateway service address");
@@ -22,6 +24,23 @@ DEFINE_string(mount_point, "/mnt/zbstorage", "Mount point");
 DEFINE_bool(allow_other, false, "Pass -o allow_other to FUSE so non-root users can access");
 DEFINE_bool(foreground, false, "Run FUSE in foreground (pass -f)");
 DEFINE_string(log_file, "", "Log file path (append). Empty = stdout/stderr");
+DEFINE_bool(direct_data_path, true, "Send chunk I/O directly to real storage nodes instead of via the SRM gateway");
+DEFINE_int32(node_cache_ttl_ms, 5000, "How long the cached node endpoint table is used before re-checking SRM");
+DEFINE_uint64(readahead_max_kb, 8192, "Maximum sequential read-ahead window per open file in KiB (0 = off)");
+DEFINE_uint64(page_cache_mb, 256, "Client page cache size for read-ahead data in MiB");
+DEFINE_int32(readahead_threads, 4, "Prefetch worker threads");
+DEFINE_uint64(write_behind_kb, 8192, "Per-handle write-behind buffer in KiB (0 = write through)");
+DEFINE_uint64(write_behind_inflight, 4, "Outstanding write-behind flushes per handle");
+DEFINE_int32(write_behind_threads, 4, "Write-behind flush worker threads");
+DEFINE_int32(ec_data, -1, "Erasure code data fragments for files created here (-1 = MDS default, 0 = off)");
+DEFINE_int32(ec_parity, 2, "Erasure code parity fragments for files created here");
+DEFINE_int32(replicas, 0, "Copies of each chunk for files created here (0 = MDS default)");
+DEFINE_int32(fuse_threads, 8, "FUSE request worker threads (1 = single-threaded loop)");
+DEFINE_int32(max_read, 131072, "Largest read request the kernel may send, in bytes");
+DEFINE_int32(max_write, 131072, "Largest write request the kernel may send, in bytes");
+DEFINE_bool(big_writes, true, "Allow writes larger than one page per request (-o big_writes)");
+DEFINE_bool(fuse_lowlevel, true,
+            "Use the inode-based low-level FUSE API (zero-copy reads); false = path-based high-level API");
 
 namespace {
 
@@ -42,26 +61,26 @@ int fuse_readdir_cb(const char* path, void* buf, fuse_fill_dir_t filler,
 
 int fuse_open_cb(const char* path, struct fuse_file_info* fi) {
     if (!g_client) return -ECOMM;
-    int fd = -1;
+    uint64_t fh = 0;
     int rc = 0;
     // Fallback: some fuse versions call open with O_CREAT instead of create callback.
     if ((fi->flags & O_CREAT) != 0) {
-        rc = g_client->Create(path, fi->flags, 0644, fd);
+        rc = g_client->Create(path, fi->flags, 0644, fh);
     } else {
-        rc = g_client->Open(path, fi->flags, fd);
+        rc = g_client->Open(path, fi->flags, fh);
     }
     if (rc == 0) {
-        fi->fh = static_cast<uint64_t>(fd);
+        fi->fh = fh;
     }
     return rc;
 }
 
 int fuse_create_cb(const char* path, mode_t mode, struct fuse_file_info* fi) {
     if (!g_client) return -ECOMM;
-    int fd = -1;
-    int rc = g_client->Create(path, fi->flags, mode, fd);
+    uint64_t fh = 0;
+    int rc = g_client->Create(path, fi->flags, mode, fh);
     if (rc == 0) {
-        fi->fh = static_cast<uint64_t>(fd);
+        fi->fh = fh;
     }
     return rc;
 }
@@ -70,10 +89,10 @@ int fuse_mknod_cb(const char* path, mode_t mode, dev_t rdev) {
     (void)rdev;
     if (!g_client) return -ECOMM;
     if (S_ISREG(mode)) {
-        int fd = -1;
-        int rc = g_client->Create(path, O_CREAT | O_WRONLY, mode, fd);
+        uint64_t fh = 0;
+        int rc = g_client->Create(path, O_CREAT | O_WRONLY, mode, fh);
         if (rc == 0) {
-            g_client->Close(fd);
+            g_client->Close(fh);
         }
         return rc;
     }
@@ -117,7 +136,7 @@ int fuse_read_cb(const char* path, char* buf, size_t size, off_t offset,
     (void)path;
     if (!g_client) return -ECOMM;
     ssize_t bytes = 0;
-    int rc = g_client->Read(static_cast<int>(fi->fh), buf, size, offset, bytes);
+    int rc = g_client->Read(fi->fh, buf, size, offset, bytes);
     if (rc != 0) return rc;
     return static_cast<int>(bytes);
 }
@@ -127,7 +146,7 @@ int fuse_write_cb(const char* path, const char* buf, size_t size, off_t offset,
     (void)path;
     if (!g_client) return -ECOMM;
     ssize_t bytes = 0;
-    int rc = g_client->Write(static_cast<int>(fi->fh), buf, size, offset, bytes);
+    int rc = g_client->Write(fi->fh, buf, size, offset, bytes);
     if (rc != 0) return rc;
     return static_cast<int>(bytes);
 }
@@ -135,20 +154,20 @@ int fuse_write_cb(const char* path, const char* buf, size_t size, off_t offset,
 int fuse_release_cb(const char* path, struct fuse_file_info* fi) {
     (void)path;
     if (!g_client) return -ECOMM;
-    return g_client->Close(static_cast<int>(fi->fh));
+    return g_client->Close(fi->fh);
 }
 
 int fuse_flush_cb(const char* path, struct fuse_file_info* fi) {
     (void)path;
-    (void)fi;
-    return 0;
+    if (!g_client) return -ECOMM;
+    return g_client->Flush(fi->fh);
 }
 
 int fuse_fsync_cb(const char* path, int isdatasync, struct fuse_file_info* fi) {
     (void)path;
     (void)isdatasync;
-    (void)fi;
-    return 0;
+    if (!g_client) return -ECOMM;
+    return g_client->Flush(fi->fh);
 }
 
 struct fuse_operations BuildFuseOps() {
@@ -186,6 +205,17 @@ int main(int argc, char* argv[]) {
     cfg.srm_addr = FLAGS_srm_addr;
     cfg.mount_point = FLAGS_mount_point;
     cfg.default_node_id = FLAGS_node_id;
+    cfg.direct_data_path = FLAGS_direct_data_path;
+    cfg.node_cache_ttl_ms = FLAGS_node_cache_ttl_ms;
+    cfg.readahead_max_kb = FLAGS_readahead_max_kb;
+    cfg.page_cache_mb = FLAGS_page_cache_mb;
+    cfg.readahead_threads = FLAGS_readahead_threads;
+    cfg.write_behind_kb = FLAGS_write_behind_kb;
+    cfg.write_behind_inflight = FLAGS_write_behind_inflight;
+    cfg.write_behind_threads = FLAGS_write_behind_threads;
+    cfg.ec_data = FLAGS_ec_data;
+    cfg.ec_parity = FLAGS_ec_parity;
+    cfg.replicas = FLAGS_replicas;
     g_client = std::make_shared<DfsClient>(cfg);
     if (!g_client->Init()) {
         std::fprintf(stderr, "Failed to initialize DFS client (mds=%s srm=%s)\n",
@@ -201,17 +231,40 @@ int main(int argc, char* argv[]) {
 
     // Build FUSE argv. Always pass program name and mount point.
     // Optionally pass "-o allow_other" and "-f" (foreground) when enabled.
+    std::string mount_opts = "max_read=" + std::to_string(FLAGS_max_read) +
+                             ",max_write=" + std::to_string(FLAGS_max_write);
+    if (FLAGS_big_writes) {
+        mount_opts += ",big_writes";
+    }
+    if (FLAGS_allow_other) {
+        mount_opts += ",allow_other";
+    }
     char* fuse_argv[6];
     fuse_argv[0] = argv[0];
     fuse_argv[1] = const_cast<char*>(cfg.mount_point.c_str());
     int fuse_argc = 2;
-    if (FLAGS_allow_other) {
-        fuse_argv[fuse_argc++] = const_cast<char*>("-o");
-        fuse_argv[fuse_argc++] = const_cast<char*>("allow_other");
-    }
+    fuse_argv[fuse_argc++] = const_cast<char*>("-o");
+    fuse_argv[fuse_argc++] = const_cast<char*>(mount_opts.c_str());
     if (FLAGS_foreground) {
         fuse_argv[fuse_argc++] = const_cast<char*>("-f");
     }
 
-    return fuse_main(fuse_argc, fuse_argv, &ops, nullptr);
+    if (FLAGS_fuse_lowlevel) {
+        int rc = RunLowLevelMount(fuse_argc, fuse_argv, g_client.get(), FLAGS_fuse_threads);
+        g_client.reset();
+        return rc;
+    }
+
+    char* mountpoint = nullptr;
+    int multithreaded = 0;
+    struct fuse* fuse =
+        fuse_setup(fuse_argc, fuse_argv, &ops, sizeof(ops), &mountpoint, &multithreaded, nullptr);
+    if (!fuse) {
+        return 1;
+    }
+    // "-s" on the command line still forces a single thread.
+    int rc = RunFuseSession(fuse_get_session(fuse), multithreaded ? FLAGS_fuse_threads : 1);
+    fuse_teardown(fuse, mountpoint);
+    g_client.reset();
+    return rc == 0 ? 0 : 1;
 }
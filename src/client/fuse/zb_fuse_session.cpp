@@ -0,0 +1,111 @@
+#define FUSE_USE_VERSION 29
+#include "zb_fuse_session.h"
+
+#include <fuse.h>
+#include <fuse_lowlevel.h>
+#include <pthread.h>
+#include <signal.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct FuseWorkerPool {
+    struct fuse_session* se{nullptr};
+    struct fuse_chan* ch{nullptr};
+    std::mutex mu;
+    std::condition_variable cv;
+    int running{0};
+};
+
+void* FuseWorker(void* arg) {
+    auto* pool = static_cast<FuseWorkerPool*>(arg);
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
+    const size_t bufsize = fuse_chan_bufsize(pool->ch);
+    std::vector<char> mem(bufsize);
+    while (!fuse_session_exited(pool->se)) {
+        struct fuse_chan* ch = pool->ch;
+        struct fuse_buf fbuf {};
+        fbuf.mem = mem.data();
+        fbuf.size = bufsize;
+        // Only the blocking receive is a cancellation point; a request that
+        // has been read is always answered.
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
+        int res = fuse_session_receive_buf(pool->se, &fbuf, &ch);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
+        if (res == -EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            if (res < 0) {
+                fuse_session_exit(pool->se);
+            }
+            break;
+        }
+        fuse_session_process_buf(pool->se, &fbuf, ch);
+    }
+    {
+        std::lock_guard<std::mutex> lk(pool->mu);
+        --pool->running;
+    }
+    pool->cv.notify_all();
+    return nullptr;
+}
+
+} // namespace
+
+int RunFuseSession(struct fuse_session* se, int threads) {
+    if (threads <= 1) {
+        return fuse_session_loop(se) == 0 ? 0 : -1;
+    }
+    FuseWorkerPool pool;
+    pool.se = se;
+    pool.ch = fuse_session_next_chan(se, nullptr);
+
+    // Workers start with signals blocked so SIGINT/SIGTERM reach this thread,
+    // whose handler (installed by the caller) marks the session exited.
+    sigset_t all;
+    sigset_t old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    std::vector<pthread_t> workers;
+    workers.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        pthread_t tid;
+        {
+            std::lock_guard<std::mutex> lk(pool.mu);
+            ++pool.running;
+        }
+        if (pthread_create(&tid, nullptr, FuseWorker, &pool) != 0) {
+            std::lock_guard<std::mutex> lk(pool.mu);
+            --pool.running;
+            std::fprintf(stderr, "[Fuse] failed to start worker %d\n", i);
+            break;
+        }
+        workers.push_back(tid);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    if (workers.empty()) {
+        return -1;
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(pool.mu);
+        while (pool.running > 0 && !fuse_session_exited(se)) {
+            pool.cv.wait_for(lk, std::chrono::seconds(1));
+        }
+    }
+    for (pthread_t tid : workers) {
+        pthread_cancel(tid);
+    }
+    for (pthread_t tid : workers) {
+        pthread_join(tid, nullptr);
+    }
+    fuse_session_reset(se);
+    return 0;
+}
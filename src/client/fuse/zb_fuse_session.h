@@ -0,0 +1,9 @@
+#pragma once
+
+struct fuse_session;
+
+// Serves requests on an already mounted session until it exits or is
+// unmounted. threads <= 1 uses libfuse's single-threaded loop; otherwise a
+// fixed pool of that many workers reads the channel (FUSE 2.9's
+// fuse_loop_mt() sizes its pool on its own). Returns 0 on a clean exit.
+int RunFuseSession(struct fuse_session* se, int threads);
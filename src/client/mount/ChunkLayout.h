@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Client-side view of a file's FileLayout (see mds.proto): fixed-size chunks
+// striped round-robin over node_ids. chunk_size == 0 describes a file created
+// before striping, stored as a single chunk whose id is the inode number.
+//
+// Erasure-coded files (ec_data = k, ec_parity = m) are cut into rows of k
+// cells of ec_cell bytes. Row r is stored at offset (r % RowsPerChunk()) *
+// ec_cell of the k data and m parity fragment chunks of chunk group
+// r / RowsPerChunk(); fragment i of group g is chunk index g * (k + m) + i on
+// node_ids[(g + i) % node_ids.size()], so parity rotates across nodes.
+//
+// Replicated files (replicas > 1, not erasure coded) keep chunk i on its
+// primary node_ids[i % N] and on the replicas - 1 nodes after it.
+struct ChunkLayout {
+    uint64_t chunk_size{0};
+    std::vector<std::string> node_ids;
+    uint32_t ec_data{0};
+    uint32_t ec_parity{0};
+    uint64_t ec_cell{0};
+    uint32_t replicas{0};
+
+    // Top bit tags striped chunk ids so they never collide with legacy ids (== inode).
+    // The remaining 63 bits hold the inode above a kIndexBits-bit chunk index.
+    static constexpr uint64_t kStripedTag = 1ULL << 63;
+    static constexpr unsigned kIndexBits = 24;
+    static constexpr unsigned kInodeBits = 63 - kIndexBits;
+
+    // One contiguous piece of a file range that falls inside a single chunk.
+    struct Piece {
+        uint64_t chunk_index{0};
+        uint64_t chunk_id{0};
+        uint64_t chunk_offset{0};  // offset inside the chunk
+        uint64_t file_offset{0};
+        size_t length{0};
+        std::string node_id;
+    };
+
+    bool striped() const { return chunk_size > 0 && !node_ids.empty(); }
+    bool erasure_coded() const {
+        return striped() && ec_data > 0 && ec_parity > 0 && ec_cell > 0 &&
+               chunk_size % ec_cell == 0 && node_ids.size() >= ec_data + ec_parity;
+    }
+
+    bool replicated() const { return striped() && !erasure_coded() && replicas > 1; }
+
+    // Nodes holding chunk_index, primary first.
+    std::vector<std::string> Replicas(uint64_t chunk_index) const {
+        const size_t n = node_ids.size();
+        const size_t copies = replicated() ? std::min<size_t>(replicas, n) : 1;
+        std::vector<std::string> out;
+        if (n == 0) {
+            return out;
+        }
+        out.reserve(copies);
+        for (size_t r = 0; r < copies; ++r) {
+            out.push_back(node_ids[(chunk_index + r) % n]);
+        }
+        return out;
+    }
+
+    uint32_t EcWidth() const { return ec_data + ec_parity; }
+    uint64_t RowBytes() const { return ec_cell * ec_data; }
+    uint64_t RowsPerChunk() const { return chunk_size / ec_cell; }
+
+    // Fragment i (i < ec_data: data column i, else parity i - ec_data) of the
+    // chunk group holding row, positioned at the row's offset in the chunk.
+    Piece Fragment(uint64_t inode, uint64_t row, uint32_t i) const {
+        const uint64_t group = row / RowsPerChunk();
+        Piece p;
+        p.chunk_index = group * EcWidth() + i;
+        p.chunk_id = ChunkId(inode, p.chunk_index);
+        p.chunk_offset = (row % RowsPerChunk()) * ec_cell;
+        p.length = static_cast<size_t>(ec_cell);
+        p.node_id = node_ids[(group + i) % node_ids.size()];
+        return p;
+    }
+
+    // Bytes fragment i of chunk group `group` holds for a file of file_size
+    // bytes; parity covers the longest data column of each row.
+    uint64_t FragmentLength(uint64_t group, uint32_t i, uint64_t file_size) const {
+        const uint64_t rows = RowsPerChunk();
+        const uint64_t end_row = file_size / RowBytes();
+        const uint64_t rem = file_size % RowBytes();
+        if (end_row < group * rows) {
+            return 0;
+        }
+        if (end_row >= (group + 1) * rows) {
+            return chunk_size;
+        }
+        const uint64_t full = (end_row - group * rows) * ec_cell;
+        const uint64_t col_start = i < ec_data ? i * ec_cell : 0;
+        const uint64_t partial = rem > col_start ? std::min(rem - col_start, ec_cell) : 0;
+        return full + partial;
+    }
+
+    static bool ChunkIdFits(uint64_t inode, uint64_t index) {
+        return (inode >> kInodeBits) == 0 && (index >> kIndexBits) == 0;
+    }
+
+    static uint64_t ChunkId(uint64_t inode, uint64_t index) {
+        assert(ChunkIdFits(inode, index));
+        return kStripedTag | (inode << kIndexBits) | index;
+    }
+
+    // Whether every chunk holding bytes of [0, end) has a distinct chunk id; past
+    // that the file is too large for its layout (EFBIG).
+    bool Addressable(uint64_t inode, uint64_t end) const {
+        if (!striped()) {
+            return true;
+        }
+        if (end == 0) {
+            return ChunkIdFits(inode, 0);
+        }
+        uint64_t last_index = (end - 1) / chunk_size;
+        if (erasure_coded()) {
+            const uint64_t group = (end - 1) / RowBytes() / RowsPerChunk();
+            last_index = group * EcWidth() + EcWidth() - 1;
+        }
+        return ChunkIdFits(inode, last_index);
+    }
+
+    // Splits [offset, offset + length) into per-chunk pieces, in file order.
+    // fallback_node is used for legacy single-chunk files. Returns no pieces when
+    // the range is not Addressable.
+    std::vector<Piece> Split(uint64_t inode, uint64_t offset, size_t length,
+                             const std::string& fallback_node) const {
+        std::vector<Piece> pieces;
+        if (length == 0 || !Addressable(inode, offset + length)) {
+            return pieces;
+        }
+        if (!striped()) {
+            pieces.push_back(Piece{0, inode, offset, offset, length, fallback_node});
+            return pieces;
+        }
+        uint64_t pos = offset;
+        const uint64_t end = offset + length;
+        if (erasure_coded()) {
+            // One piece per data cell.
+            while (pos < end) {
+                const uint64_t row = pos / RowBytes();
+                const uint64_t in_row = pos % RowBytes();
+                const uint64_t in_cell = in_row % ec_cell;
+                const uint64_t take = std::min<uint64_t>(ec_cell - in_cell, end - pos);
+                Piece p = Fragment(inode, row, static_cast<uint32_t>(in_row / ec_cell));
+                p.chunk_offset += in_cell;
+                p.file_offset = pos;
+                p.length = static_cast<size_t>(take);
+                pieces.push_back(std::move(p));
+                pos += take;
+            }
+            return pieces;
+        }
+        while (pos < end) {
+            const uint64_t index = pos / chunk_size;
+            const uint64_t in_chunk = pos % chunk_size;
+            const uint64_t take = std::min<uint64_t>(chunk_size - in_chunk, end - pos);
+            pieces.push_back(Piece{index, ChunkId(inode, index), in_chunk, pos,
+                                   static_cast<size_t>(take),
+                                   node_ids[index % node_ids.size()]});
+            pos += take;
+        }
+        return pieces;
+    }
+};
@@ -1,5 +1,6 @@
 #include "DfsClient.h"
 
+#include <brpc/callback.h>
 #include <brpc/controller.h>
 #include <algorithm>
 #include <cstring>
@@ -9,8 +10,79 @@
 #include "mds.pb.h"
 #include "storage_node.pb.h"
 
+namespace {
+
+// Chunk calls carry `direct` (the NodeRouter stub they were sent on, if any).
+// Calls whose direct attempt failed in transport are re-sent through the SRM
+// gateway, which also covers a node that moved since the table was fetched.
+template <typename Call, typename Issue>
+void RetryFailedDirect(std::vector<std::unique_ptr<Call>>& calls, NodeRouter* router,
+                       storagenode::StorageService_Stub* gateway, Issue&& issue) {
+    std::vector<Call*> retried;
+    for (auto& call : calls) {
+        if (!call->direct || !call->cntl.Failed()) {
+            continue;
+        }
+        std::cerr << "[Client] direct call to node " << call->req.node_id()
+                  << " failed, retrying via SRM: " << call->cntl.ErrorText() << std::endl;
+        router->Invalidate(call->req.node_id());
+        call->direct.reset();
+        issue(call.get(), gateway);
+        retried.push_back(call.get());
+    }
+    for (auto* call : retried) {
+        brpc::Join(call->cntl.call_id());
+    }
+}
+
+} // namespace
+
 DfsClient::DfsClient(MountConfig cfg)
-    : cfg_(std::move(cfg)), rpc_(std::make_unique<RpcClients>(cfg_)) {}
+    : cfg_(std::move(cfg)),
+      rpc_(std::make_unique<RpcClients>(cfg_)),
+      router_(std::make_unique<NodeRouter>(cfg_, rpc_.get())) {
+    if (cfg_.readahead_max_kb > 0 && cfg_.page_cache_mb > 0) {
+        ReadAhead::Options opts;
+        opts.max_window = cfg_.readahead_max_kb * 1024;
+        opts.cache_bytes = cfg_.page_cache_mb << 20;
+        opts.threads = cfg_.readahead_threads;
+        readahead_ = std::make_unique<ReadAhead>(
+            opts, [this](const InodeInfo& info, uint64_t offset, size_t len, char* buf, size_t& got) {
+                return FetchRange(info, offset, len, true, buf, got);
+            });
+    }
+    if (cfg_.write_behind_kb > 0) {
+        WriteBehind::Options opts;
+        opts.buffer_bytes = cfg_.write_behind_kb * 1024;
+        opts.max_inflight = cfg_.write_behind_inflight;
+        opts.threads = cfg_.write_behind_threads;
+        write_behind_ = std::make_unique<WriteBehind>(
+            opts,
+            [this](const InodeInfo& info, uint64_t offset, const char* data, size_t len) {
+                size_t written = 0;
+                int rc = WriteRange(info, offset, data, len, written);
+                return rc != 0 ? rc : (written == len ? 0 : -EIO);
+            },
+            [this](uint64_t inode, uint64_t size) {
+                auto code = UpdateRemoteSize(inode, size);
+                if (code != rpc::STATUS_SUCCESS) {
+                    std::cerr << "[Client] UpdateFileSize failed inode=" << inode
+                              << " code=" << static_cast<int>(code) << std::endl;
+                    return -StatusToErrno(code);
+                }
+                return 0;
+            });
+    }
+}
+
+DfsClient::~DfsClient() {
+    // Normally FUSE has released every handle by now; push out whatever is left.
+    if (write_behind_) {
+        for (auto& state : inodes_.Snapshot()) {
+            write_behind_->FlushInode(state->wb);
+        }
+    }
+}
 
 bool DfsClient::Init() {
     return rpc_->Init();
@@ -79,6 +151,16 @@ rpc::StatusCode DfsClient::LookupInode(const std::string& path, InodeInfo& out_i
         return rpc::STATUS_NETWORK_ERROR;
     }
     out_info.node_id = !resp.node_id().empty() ? resp.node_id() : resp.volume_id();
+    out_info.layout = ChunkLayout{};
+    if (resp.has_layout() && resp.layout().chunk_size() > 0) {
+        out_info.layout.chunk_size = resp.layout().chunk_size();
+        out_info.layout.node_ids.assign(resp.layout().node_ids().begin(),
+                                        resp.layout().node_ids().end());
+        out_info.layout.ec_data = resp.layout().ec_data();
+        out_info.layout.ec_parity = resp.layout().ec_parity();
+        out_info.layout.ec_cell = resp.layout().ec_cell_size();
+        out_info.layout.replicas = resp.layout().replicas();
+    }
     return rpc::STATUS_SUCCESS;
 }
 
@@ -125,10 +207,9 @@ int DfsClient::GetAttr(const std::string& path, struct stat* st) {
     }
     if (!PopulateStat(st, is_dir)) return -EIO;
     if (!is_dir) {
-        std::lock_guard<std::mutex> lk(mu_);
-        auto it = inode_size_.find(info.inode);
-        if (it != inode_size_.end()) {
-            st->st_size = static_cast<off_t>(it->second);
+        auto state = inodes_.Find(info.inode);
+        if (state && state->has_size.load(std::memory_order_acquire)) {
+            st->st_size = static_cast<off_t>(state->size.load(std::memory_order_acquire));
         }
     }
     return 0;
@@ -157,28 +238,26 @@ int DfsClient::ReadDir(const std::string& path, void* buf, fuse_fill_dir_t fille
     return 0;
 }
 
-int DfsClient::Open(const std::string& path, int flags, int& out_fd) {
+int DfsClient::Open(const std::string& path, int flags, uint64_t& out_fh) {
     InodeInfo info;
     auto code = LookupInode(path, info);
     if (code != rpc::STATUS_SUCCESS) {
         if (code == rpc::STATUS_NODE_NOT_FOUND && (flags & O_CREAT) != 0) {
-            return Create(path, flags, 0644, out_fd);
+            return Create(path, flags, 0644, out_fh);
         }
         return -StatusToErrno(code);
     }
-    int fd = next_fd_++;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        fd_info_[fd] = info;
-        if (inode_size_.find(info.inode) == inode_size_.end()) {
-            inode_size_[info.inode] = 0;
-        }
+    auto* fh = new FileHandle();
+    fh->info = info;
+    fh->state = inodes_.GetOrCreate(info.inode);
+    if (write_behind_) {
+        write_behind_->Attach(fh->wb, fh->state->wb, info);
     }
-    out_fd = fd;
+    out_fh = reinterpret_cast<uint64_t>(fh);
     return 0;
 }
 
-int DfsClient::Create(const std::string& path, int flags, mode_t mode, int& out_fd) {
+int DfsClient::Create(const std::string& path, int flags, mode_t mode, uint64_t& out_fh) {
     if (!rpc_ || !rpc_->mds()) return -ECOMM;
     rpc::PathModeRequest creq;
     rpc::Status cresp;
@@ -186,6 +265,14 @@ int DfsClient::Create(const std::string& path, int flags, mode_t mode, int& out_
     ccntl.set_timeout_ms(cfg_.rpc_timeout_ms);
     creq.set_path(path);
     creq.set_mode(static_cast<uint32_t>(mode));
+    if (cfg_.ec_data >= 0) {
+        // Explicit per-mount choice; 0 asks for plain striping.
+        creq.mutable_layout()->set_ec_data(static_cast<uint32_t>(cfg_.ec_data));
+        creq.mutable_layout()->set_ec_parity(static_cast<uint32_t>(std::max(0, cfg_.ec_parity)));
+    }
+    if (cfg_.replicas > 0) {
+        creq.set_replicas(static_cast<uint32_t>(cfg_.replicas));
+    }
     rpc_->mds()->CreateFile(&ccntl, &creq, &cresp, nullptr);
     if (ccntl.Failed()) {
         std::cerr << "[Client] CreateFile RPC failed path=" << path << " err=" << ccntl.ErrorText() << std::endl;
@@ -198,7 +285,7 @@ int DfsClient::Create(const std::string& path, int flags, mode_t mode, int& out_
                   << " msg=" << cresp.message() << std::endl;
         return -StatusToErrno(ccode);
     }
-    return Open(path, flags, out_fd);
+    return Open(path, flags, out_fh);
 }
 
 int DfsClient::Mkdir(const std::string& path, mode_t mode) {
@@ -268,8 +355,14 @@ int DfsClient::Unlink(const std::string& path) {
         return -StatusToErrno(code);
     }
     if (had_inode) {
-        std::lock_guard<std::mutex> lk(mu_);
-        inode_size_.erase(info.inode);
+        auto state = inodes_.Find(info.inode);
+        inodes_.Erase(info.inode);
+        if (state && write_behind_) {
+            write_behind_->ResetInode(state->wb, 0);
+        }
+    }
+    if (had_inode && readahead_) {
+        readahead_->InvalidateInode(info.inode);
     }
     return 0;
 }
@@ -284,26 +377,115 @@ int DfsClient::Truncate(const std::string& path, off_t size) {
         return -StatusToErrno(code);
     }
 
-    storagenode::TruncateRequest treq;
-    storagenode::TruncateReply tresp;
-    brpc::Controller tcntl;
-    tcntl.set_timeout_ms(cfg_.rpc_timeout_ms);
-    const std::string& node_id = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
-    treq.set_node_id(node_id);
-    treq.set_chunk_id(static_cast<uint64_t>(info.inode));
-    treq.set_size(static_cast<uint64_t>(size));
-    rpc_->srm()->Truncate(&tcntl, &treq, &tresp, nullptr);
-    if (tcntl.Failed()) {
-        std::cerr << "[Client] Truncate SRM RPC failed path=" << path
-                  << " err=" << tcntl.ErrorText() << std::endl;
-        return -ECOMM;
+    auto state = inodes_.GetOrCreate(info.inode);
+    if (write_behind_) {
+        write_behind_->FlushInode(state->wb);
     }
-    auto tcode = StatusUtils::NormalizeCode(tresp.status().code());
-    if (tcode != rpc::STATUS_SUCCESS) {
-        std::cerr << "[Client] Truncate failed path=" << path
-                  << " code=" << static_cast<int>(tcode)
-                  << " msg=" << tresp.status().message() << std::endl;
-        return -StatusToErrno(tcode);
+    const uint64_t old_size =
+        state->has_size.load(std::memory_order_acquire) ? state->size.load(std::memory_order_acquire) : 0;
+
+    // (chunk, new length) pairs. Legacy files are one chunk; striped files only
+    // touch the chunk holding the new EOF and the chunks after it.
+    std::vector<std::pair<ChunkLayout::Piece, uint64_t>> targets;
+    const std::string& default_node = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
+    const uint64_t new_size = static_cast<uint64_t>(size);
+    if (!info.layout.Addressable(info.inode, std::max(old_size, new_size))) {
+        return -EFBIG;
+    }
+    if (!info.layout.striped()) {
+        ChunkLayout::Piece p;
+        p.chunk_id = info.inode;
+        p.node_id = default_node;
+        targets.emplace_back(p, new_size);
+    } else if (info.layout.erasure_coded()) {
+        if (new_size < old_size) {
+            // Every fragment of the chunk groups from the new EOF on is cut to
+            // what the new size leaves in it (see FragmentLength).
+            const ChunkLayout& layout = info.layout;
+            const uint64_t rows = layout.RowsPerChunk();
+            const uint64_t first = new_size / layout.RowBytes() / rows;
+            const uint64_t last = (old_size - 1) / layout.RowBytes() / rows;
+            for (uint64_t g = first; g <= last; ++g) {
+                for (uint32_t i = 0; i < layout.EcWidth(); ++i) {
+                    ChunkLayout::Piece p = layout.Fragment(info.inode, g * rows, i);
+                    targets.emplace_back(p, layout.FragmentLength(g, i, new_size));
+                }
+            }
+        }
+    } else if (new_size < old_size) {
+        const uint64_t cs = info.layout.chunk_size;
+        const uint64_t last = (old_size + cs - 1) / cs;
+        for (uint64_t idx = new_size / cs; idx < last; ++idx) {
+            ChunkLayout::Piece p;
+            p.chunk_index = idx;
+            p.chunk_id = ChunkLayout::ChunkId(info.inode, idx);
+            const uint64_t start = idx * cs;
+            // Every copy of a replicated chunk is cut.
+            for (auto& node : info.layout.Replicas(idx)) {
+                p.node_id = std::move(node);
+                targets.emplace_back(p, new_size > start ? new_size - start : 0);
+            }
+        }
+    }
+
+    struct PendingTruncate {
+        brpc::Controller cntl;
+        storagenode::TruncateRequest req;
+        storagenode::TruncateReply resp;
+        NodeRouter::StubPtr direct;
+    };
+    auto issue = [this](PendingTruncate* call, storagenode::StorageService_Stub* stub) {
+        call->cntl.Reset();
+        call->cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
+        stub->Truncate(&call->cntl, &call->req, &call->resp, brpc::DoNothing());
+    };
+    std::vector<std::unique_ptr<PendingTruncate>> calls;
+    calls.reserve(targets.size());
+    for (const auto& t : targets) {
+        auto call = std::make_unique<PendingTruncate>();
+        call->req.set_node_id(t.first.node_id);
+        call->req.set_chunk_id(t.first.chunk_id);
+        call->req.set_size(t.second);
+        call->direct = router_->Route(t.first.node_id);
+        issue(call.get(), call->direct ? call->direct.get() : rpc_->srm());
+        calls.push_back(std::move(call));
+    }
+    for (auto& call : calls) {
+        brpc::Join(call->cntl.call_id());
+    }
+    RetryFailedDirect(calls, router_.get(), rpc_->srm(), issue);
+    int rc = 0;
+    for (auto& call : calls) {
+        if (rc != 0) {
+            break;
+        }
+        if (call->cntl.Failed()) {
+            std::cerr << "[Client] Truncate SRM RPC failed path=" << path
+                      << " chunk=" << call->req.chunk_id()
+                      << " err=" << call->cntl.ErrorText() << std::endl;
+            rc = -ECOMM;
+            continue;
+        }
+        auto tcode = StatusUtils::NormalizeCode(call->resp.status().code());
+        if (tcode != rpc::STATUS_SUCCESS) {
+            std::cerr << "[Client] Truncate failed path=" << path
+                      << " chunk=" << call->req.chunk_id()
+                      << " code=" << static_cast<int>(tcode)
+                      << " msg=" << call->resp.status().message() << std::endl;
+            rc = -StatusToErrno(tcode);
+        }
+    }
+    if (rc == 0 && info.layout.erasure_coded() && new_size < old_size) {
+        // The row holding the new EOF lost the tail of some data cells; its
+        // parity must now treat those bytes as zeros.
+        const uint64_t rem = new_size % info.layout.RowBytes();
+        if (rem > 0) {
+            rc = RewriteParity(info, new_size / info.layout.RowBytes(),
+                               std::min(rem, info.layout.ec_cell));
+        }
+    }
+    if (rc != 0) {
+        return rc;
     }
 
     auto ucode = UpdateRemoteSize(info.inode, static_cast<uint64_t>(size));
@@ -312,117 +494,278 @@ int DfsClient::Truncate(const std::string& path, off_t size) {
                   << " code=" << static_cast<int>(ucode) << std::endl;
         return -StatusToErrno(ucode);
     }
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        inode_size_[info.inode] = static_cast<uint64_t>(size);
+    state->SetSize(static_cast<uint64_t>(size));
+    if (write_behind_) {
+        write_behind_->ResetInode(state->wb, static_cast<uint64_t>(size));
+    }
+    if (readahead_) {
+        readahead_->InvalidateInode(info.inode);
     }
     return 0;
 }
 
-int DfsClient::Read(int fd, char* buf, size_t size, off_t offset, ssize_t& out_bytes) {
+DfsClient::ReadPlan DfsClient::BeginRead(FileHandle& h, size_t size, off_t offset) {
+    InodeState& state = *h.state;
+    ReadPlan plan;
+    plan.has_size = state.has_size.load(std::memory_order_acquire);
+    plan.known_size = plan.has_size ? state.size.load(std::memory_order_acquire) : 0;
+    plan.len = size;
+    if (plan.has_size) {
+        const uint64_t pos = static_cast<uint64_t>(offset);
+        plan.len = pos >= plan.known_size
+                       ? 0
+                       : static_cast<size_t>(std::min<uint64_t>(plan.known_size - pos, size));
+    }
+    if (plan.len > 0 && write_behind_ && WriteBehind::HasDirty(state.wb)) {
+        write_behind_->FlushInode(state.wb);
+    }
+    return plan;
+}
+
+void DfsClient::EndRead(FileHandle& h, const ReadPlan& plan, off_t offset, size_t got) {
+    if (readahead_ && plan.has_size) {
+        readahead_->OnRead(h.ra, h.info, static_cast<uint64_t>(offset), got, plan.known_size);
+    }
+}
+
+int DfsClient::Read(uint64_t fh, char* buf, size_t size, off_t offset, ssize_t& out_bytes) {
     if (!rpc_ || !rpc_->srm()) return -ECOMM;
-    InodeInfo info;
-    uint64_t known_size = 0;
-    bool has_size = false;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        auto it = fd_info_.find(fd);
-        if (it == fd_info_.end()) return -EBADF;
-        info = it->second;
-        auto sit = inode_size_.find(info.inode);
-        if (sit != inode_size_.end()) {
-            known_size = sit->second;
-            has_size = true;
-        }
-    }
-    if (has_size && offset >= static_cast<off_t>(known_size)) {
+    auto* h = reinterpret_cast<FileHandle*>(fh);
+    if (!h) return -EBADF;
+    const InodeInfo& info = h->info;
+    const ReadPlan plan = BeginRead(*h, size, offset);
+    if (plan.len == 0) {
         out_bytes = 0;
         return 0;
     }
-    size_t req_len = size;
-    if (has_size) {
-        uint64_t remain = known_size - static_cast<uint64_t>(offset);
-        req_len = static_cast<size_t>(std::min<uint64_t>(remain, size));
+
+    size_t total = 0;
+    if (readahead_) {
+        total = readahead_->ReadCached(info.inode, static_cast<uint64_t>(offset), plan.len, buf);
+    }
+    if (total < plan.len) {
+        size_t got = 0;
+        int rc = FetchRange(info, static_cast<uint64_t>(offset) + total, plan.len - total,
+                            plan.has_size, buf + total, got);
+        if (rc != 0) {
+            return rc;
+        }
+        total += got;
     }
+    EndRead(*h, plan, offset, total);
+    out_bytes = static_cast<ssize_t>(total);
+    return 0;
+}
 
-    storagenode::ReadRequest req;
-    storagenode::ReadReply resp;
-    brpc::Controller cntl;
-    cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
-    const std::string& node_id = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
-    req.set_node_id(node_id);
-    req.set_chunk_id(static_cast<uint64_t>(info.inode));
-    req.set_offset(static_cast<uint64_t>(offset));
-    req.set_length(static_cast<uint64_t>(req_len));
-    rpc_->srm()->Read(&cntl, &req, &resp, nullptr);
-    if (cntl.Failed()) {
-        std::cerr << "[Client] Read RPC failed: " << cntl.ErrorText() << std::endl;
-        return -ECOMM;
+int DfsClient::ReadBuf(uint64_t fh, size_t size, off_t offset, butil::IOBuf* out) {
+    if (!rpc_ || !rpc_->srm()) return -ECOMM;
+    auto* h = reinterpret_cast<FileHandle*>(fh);
+    if (!h) return -EBADF;
+    const InodeInfo& info = h->info;
+    const ReadPlan plan = BeginRead(*h, size, offset);
+    if (plan.len == 0) {
+        return 0;
     }
-    auto code = StatusUtils::NormalizeCode(resp.status().code());
-    if (code != rpc::STATUS_SUCCESS) {
-        std::cerr << "[Client] Read failed fd=" << fd
-                  << " code=" << static_cast<int>(code)
-                  << " msg=" << resp.status().message() << std::endl;
-        return -StatusToErrno(code);
+
+    const size_t base = out->size();
+    size_t total = 0;
+    if (readahead_) {
+        total = readahead_->ReadCached(info.inode, static_cast<uint64_t>(offset), plan.len,
+                                       [out](const char* data, size_t n) { out->append(data, n); });
     }
-    out_bytes = static_cast<ssize_t>(resp.bytes_read());
-    if (out_bytes > 0 && static_cast<size_t>(out_bytes) <= size) {
-        std::memcpy(buf, resp.data().data(), static_cast<size_t>(out_bytes));
+    if (total < plan.len) {
+        int rc = FetchRange(info, static_cast<uint64_t>(offset) + total, plan.len - total,
+                            plan.has_size, out);
+        if (rc != 0) {
+            out->pop_back(out->size() - base);
+            return rc;
+        }
+        total = out->size() - base;
     }
+    EndRead(*h, plan, offset, total);
     return 0;
 }
 
-int DfsClient::Write(int fd, const char* buf, size_t size, off_t offset, ssize_t& out_bytes) {
-    if (!rpc_ || !rpc_->srm()) return -ECOMM;
-    InodeInfo info;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        auto it = fd_info_.find(fd);
-        if (it == fd_info_.end()) return -EBADF;
-        info = it->second;
+int DfsClient::FetchRange(const InodeInfo& info, uint64_t offset, size_t len, bool has_size,
+                          char* buf, size_t& out_bytes) {
+    butil::IOBuf data;
+    int rc = FetchRange(info, offset, len, has_size, &data);
+    out_bytes = rc == 0 ? data.copy_to(buf, len) : 0;
+    return rc;
+}
+
+int DfsClient::FetchRange(const InodeInfo& info, uint64_t offset, size_t len, bool has_size,
+                          butil::IOBuf* out) {
+    if (!info.layout.Addressable(info.inode, offset + len)) {
+        return -EFBIG;
+    }
+    // One RPC per chunk piece, all in flight at once so a striped file reads
+    // from every node in its stripe concurrently.
+    struct PendingRead {
+        brpc::Controller cntl;
+        storagenode::ReadRequest req;
+        storagenode::ReadReply resp;
+        ChunkLayout::Piece piece;
+        NodeRouter::StubPtr direct;
+        std::vector<std::string> replicas;  // replicated files only
+        size_t replica{0};
+    };
+    auto issue = [this](PendingRead* call, storagenode::StorageService_Stub* stub) {
+        call->cntl.Reset();
+        call->cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
+        stub->Read(&call->cntl, &call->req, &call->resp, brpc::DoNothing());
+    };
+    // Sends call to replicas[i] and waits for it, falling back to the gateway
+    // like RetryFailedDirect does.
+    auto reissue = [this, &issue](PendingRead* call, size_t i) {
+        call->replica = i;
+        call->piece.node_id = call->replicas[i];
+        call->req.set_node_id(call->piece.node_id);
+        call->resp.Clear();
+        call->direct = router_->Route(call->piece.node_id);
+        issue(call, call->direct ? call->direct.get() : rpc_->srm());
+        brpc::Join(call->cntl.call_id());
+        if (call->direct && call->cntl.Failed()) {
+            router_->Invalidate(call->piece.node_id);
+            call->direct.reset();
+            issue(call, rpc_->srm());
+            brpc::Join(call->cntl.call_id());
+        }
+    };
+    // 0 with got set, or the errno-style failure of the call. A striped chunk
+    // the node does not have is -ENOENT; whether that is a hole is decided by
+    // the caller once the other copies or fragments have been asked.
+    auto evaluate = [this, &info](PendingRead* call, size_t& got) {
+        got = 0;
+        if (call->cntl.Failed()) {
+            std::cerr << "[Client] Read RPC failed: " << call->cntl.ErrorText() << std::endl;
+            return -ECOMM;
+        }
+        auto code = StatusUtils::NormalizeCode(call->resp.status().code());
+        if (code == rpc::STATUS_SUCCESS) {
+            got = std::min<size_t>(static_cast<size_t>(call->resp.bytes_read()), call->piece.length);
+        } else if (code == rpc::STATUS_NODE_NOT_FOUND && info.layout.striped()) {
+            return -ENOENT;
+        } else {
+            std::cerr << "[Client] Read failed inode=" << info.inode
+                      << " chunk=" << call->req.chunk_id()
+                      << " node=" << call->req.node_id()
+                      << " code=" << static_cast<int>(code)
+                      << " msg=" << call->resp.status().message() << std::endl;
+            return -StatusToErrno(code);
+        }
+        return 0;
+    };
+    const std::string& default_node = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
+    auto pieces = info.layout.Split(info.inode, offset, len, default_node);
+    const bool replicated = info.layout.replicated();
+    std::vector<std::unique_ptr<PendingRead>> calls;
+    calls.reserve(pieces.size());
+    for (auto& piece : pieces) {
+        auto call = std::make_unique<PendingRead>();
+        if (replicated) {
+            // Read each chunk from whichever copy is expected to answer first.
+            call->replicas = info.layout.Replicas(piece.chunk_index);
+            call->replica = router_->PickReplica(call->replicas);
+            piece.node_id = call->replicas[call->replica];
+        }
+        call->req.set_node_id(piece.node_id);
+        call->req.set_chunk_id(piece.chunk_id);
+        call->req.set_offset(piece.chunk_offset);
+        call->req.set_length(static_cast<uint64_t>(piece.length));
+        call->req.set_attachment(true);
+        call->piece = std::move(piece);
+        call->direct = router_->Route(call->piece.node_id);
+        issue(call.get(), call->direct ? call->direct.get() : rpc_->srm());
+        calls.push_back(std::move(call));
     }
+    for (auto& call : calls) {
+        brpc::Join(call->cntl.call_id());
+    }
+    RetryFailedDirect(calls, router_.get(), rpc_->srm(), issue);
 
-    storagenode::WriteRequest req;
-    storagenode::WriteReply resp;
-    brpc::Controller cntl;
-    cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
-    const std::string& node_id = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
-    req.set_node_id(node_id);
-    req.set_chunk_id(static_cast<uint64_t>(info.inode));
-    req.set_offset(static_cast<uint64_t>(offset));
-    req.set_data(buf, size);
-    req.set_checksum(0);
-    req.set_flags(0);
-    req.set_mode(0644);
-
-    rpc_->srm()->Write(&cntl, &req, &resp, nullptr);
-    if (cntl.Failed()) {
-        std::cerr << "[Client] Write RPC failed: " << cntl.ErrorText() << std::endl;
-        return -ECOMM;
+    // Within a known file size, missing chunks and short chunks are holes.
+    // Without one, the first short piece is EOF.
+    for (auto& call : calls) {
+        size_t got = 0;
+        int err = evaluate(call.get(), got);
+        if (replicated) {
+            if (err == 0) {
+                router_->ObserveLatency(call->piece.node_id, call->cntl.latency_us());
+            }
+            // Fail over to the other copies, one at a time. The chunk is a hole
+            // only when every copy reports it missing.
+            bool all_missing = err == -ENOENT;
+            const size_t first = call->replica;
+            for (size_t step = 1; err != 0 && step < call->replicas.size(); ++step) {
+                reissue(call.get(), (first + step) % call->replicas.size());
+                err = evaluate(call.get(), got);
+                all_missing = all_missing && err == -ENOENT;
+            }
+            if (err != 0 && all_missing) {
+                err = 0;
+            }
+        } else if (err == -ENOENT && !info.layout.erasure_coded()) {
+            // Single copy: a chunk that was never written is a hole.
+            err = 0;
+        }
+        if (err != 0) {
+            if (!info.layout.erasure_coded()) {
+                return err;
+            }
+            // Degraded read: rebuild the cell from the rest of its row.
+            std::vector<char> cell(call->piece.length);
+            int rc = ReconstructPiece(info, call->piece, cell.data());
+            if (rc != 0) {
+                return rc;
+            }
+            out->append(cell.data(), cell.size());
+            continue;
+        }
+        if (got > 0) {
+            // The payload arrives as the response attachment; share its blocks
+            // instead of copying them.
+            const butil::IOBuf& payload = call->cntl.response_attachment();
+            if (!payload.empty()) {
+                payload.append_to(out, got);
+            } else {
+                out->append(call->resp.data().data(), got);
+            }
+        }
+        if (got < call->piece.length) {
+            if (!has_size) {
+                break;
+            }
+            out->resize(out->size() + (call->piece.length - got));
+        }
     }
-    auto code = StatusUtils::NormalizeCode(resp.status().code());
-    if (code != rpc::STATUS_SUCCESS) {
-        std::cerr << "[Client] Write failed fd=" << fd
-                  << " code=" << static_cast<int>(code)
-                  << " msg=" << resp.status().message() << std::endl;
-        return -StatusToErrno(code);
+    return 0;
+}
+
+int DfsClient::Write(uint64_t fh, const char* buf, size_t size, off_t offset, ssize_t& out_bytes) {
+    if (!rpc_ || !rpc_->srm()) return -ECOMM;
+    auto* h = reinterpret_cast<FileHandle*>(fh);
+    if (!h) return -EBADF;
+    const InodeInfo& info = h->info;
+
+    size_t written = 0;
+    if (write_behind_) {
+        // Buffered: data and the MDS size go out when the buffer is flushed.
+        int rc = write_behind_->Write(h->wb, buf, size, static_cast<uint64_t>(offset));
+        if (rc != 0) {
+            return rc;
+        }
+        written = size;
+    } else {
+        int rc = WriteRange(info, static_cast<uint64_t>(offset), buf, size, written);
+        if (rc != 0) {
+            return rc;
+        }
     }
-    out_bytes = static_cast<ssize_t>(resp.bytes_written());
-    uint64_t new_size = 0;
-    bool need_update = false;
-    {
-        std::lock_guard<std::mutex> lk(mu_);
-        uint64_t end = static_cast<uint64_t>(offset) + static_cast<uint64_t>(out_bytes);
-        auto& cur = inode_size_[info.inode];
-        if (end > cur) {
-            cur = end;
-            new_size = cur;
-            need_update = true;
-        }
-    }
-    if (need_update) {
-        auto code = UpdateRemoteSize(info.inode, new_size);
+    out_bytes = static_cast<ssize_t>(written);
+    const uint64_t end = static_cast<uint64_t>(offset) + static_cast<uint64_t>(out_bytes);
+    if (h->state->ExtendSize(end) && !write_behind_) {
+        auto code = UpdateRemoteSize(info.inode, end);
         if (code != rpc::STATUS_SUCCESS) {
             std::cerr << "[Client] UpdateFileSize failed inode=" << info.inode
                       << " code=" << static_cast<int>(code) << std::endl;
@@ -432,11 +775,490 @@ int DfsClient::Write(int fd, const char* buf, size_t size, off_t offset, ssize_t
     return 0;
 }
 
-int DfsClient::Close(int fd) {
-    std::lock_guard<std::mutex> lk(mu_);
-    auto it = fd_info_.find(fd);
-    if (it != fd_info_.end()) {
-        fd_info_.erase(it);
+int DfsClient::WriteRange(const InodeInfo& info, uint64_t offset, const char* buf, size_t size,
+                          size_t& written) {
+    written = 0;
+    if (!info.layout.Addressable(info.inode, offset + size)) {
+        return -EFBIG;
+    }
+    if (info.layout.erasure_coded()) {
+        return WriteRangeEc(info, offset, buf, size, written);
+    }
+    struct PendingWrite {
+        brpc::Controller cntl;
+        storagenode::WriteRequest req;
+        storagenode::WriteReply resp;
+        const char* data{nullptr};
+        size_t length{0};
+        uint32_t copies{1};
+        NodeRouter::StubPtr direct;
+    };
+    auto issue = [this](PendingWrite* call, storagenode::StorageService_Stub* stub) {
+        call->cntl.Reset();
+        // A replicated write is acknowledged by the end of its chain: one timeout per hop.
+        call->cntl.set_timeout_ms(cfg_.rpc_timeout_ms * (1 + call->req.chain_size()));
+        // Sent as an attachment so the payload is not serialized into the protobuf.
+        call->cntl.request_attachment().append(call->data, call->length);
+        stub->Write(&call->cntl, &call->req, &call->resp, brpc::DoNothing());
+    };
+    const std::string& default_node = info.node_id.empty() ? cfg_.default_node_id : info.node_id;
+    auto pieces = info.layout.Split(info.inode, offset, size, default_node);
+    const bool replicated = info.layout.replicated();
+    std::vector<std::unique_ptr<PendingWrite>> calls;
+    calls.reserve(pieces.size());
+    for (const auto& piece : pieces) {
+        auto call = std::make_unique<PendingWrite>();
+        call->req.set_node_id(piece.node_id);
+        call->req.set_chunk_id(piece.chunk_id);
+        call->req.set_offset(piece.chunk_offset);
+        call->req.set_checksum(0);
+        call->req.set_flags(0);
+        call->req.set_mode(0644);
+        bool chain_resolved = true;
+        if (replicated) {
+            // Pipelined replication: the primary streams the data down the
+            // chain of the other copies, so the client sends it only once.
+            auto replicas = info.layout.Replicas(piece.chunk_index);
+            call->copies = static_cast<uint32_t>(replicas.size());
+            for (size_t r = 1; r < replicas.size(); ++r) {
+                auto* next = call->req.add_chain();
+                next->set_node_id(replicas[r]);
+                next->set_addr(router_->Address(replicas[r]));
+                chain_resolved = chain_resolved && !next->addr().empty();
+            }
+        }
+        call->data = buf + (piece.file_offset - offset);
+        call->length = piece.length;
+        // A primary cannot forward to a copy it has no address for; the SRM gateway
+        // resolves the chain itself, so such writes go through it.
+        if (chain_resolved) {
+            call->direct = router_->Route(piece.node_id);
+        }
+        issue(call.get(), call->direct ? call->direct.get() : rpc_->srm());
+        calls.push_back(std::move(call));
+    }
+    for (auto& call : calls) {
+        brpc::Join(call->cntl.call_id());
+    }
+    RetryFailedDirect(calls, router_.get(), rpc_->srm(), issue);
+    // Any piece may have landed, even if a later one failed.
+    if (readahead_) {
+        readahead_->Invalidate(info.inode, offset, size);
+    }
+    // The write only counts up to the first failed or short piece.
+    for (auto& call : calls) {
+        if (call->cntl.Failed()) {
+            std::cerr << "[Client] Write RPC failed: " << call->cntl.ErrorText() << std::endl;
+            return -ECOMM;
+        }
+        auto code = StatusUtils::NormalizeCode(call->resp.status().code());
+        if (code != rpc::STATUS_SUCCESS) {
+            std::cerr << "[Client] Write failed inode=" << info.inode
+                      << " chunk=" << call->req.chunk_id()
+                      << " code=" << static_cast<int>(code)
+                      << " msg=" << call->resp.status().message() << std::endl;
+            return -StatusToErrno(code);
+        }
+        if (call->copies > 1 && call->resp.replicas() < call->copies) {
+            std::cerr << "[Client] Write under-replicated inode=" << info.inode
+                      << " chunk=" << call->req.chunk_id()
+                      << " replicas=" << call->resp.replicas() << "/" << call->copies << std::endl;
+            return -EIO;
+        }
+        written += static_cast<size_t>(call->resp.bytes_written());
+        if (call->resp.bytes_written() < call->length) {
+            break;
+        }
+    }
+    return 0;
+}
+
+int DfsClient::Flush(uint64_t fh) {
+    auto* h = reinterpret_cast<FileHandle*>(fh);
+    if (!h) return -EBADF;
+    return write_behind_ ? write_behind_->Flush(h->wb) : 0;
+}
+
+int DfsClient::Close(uint64_t fh) {
+    auto* h = reinterpret_cast<FileHandle*>(fh);
+    if (!h) return -EBADF;
+    int rc = write_behind_ ? write_behind_->Release(h->wb) : 0;
+    delete h;
+    return rc;
+}
+
+void DfsClient::ReadFragments(std::vector<FragmentIo>& ios) {
+    struct PendingRead {
+        brpc::Controller cntl;
+        storagenode::ReadRequest req;
+        storagenode::ReadReply resp;
+        FragmentIo* io{nullptr};
+        NodeRouter::StubPtr direct;
+    };
+    auto issue = [this](PendingRead* call, storagenode::StorageService_Stub* stub) {
+        call->cntl.Reset();
+        call->cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
+        stub->Read(&call->cntl, &call->req, &call->resp, brpc::DoNothing());
+    };
+    std::vector<std::unique_ptr<PendingRead>> calls;
+    calls.reserve(ios.size());
+    for (auto& io : ios) {
+        auto call = std::make_unique<PendingRead>();
+        call->io = &io;
+        call->req.set_node_id(io.frag.node_id);
+        call->req.set_chunk_id(io.frag.chunk_id);
+        call->req.set_offset(io.frag.chunk_offset);
+        call->req.set_length(static_cast<uint64_t>(io.frag.length));
+        call->req.set_attachment(true);
+        call->direct = router_->Route(io.frag.node_id);
+        issue(call.get(), call->direct ? call->direct.get() : rpc_->srm());
+        calls.push_back(std::move(call));
+    }
+    for (auto& call : calls) {
+        brpc::Join(call->cntl.call_id());
+    }
+    RetryFailedDirect(calls, router_.get(), rpc_->srm(), issue);
+
+    for (auto& call : calls) {
+        FragmentIo& io = *call->io;
+        io.rc = 0;
+        if (call->cntl.Failed()) {
+            std::cerr << "[Client] fragment read RPC failed node=" << io.frag.node_id
+                      << " chunk=" << io.frag.chunk_id << ": " << call->cntl.ErrorText() << std::endl;
+            io.rc = -ECOMM;
+            continue;
+        }
+        auto code = StatusUtils::NormalizeCode(call->resp.status().code());
+        size_t got = 0;
+        if (code == rpc::STATUS_SUCCESS) {
+            got = std::min<size_t>(static_cast<size_t>(call->resp.bytes_read()), io.frag.length);
+            const butil::IOBuf& payload = call->cntl.response_attachment();
+            if (!payload.empty()) {
+                payload.copy_to(io.dst, got);
+            } else {
+                std::memcpy(io.dst, call->resp.data().data(), got);
+            }
+        } else {
+            io.rc = code == rpc::STATUS_NODE_NOT_FOUND ? -ENOENT : -StatusToErrno(code);
+        }
+        std::memset(io.dst + got, 0, io.frag.length - got);
+    }
+}
+
+int DfsClient::WriteFragments(std::vector<FragmentIo>& ios) {
+    struct PendingWrite {
+        brpc::Controller cntl;
+        storagenode::WriteRequest req;
+        storagenode::WriteReply resp;
+        const FragmentIo* io{nullptr};
+        NodeRouter::StubPtr direct;
+    };
+    auto issue = [this](PendingWrite* call, storagenode::StorageService_Stub* stub) {
+        call->cntl.Reset();
+        call->cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
+        call->cntl.request_attachment().append(call->io->src, call->io->frag.length);
+        stub->Write(&call->cntl, &call->req, &call->resp, brpc::DoNothing());
+    };
+    std::vector<std::unique_ptr<PendingWrite>> calls;
+    calls.reserve(ios.size());
+    for (const auto& io : ios) {
+        auto call = std::make_unique<PendingWrite>();
+        call->io = &io;
+        call->req.set_node_id(io.frag.node_id);
+        call->req.set_chunk_id(io.frag.chunk_id);
+        call->req.set_offset(io.frag.chunk_offset);
+        call->req.set_checksum(0);
+        call->req.set_flags(0);
+        call->req.set_mode(0644);
+        call->direct = router_->Route(io.frag.node_id);
+        issue(call.get(), call->direct ? call->direct.get() : rpc_->srm());
+        calls.push_back(std::move(call));
+    }
+    for (auto& call : calls) {
+        brpc::Join(call->cntl.call_id());
+    }
+    RetryFailedDirect(calls, router_.get(), rpc_->srm(), issue);
+
+    // No degraded writes: a fragment that missed an update would later be
+    // decoded as if it were current.
+    for (auto& call : calls) {
+        if (call->cntl.Failed()) {
+            std::cerr << "[Client] fragment write RPC failed node=" << call->io->frag.node_id
+                      << " chunk=" << call->io->frag.chunk_id << ": " << call->cntl.ErrorText()
+                      << std::endl;
+            return -ECOMM;
+        }
+        auto code = StatusUtils::NormalizeCode(call->resp.status().code());
+        if (code != rpc::STATUS_SUCCESS) {
+            std::cerr << "[Client] fragment write failed chunk=" << call->req.chunk_id()
+                      << " code=" << static_cast<int>(code)
+                      << " msg=" << call->resp.status().message() << std::endl;
+            return -StatusToErrno(code);
+        }
+        if (call->resp.bytes_written() < call->io->frag.length) {
+            return -EIO;
+        }
+    }
+    return 0;
+}
+
+int DfsClient::ReconstructPiece(const InodeInfo& info, const ChunkLayout::Piece& piece, char* dst) {
+    const ChunkLayout& layout = info.layout;
+    const uint32_t k = layout.ec_data;
+    const uint32_t width = layout.EcWidth();
+    const uint64_t row = piece.file_offset / layout.RowBytes();
+    const uint32_t col = static_cast<uint32_t>(piece.file_offset % layout.RowBytes() / layout.ec_cell);
+    const uint64_t lo = piece.file_offset % layout.ec_cell;
+
+    // All other fragments are read at once; the first k that answer are used.
+    std::vector<std::vector<char>> bufs(width);
+    std::vector<FragmentIo> ios;
+    ios.reserve(width - 1);
+    for (uint32_t i = 0; i < width; ++i) {
+        if (i == col) {
+            continue;
+        }
+        bufs[i].resize(piece.length);
+        FragmentIo io;
+        io.frag = layout.Fragment(info.inode, row, i);
+        io.frag.chunk_offset += lo;
+        io.frag.length = piece.length;
+        io.dst = bufs[i].data();
+        ios.push_back(std::move(io));
+    }
+    ReadFragments(ios);
+
+    std::vector<const uint8_t*> frags(width, nullptr);
+    uint32_t present = 0;
+    bool decidable = true;  // every fragment that did not answer is known to be missing
+    for (const auto& io : ios) {
+        const uint32_t i = static_cast<uint32_t>(io.frag.chunk_index % width);
+        if (io.rc == 0) {
+            frags[i] = reinterpret_cast<const uint8_t*>(bufs[i].data());
+            ++present;
+        } else if (io.rc != -ENOENT) {
+            decidable = false;
+        }
+    }
+    std::vector<uint8_t*> out(k, nullptr);
+    out[col] = reinterpret_cast<uint8_t*>(dst);
+    ErasureCode ec(static_cast<int>(k), static_cast<int>(layout.ec_parity));
+    if (present >= k) {
+        ec.Reconstruct(frags.data(), out.data(), piece.length);
+        std::cerr << "[Client] degraded read inode=" << info.inode << " row=" << row
+                  << " column=" << col << " rebuilt " << piece.length << " bytes" << std::endl;
+        return 0;
+    }
+    // Too few fragments to decode. The cell is a hole only if the absent
+    // fragments were never written: nothing in the row exists at all, or the
+    // stored parity matches the data with every absent column taken as zeros.
+    bool parity_checked = false;
+    if (decidable && present > 0) {
+        const std::vector<uint8_t> zeros(piece.length, 0);
+        std::vector<const uint8_t*> data(k);
+        for (uint32_t j = 0; j < k; ++j) {
+            data[j] = frags[j] ? frags[j] : zeros.data();
+        }
+        std::vector<std::vector<uint8_t>> parity(layout.ec_parity, std::vector<uint8_t>(piece.length));
+        std::vector<uint8_t*> parity_ptrs(layout.ec_parity);
+        for (uint32_t i = 0; i < layout.ec_parity; ++i) {
+            parity_ptrs[i] = parity[i].data();
+        }
+        ec.Encode(data.data(), parity_ptrs.data(), piece.length);
+        for (uint32_t i = 0; i < layout.ec_parity && decidable; ++i) {
+            if (const uint8_t* stored = frags[k + i]) {
+                parity_checked = true;
+                decidable = std::memcmp(stored, parity[i].data(), piece.length) == 0;
+            }
+        }
+    }
+    if (decidable && (present == 0 || parity_checked)) {
+        std::memset(dst, 0, piece.length);
+        return 0;
+    }
+    std::cerr << "[Client] degraded read failed inode=" << info.inode << " row=" << row
+              << " column=" << col << ": " << present << " of " << k
+              << " fragments available and the rest cannot be shown to be holes" << std::endl;
+    return -EIO;
+}
+
+int DfsClient::WriteRangeEc(const InodeInfo& info, uint64_t offset, const char* buf, size_t size,
+                            size_t& written) {
+    written = 0;
+    if (size == 0) {
+        return 0;
+    }
+    const ChunkLayout& layout = info.layout;
+    const uint32_t k = layout.ec_data;
+    const uint32_t m = layout.ec_parity;
+    const uint64_t cell = layout.ec_cell;
+    const uint64_t row_bytes = layout.RowBytes();
+    const uint64_t end = offset + size;
+    const uint64_t first_row = offset / row_bytes;
+    const uint64_t last_row = (end - 1) / row_bytes;
+    auto state = inodes_.GetOrCreate(info.inode);
+    RowLocks::Guard guard(state->rows, first_row, last_row);
+
+    // Per row, parity is redone over [lo, hi): the in-cell span the write
+    // touches in any column. Data outside the write but inside that span is
+    // read back first; a fully overwritten row needs no reads at all.
+    struct RowWork {
+        uint64_t row{0};
+        uint64_t lo{0};
+        uint64_t hi{0};
+        std::vector<const uint8_t*> data;    // k encoder inputs over [lo, hi)
+        std::vector<std::vector<char>> old;  // read-back columns
+        std::vector<std::vector<char>> parity;
+    };
+    auto covered = [&](uint64_t row, uint32_t col, uint64_t& a, uint64_t& b) {
+        const uint64_t cs = row * row_bytes + col * cell;
+        a = std::max(offset, cs);
+        b = std::min(end, cs + cell);
+        return a < b;
+    };
+    std::vector<RowWork> rows;
+    rows.reserve(static_cast<size_t>(last_row - first_row + 1));
+    std::vector<FragmentIo> reads;
+    std::vector<ChunkLayout::Piece> read_pieces;
+    for (uint64_t row = first_row; row <= last_row; ++row) {
+        RowWork w;
+        w.row = row;
+        w.lo = cell;
+        w.hi = 0;
+        for (uint32_t col = 0; col < k; ++col) {
+            uint64_t a = 0;
+            uint64_t b = 0;
+            if (covered(row, col, a, b)) {
+                const uint64_t cs = row * row_bytes + col * cell;
+                w.lo = std::min(w.lo, a - cs);
+                w.hi = std::max(w.hi, b - cs);
+            }
+        }
+        const uint64_t span = w.hi - w.lo;
+        w.data.assign(k, nullptr);
+        w.old.resize(k);
+        for (uint32_t col = 0; col < k; ++col) {
+            const uint64_t cs = row * row_bytes + col * cell;
+            uint64_t a = 0;
+            uint64_t b = 0;
+            if (covered(row, col, a, b) && a <= cs + w.lo && b >= cs + w.hi) {
+                w.data[col] = reinterpret_cast<const uint8_t*>(buf + (cs + w.lo - offset));
+                continue;
+            }
+            w.old[col].resize(span);
+            FragmentIo io;
+            io.frag = layout.Fragment(info.inode, row, col);
+            io.frag.chunk_offset += w.lo;
+            io.frag.length = static_cast<size_t>(span);
+            io.dst = w.old[col].data();
+            reads.push_back(std::move(io));
+            ChunkLayout::Piece piece;
+            piece.file_offset = cs + w.lo;
+            piece.length = static_cast<size_t>(span);
+            read_pieces.push_back(piece);
+        }
+        rows.push_back(std::move(w));
+    }
+    if (!reads.empty()) {
+        ReadFragments(reads);
+        for (size_t i = 0; i < reads.size(); ++i) {
+            if (reads[i].rc != 0) {
+                int rc = ReconstructPiece(info, read_pieces[i], reads[i].dst);
+                if (rc != 0) {
+                    return rc;
+                }
+            }
+        }
+    }
+
+    ErasureCode ec(static_cast<int>(k), static_cast<int>(m));
+    std::vector<FragmentIo> writes;
+    for (auto& w : rows) {
+        const uint64_t span = w.hi - w.lo;
+        for (uint32_t col = 0; col < k; ++col) {
+            const uint64_t cs = w.row * row_bytes + col * cell;
+            uint64_t a = 0;
+            uint64_t b = 0;
+            const bool touched = covered(w.row, col, a, b);
+            if (w.data[col] == nullptr) {
+                if (touched) {
+                    std::memcpy(w.old[col].data() + (a - cs - w.lo), buf + (a - offset), b - a);
+                }
+                w.data[col] = reinterpret_cast<const uint8_t*>(w.old[col].data());
+            }
+            if (touched) {
+                FragmentIo io;
+                io.frag = layout.Fragment(info.inode, w.row, col);
+                io.frag.chunk_offset += a - cs;
+                io.frag.length = static_cast<size_t>(b - a);
+                io.src = buf + (a - offset);
+                writes.push_back(std::move(io));
+            }
+        }
+        w.parity.assign(m, std::vector<char>(span));
+        std::vector<uint8_t*> parity(m);
+        for (uint32_t i = 0; i < m; ++i) {
+            parity[i] = reinterpret_cast<uint8_t*>(w.parity[i].data());
+        }
+        ec.Encode(w.data.data(), parity.data(), span);
+        for (uint32_t i = 0; i < m; ++i) {
+            FragmentIo io;
+            io.frag = layout.Fragment(info.inode, w.row, k + i);
+            io.frag.chunk_offset += w.lo;
+            io.frag.length = static_cast<size_t>(span);
+            io.src = w.parity[i].data();
+            writes.push_back(std::move(io));
+        }
+    }
+    int rc = WriteFragments(writes);
+    if (readahead_) {
+        readahead_->Invalidate(info.inode, offset, size);
     }
+    if (rc != 0) {
+        return rc;
+    }
+    written = size;
     return 0;
 }
+
+int DfsClient::RewriteParity(const InodeInfo& info, uint64_t row, uint64_t len) {
+    const ChunkLayout& layout = info.layout;
+    const uint32_t k = layout.ec_data;
+    const uint32_t m = layout.ec_parity;
+    auto state = inodes_.GetOrCreate(info.inode);
+    RowLocks::Guard guard(state->rows, row, row);
+
+    std::vector<std::vector<char>> cells(k + m, std::vector<char>(len));
+    std::vector<FragmentIo> reads(k);
+    for (uint32_t col = 0; col < k; ++col) {
+        reads[col].frag = layout.Fragment(info.inode, row, col);
+        reads[col].frag.length = static_cast<size_t>(len);
+        reads[col].dst = cells[col].data();
+    }
+    ReadFragments(reads);
+    std::vector<const uint8_t*> data(k);
+    for (uint32_t col = 0; col < k; ++col) {
+        if (reads[col].rc != 0) {
+            // A lost or never-written column is rebuilt (or shown to be a hole)
+            // from the rest of the row before parity is recomputed over it.
+            ChunkLayout::Piece piece;
+            piece.file_offset = row * layout.RowBytes() + col * layout.ec_cell;
+            piece.length = static_cast<size_t>(len);
+            int rc = ReconstructPiece(info, piece, cells[col].data());
+            if (rc != 0) {
+                return rc;
+            }
+        }
+        data[col] = reinterpret_cast<const uint8_t*>(cells[col].data());
+    }
+    std::vector<uint8_t*> parity(m);
+    std::vector<FragmentIo> writes(m);
+    for (uint32_t i = 0; i < m; ++i) {
+        parity[i] = reinterpret_cast<uint8_t*>(cells[k + i].data());
+        writes[i].frag = layout.Fragment(info.inode, row, k + i);
+        writes[i].frag.length = static_cast<size_t>(len);
+        writes[i].src = cells[k + i].data();
+    }
+    ErasureCode(static_cast<int>(k), static_cast<int>(m)).Encode(data.data(), parity.data(), len);
+    return WriteFragments(writes);
+}
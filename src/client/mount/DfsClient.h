@@ -6,44 +6,101 @@
 #include <sys/stat.h>
 #include <vector>
 #include <fuse.h>
-#include <unordered_map>
-#include <mutex>
 
+#include <butil/iobuf.h>
+
+#include "ChunkLayout.h"
+#include "FileHandle.h"
+#include "InodeInfo.h"
+#include "NodeRouter.h"
+#include "ReadAhead.h"
+#include "WriteBehind.h"
 #include "RpcClients.h"
+#include "common/ErasureCode.h"
 #include "common/StatusUtils.h"
 
-struct InodeInfo {
-    uint64_t inode{0};
-    std::string node_id;
-};
-
+// File handles (fh) are FileHandle pointers owned by the client between
+// Open/Create and Close; FUSE stores them in fi->fh. The data path (Read,
+// Write, Flush) only touches the handle and its InodeState, so concurrent
+// FUSE workers do not contend on any client-wide lock.
 class DfsClient {
 public:
     explicit DfsClient(MountConfig cfg);
+    ~DfsClient();
     bool Init();
 
     int GetAttr(const std::string& path, struct stat* st);
     int ReadDir(const std::string& path, void* buf, fuse_fill_dir_t filler);
-    int Open(const std::string& path, int flags, int& out_fd);
-    int Create(const std::string& path, int flags, mode_t mode, int& out_fd);
+    int Open(const std::string& path, int flags, uint64_t& out_fh);
+    int Create(const std::string& path, int flags, mode_t mode, uint64_t& out_fh);
     int Mkdir(const std::string& path, mode_t mode);
     int Rmdir(const std::string& path);
     int Unlink(const std::string& path);
     int Truncate(const std::string& path, off_t size);
-    int Read(int fd, char* buf, size_t size, off_t offset, ssize_t& out_bytes);
-    int Write(int fd, const char* buf, size_t size, off_t offset, ssize_t& out_bytes);
-    int Close(int fd);
+    int Read(uint64_t fh, char* buf, size_t size, off_t offset, ssize_t& out_bytes);
+    // Like Read, but leaves the data in out. Bytes fetched from storage nodes are
+    // the RPC attachments themselves, so the caller can pass them to the kernel
+    // without another copy.
+    int ReadBuf(uint64_t fh, size_t size, off_t offset, butil::IOBuf* out);
+    int Write(uint64_t fh, const char* buf, size_t size, off_t offset, ssize_t& out_bytes);
+    // Makes buffered writes on fh durable (FUSE flush/fsync); returns any deferred error.
+    int Flush(uint64_t fh);
+    int Close(uint64_t fh);
 
 private:
     int StatusToErrno(rpc::StatusCode code) const;
     bool PopulateStat(struct stat* st, bool is_dir) const;
     rpc::StatusCode LookupInode(const std::string& path, InodeInfo& out_info);
     rpc::StatusCode UpdateRemoteSize(uint64_t inode, uint64_t size_bytes);
+    struct ReadPlan {
+        size_t len{0};        // bytes to read after clamping to the known size
+        bool has_size{false};
+        uint64_t known_size{0};
+    };
+    // Clamps a read to the client-side size and flushes buffered writes first.
+    ReadPlan BeginRead(FileHandle& h, size_t size, off_t offset);
+    void EndRead(FileHandle& h, const ReadPlan& plan, off_t offset, size_t got);
+    // Reads [offset, offset + len) from the chunk nodes, one RPC per chunk piece,
+    // appending to out. With has_size, holes read as zeros; otherwise the first
+    // short piece is EOF.
+    int FetchRange(const InodeInfo& info, uint64_t offset, size_t len, bool has_size,
+                   butil::IOBuf* out);
+    int FetchRange(const InodeInfo& info, uint64_t offset, size_t len, bool has_size,
+                   char* buf, size_t& out_bytes);
+    // Writes [offset, offset + size) to the chunk nodes; written stops at the first short piece.
+    int WriteRange(const InodeInfo& info, uint64_t offset, const char* buf, size_t size,
+                   size_t& written);
+
+    // Erasure-coded files (ChunkLayout::erasure_coded()).
+    struct FragmentIo {
+        ChunkLayout::Piece frag;  // node, chunk, chunk_offset and length
+        char* dst{nullptr};       // read target
+        const char* src{nullptr}; // write source
+        int rc{0};                // 0 or -errno
+    };
+    // Reads every range in parallel. Bytes past a chunk's end read as zeros; a
+    // chunk the node does not have leaves rc = -ENOENT (dst zeroed) so callers
+    // can tell a lost fragment from a hole. Other failures are left in rc.
+    void ReadFragments(std::vector<FragmentIo>& ios);
+    // Writes every range in parallel; returns the first failure.
+    int WriteFragments(std::vector<FragmentIo>& ios);
+    // Rebuilds the data cell bytes of `piece` (one cell of a Split) from the
+    // other fragments of its row. With fewer than k fragments present the cell
+    // reads as zeros only if every absent fragment is missing (never written)
+    // and the present parity agrees; otherwise -EIO.
+    int ReconstructPiece(const InodeInfo& info, const ChunkLayout::Piece& piece, char* dst);
+    // Writes new data cells and re-encodes the parity of every row it touches.
+    int WriteRangeEc(const InodeInfo& info, uint64_t offset, const char* buf, size_t size,
+                     size_t& written);
+    // Recomputes parity for [0, len) of row from the stored data cells.
+    int RewriteParity(const InodeInfo& info, uint64_t row, uint64_t len);
 
     MountConfig cfg_;
     std::unique_ptr<RpcClients> rpc_;
-    int next_fd_{3};
-    std::unordered_map<int, InodeInfo> fd_info_;
-    std::unordered_map<uint64_t, uint64_t> inode_size_;
-    mutable std::mutex mu_;
+    std::unique_ptr<NodeRouter> router_;
+    InodeTable inodes_;
+    // Declared last so their workers stop before the RPC clients go away;
+    // write_behind_ flushes on destruction and may still invalidate readahead_.
+    std::unique_ptr<ReadAhead> readahead_;
+    std::unique_ptr<WriteBehind> write_behind_;
 };
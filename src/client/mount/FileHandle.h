@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "InodeInfo.h"
+#include "ReadAhead.h"
+#include "WriteBehind.h"
+
+// Rows of an erasure-coded file with a parity read-modify-write in progress.
+// Writers of overlapping row ranges take turns so parity always matches the
+// data it was computed from.
+class RowLocks {
+public:
+    class Guard {
+    public:
+        Guard(RowLocks& locks, uint64_t first, uint64_t last) : locks_(locks), range_(first, last) {
+            std::unique_lock<std::mutex> lk(locks_.mu_);
+            locks_.cv_.wait(lk, [&] {
+                for (const auto& r : locks_.busy_) {
+                    if (r.first <= range_.second && range_.first <= r.second) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+            locks_.busy_.push_back(range_);
+        }
+        ~Guard() {
+            {
+                std::lock_guard<std::mutex> lk(locks_.mu_);
+                auto it = std::find(locks_.busy_.begin(), locks_.busy_.end(), range_);
+                if (it != locks_.busy_.end()) {
+                    locks_.busy_.erase(it);
+                }
+            }
+            locks_.cv_.notify_all();
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        RowLocks& locks_;
+        std::pair<uint64_t, uint64_t> range_;
+    };
+
+private:
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<std::pair<uint64_t, uint64_t>> busy_;  // inclusive row ranges
+};
+
+// State shared by every open handle of one inode.
+struct InodeState {
+    uint64_t inode{0};
+    // Size as seen by this client, including buffered writes. Only meaningful
+    // once this client has written or truncated the inode (has_size).
+    std::atomic<uint64_t> size{0};
+    std::atomic<bool> has_size{false};
+    WriteBehind::Inode wb;
+    RowLocks rows;
+
+    void SetSize(uint64_t value) {
+        size.store(value, std::memory_order_release);
+        has_size.store(true, std::memory_order_release);
+    }
+
+    // Raises size to at least end; returns true when this call grew it.
+    bool ExtendSize(uint64_t end) {
+        has_size.store(true, std::memory_order_release);
+        uint64_t cur = size.load(std::memory_order_acquire);
+        while (end > cur) {
+            if (size.compare_exchange_weak(cur, end, std::memory_order_acq_rel)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// One open file. DfsClient hands its address to FUSE as fi->fh, so the data
+// path reaches all per-open state without a table lookup or a shared lock.
+struct FileHandle {
+    InodeInfo info;
+    std::shared_ptr<InodeState> state;
+    ReadAhead::Stream ra;
+    WriteBehind::Handle wb;
+};
+
+// inode -> InodeState, split over independently locked shards. Only metadata
+// operations (open, getattr, truncate, unlink) go through it.
+class InodeTable {
+public:
+    std::shared_ptr<InodeState> GetOrCreate(uint64_t inode) {
+        Shard& s = ShardFor(inode);
+        std::lock_guard<std::mutex> lk(s.mu);
+        auto& slot = s.map[inode];
+        if (!slot) {
+            slot = std::make_shared<InodeState>();
+            slot->inode = inode;
+        }
+        return slot;
+    }
+
+    std::shared_ptr<InodeState> Find(uint64_t inode) const {
+        const Shard& s = ShardFor(inode);
+        std::lock_guard<std::mutex> lk(s.mu);
+        auto it = s.map.find(inode);
+        return it == s.map.end() ? nullptr : it->second;
+    }
+
+    void Erase(uint64_t inode) {
+        Shard& s = ShardFor(inode);
+        std::lock_guard<std::mutex> lk(s.mu);
+        s.map.erase(inode);
+    }
+
+    std::vector<std::shared_ptr<InodeState>> Snapshot() const {
+        std::vector<std::shared_ptr<InodeState>> out;
+        for (const auto& s : shards_) {
+            std::lock_guard<std::mutex> lk(s.mu);
+            for (const auto& kv : s.map) {
+                out.push_back(kv.second);
+            }
+        }
+        return out;
+    }
+
+private:
+    static constexpr size_t kShards = 32;
+    struct Shard {
+        mutable std::mutex mu;
+        std::unordered_map<uint64_t, std::shared_ptr<InodeState>> map;
+    };
+
+    Shard& ShardFor(uint64_t inode) { return shards_[inode % kShards]; }
+    const Shard& ShardFor(uint64_t inode) const { return shards_[inode % kShards]; }
+
+    std::array<Shard, kShards> shards_;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ChunkLayout.h"
+
+struct InodeInfo {
+    uint64_t inode{0};
+    std::string node_id;
+    ChunkLayout layout;
+};
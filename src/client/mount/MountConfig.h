@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 struct MountConfig {
@@ -9,4 +10,27 @@ struct MountConfig {
     std::string default_node_id{"node-1"};
     int rpc_timeout_ms{3000};
     int rpc_max_retry{2};
+    // Send chunk I/O straight to real storage nodes; the SRM gateway is only
+    // used for virtual nodes and as a fallback when a direct call fails.
+    bool direct_data_path{true};
+    // How long a fetched node endpoint table is trusted before re-checking its epoch.
+    int node_cache_ttl_ms{5000};
+    // Sequential read-ahead: the per-file window grows up to readahead_max_kb
+    // (0 disables it) and prefetched pages are kept in a page_cache_mb cache.
+    size_t readahead_max_kb{8192};
+    size_t page_cache_mb{256};
+    int readahead_threads{4};
+    // Write-behind: contiguous writes per handle are coalesced into buffers of
+    // write_behind_kb (0 writes through) with up to write_behind_inflight
+    // flushes outstanding per handle.
+    size_t write_behind_kb{8192};
+    size_t write_behind_inflight{4};
+    int write_behind_threads{4};
+    // Erasure coding requested for files this mount creates: RS(ec_data,
+    // ec_parity). -1 leaves the choice to the MDS default, 0 asks for plain striping.
+    int ec_data{-1};
+    int ec_parity{2};
+    // Copies of each chunk for replicated files this mount creates; 0 leaves it
+    // to the MDS default.
+    int replicas{0};
 };
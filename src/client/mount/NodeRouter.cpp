@@ -0,0 +1,215 @@
+#include "NodeRouter.h"
+
+#include <brpc/controller.h>
+
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "cluster_manager.pb.h"
+#include "common/StatusUtils.h"
+
+NodeRouter::NodeRouter(MountConfig cfg, RpcClients* rpc)
+    : cfg_(std::move(cfg)), rpc_(rpc) {}
+
+NodeRouter::StubPtr NodeRouter::Route(const std::string& node_id) {
+    if (!cfg_.direct_data_path || !rpc_ || !rpc_->cluster()) {
+        return nullptr;
+    }
+    RefreshIfStale();
+
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto sit = suspect_until_.find(node_id);
+    if (sit != suspect_until_.end() && Clock::now() < sit->second) {
+        return nullptr;
+    }
+    auto it = direct_.find(node_id);
+    if (it == direct_.end()) {
+        return nullptr;
+    }
+    // Aliasing constructor: the caller's handle pins the whole Endpoint.
+    return StubPtr(it->second, it->second->stub.get());
+}
+
+void NodeRouter::Invalidate(const std::string& node_id) {
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    direct_.erase(node_id);
+    suspect_until_[node_id] = Clock::now() + std::chrono::milliseconds(cfg_.node_cache_ttl_ms);
+    epoch_ = 0;
+    next_refresh_ = Clock::time_point{};
+}
+
+std::string NodeRouter::Address(const std::string& node_id) {
+    if (!cfg_.direct_data_path || !rpc_ || !rpc_->cluster()) {
+        return std::string();
+    }
+    RefreshIfStale();
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    auto it = direct_.find(node_id);
+    return it == direct_.end() ? std::string() : it->second->addr;
+}
+
+size_t NodeRouter::PickReplica(const std::vector<std::string>& replicas) {
+    if (replicas.size() <= 1) {
+        return 0;
+    }
+    if (rpc_ && rpc_->cluster()) {
+        RefreshIfStale();
+    }
+    // Nodes never measured count as 1ms so they get tried.
+    constexpr double kDefaultLatencyUs = 1000.0;
+    std::vector<double> latency(replicas.size(), kDefaultLatencyUs);
+    {
+        std::lock_guard<std::mutex> lk(latency_mu_);
+        for (size_t i = 0; i < replicas.size(); ++i) {
+            auto it = latency_us_.find(replicas[i]);
+            if (it != latency_us_.end()) {
+                latency[i] = it->second;
+            }
+        }
+    }
+    const auto now = Clock::now();
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    size_t best = 0;
+    double best_cost = 0.0;
+    for (size_t i = 0; i < replicas.size(); ++i) {
+        // Expected wait: the queue ahead of us times the per-request latency.
+        double cost = latency[i];
+        auto lit = loads_.find(replicas[i]);
+        if (lit != loads_.end()) {
+            cost *= (1.0 + static_cast<double>(lit->second.in_flight_io)) *
+                    (1.0 + lit->second.cpu_usage);
+        }
+        auto sit = suspect_until_.find(replicas[i]);
+        if (sit != suspect_until_.end() && now < sit->second) {
+            cost *= 1e6;
+        }
+        if (i == 0 || cost < best_cost) {
+            best = i;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+void NodeRouter::ObserveLatency(const std::string& node_id, int64_t latency_us) {
+    if (latency_us <= 0) {
+        return;
+    }
+    constexpr double kAlpha = 0.2;
+    std::lock_guard<std::mutex> lk(latency_mu_);
+    auto it = latency_us_.find(node_id);
+    if (it == latency_us_.end()) {
+        latency_us_.emplace(node_id, static_cast<double>(latency_us));
+    } else {
+        it->second += kAlpha * (static_cast<double>(latency_us) - it->second);
+    }
+}
+
+std::shared_ptr<NodeRouter::Endpoint> NodeRouter::Connect(const std::string& addr) const {
+    auto ep = std::make_shared<Endpoint>();
+    ep->addr = addr;
+    ep->channel = std::make_unique<brpc::Channel>();
+    brpc::ChannelOptions opts;
+    opts.protocol = "baidu_std";
+    opts.timeout_ms = cfg_.rpc_timeout_ms;
+    // Retries go through the gateway instead, see DfsClient.
+    opts.max_retry = 0;
+    if (ep->channel->Init(addr.c_str(), &opts) != 0) {
+        std::cerr << "[NodeRouter] channel init failed addr=" << addr << std::endl;
+        return nullptr;
+    }
+    ep->stub = std::make_unique<storagenode::StorageService_Stub>(ep->channel.get());
+    return ep;
+}
+
+void NodeRouter::RefreshIfStale() {
+    bool first = false;
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        if (loaded_ && Clock::now() < next_refresh_) {
+            return;
+        }
+        first = !loaded_;
+    }
+    // Only the first load makes callers wait; later refreshes are skipped by
+    // threads that lose the race and keep using the current table.
+    std::unique_lock<std::mutex> rl(refresh_mu_, std::defer_lock);
+    if (first) {
+        rl.lock();
+    } else if (!rl.try_lock()) {
+        return;
+    }
+    uint64_t known_epoch = 0;
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        if (loaded_ && Clock::now() < next_refresh_) {
+            return;
+        }
+        known_epoch = epoch_;
+    }
+
+    storagenode::ListNodesRequest req;
+    storagenode::ListNodesResponse resp;
+    req.set_known_epoch(known_epoch);
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(cfg_.rpc_timeout_ms);
+    rpc_->cluster()->ListNodes(&cntl, &req, &resp, nullptr);
+
+    const auto next = Clock::now() + std::chrono::milliseconds(cfg_.node_cache_ttl_ms);
+    if (cntl.Failed() ||
+        StatusUtils::NormalizeCode(resp.status().code()) != rpc::STATUS_SUCCESS) {
+        // Keep the old table (or none: everything goes via the gateway) until the next TTL.
+        std::cerr << "[NodeRouter] ListNodes failed: "
+                  << (cntl.Failed() ? cntl.ErrorText() : resp.status().message()) << std::endl;
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        loaded_ = true;
+        next_refresh_ = next;
+        return;
+    }
+    std::unordered_map<std::string, Load> loads;
+    for (const auto& load : resp.loads()) {
+        loads[load.node_id()] = Load{load.in_flight_io(), load.cpu_usage()};
+    }
+    if (resp.unchanged()) {
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        loads_.swap(loads);
+        loaded_ = true;
+        next_refresh_ = next;
+        return;
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<Endpoint>> old;
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        old = direct_;
+    }
+    // Channels are built outside mu_; unchanged endpoints keep their channel.
+    std::unordered_map<std::string, std::shared_ptr<Endpoint>> fresh;
+    for (const auto& node : resp.nodes()) {
+        if (node.is_virtual() || !node.online() || node.ip().empty() || node.port() == 0) {
+            continue;
+        }
+        const std::string addr = node.ip() + ":" + std::to_string(node.port());
+        auto it = old.find(node.node_id());
+        if (it != old.end() && it->second->addr == addr) {
+            fresh.emplace(node.node_id(), it->second);
+            continue;
+        }
+        if (auto ep = Connect(addr)) {
+            fresh.emplace(node.node_id(), std::move(ep));
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lk(mu_);
+    direct_.swap(fresh);
+    loads_.swap(loads);
+    epoch_ = resp.epoch();
+    // Expired hold-downs are dropped here rather than on the shared-lock Route path.
+    const auto now = Clock::now();
+    for (auto it = suspect_until_.begin(); it != suspect_until_.end();) {
+        it = now >= it->second ? suspect_until_.erase(it) : std::next(it);
+    }
+    loaded_ = true;
+    next_refresh_ = next;
+}
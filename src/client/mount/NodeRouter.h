@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <brpc/channel.h>
+
+#include "MountConfig.h"
+#include "RpcClients.h"
+#include "storage_node.pb.h"
+
+// Maps storage node ids to direct StorageService stubs so chunk I/O skips the
+// SRM gateway hop. The endpoint table comes from ClusterManagerService::ListNodes
+// and is re-validated against SRM's registry epoch at most once per
+// node_cache_ttl_ms; a transport failure on a direct call invalidates it early.
+class NodeRouter {
+public:
+    using StubPtr = std::shared_ptr<storagenode::StorageService_Stub>;
+
+    NodeRouter(MountConfig cfg, RpcClients* rpc);
+
+    // Direct stub for node_id, or nullptr when the call should go through the
+    // gateway: virtual, offline or unknown node, recently failed node, or the
+    // direct path is disabled. The stub keeps its channel alive while held.
+    StubPtr Route(const std::string& node_id);
+
+    // A direct call to node_id failed before reaching the service. The node is
+    // sent through the gateway for one TTL and the table is re-fetched in full.
+    void Invalidate(const std::string& node_id);
+
+    // host:port of node_id's StorageService, or empty when there is no usable
+    // direct endpoint (the SRM gateway fills those in for replication chains).
+    std::string Address(const std::string& node_id);
+
+    // Index in replicas of the copy to read from: the lowest in-flight count
+    // and CPU load reported by SRM heartbeats, weighted by the latency this
+    // client has seen from the node. Nodes on hold-down after a failure go last.
+    size_t PickReplica(const std::vector<std::string>& replicas);
+
+    // Feeds the latency of a completed call into node_id's moving average.
+    void ObserveLatency(const std::string& node_id, int64_t latency_us);
+
+private:
+    struct Endpoint {
+        std::string addr;
+        std::unique_ptr<brpc::Channel> channel;
+        std::unique_ptr<storagenode::StorageService_Stub> stub;
+    };
+    using Clock = std::chrono::steady_clock;
+
+    void RefreshIfStale();
+    std::shared_ptr<Endpoint> Connect(const std::string& addr) const;
+
+    MountConfig cfg_;
+    RpcClients* rpc_;
+
+    std::mutex refresh_mu_;  // one ListNodes in flight at a time
+    // Guards everything below; Route() only takes it shared.
+    mutable std::shared_mutex mu_;
+    bool loaded_{false};
+    uint64_t epoch_{0};      // 0 forces a full table on the next refresh
+    Clock::time_point next_refresh_{};
+    // Only real, online nodes with a usable endpoint have an entry.
+    std::unordered_map<std::string, std::shared_ptr<Endpoint>> direct_;
+    std::unordered_map<std::string, Clock::time_point> suspect_until_;
+    struct Load {
+        uint64_t in_flight_io{0};
+        double cpu_usage{0.0};
+    };
+    // Refreshed with every ListNodes reply, also when the epoch is unchanged.
+    std::unordered_map<std::string, Load> loads_;
+
+    std::mutex latency_mu_;
+    std::unordered_map<std::string, double> latency_us_;  // EWMA per node
+};
@@ -0,0 +1,164 @@
+#include "PageCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+PageCache::PageCache(size_t page_size, size_t capacity_bytes, size_t shards)
+    : page_size_(page_size > 0 ? page_size : 1),
+      shards_(std::max<size_t>(1, shards)) {
+    const size_t total_pages = std::max<size_t>(1, capacity_bytes / page_size_);
+    max_pages_ = std::max<size_t>(1, total_pages / shards_.size());
+}
+
+PageCache::PagePtr PageCache::Reserve(uint64_t inode, uint64_t index) {
+    Shard& shard = ShardFor(inode, index);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    if (shard.pages.count(Key{inode, index}) != 0) {
+        return nullptr;
+    }
+    if (!MakeRoomLocked(shard)) {
+        return nullptr;
+    }
+    auto page = std::make_shared<Page>();
+    page->inode = inode;
+    page->index = index;
+    page->lru = shard.lru.end();
+    shard.pages.emplace(Key{inode, index}, page);
+    return page;
+}
+
+void PageCache::Complete(const PagePtr& page, const char* data, size_t n) {
+    if (!page) {
+        return;
+    }
+    n = std::min(n, page_size_);
+    Shard& shard = ShardFor(page->inode, page->index);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    page->data.assign(data, data + n);
+    page->valid = n;
+    page->state = Page::State::Ready;
+    if (page->attached) {
+        shard.lru.push_front(page);
+        page->lru = shard.lru.begin();
+    }
+    shard.cv.notify_all();
+}
+
+void PageCache::Abort(const PagePtr& page) {
+    if (!page) {
+        return;
+    }
+    Shard& shard = ShardFor(page->inode, page->index);
+    std::lock_guard<std::mutex> lk(shard.mu);
+    page->state = Page::State::Failed;
+    DetachLocked(shard, page);
+    shard.cv.notify_all();
+}
+
+size_t PageCache::Read(uint64_t inode, uint64_t offset, size_t len, char* dst) {
+    char* out = dst;
+    return Read(inode, offset, len, [&out](const char* data, size_t n) {
+        std::memcpy(out, data, n);
+        out += n;
+    });
+}
+
+size_t PageCache::Read(uint64_t inode, uint64_t offset, size_t len, const Sink& sink) {
+    size_t copied = 0;
+    while (copied < len) {
+        const uint64_t pos = offset + copied;
+        const uint64_t index = pos / page_size_;
+        Shard& shard = ShardFor(inode, index);
+        std::unique_lock<std::mutex> lk(shard.mu);
+        auto it = shard.pages.find(Key{inode, index});
+        if (it == shard.pages.end()) {
+            break;
+        }
+        PagePtr page = it->second;
+        shard.cv.wait(lk, [&] { return page->state != Page::State::Loading; });
+        if (page->state != Page::State::Ready) {
+            break;
+        }
+        const size_t in_page = static_cast<size_t>(pos % page_size_);
+        if (in_page >= page->valid) {
+            break;
+        }
+        const size_t n = std::min(len - copied, page->valid - in_page);
+        sink(page->data.data() + in_page, n);
+        copied += n;
+        if (page->attached && page->lru != shard.lru.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, page->lru);
+        }
+        if (page->valid < page_size_) {
+            break;
+        }
+    }
+    return copied;
+}
+
+void PageCache::Invalidate(uint64_t inode, uint64_t offset, uint64_t len) {
+    if (len == 0) {
+        return;
+    }
+    const uint64_t first = offset / page_size_;
+    const uint64_t last = (offset + len - 1) / page_size_;
+    if (last - first >= max_pages_ * shards_.size()) {
+        // Wider than the whole cache: scanning is cheaper than probing every index.
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lk(shard.mu);
+            for (auto it = shard.pages.begin(); it != shard.pages.end();) {
+                PagePtr page = it->second;
+                ++it;
+                if (page->inode == inode && page->index >= first && page->index <= last) {
+                    DetachLocked(shard, page);
+                }
+            }
+        }
+        return;
+    }
+    for (uint64_t idx = first; idx <= last; ++idx) {
+        Shard& shard = ShardFor(inode, idx);
+        std::lock_guard<std::mutex> lk(shard.mu);
+        auto it = shard.pages.find(Key{inode, idx});
+        if (it != shard.pages.end()) {
+            DetachLocked(shard, it->second);
+        }
+    }
+}
+
+void PageCache::InvalidateInode(uint64_t inode) {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lk(shard.mu);
+        for (auto it = shard.pages.begin(); it != shard.pages.end();) {
+            PagePtr page = it->second;
+            ++it;
+            if (page->inode == inode) {
+                DetachLocked(shard, page);
+            }
+        }
+    }
+}
+
+void PageCache::DetachLocked(Shard& shard, const PagePtr& page) {
+    if (!page->attached) {
+        return;
+    }
+    page->attached = false;
+    if (page->lru != shard.lru.end()) {
+        shard.lru.erase(page->lru);
+        page->lru = shard.lru.end();
+    }
+    shard.pages.erase(Key{page->inode, page->index});
+}
+
+bool PageCache::MakeRoomLocked(Shard& shard) {
+    while (shard.pages.size() >= max_pages_) {
+        if (shard.lru.empty()) {
+            // Everything left is still loading.
+            return false;
+        }
+        PagePtr victim = shard.lru.back();
+        DetachLocked(shard, victim);
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Bounded client-side cache of fixed-size file pages, keyed by (inode, page
+// index). Pages are reserved before their data is fetched so concurrent
+// readers wait on an in-flight page instead of fetching it again. The cache is
+// split into independently locked shards; each evicts its ready pages LRU once
+// its share of the byte budget is reached.
+class PageCache {
+public:
+    struct Page {
+        enum class State { Loading, Ready, Failed };
+        uint64_t inode{0};
+        uint64_t index{0};
+        State state{State::Loading};
+        std::vector<char> data;
+        size_t valid{0};         // < page size only for the page holding EOF
+        bool attached{true};     // false once invalidated; Complete() then drops it
+        std::list<std::shared_ptr<Page>>::iterator lru;
+    };
+    using PagePtr = std::shared_ptr<Page>;
+
+    PageCache(size_t page_size, size_t capacity_bytes, size_t shards = 16);
+
+    size_t page_size() const { return page_size_; }
+
+    // Claims page `index` of inode for loading. Returns nullptr when the page is
+    // already cached or in flight, or when no room can be made for it.
+    PagePtr Reserve(uint64_t inode, uint64_t index);
+    // Publishes n bytes for a reserved page and wakes waiting readers.
+    void Complete(const PagePtr& page, const char* data, size_t n);
+    void Abort(const PagePtr& page);
+
+    // Receives consecutive pieces of cached data; called with the shard locked.
+    using Sink = std::function<void(const char* data, size_t len)>;
+
+    // Hands the cached prefix of [offset, offset + len) to sink, waiting for
+    // pages that are still loading. Returns the number of bytes delivered.
+    size_t Read(uint64_t inode, uint64_t offset, size_t len, const Sink& sink);
+    // Same, copying into dst.
+    size_t Read(uint64_t inode, uint64_t offset, size_t len, char* dst);
+
+    // Drops pages overlapping [offset, offset + len), or every page of inode.
+    void Invalidate(uint64_t inode, uint64_t offset, uint64_t len);
+    void InvalidateInode(uint64_t inode);
+
+private:
+    struct Key {
+        uint64_t inode;
+        uint64_t index;
+        bool operator==(const Key& o) const { return inode == o.inode && index == o.index; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<uint64_t>()(k.inode * 0x9E3779B97F4A7C15ULL ^ k.index);
+        }
+    };
+
+    struct Shard {
+        std::mutex mu;
+        std::condition_variable cv;
+        std::unordered_map<Key, PagePtr, KeyHash> pages;
+        std::list<PagePtr> lru;  // ready pages, most recently used first
+    };
+
+    Shard& ShardFor(uint64_t inode, uint64_t index) {
+        return shards_[KeyHash()(Key{inode, index}) % shards_.size()];
+    }
+    static void DetachLocked(Shard& shard, const PagePtr& page);
+    bool MakeRoomLocked(Shard& shard);
+
+    const size_t page_size_;
+    size_t max_pages_;  // per shard
+    std::vector<Shard> shards_;
+};
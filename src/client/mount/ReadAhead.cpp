@@ -0,0 +1,175 @@
+#include "ReadAhead.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+ReadAhead::ReadAhead(const Options& opts, Fetcher fetch)
+    : opts_(opts), fetch_(std::move(fetch)), cache_(opts.page_size, opts.cache_bytes) {
+    opts_.page_size = cache_.page_size();
+    opts_.extent_bytes = std::max(opts_.extent_bytes, opts_.page_size);
+    opts_.min_window = std::min(opts_.min_window, opts_.max_window);
+    const int threads = std::max(1, opts_.threads);
+    workers_.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ReadAhead::~ReadAhead() {
+    {
+        std::lock_guard<std::mutex> lk(task_mu_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    for (auto& task : tasks_) {
+        for (auto& page : task.pages) {
+            cache_.Abort(page);
+        }
+    }
+}
+
+size_t ReadAhead::ReadCached(uint64_t inode, uint64_t offset, size_t len, char* dst) {
+    return cache_.Read(inode, offset, len, dst);
+}
+
+size_t ReadAhead::ReadCached(uint64_t inode, uint64_t offset, size_t len,
+                             const PageCache::Sink& sink) {
+    return cache_.Read(inode, offset, len, sink);
+}
+
+void ReadAhead::OnRead(Stream& st, const InodeInfo& info, uint64_t offset, size_t len,
+                       uint64_t file_size) {
+    uint64_t from = 0;
+    uint64_t to = 0;
+    {
+        std::lock_guard<std::mutex> lk(st.mu);
+        const uint64_t generation = generation_.load(std::memory_order_acquire);
+        if (st.generation != generation) {
+            st.ra_end = 0;
+            st.window = 0;
+            st.generation = generation;
+        }
+        const uint64_t end = offset + len;
+        // A read that starts where the last one ended, or skips ahead inside
+        // the prefetched range, keeps the stream sequential.
+        const bool sequential = offset == st.prev_end || (offset > st.prev_end && offset < st.ra_end);
+        st.prev_end = end;
+        if (!sequential) {
+            st.window = 0;
+            st.ra_end = 0;
+            return;
+        }
+        if (len == 0) {
+            return;
+        }
+        st.ra_end = std::max(st.ra_end, end);
+        if (st.window != 0 && st.ra_end - end >= st.window / 2) {
+            return;
+        }
+        st.window = st.window == 0
+                        ? std::min(opts_.max_window, std::max(opts_.min_window, 2 * len))
+                        : std::min(opts_.max_window, st.window * 2);
+        from = st.ra_end;
+        to = std::min<uint64_t>(end + st.window, file_size);
+        if (to <= from) {
+            return;
+        }
+        st.ra_end = to;
+    }
+    Schedule(info, from, to, file_size);
+}
+
+void ReadAhead::Invalidate(uint64_t inode, uint64_t offset, uint64_t len) {
+    cache_.Invalidate(inode, offset, len);
+}
+
+void ReadAhead::InvalidateInode(uint64_t inode) {
+    cache_.InvalidateInode(inode);
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void ReadAhead::Schedule(const InodeInfo& info, uint64_t from, uint64_t to, uint64_t file_size) {
+    const size_t ps = opts_.page_size;
+    const size_t pages_per_task = opts_.extent_bytes / ps;
+    std::vector<Task> batch;
+    Task cur;
+    auto flush = [&] {
+        if (!cur.pages.empty()) {
+            batch.push_back(std::move(cur));
+        }
+        cur = Task{};
+    };
+    for (uint64_t idx = from / ps; idx * ps < to; ++idx) {
+        auto page = cache_.Reserve(info.inode, idx);
+        if (!page) {
+            // Cached, in flight or no room: the next run of pages starts a new task.
+            flush();
+            continue;
+        }
+        if (cur.pages.empty()) {
+            cur.info = info;
+            cur.offset = idx * ps;
+            cur.file_size = file_size;
+        }
+        cur.pages.push_back(std::move(page));
+        if (cur.pages.size() >= pages_per_task) {
+            flush();
+        }
+    }
+    flush();
+    if (batch.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(task_mu_);
+        for (auto& task : batch) {
+            tasks_.push_back(std::move(task));
+        }
+    }
+    task_cv_.notify_all();
+}
+
+void ReadAhead::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lk(task_mu_);
+            task_cv_.wait(lk, [this] { return stopping_ || !tasks_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        RunTask(task);
+    }
+}
+
+void ReadAhead::RunTask(Task& task) {
+    const size_t ps = opts_.page_size;
+    const uint64_t span = static_cast<uint64_t>(task.pages.size()) * ps;
+    const size_t len = task.offset < task.file_size
+                           ? static_cast<size_t>(std::min<uint64_t>(span, task.file_size - task.offset))
+                           : 0;
+    std::vector<char> buf(len);
+    size_t got = 0;
+    int rc = len > 0 ? fetch_(task.info, task.offset, len, buf.data(), got) : 0;
+    if (rc != 0) {
+        std::cerr << "[ReadAhead] prefetch failed inode=" << task.info.inode
+                  << " offset=" << task.offset << " rc=" << rc << std::endl;
+    }
+    for (size_t i = 0; i < task.pages.size(); ++i) {
+        const size_t begin = i * ps;
+        if (rc != 0 || got <= begin) {
+            cache_.Abort(task.pages[i]);
+            continue;
+        }
+        cache_.Complete(task.pages[i], buf.data() + begin, std::min(ps, got - begin));
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "InodeInfo.h"
+#include "PageCache.h"
+
+// Sequential read detection per open file (a Stream, owned by the file
+// handle) with an asynchronous read-ahead window. The window starts at max(min_window, 2 * request) on the first
+// sequential read and doubles every time it is refilled, up to max_window; a
+// non-sequential read collapses it. Prefetched pages land in a PageCache
+// shared by all open files and are fetched by a small worker pool.
+class ReadAhead {
+public:
+    struct Options {
+        size_t page_size{128 * 1024};
+        size_t cache_bytes{256ULL << 20};
+        size_t min_window{256 * 1024};
+        size_t max_window{8ULL << 20};
+        // Pages fetched by one worker request; also the unit RPCs are issued in.
+        size_t extent_bytes{1ULL << 20};
+        int threads{4};
+    };
+
+    // Pattern state of one open file; lives in the file handle.
+    struct Stream {
+        std::mutex mu;
+        uint64_t prev_end{0};
+        uint64_t ra_end{0};    // prefetch has been queued up to here
+        size_t window{0};
+        uint64_t generation{0};  // InvalidateInode() count this state was built on
+    };
+
+    // Synchronously reads [offset, offset + len) of the file into buf.
+    using Fetcher = std::function<int(const InodeInfo& info, uint64_t offset, size_t len,
+                                      char* buf, size_t& out_bytes)>;
+
+    ReadAhead(const Options& opts, Fetcher fetch);
+    ~ReadAhead();
+
+    ReadAhead(const ReadAhead&) = delete;
+    ReadAhead& operator=(const ReadAhead&) = delete;
+
+    // Copies the cached prefix of the range into dst; returns bytes copied.
+    size_t ReadCached(uint64_t inode, uint64_t offset, size_t len, char* dst);
+    size_t ReadCached(uint64_t inode, uint64_t offset, size_t len, const PageCache::Sink& sink);
+
+    // Feeds a completed read into the stream's pattern detector and, when it is
+    // sequential and the window is running low, queues prefetches up to file_size.
+    void OnRead(Stream& st, const InodeInfo& info, uint64_t offset, size_t len, uint64_t file_size);
+
+    void Invalidate(uint64_t inode, uint64_t offset, uint64_t len);
+    void InvalidateInode(uint64_t inode);
+
+private:
+    struct Task {
+        InodeInfo info;
+        uint64_t offset{0};
+        uint64_t file_size{0};
+        std::vector<PageCache::PagePtr> pages;
+    };
+
+    void Schedule(const InodeInfo& info, uint64_t from, uint64_t to, uint64_t file_size);
+    void WorkerLoop();
+    void RunTask(Task& task);
+
+    Options opts_;
+    Fetcher fetch_;
+    PageCache cache_;
+
+    // Bumped by InvalidateInode so streams drop a prefetch horizon whose pages are gone.
+    std::atomic<uint64_t> generation_{0};
+
+    std::mutex task_mu_;
+    std::condition_variable task_cv_;
+    std::deque<Task> tasks_;
+    bool stopping_{false};
+    std::vector<std::thread> workers_;
+};
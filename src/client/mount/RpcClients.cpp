@@ -19,5 +19,6 @@ bool RpcClients::Init() {
 
     mds_stub_ = std::make_unique<rpc::MdsService_Stub>(mds_channel_.get());
     srm_stub_ = std::make_unique<storagenode::StorageService_Stub>(srm_channel_.get());
+    cluster_stub_ = std::make_unique<storagenode::ClusterManagerService_Stub>(srm_channel_.get());
     return true;
 }
@@ -5,6 +5,7 @@
 
 #include <brpc/channel.h>
 
+#include "cluster_manager.pb.h"
 #include "mds.pb.h"
 #include "storage_node.pb.h"
 #include "MountConfig.h"
@@ -21,6 +22,8 @@ public:
 
     rpc::MdsService_Stub* mds() { return mds_stub_.get(); }
     storagenode::StorageService_Stub* srm() { return srm_stub_.get(); }
+    // ClusterManagerService is served on the same SRM port as the gateway.
+    storagenode::ClusterManagerService_Stub* cluster() { return cluster_stub_.get(); }
 
 private:
     MountConfig cfg_;
@@ -28,4 +31,5 @@ private:
     std::unique_ptr<brpc::Channel> srm_channel_;
     std::unique_ptr<rpc::MdsService_Stub> mds_stub_;
     std::unique_ptr<storagenode::StorageService_Stub> srm_stub_;
+    std::unique_ptr<storagenode::ClusterManagerService_Stub> cluster_stub_;
 };
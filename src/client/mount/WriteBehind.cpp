@@ -0,0 +1,222 @@
+#include "WriteBehind.h"
+
+#include <algorithm>
+#include <iostream>
+
+WriteBehind::WriteBehind(const Options& opts, Writer writer, SizeUpdater update_size)
+    : opts_(opts), writer_(std::move(writer)), update_size_(std::move(update_size)) {
+    opts_.max_inflight = std::max<size_t>(1, opts_.max_inflight);
+    const int threads = std::max(1, opts_.threads);
+    workers_.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+WriteBehind::~WriteBehind() {
+    {
+        std::lock_guard<std::mutex> lk(task_mu_);
+        stopping_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+void WriteBehind::Attach(Handle& h, Inode& ino, const InodeInfo& info) {
+    std::lock_guard<std::mutex> lk(ino.mu);
+    h.owner = &ino;
+    h.info = info;
+    ino.inode = info.inode;
+    ino.handles.push_back(&h);
+}
+
+int WriteBehind::Write(Handle& h, const char* buf, size_t len, uint64_t offset) {
+    Inode& ino = *h.owner;
+    std::unique_lock<std::mutex> lk(ino.mu);
+    if (int err = TakeError(h)) {
+        return err;
+    }
+    if (!h.data.empty() &&
+        (offset != h.start + h.data.size() || h.data.size() + len > opts_.buffer_bytes)) {
+        SubmitLocked(lk, h);
+    }
+    if (h.data.empty()) {
+        h.start = offset;
+        h.data.reserve(std::max(opts_.buffer_bytes, len));
+    }
+    h.data.insert(h.data.end(), buf, buf + len);
+    ino.dirty_bytes.fetch_add(len, std::memory_order_acq_rel);
+    if (h.data.size() >= opts_.buffer_bytes) {
+        SubmitLocked(lk, h);
+    }
+    return 0;
+}
+
+int WriteBehind::Flush(Handle& h) {
+    if (!h.owner) {
+        return 0;
+    }
+    Inode& ino = *h.owner;
+    std::unique_lock<std::mutex> lk(ino.mu);
+    if (!h.data.empty()) {
+        SubmitLocked(lk, h);
+    }
+    ino.cv.wait(lk, [&] { return h.inflight == 0; });
+    return TakeError(h);
+}
+
+int WriteBehind::Release(Handle& h) {
+    if (!h.owner) {
+        return 0;
+    }
+    int rc = Flush(h);
+    Inode& ino = *h.owner;
+    std::lock_guard<std::mutex> lk(ino.mu);
+    ino.handles.erase(std::remove(ino.handles.begin(), ino.handles.end(), &h), ino.handles.end());
+    h.owner = nullptr;
+    return rc;
+}
+
+void WriteBehind::FlushInode(Inode& ino) {
+    std::unique_lock<std::mutex> lk(ino.mu);
+    // SubmitLocked may drop the lock, so work on a snapshot of the handle list.
+    std::vector<Handle*> open = ino.handles;
+    for (Handle* h : open) {
+        if (!h->data.empty()) {
+            SubmitLocked(lk, *h);
+        }
+    }
+    ino.cv.wait(lk, [&] {
+        return std::all_of(ino.handles.begin(), ino.handles.end(),
+                           [](const Handle* h) { return h->inflight == 0; });
+    });
+}
+
+void WriteBehind::ResetInode(Inode& ino, uint64_t size) {
+    std::lock_guard<std::mutex> sl(ino.size_mu);
+    std::lock_guard<std::mutex> lk(ino.mu);
+    ino.durable_end = size;
+    ino.published_end = size;
+}
+
+void WriteBehind::SubmitLocked(std::unique_lock<std::mutex>& lk, Handle& h) {
+    Inode& ino = *h.owner;
+    Task task;
+    task.handle = &h;
+    task.offset = h.start;
+    task.data = std::move(h.data);
+    h.data = std::vector<char>();
+    h.start = 0;
+    // Counted before waiting so Flush() on another thread also waits for this data.
+    ++h.inflight;
+    // Tickets keep a handle's flushes in submission order while they wait.
+    const uint64_t ticket = h.next_ticket++;
+
+    const uint64_t lo = task.offset;
+    const uint64_t hi = lo + task.data.size();
+    ino.cv.wait(lk, [&] {
+        if (h.serving != ticket || h.issued >= opts_.max_inflight) {
+            return false;
+        }
+        return std::none_of(ino.inflight_ranges.begin(), ino.inflight_ranges.end(),
+                            [&](const std::pair<uint64_t, uint64_t>& r) {
+                                return r.first < hi && lo < r.second;
+                            });
+    });
+    ++h.issued;
+    ++h.serving;
+    ino.inflight_ranges.emplace_back(lo, hi);
+    ino.cv.notify_all();
+    {
+        std::lock_guard<std::mutex> tl(task_mu_);
+        tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+}
+
+void WriteBehind::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lk(task_mu_);
+            task_cv_.wait(lk, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        RunTask(task);
+    }
+}
+
+void WriteBehind::RunTask(Task& task) {
+    Handle& h = *task.handle;
+    Inode& ino = *h.owner;
+    const size_t len = task.data.size();
+    const uint64_t end = task.offset + len;
+    int rc = writer_(h.info, task.offset, task.data.data(), len);
+    bool grew = false;
+    if (rc == 0) {
+        std::lock_guard<std::mutex> lk(ino.mu);
+        if (end > ino.durable_end) {
+            ino.durable_end = end;
+            grew = true;
+        }
+    } else {
+        std::cerr << "[WriteBehind] flush failed inode=" << ino.inode << " offset=" << task.offset
+                  << " len=" << len << " rc=" << rc << std::endl;
+    }
+    // The size goes out before the flush is retired so Flush() covers it too.
+    if (grew) {
+        PublishSize(ino);
+    }
+    {
+        std::lock_guard<std::mutex> lk(ino.mu);
+        if (rc != 0 && h.error == 0) {
+            h.error = rc;
+        }
+        auto r = std::find(ino.inflight_ranges.begin(), ino.inflight_ranges.end(),
+                           std::make_pair(task.offset, end));
+        if (r != ino.inflight_ranges.end()) {
+            ino.inflight_ranges.erase(r);
+        }
+        --h.issued;
+        --h.inflight;
+        ino.dirty_bytes.fetch_sub(len, std::memory_order_acq_rel);
+        ino.cv.notify_all();
+    }
+}
+
+void WriteBehind::PublishSize(Inode& ino) {
+    std::lock_guard<std::mutex> sl(ino.size_mu);
+    uint64_t target = 0;
+    {
+        std::lock_guard<std::mutex> lk(ino.mu);
+        target = ino.durable_end;
+    }
+    if (target <= ino.published_end) {
+        return;
+    }
+    int rc = update_size_(ino.inode, target);
+    if (rc == 0) {
+        ino.published_end = target;
+        return;
+    }
+    std::lock_guard<std::mutex> lk(ino.mu);
+    for (Handle* h : ino.handles) {
+        if (h->error == 0) {
+            h->error = rc;
+        }
+    }
+}
+
+int WriteBehind::TakeError(Handle& h) {
+    int err = h.error;
+    h.error = 0;
+    return err;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "InodeInfo.h"
+
+// Per-handle write-behind buffer. Contiguous writes on a handle are coalesced
+// into one buffer of up to buffer_bytes, which is then flushed by a worker
+// pool while the application keeps writing into a fresh buffer. Each handle
+// has at most max_inflight flushes outstanding; a writer that hits the limit
+// waits. Flushes whose ranges overlap on the same inode are serialized so a
+// rewrite never lands before older data. Errors from background flushes are
+// sticky and surface on the next Write/Flush/Release of the handle.
+//
+// State lives with the caller: an Inode per open inode and a Handle per open
+// file. Writers only lock their inode; the shared task queue is touched once
+// per flushed buffer, not once per write.
+class WriteBehind {
+public:
+    struct Options {
+        size_t buffer_bytes{8ULL << 20};
+        size_t max_inflight{4};
+        int threads{4};
+    };
+
+    struct Handle;
+
+    struct Inode {
+        uint64_t inode{0};
+        std::mutex mu;
+        std::condition_variable cv;
+        std::vector<Handle*> handles;
+        std::vector<std::pair<uint64_t, uint64_t>> inflight_ranges;
+        uint64_t durable_end{0};
+        std::atomic<size_t> dirty_bytes{0};  // buffered or in flight
+
+        std::mutex size_mu;  // orders size updates so a smaller one never follows a larger
+        uint64_t published_end{0};
+    };
+
+    struct Handle {
+        Inode* owner{nullptr};
+        InodeInfo info;
+        uint64_t start{0};
+        std::vector<char> data;
+        size_t inflight{0};  // submitted flushes, including ones waiting for a slot
+        size_t issued{0};    // queued or running; bounded by max_inflight
+        uint64_t next_ticket{0};
+        uint64_t serving{0};
+        int error{0};
+    };
+
+    // Synchronously writes the whole range; returns 0 or -errno.
+    using Writer = std::function<int(const InodeInfo& info, uint64_t offset,
+                                     const char* data, size_t len)>;
+    // Publishes a new durable file size (one call per flush that grew the file).
+    using SizeUpdater = std::function<int(uint64_t inode, uint64_t size)>;
+
+    WriteBehind(const Options& opts, Writer writer, SizeUpdater update_size);
+    // Callers must Release() every handle first.
+    ~WriteBehind();
+
+    WriteBehind(const WriteBehind&) = delete;
+    WriteBehind& operator=(const WriteBehind&) = delete;
+
+    // Binds a freshly opened handle to its inode state.
+    void Attach(Handle& h, Inode& ino, const InodeInfo& info);
+    // Buffers the write; returns 0, or a pending error from an earlier flush.
+    int Write(Handle& h, const char* buf, size_t len, uint64_t offset);
+    // Pushes out the handle's buffer and waits for all of its flushes.
+    int Flush(Handle& h);
+    // Flush + detach from the inode.
+    int Release(Handle& h);
+    // Makes every buffered byte of the inode durable; used before reads and truncate.
+    void FlushInode(Inode& ino);
+    // The inode was truncated or removed: restart its durable size at size.
+    void ResetInode(Inode& ino, uint64_t size);
+
+    // Cheap check for the read path.
+    static bool HasDirty(const Inode& ino) {
+        return ino.dirty_bytes.load(std::memory_order_acquire) > 0;
+    }
+
+private:
+    struct Task {
+        Handle* handle{nullptr};
+        uint64_t offset{0};
+        std::vector<char> data;
+    };
+
+    void SubmitLocked(std::unique_lock<std::mutex>& lk, Handle& h);
+    void WorkerLoop();
+    void RunTask(Task& task);
+    void PublishSize(Inode& ino);
+    static int TakeError(Handle& h);
+
+    Options opts_;
+    Writer writer_;
+    SizeUpdater update_size_;
+
+    std::mutex task_mu_;
+    std::condition_variable task_cv_;
+    std::deque<Task> tasks_;
+    bool stopping_{false};
+    std::vector<std::thread> workers_;
+};
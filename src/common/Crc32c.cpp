@@ -0,0 +1,73 @@
+#include "Crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define ZB_CRC32C_X86 1
+#endif
+
+namespace {
+
+struct Crc32cTable {
+    uint32_t t[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            t[i] = c;
+        }
+    }
+};
+
+// Both kernels work on the inverted register value.
+uint32_t UpdateSoft(uint32_t c, const uint8_t* p, size_t n) {
+    static const Crc32cTable table;
+    while (n--) {
+        c = table.t[(c ^ *p++) & 0xff] ^ (c >> 8);
+    }
+    return c;
+}
+
+#ifdef ZB_CRC32C_X86
+__attribute__((target("sse4.2")))
+uint32_t UpdateHw(uint32_t c32, const uint8_t* p, size_t n) {
+    uint64_t c = c32;
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+    }
+    c32 = static_cast<uint32_t>(c);
+    while (n--) {
+        c32 = _mm_crc32_u8(c32, *p++);
+    }
+    return c32;
+}
+#endif
+
+uint32_t Update(uint32_t c, const uint8_t* p, size_t n) {
+#ifdef ZB_CRC32C_X86
+    static const bool hw = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }();
+    if (hw) {
+        return UpdateHw(c, p, n);
+    }
+#endif
+    return UpdateSoft(c, p, n);
+}
+
+} // namespace
+
+uint32_t Crc32c(const void* data, size_t len) {
+    return Crc32cExtend(0, data, len);
+}
+
+uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t len) {
+    return ~Update(~crc, static_cast<const uint8_t*>(data), len);
+}
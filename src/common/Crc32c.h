@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli), using the SSE4.2 crc32 instruction when the CPU has it
+// (checked at run time) and a table otherwise. Crc32c("123456789") == 0xE3069283.
+uint32_t Crc32c(const void* data, size_t len);
+
+// Continues crc (a previous Crc32c/Crc32cExtend result) over more bytes, so
+// Crc32cExtend(Crc32c(a), b) == Crc32c(a + b). Crc32cExtend(0, x) == Crc32c(x).
+uint32_t Crc32cExtend(uint32_t crc, const void* data, size_t len);
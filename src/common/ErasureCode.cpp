@@ -0,0 +1,278 @@
+#include "ErasureCode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ZB_EC_X86 1
+#endif
+
+namespace {
+
+// GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d).
+struct GfTables {
+    uint8_t exp[512];
+    uint8_t log[256];
+
+    GfTables() {
+        unsigned x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = static_cast<uint8_t>(x);
+            log[x] = static_cast<uint8_t>(i);
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+    }
+};
+
+const GfTables& Gf() {
+    static const GfTables tables;
+    return tables;
+}
+
+uint8_t GfMul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    const auto& t = Gf();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+uint8_t GfInv(uint8_t a) {
+    const auto& t = Gf();
+    return t.exp[255 - t.log[a]];
+}
+
+// c * x == lo[x & 15] ^ hi[x >> 4]; this is what the SIMD kernels shuffle with.
+struct NibbleTables {
+    uint8_t lo[16];
+    uint8_t hi[16];
+
+    explicit NibbleTables(uint8_t c) {
+        for (int i = 0; i < 16; ++i) {
+            lo[i] = GfMul(c, static_cast<uint8_t>(i));
+            hi[i] = GfMul(c, static_cast<uint8_t>(i << 4));
+        }
+    }
+};
+
+void MulAddScalar(const NibbleTables& t, const uint8_t* src, uint8_t* dst, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] ^= t.lo[src[i] & 0x0f] ^ t.hi[src[i] >> 4];
+    }
+}
+
+#ifdef ZB_EC_X86
+__attribute__((target("ssse3")))
+void MulAddSsse3(const NibbleTables& t, const uint8_t* src, uint8_t* dst, size_t len) {
+    const __m128i tlo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.lo));
+    const __m128i thi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t.hi));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i l = _mm_and_si128(s, mask);
+        const __m128i h = _mm_and_si128(_mm_srli_epi16(s, 4), mask);
+        const __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, l), _mm_shuffle_epi8(thi, h));
+        __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(d, _mm_xor_si128(_mm_loadu_si128(d), p));
+    }
+    MulAddScalar(t, src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx2")))
+void MulAddAvx2(const NibbleTables& t, const uint8_t* src, uint8_t* dst, size_t len) {
+    const __m256i tlo =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t.lo)));
+    const __m256i thi =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(t.hi)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i l = _mm256_and_si256(s, mask);
+        const __m256i h = _mm256_and_si256(_mm256_srli_epi16(s, 4), mask);
+        const __m256i p =
+            _mm256_xor_si256(_mm256_shuffle_epi8(tlo, l), _mm256_shuffle_epi8(thi, h));
+        __m256i* d = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(d, _mm256_xor_si256(_mm256_loadu_si256(d), p));
+    }
+    MulAddScalar(t, src + i, dst + i, len - i);
+}
+#endif
+
+using MulAddFn = void (*)(const NibbleTables&, const uint8_t*, uint8_t*, size_t);
+
+struct Kernel {
+    MulAddFn fn{MulAddScalar};
+    const char* name{"scalar"};
+
+    Kernel() {
+#ifdef ZB_EC_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            fn = MulAddAvx2;
+            name = "avx2";
+        } else if (__builtin_cpu_supports("ssse3")) {
+            fn = MulAddSsse3;
+            name = "ssse3";
+        }
+#endif
+    }
+};
+
+const Kernel& SelectedKernel() {
+    static const Kernel kernel;
+    return kernel;
+}
+
+// Work on slices small enough that every output slice stays in L1 while all
+// inputs are folded into it.
+constexpr size_t kSlice = 16 * 1024;
+
+// out[r] = sum_j rows[r * n + j] * in[j], for r < nout.
+void MatMul(const uint8_t* rows, int nout, const uint8_t* const* in, int n,
+            uint8_t* const* out, size_t len) {
+    const Kernel& kernel = SelectedKernel();
+    std::vector<NibbleTables> tables;
+    tables.reserve(static_cast<size_t>(nout) * static_cast<size_t>(n));
+    for (int i = 0; i < nout * n; ++i) {
+        tables.emplace_back(rows[i]);
+    }
+    for (size_t off = 0; off < len; off += kSlice) {
+        const size_t cur = std::min(kSlice, len - off);
+        for (int r = 0; r < nout; ++r) {
+            std::memset(out[r] + off, 0, cur);
+            for (int j = 0; j < n; ++j) {
+                if (rows[r * n + j] != 0) {
+                    kernel.fn(tables[static_cast<size_t>(r * n + j)], in[j] + off, out[r] + off, cur);
+                }
+            }
+        }
+    }
+}
+
+// Gauss-Jordan inversion of the n x n matrix a (row-major) in place.
+bool Invert(std::vector<uint8_t>& a, int n) {
+    std::vector<uint8_t> inv(static_cast<size_t>(n) * n, 0);
+    for (int i = 0; i < n; ++i) {
+        inv[i * n + i] = 1;
+    }
+    for (int col = 0; col < n; ++col) {
+        int pivot = col;
+        while (pivot < n && a[pivot * n + col] == 0) {
+            ++pivot;
+        }
+        if (pivot == n) {
+            return false;
+        }
+        if (pivot != col) {
+            for (int j = 0; j < n; ++j) {
+                std::swap(a[pivot * n + j], a[col * n + j]);
+                std::swap(inv[pivot * n + j], inv[col * n + j]);
+            }
+        }
+        const uint8_t scale = GfInv(a[col * n + col]);
+        for (int j = 0; j < n; ++j) {
+            a[col * n + j] = GfMul(a[col * n + j], scale);
+            inv[col * n + j] = GfMul(inv[col * n + j], scale);
+        }
+        for (int row = 0; row < n; ++row) {
+            const uint8_t f = a[row * n + col];
+            if (row == col || f == 0) {
+                continue;
+            }
+            for (int j = 0; j < n; ++j) {
+                a[row * n + j] ^= GfMul(f, a[col * n + j]);
+                inv[row * n + j] ^= GfMul(f, inv[col * n + j]);
+            }
+        }
+    }
+    a.swap(inv);
+    return true;
+}
+
+} // namespace
+
+ErasureCode::ErasureCode(int data, int parity) : k_(data), m_(parity) {
+    if (data < 1 || parity < 0 || data + parity > 256) {
+        throw std::invalid_argument("ErasureCode: need 1 <= k, 0 <= m, k + m <= 256");
+    }
+    // Cauchy rows 1 / (x_i + y_j) with x_i = k + i and y_j = j: every square
+    // sub-matrix is invertible, so [I; C] is MDS.
+    coef_.resize(static_cast<size_t>(m_) * k_);
+    for (int i = 0; i < m_; ++i) {
+        for (int j = 0; j < k_; ++j) {
+            coef_[i * k_ + j] = GfInv(static_cast<uint8_t>((k_ + i) ^ j));
+        }
+    }
+}
+
+void ErasureCode::Encode(const uint8_t* const* data, uint8_t* const* parity, size_t len) const {
+    if (m_ == 0 || len == 0) {
+        return;
+    }
+    MatMul(coef_.data(), m_, data, k_, parity, len);
+}
+
+bool ErasureCode::Reconstruct(const uint8_t* const* frags, uint8_t* const* out, size_t len) const {
+    // Any k present fragments will do; data fragments first keeps the system sparse.
+    std::vector<int> use;
+    use.reserve(static_cast<size_t>(k_));
+    for (int i = 0; i < k_ + m_ && static_cast<int>(use.size()) < k_; ++i) {
+        if (frags[i] != nullptr) {
+            use.push_back(i);
+        }
+    }
+    if (static_cast<int>(use.size()) < k_) {
+        return false;
+    }
+    std::vector<uint8_t> a(static_cast<size_t>(k_) * k_, 0);
+    for (int r = 0; r < k_; ++r) {
+        const int f = use[r];
+        if (f < k_) {
+            a[r * k_ + f] = 1;
+        } else {
+            std::memcpy(&a[r * k_], &coef_[(f - k_) * k_], static_cast<size_t>(k_));
+        }
+    }
+    if (!Invert(a, k_)) {
+        return false;
+    }
+    std::vector<const uint8_t*> in;
+    in.reserve(use.size());
+    for (int f : use) {
+        in.push_back(frags[f]);
+    }
+    std::vector<uint8_t> rows;
+    std::vector<uint8_t*> dst;
+    for (int j = 0; j < k_; ++j) {
+        if (out[j] == nullptr) {
+            continue;
+        }
+        if (frags[j] != nullptr) {
+            if (out[j] != frags[j]) {
+                std::memcpy(out[j], frags[j], len);
+            }
+            continue;
+        }
+        rows.insert(rows.end(), a.begin() + j * k_, a.begin() + (j + 1) * k_);
+        dst.push_back(out[j]);
+    }
+    if (!dst.empty() && len > 0) {
+        MatMul(rows.data(), static_cast<int>(dst.size()), in.data(), k_, dst.data(), len);
+    }
+    return true;
+}
+
+const char* ErasureCode::KernelName() {
+    return SelectedKernel().name;
+}
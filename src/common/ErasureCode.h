@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Systematic Reed-Solomon RS(k, m) over GF(2^8). Data fragments are stored as
+// is; the m parity fragments come from a Cauchy matrix, so any k of the k + m
+// fragments are enough to rebuild the data. Fragments are byte-wise
+// independent: byte x of every parity fragment depends only on byte x of the
+// data fragments, so any sub-range can be encoded or rebuilt on its own.
+//
+// The multiply-accumulate kernel uses AVX2 or SSSE3 nibble lookups when the
+// CPU has them (checked at run time) and a table-driven loop otherwise.
+class ErasureCode {
+public:
+    // 1 <= data, 0 <= parity, data + parity <= 256.
+    ErasureCode(int data, int parity);
+
+    int data() const { return k_; }
+    int parity() const { return m_; }
+    int width() const { return k_ + m_; }
+
+    // parity[i][0, len) from data[0..k)[0, len).
+    void Encode(const uint8_t* const* data, uint8_t* const* parity, size_t len) const;
+
+    // frags holds width() pointers in fragment order (data first, then parity);
+    // nullptr marks a missing fragment. Every data fragment j with out[j] !=
+    // nullptr is rebuilt into out[j]. Returns false when fewer than data()
+    // fragments are present.
+    bool Reconstruct(const uint8_t* const* frags, uint8_t* const* out, size_t len) const;
+
+    // Name of the kernel in use ("avx2", "ssse3" or "scalar"), for logs and tests.
+    static const char* KernelName();
+
+private:
+    int k_;
+    int m_;
+    // Row i (0 <= i < m) of the Cauchy part: parity i = sum_j coef[i * k + j] * data j.
+    std::vector<uint8_t> coef_;
+};
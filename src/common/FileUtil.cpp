@@ -0,0 +1,73 @@
+#include "FileUtil.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+bool WriteAll(int fd, const void* data, size_t n) {
+    const auto* p = static_cast<const char*>(data);
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool SyncDir(const std::string& dir) {
+    int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(dfd) == 0;
+    const int saved = errno;
+    ::close(dfd);
+    errno = saved;
+    return ok;
+}
+
+std::vector<uint64_t> ListNumberedFiles(const std::string& dir,
+                                        const std::string& prefix,
+                                        const std::string& suffix,
+                                        std::error_code& ec) {
+    std::vector<uint64_t> nums;
+    ec.clear();
+    for (const auto& entry : fs::directory_iterator(dir.empty() ? "." : dir, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        uint64_t n = 0;
+        bool valid = true;
+        for (size_t i = prefix.size(); i < name.size() - suffix.size(); ++i) {
+            const char c = name[i];
+            const uint64_t digit = static_cast<uint64_t>(c - '0');
+            if (c < '0' || c > '9' || n > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+                valid = false;
+                break;
+            }
+            n = n * 10 + digit;
+        }
+        if (valid) {
+            nums.push_back(n);
+        }
+    }
+    if (ec) {
+        nums.clear();
+    }
+    std::sort(nums.begin(), nums.end());
+    return nums;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// splitmix64 finalizer: spreads sequential integer keys (chunk ids, inode
+// numbers) over hash slots, shards and lock stripes.
+inline uint64_t Mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Writes all n bytes at the current file position, across short writes and
+// EINTR. Returns false with errno set on the first failed write.
+bool WriteAll(int fd, const void* data, size_t n);
+
+// fsyncs directory dir ("" means the current directory) so that entries created,
+// renamed or removed in it survive a crash. Returns false with errno set on failure.
+bool SyncDir(const std::string& dir);
+
+// Numbers N of the entries named <prefix>N<suffix> in dir, in ascending order.
+// Names whose N is not a decimal number that fits in 64 bits are ignored. A
+// directory that cannot be listed yields an empty result with ec set.
+std::vector<uint64_t> ListNumberedFiles(const std::string& dir,
+                                        const std::string& prefix,
+                                        const std::string& suffix,
+                                        std::error_code& ec);
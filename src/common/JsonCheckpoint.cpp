@@ -0,0 +1,69 @@
+#include "JsonCheckpoint.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "FileUtil.h"
+
+namespace fs = std::filesystem;
+
+bool LoadJsonCheckpoint(const std::string& path, nlohmann::json& out, std::string& error) {
+    error.clear();
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::error_code ec;
+        if (fs::exists(path, ec) || ec) {
+            error = "cannot open";
+        }
+        return false;
+    }
+    try {
+        in >> out;
+    } catch (const std::exception& ex) {
+        error = ex.what();
+        return false;
+    }
+    return true;
+}
+
+bool SaveJsonCheckpoint(const std::string& path, const nlohmann::json& root, std::string& error) {
+    error.clear();
+    const fs::path out_path(path);
+    const std::string dir = out_path.parent_path().string();
+    std::error_code ec;
+    if (!dir.empty()) {
+        fs::create_directories(dir, ec);
+    }
+    const std::string tmp_path = path + ".tmp";
+    const std::string text = root.dump(2);
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "open " + tmp_path + ": " + std::strerror(errno);
+        return false;
+    }
+    bool ok = WriteAll(fd, text.data(), text.size()) && ::fsync(fd) == 0;
+    const int saved = errno;
+    ::close(fd);
+    if (!ok) {
+        error = "write " + tmp_path + ": " + std::strerror(saved);
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        error = "rename to " + path + ": " + std::strerror(errno);
+        ::unlink(tmp_path.c_str());
+        return false;
+    }
+    if (!SyncDir(dir)) {
+        error = "sync dir of " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
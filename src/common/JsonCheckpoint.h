@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// Small JSON state files (scan cursors and the like) that must survive a crash
+// either as the previous version or the new one, never half written.
+
+// Reads the checkpoint at path into out. Returns false with error empty when
+// the file does not exist, and false with error set when it cannot be read or
+// is not valid JSON.
+bool LoadJsonCheckpoint(const std::string& path, nlohmann::json& out, std::string& error);
+
+// Atomically replaces path with root: creates the parent directory, writes
+// path + ".tmp", fsyncs it, renames it over path and fsyncs the directory.
+// Returns false with error set on the first failing step.
+bool SaveJsonCheckpoint(const std::string& path, const nlohmann::json& root, std::string& error);
@@ -80,7 +80,8 @@ FileSystem::FileSystem(bool create_new)
 
 FileSystem::FileSystem(std::shared_ptr<MdsServer> mds,
                        std::shared_ptr<IVolumeRegistry> volume_registry,
-                       std::shared_ptr<VolumeManager> volume_manager)
+                       std::shared_ptr<VolumeManager> volume_manager,
+                       const WriteBackOptions& write_back)
     : mds_(std::move(mds)),
       volume_manager_(volume_manager ? std::move(volume_manager)
                                    : std::make_shared<VolumeManager>()) {
@@ -103,6 +104,16 @@ FileSystem::FileSystem(std::shared_ptr<MdsServer> mds,
     }
     if (volume_manager_) {
         volume_manager_->set_default_gateway(std::make_shared<LocalStorageGateway>());
+        // 后台刷写新分配的块映射需要写回 inode
+        std::weak_ptr<MdsServer> weak_mds = mds_;
+        volume_manager_->set_flush_listener([weak_mds](const std::shared_ptr<Inode>& flushed) {
+            if (auto mds = weak_mds.lock()) {
+                mds->WriteInode(flushed->inode, *flushed);
+            }
+        });
+        if (write_back.enabled) {
+            volume_manager_->set_write_back_options(write_back);
+        }
     }
     handle_observer_ = std::make_shared<FileSystemHandleObserver>(this);
     if (mds_) {
@@ -114,6 +125,9 @@ FileSystem::~FileSystem() {
     if (handle_observer_) {
         handle_observer_->detach();
     }
+    if (volume_manager_) {
+        volume_manager_->set_flush_listener(nullptr);
+    }
     if (mds_) {
         mds_->set_handle_observer({});
         mds_->set_volume_manager(nullptr);
@@ -136,6 +150,12 @@ void FileSystem::set_volume_manager(std::shared_ptr<VolumeManager> manager) {
     volume_manager_ = std::move(manager);
 }
 
+void FileSystem::set_write_back_options(const WriteBackOptions& options) {
+    if (volume_manager_) {
+        volume_manager_->set_write_back_options(options);
+    }
+}
+
 bool FileSystem::create_root_directory() {
     bool ok = mds_ && mds_->CreateRoot();
     report_bool("create_root_directory", "/", ok,
@@ -286,6 +306,12 @@ bool FileSystem::startup() {
 
 bool FileSystem::shutdown() {
     bool ok = true;
+    if (volume_manager_ && mds_) {
+        for (const auto& flushed : volume_manager_->flush_all()) {
+            auto guard = volume_manager_->lock_inode(flushed->inode);
+            mds_->WriteInode(flushed->inode, *flushed);
+        }
+    }
     if (auto registry = volume_registry()) {
         ok = registry->shutdown() && ok;
     }
@@ -377,7 +403,19 @@ int FileSystem::open(const std::string& path, int flags, mode_t mode) {
 }
 
 int FileSystem::close(int fd) {
+    std::shared_ptr<Inode> inode;
+    {
+        std::lock_guard lk(fd_mutex_);
+        FdTableEntry* entry = find_fd_locked(fd);
+        if (entry) {
+            inode = entry->inode;
+        }
+    }
+    bool flushed = !inode || flush_inode_data(inode);
     int rv = shutdown_fd(fd);
+    if (rv == 0 && !flushed) {
+        rv = -1;
+    }
     report_value("close", std::to_string(fd), rv, rv == 0,
                  "fd removed from table and further IO rejected");
     return rv;
@@ -400,6 +438,37 @@ int FileSystem::shutdown_fd(int fd) {
     return 0;
 }
 
+int FileSystem::fsync(int fd) {
+    std::shared_ptr<Inode> inode;
+    {
+        std::lock_guard lk(fd_mutex_);
+        FdTableEntry* entry = find_fd_locked(fd);
+        if (!entry || !entry->inode) {
+            report_value("fsync", std::to_string(fd), -1, false,
+                         "fd must reference inode before fsync");
+            return -1;
+        }
+        inode = entry->inode;
+    }
+    bool ok = flush_inode_data(inode);
+    report_value("fsync", std::to_string(fd), ok ? 0 : -1, ok,
+                 "buffered data allocated and dispatched to volume");
+    return ok ? 0 : -1;
+}
+
+bool FileSystem::flush_inode_data(const std::shared_ptr<Inode>& inode) {
+    if (!volume_manager_ || !mds_) return false;
+    if (!volume_manager_->has_dirty(inode->inode)) {
+        return true;
+    }
+    if (!volume_manager_->flush_inode(inode)) {
+        return false;
+    }
+    auto guard = volume_manager_->lock_inode(inode->inode);
+    mds_->WriteInode(inode->inode, *inode);
+    return true;
+}
+
 off_t FileSystem::seek(int fd, off_t offset, int whence) {
     std::lock_guard lk(fd_mutex_);
     FdTableEntry* entry = find_fd_locked(fd);
@@ -475,12 +544,16 @@ ssize_t FileSystem::write(int fd, const char* buf, size_t count) {
     }
 
     InodeTimestamp now;
-    inode->setFmTime(now);
-    inode->setFaTime(now);
-    inode->setFcTime(now);
-    mds_->WriteInode(inode->inode, *inode);
+    {
+        // 后台刷写线程可能正在给同一 inode 分配块
+        auto guard = volume_manager_->lock_inode(inode->inode);
+        inode->setFmTime(now);
+        inode->setFaTime(now);
+        inode->setFcTime(now);
+        mds_->WriteInode(inode->inode, *inode);
+    }
     report_value("write", std::to_string(fd), written, true,
-                 "bytes durable; read should return same count");
+                 "bytes written or buffered until fsync/close; read should return same count");
     return written;
 }
 
@@ -523,8 +596,11 @@ ssize_t FileSystem::read(int fd, char* buf, size_t count) {
     }
 
     InodeTimestamp now;
-    inode->setFaTime(now);
-    mds_->WriteInode(inode->inode, *inode);
+    {
+        auto guard = volume_manager_->lock_inode(inode->inode);
+        inode->setFaTime(now);
+        mds_->WriteInode(inode->inode, *inode);
+    }
     report_value("read", std::to_string(fd), read_bytes, true,
                  "buffer now holds bytes written earlier");
     return read_bytes;
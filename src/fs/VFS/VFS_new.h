@@ -56,6 +56,12 @@ private:
      */
     FdTableEntry* find_fd_locked(int fd);
     void force_close_handles(uint64_t inode);
+    /**
+     * @brief 刷写 inode 的脏数据并写回 inode 元数据。
+     * @param inode 目标 inode。
+     * @return 刷写是否成功。
+     */
+    bool flush_inode_data(const std::shared_ptr<Inode>& inode);
 
 public:
     /**
@@ -70,10 +76,12 @@ public:
      * @param mds 元数据服务实例，不能为空。
      * @param volume_registry 卷注册中心实例，可为 nullptr（表示暂不管理卷）。
      * @param volume_manager 卷管理器实例，可为 nullptr（表示暂不管理卷）。
+     * @param write_back 写回缓冲配置，默认关闭（见 WriteBackOptions）。
      */
     FileSystem(std::shared_ptr<MdsServer> mds,
                std::shared_ptr<IVolumeRegistry> volume_registry,
-               std::shared_ptr<VolumeManager> volume_manager = nullptr);
+               std::shared_ptr<VolumeManager> volume_manager = nullptr,
+               const WriteBackOptions& write_back = WriteBackOptions());
 
     /**
      * @brief 获取底层元数据服务对象。
@@ -99,6 +107,12 @@ public:
      */
     void set_volume_manager(std::shared_ptr<VolumeManager> manager);
 
+    /**
+     * @brief 设置卷管理器的写回缓冲参数；后台刷写出的块映射经 MdsServer 持久化。
+     * @param options 新配置。
+     */
+    void set_write_back_options(const WriteBackOptions& options);
+
     /**
      * @brief 创建根目录（若已存在则返回 true，用于幂等初始化）。
      * @return 操作是否成功。
@@ -214,13 +228,20 @@ public:
     int open(const std::string& path, int flags, mode_t mode = 0644);
 
     /**
-     * @brief 关闭文件描述符。
+     * @brief 关闭文件描述符，关闭前刷写该文件的写回缓冲。
      * @param fd 待关闭的文件描述符。
      * @return 成功返回 0，失败返回 -1。
      */
     int close(int fd);
     int shutdown_fd(int fd);
 
+    /**
+     * @brief 刷写文件的写回缓冲并持久化块映射。
+     * @param fd 文件描述符。
+     * @return 成功返回 0，失败返回 -1。
+     */
+    int fsync(int fd);
+
     /**
      * @brief 调整文件当前读写偏移。
      * @param fd 文件描述符。
@@ -232,6 +253,8 @@ public:
 
     /**
      * @brief 写入文件。
+     *
+     * 启用写回缓冲时数据返回前只进入内存脏缓冲，fsync/close 后才保证落盘。
      * @param fd 文件描述符。
      * @param buf 待写入数据缓冲区。
      * @param count 写入字节数。
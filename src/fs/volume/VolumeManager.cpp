@@ -2,12 +2,17 @@
 #include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
 namespace {
 constexpr size_t kBytesPerBlock = BLOCK_SIZE;
 }
 
+VolumeManager::~VolumeManager() {
+    stop_flusher();
+}
+
 void VolumeManager::register_volume(std::shared_ptr<Volume> volume,
                                     std::shared_ptr<IIOGateway> gateway) {
     if (!volume) {
@@ -17,11 +22,13 @@ void VolumeManager::register_volume(std::shared_ptr<Volume> volume,
     VolumeContext ctx;
     ctx.volume = std::move(volume);
     ctx.gateway = std::move(gateway);
+    std::unique_lock lk(volumes_mutex_);
     volumes_[uuid] = std::move(ctx);
 }
 
 bool VolumeManager::set_volume_gateway(const std::string& volume_uuid,
                                        std::shared_ptr<IIOGateway> gateway) {
+    std::unique_lock lk(volumes_mutex_);
     auto it = volumes_.find(volume_uuid);
     if (it == volumes_.end()) {
         return false;
@@ -31,9 +38,33 @@ bool VolumeManager::set_volume_gateway(const std::string& volume_uuid,
 }
 
 void VolumeManager::set_default_gateway(std::shared_ptr<IIOGateway> gateway) {
+    std::unique_lock lk(volumes_mutex_);
     default_gateway_ = std::move(gateway);
 }
 
+void VolumeManager::set_write_back_options(const WriteBackOptions& options) {
+    if (!options.enabled) {
+        stop_flusher();
+        flush_all();
+    }
+    std::lock_guard lk(wb_mutex_);
+    wb_options_ = options;
+    if (options.enabled && !flusher_.joinable()) {
+        flusher_stop_ = false;
+        flusher_ = std::thread([this] { flusher_loop(); });
+    }
+}
+
+void VolumeManager::set_flush_listener(std::function<void(const std::shared_ptr<Inode>&)> listener) {
+    std::lock_guard lk(wb_mutex_);
+    flush_listener_ = std::move(listener);
+}
+
+WriteBackOptions VolumeManager::write_back_options() {
+    std::lock_guard lk(wb_mutex_);
+    return wb_options_;
+}
+
 ssize_t VolumeManager::write_file(const std::shared_ptr<Inode>& inode,
                                   size_t offset,
                                   const char* buf,
@@ -41,6 +72,68 @@ ssize_t VolumeManager::write_file(const std::shared_ptr<Inode>& inode,
     if (!inode || !buf || count == 0) {
         return 0;
     }
+    const uint64_t inode_no = inode->inode;
+    bool buffered = false;
+    bool flushed = true;
+    {
+        std::unique_lock lk(wb_mutex_);
+        flush_cv_.wait(lk, [&] { return fenced_.count(inode_no) == 0; });
+        if (wb_options_.enabled) {
+            auto ctx = resolve_context(inode->getVolumeUUID());
+            if (!ctx || !ctx->volume) {
+                std::cerr << "[VolumeManager] 未找到卷: " << inode->getVolumeUUID() << std::endl;
+                return -1;
+            }
+            auto now = std::chrono::steady_clock::now();
+            DirtyBuffer& buffer = dirty_[inode_no];
+            if (buffer.extents.empty()) {
+                buffer.first_dirty = now;
+            }
+            buffer.inode = inode;
+            buffer.insert(offset, buf, count);
+            buffered = true;
+
+            if (buffer.dirty_bytes >= wb_options_.max_dirty_bytes ||
+                now - buffer.first_dirty >= wb_options_.max_dirty_age) {
+                flushed = flush_detached(lk, inode_no);
+            }
+        } else {
+            writers_[inode_no]++;
+        }
+    }
+    if (buffered) {
+        // inode 锁不能在持有 wb_mutex_ 时获取（刷写在 inode 锁下分配块），放到锁外更新大小
+        {
+            auto guard = lock_inode(inode_no);
+            inode->setFileSize(static_cast<uint64_t>(std::max<size_t>(
+                inode->getFileSize(), offset + count)));
+        }
+        return flushed ? static_cast<ssize_t>(count) : -1;
+    }
+    const ssize_t written = write_through(inode, offset, buf, count);
+    {
+        std::lock_guard lk(wb_mutex_);
+        if (--writers_[inode_no] == 0) {
+            writers_.erase(inode_no);
+        }
+    }
+    return written;
+}
+
+ssize_t VolumeManager::write_file_direct(const std::shared_ptr<Inode>& inode,
+                                        size_t offset,
+                                        const char* buf,
+                                        size_t count) {
+    if (!inode || !buf || count == 0) {
+        return 0;
+    }
+    return write_through(inode, offset, buf, count);
+}
+
+ssize_t VolumeManager::write_through(const std::shared_ptr<Inode>& inode,
+                                     size_t offset,
+                                     const char* buf,
+                                     size_t count) {
     auto ctx = resolve_context(inode->getVolumeUUID());
     if (!ctx || !ctx->volume) {
         std::cerr << "[VolumeManager] 未找到卷: " << inode->getVolumeUUID() << std::endl;
@@ -49,67 +142,24 @@ ssize_t VolumeManager::write_file(const std::shared_ptr<Inode>& inode,
 
     size_t total_blocks_needed = (offset + count + kBytesPerBlock - 1) / kBytesPerBlock;
     size_t bytes_allocated = 0;
-    if (!ensure_blocks(inode, *ctx->volume, total_blocks_needed, bytes_allocated)) {
-        return -1;
-    }
-
     std::vector<IORequest> requests;
-    requests.reserve(total_blocks_needed);
-
-    size_t remaining = count;
-    size_t current_offset = offset;
-    const char* current_buf = buf;
-
-    for (const auto& seg : inode->getBlocks()) {
-        if (remaining == 0) break;
-
-        const size_t seg_start_offset = seg.logical_start * kBytesPerBlock;
-        const size_t seg_total_bytes  = seg.block_count * kBytesPerBlock;
-        const size_t seg_end_offset   = seg_start_offset + seg_total_bytes;
-
-        if (current_offset >= seg_end_offset) continue;
-        if (current_offset + remaining <= seg_start_offset) break;
-
-        size_t within_segment_offset = current_offset > seg_start_offset
-            ? current_offset - seg_start_offset
-            : 0;
-
-        size_t block_index_in_seg = within_segment_offset / kBytesPerBlock;
-        size_t block_inner_offset = within_segment_offset % kBytesPerBlock;
-
-        size_t bytes_available = kBytesPerBlock - block_inner_offset;
-        size_t bytes_to_write  = std::min(bytes_available, remaining);
-
-        IORequest req{};
-        req.type              = IOType::Write;
-        req.storage_node_id   = ctx->volume->storage_node_id();
-        req.node_id           = req.storage_node_id;
-        req.volume_id         = inode->getVolumeUUID();
-        req.volume_uuid       = req.volume_id;
-        req.start_block       = seg.start_block + block_index_in_seg;
-        req.block_count       = 1;
-        req.offset_in_block   = block_inner_offset;
-        req.offset            = req.offset_in_block;
-        req.data_size         = bytes_to_write;
-        req.length            = bytes_to_write;
-        req.buffer            = const_cast<char*>(current_buf);
-        req.buffer_size       = bytes_to_write;
-
-        requests.emplace_back(req);
-
-        current_offset += bytes_to_write;
-        current_buf    += bytes_to_write;
-        remaining      -= bytes_to_write;
-    }
-
-    if (remaining > 0) {
-        std::cerr << "[VolumeManager] write_file 不足的物理块 (remaining="
-                  << remaining << ")" << std::endl;
-        return count - remaining;
+    {
+        auto guard = lock_inode(inode->inode);
+        if (!ensure_blocks(inode, *ctx->volume, total_blocks_needed, bytes_allocated)) {
+            return -1;
+        }
+        size_t mapped = build_requests(*ctx, inode, IOType::Write, offset,
+                                       const_cast<char*>(buf), count, requests);
+        if (mapped < count) {
+            std::cerr << "[VolumeManager] write_file 不足的物理块 (remaining="
+                      << count - mapped << ")" << std::endl;
+            return static_cast<ssize_t>(mapped);
+        }
     }
 
     dispatch_requests(*ctx, requests);
 
+    auto guard = lock_inode(inode->inode);
     inode->setFileSize(static_cast<uint64_t>(std::max<size_t>(
         inode->getFileSize(), offset + count)));
     return static_cast<ssize_t>(count);
@@ -128,56 +178,42 @@ ssize_t VolumeManager::read_file(const std::shared_ptr<Inode>& inode,
         return -1;
     }
 
-    std::vector<IORequest> requests;
-    requests.reserve(inode->getBlocks().size());
-
-    size_t remaining = count;
-    size_t current_offset = offset;
-    char* current_buf = buf;
-
-    for (const auto& seg : inode->getBlocks()) {
-        if (remaining == 0) break;
-
-        const size_t seg_start_offset = seg.logical_start * kBytesPerBlock;
-        const size_t seg_total_bytes  = seg.block_count * kBytesPerBlock;
-        const size_t seg_end_offset   = seg_start_offset + seg_total_bytes;
-
-        if (current_offset >= seg_end_offset) continue;
-        if (current_offset + remaining <= seg_start_offset) break;
-
-        size_t within_segment_offset = current_offset > seg_start_offset
-            ? current_offset - seg_start_offset
-            : 0;
-
-        size_t block_index_in_seg = within_segment_offset / kBytesPerBlock;
-        size_t block_inner_offset = within_segment_offset % kBytesPerBlock;
-
-        size_t bytes_available = kBytesPerBlock - block_inner_offset;
-        size_t bytes_to_read   = std::min(bytes_available, remaining);
-
-        IORequest req{};
-        req.type        = IOType::Read;
-        req.node_id     = inode->getVolumeUUID();
-        req.volume_uuid = inode->getVolumeUUID();
-        req.start_block = seg.start_block + block_index_in_seg;
-        req.block_count = 1;
-        req.offset      = block_inner_offset;
-        req.length      = bytes_to_read;
-        req.buffer      = current_buf;
-        req.buffer_size = bytes_to_read;
-
-        requests.emplace_back(req);
-
-        current_offset += bytes_to_read;
-        current_buf    += bytes_to_read;
-        remaining      -= bytes_to_read;
+    // 先快照与读区间重叠的脏数据；即便读期间发生刷写，快照内容与落盘内容一致。
+    std::vector<std::pair<size_t, std::string>> overlay;
+    {
+        std::lock_guard lk(wb_mutex_);
+        auto collect = [&](const DirtyBuffer& buffer) {
+            for (const auto& [ext_off, data] : buffer.extents) {
+                size_t lo = std::max(offset, ext_off);
+                size_t hi = std::min(offset + count, ext_off + data.size());
+                if (lo < hi) {
+                    overlay.emplace_back(lo, data.substr(lo - ext_off, hi - lo));
+                }
+            }
+        };
+        // 正在下发的旧数据在前，之后写入的脏数据覆盖其上
+        auto fit = flushing_.find(inode->inode);
+        if (fit != flushing_.end()) {
+            collect(*fit->second);
+        }
+        auto it = dirty_.find(inode->inode);
+        if (it != dirty_.end()) {
+            collect(it->second);
+        }
     }
 
-    if (remaining > 0) {
-        std::memset(current_buf, 0, remaining);
+    // 未映射的区间（空洞或尚未刷写的尾部）读出为 0
+    std::memset(buf, 0, count);
+    std::vector<IORequest> requests;
+    {
+        auto guard = lock_inode(inode->inode);
+        build_requests(*ctx, inode, IOType::Read, offset, buf, count, requests);
     }
-
     dispatch_requests(*ctx, requests);
+
+    for (const auto& [lo, data] : overlay) {
+        std::memcpy(buf + (lo - offset), data.data(), data.size());
+    }
     return static_cast<ssize_t>(count);
 }
 
@@ -185,6 +221,12 @@ bool VolumeManager::release_inode_blocks(const std::shared_ptr<Inode>& inode) {
     if (!inode) {
         return false;
     }
+    {
+        // 文件被删除/截断，尚未落盘的脏数据直接丢弃；正在下发的刷写要先等它结束再释放块
+        std::unique_lock lk(wb_mutex_);
+        flush_cv_.wait(lk, [&] { return flushing_.count(inode->inode) == 0; });
+        dirty_.erase(inode->inode);
+    }
     auto ctx = resolve_context(inode->getVolumeUUID());
     if (!ctx || !ctx->volume) {
         std::cerr << "[VolumeManager] release_inode_blocks 未找到卷: "
@@ -192,6 +234,7 @@ bool VolumeManager::release_inode_blocks(const std::shared_ptr<Inode>& inode) {
         return false;
     }
 
+    auto guard = lock_inode(inode->inode);
     bool released = false;
     for (const auto& seg : inode->getBlocks()) {
         try {
@@ -209,15 +252,18 @@ bool VolumeManager::release_inode_blocks(const std::shared_ptr<Inode>& inode) {
     return released;
 }
 
-VolumeManager::VolumeContext* VolumeManager::resolve_context(const std::string& volume_uuid) {
+std::optional<VolumeManager::VolumeContext>
+VolumeManager::resolve_context(const std::string& volume_uuid) const {
+    std::shared_lock lk(volumes_mutex_);
     auto it = volumes_.find(volume_uuid);
     if (it == volumes_.end()) {
-        return nullptr;
+        return std::nullopt;
     }
-    if (!it->second.gateway && default_gateway_) {
-        it->second.gateway = default_gateway_;
+    VolumeContext ctx = it->second;
+    if (!ctx.gateway) {
+        ctx.gateway = default_gateway_;
     }
-    return &(it->second);
+    return ctx;
 }
 
 bool VolumeManager::ensure_blocks(const std::shared_ptr<Inode>& inode,
@@ -267,7 +313,284 @@ bool VolumeManager::ensure_blocks(const std::shared_ptr<Inode>& inode,
     return true;
 }
 
-void VolumeManager::dispatch_requests(VolumeContext& ctx,
+size_t VolumeManager::build_requests(const VolumeContext& ctx,
+                                     const std::shared_ptr<Inode>& inode,
+                                     IOType type,
+                                     size_t offset,
+                                     char* buf,
+                                     size_t count,
+                                     std::vector<IORequest>& requests) const {
+    // 每个块段与 [offset, offset+count) 的交集生成一个跨多块的请求
+    size_t mapped = 0;
+    const size_t end = offset + count;
+    for (const auto& seg : inode->getBlocks()) {
+        const size_t seg_start_offset = seg.logical_start * kBytesPerBlock;
+        const size_t seg_end_offset   = seg_start_offset + seg.block_count * kBytesPerBlock;
+        const size_t lo = std::max(offset, seg_start_offset);
+        const size_t hi = std::min(end, seg_end_offset);
+        if (lo >= hi) continue;
+
+        const size_t within_segment_offset = lo - seg_start_offset;
+        const size_t block_inner_offset = within_segment_offset % kBytesPerBlock;
+        const size_t bytes = hi - lo;
+
+        IORequest req{};
+        req.type            = type;
+        req.storage_node_id = ctx.volume->storage_node_id();
+        req.volume_id       = inode->getVolumeUUID();
+        req.start_block     = seg.start_block + within_segment_offset / kBytesPerBlock;
+        req.block_count     = (block_inner_offset + bytes + kBytesPerBlock - 1) / kBytesPerBlock;
+        req.offset_in_block = block_inner_offset;
+        req.data_size       = bytes;
+        req.buffer          = buf + (lo - offset);
+        req.buffer_size     = bytes;
+        req.sync_aliases();
+
+        requests.emplace_back(std::move(req));
+        mapped += bytes;
+    }
+    return mapped;
+}
+
+bool VolumeManager::write_back(DirtyBuffer& buffer) {
+    if (buffer.extents.empty() || !buffer.inode) {
+        return true;
+    }
+    const auto& inode = buffer.inode;
+    auto ctx = resolve_context(inode->getVolumeUUID());
+    if (!ctx || !ctx->volume) {
+        std::cerr << "[VolumeManager] flush 未找到卷: " << inode->getVolumeUUID() << std::endl;
+        return false;
+    }
+
+    // 延迟分配：整段脏数据一次性申请块，尽量获得连续布局
+    size_t total_blocks_needed = (buffer.end_offset() + kBytesPerBlock - 1) / kBytesPerBlock;
+    size_t bytes_allocated = 0;
+    std::vector<IORequest> requests;
+    {
+        auto guard = lock_inode(inode->inode);
+        if (!ensure_blocks(inode, *ctx->volume, total_blocks_needed, bytes_allocated)) {
+            return false;
+        }
+        for (auto& [ext_off, data] : buffer.extents) {
+            size_t mapped = build_requests(*ctx, inode, IOType::Write, ext_off,
+                                           data.data(), data.size(), requests);
+            if (mapped < data.size()) {
+                std::cerr << "[VolumeManager] flush 不足的物理块 (remaining="
+                          << data.size() - mapped << ")" << std::endl;
+                return false;
+            }
+        }
+    }
+    // 不清空 extents：缓冲仍挂在 flushing_ 上，读路径会在 wb_mutex_ 下遍历它，
+    // 由 flush_detached 在持锁时摘下后丢弃
+    dispatch_requests(*ctx, requests);
+    return true;
+}
+
+bool VolumeManager::flush_detached(std::unique_lock<std::mutex>& lk,
+                                   uint64_t inode_no,
+                                   std::shared_ptr<Inode>* flushed) {
+    // 同一 inode 的上一次刷写尚未结束时先等待，保证块分配与下发按序进行
+    flush_cv_.wait(lk, [&] { return flushing_.count(inode_no) == 0; });
+    auto it = dirty_.find(inode_no);
+    if (it == dirty_.end()) {
+        return true;
+    }
+    auto buffer = std::make_shared<DirtyBuffer>(std::move(it->second));
+    dirty_.erase(it);
+    flushing_.emplace(inode_no, buffer);
+
+    // 块分配与设备 I/O 不持有 wb_mutex_，其他 inode 的读写不受影响
+    lk.unlock();
+    bool ok = write_back(*buffer);
+    lk.lock();
+
+    flushing_.erase(inode_no);
+    if (ok) {
+        if (flushed) {
+            *flushed = buffer->inode;
+        }
+    } else {
+        // 刷写失败：数据放回脏缓冲，期间新写入的数据覆盖旧数据
+        auto& current = dirty_[inode_no];
+        if (!current.extents.empty()) {
+            for (const auto& [ext_off, data] : current.extents) {
+                buffer->insert(ext_off, data.data(), data.size());
+            }
+            buffer->inode = current.inode;
+        }
+        current = std::move(*buffer);
+    }
+    flush_cv_.notify_all();
+    return ok;
+}
+
+bool VolumeManager::flush_inode(const std::shared_ptr<Inode>& inode) {
+    if (!inode) {
+        return false;
+    }
+    std::unique_lock lk(wb_mutex_);
+    return flush_detached(lk, inode->inode);
+}
+
+std::vector<std::shared_ptr<Inode>> VolumeManager::flush_expired() {
+    std::vector<std::shared_ptr<Inode>> flushed;
+    std::unique_lock lk(wb_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    std::vector<uint64_t> expired;
+    for (const auto& [inode_no, buffer] : dirty_) {
+        if (now - buffer.first_dirty >= wb_options_.max_dirty_age) {
+            expired.push_back(inode_no);
+        }
+    }
+    for (uint64_t inode_no : expired) {
+        std::shared_ptr<Inode> inode;
+        if (flush_detached(lk, inode_no, &inode) && inode) {
+            flushed.push_back(std::move(inode));
+        }
+    }
+    return flushed;
+}
+
+std::vector<std::shared_ptr<Inode>> VolumeManager::flush_all() {
+    std::vector<std::shared_ptr<Inode>> flushed;
+    std::unique_lock lk(wb_mutex_);
+    std::vector<uint64_t> pending;
+    pending.reserve(dirty_.size());
+    for (const auto& [inode_no, buffer] : dirty_) {
+        pending.push_back(inode_no);
+    }
+    for (uint64_t inode_no : pending) {
+        std::shared_ptr<Inode> inode;
+        if (flush_detached(lk, inode_no, &inode) && inode) {
+            flushed.push_back(std::move(inode));
+        }
+    }
+    return flushed;
+}
+
+void VolumeManager::flusher_loop() {
+    std::unique_lock lk(wb_mutex_);
+    while (true) {
+        // 以驻留上限的一半为周期巡检，脏数据最迟约 1.5 倍 max_dirty_age 后落盘
+        auto period = std::max(std::chrono::milliseconds(1), wb_options_.max_dirty_age / 2);
+        if (flusher_cv_.wait_for(lk, period, [this] { return flusher_stop_; })) {
+            break;
+        }
+        auto listener = flush_listener_;
+        lk.unlock();
+        for (const auto& inode : flush_expired()) {
+            if (listener) {
+                auto guard = lock_inode(inode->inode);
+                listener(inode);
+            }
+        }
+        lk.lock();
+    }
+}
+
+void VolumeManager::stop_flusher() {
+    {
+        std::lock_guard lk(wb_mutex_);
+        flusher_stop_ = true;
+    }
+    flusher_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
+
+bool VolumeManager::has_dirty(uint64_t inode_no) {
+    std::lock_guard lk(wb_mutex_);
+    if (flushing_.count(inode_no)) {
+        return true;
+    }
+    auto it = dirty_.find(inode_no);
+    return it != dirty_.end() && !it->second.extents.empty();
+}
+
+bool VolumeManager::fence_writes(uint64_t inode_no) {
+    std::lock_guard lk(wb_mutex_);
+    auto it = dirty_.find(inode_no);
+    if (flushing_.count(inode_no) || writers_.count(inode_no) ||
+        (it != dirty_.end() && !it->second.extents.empty())) {
+        return false;
+    }
+    return fenced_.insert(inode_no).second;
+}
+
+void VolumeManager::release_fence(uint64_t inode_no) {
+    {
+        std::lock_guard lk(wb_mutex_);
+        fenced_.erase(inode_no);
+    }
+    flush_cv_.notify_all();
+}
+
+std::unique_lock<std::mutex> VolumeManager::lock_inode(uint64_t inode_no) {
+    return std::unique_lock<std::mutex>(inode_locks_[inode_no % kInodeLockStripes]);
+}
+
+void VolumeManager::DirtyBuffer::insert(size_t offset, const char* buf, size_t count) {
+    size_t new_start = offset;
+    size_t new_end = offset + count;
+
+    // 找到第一个可能与新区间重叠或相邻的区间
+    auto first = extents.upper_bound(offset);
+    if (first != extents.begin()) {
+        auto prev = std::prev(first);
+        if (prev->first + prev->second.size() >= offset) {
+            first = prev;
+        }
+    }
+    auto last = first;
+    while (last != extents.end() && last->first <= new_end) {
+        new_start = std::min(new_start, last->first);
+        new_end = std::max(new_end, last->first + last->second.size());
+        ++last;
+    }
+
+    if (first != last && std::next(first) == last && first->first <= offset) {
+        // 只触及一个已有区间且不在其前方：原地扩展，顺序追加不再整段拷贝
+        std::string& data = first->second;
+        const size_t old_size = data.size();
+        const size_t rel = offset - first->first;
+        if (rel == old_size) {
+            data.append(buf, count);
+        } else {
+            if (rel + count > old_size) {
+                data.resize(rel + count);
+            }
+            std::memcpy(&data[rel], buf, count);
+        }
+        dirty_bytes += data.size() - old_size;
+        return;
+    }
+
+    std::string merged;
+    if (first == last) {
+        merged.assign(buf, count);
+    } else {
+        merged.resize(new_end - new_start);
+        for (auto it = first; it != last; ++it) {
+            std::memcpy(&merged[it->first - new_start], it->second.data(), it->second.size());
+            dirty_bytes -= it->second.size();
+        }
+        std::memcpy(&merged[offset - new_start], buf, count);
+        extents.erase(first, last);
+    }
+    dirty_bytes += merged.size();
+    extents.emplace(new_start, std::move(merged));
+}
+
+size_t VolumeManager::DirtyBuffer::end_offset() const {
+    if (extents.empty()) return 0;
+    const auto& last = *extents.rbegin();
+    return last.first + last.second.size();
+}
+
+void VolumeManager::dispatch_requests(const VolumeContext& ctx,
                                       std::vector<IORequest>& requests) {
     if (requests.empty()) return;
 
@@ -1,9 +1,19 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "../../mds/inode/inode.h"
 #include "Volume.h"
@@ -12,6 +22,19 @@
 #include "./Volume.h"
 #include "./VolumeRegistry.h"
 
+/**
+ * @brief 写回缓冲（延迟分配）配置。
+ *
+ * 启用后 write_file 仅把数据写入 inode 级脏缓冲，直到脏数据超过阈值、驻留超时
+ * 或显式 flush（close/fsync）时才一次性分配块并批量下发。默认关闭：写回会推迟
+ * 数据落盘，需由调用方显式开启。
+ */
+struct WriteBackOptions {
+    bool enabled = false;                                 ///< 是否启用写回缓冲
+    size_t max_dirty_bytes = 8 * 1024 * 1024;             ///< 单 inode 脏数据上限，超过立即刷写
+    std::chrono::milliseconds max_dirty_age{5000};        ///< 脏数据最长驻留时间
+};
+
 /**
  * @brief VolumeManager 聚合卷与 I/O 网关，负责块分配、I/ORequest 打包与下发。
  */
@@ -22,18 +45,75 @@ private:
         std::shared_ptr<IIOGateway> gateway;
     };
 
+    /**
+     * @brief 单个 inode 的脏数据缓冲，按文件偏移保存互不重叠的区间。
+     */
+    struct DirtyBuffer {
+        std::shared_ptr<Inode> inode;
+        std::map<size_t, std::string> extents;            ///< 文件偏移 -> 数据
+        size_t dirty_bytes = 0;
+        std::chrono::steady_clock::time_point first_dirty;
+
+        void insert(size_t offset, const char* buf, size_t count);
+        size_t end_offset() const;
+    };
+
     std::unordered_map<std::string, VolumeContext> volumes_;
     std::shared_ptr<IIOGateway> default_gateway_;
+    mutable std::shared_mutex volumes_mutex_;             ///< 保护 volumes_、default_gateway_
+
+    WriteBackOptions wb_options_;
+    std::unordered_map<uint64_t, DirtyBuffer> dirty_;    ///< inode 号 -> 脏缓冲
+    /// 已从 dirty_ 摘下、正在锁外下发的缓冲；读路径仍需覆盖这些数据
+    std::unordered_map<uint64_t, std::shared_ptr<DirtyBuffer>> flushing_;
+    std::unordered_map<uint64_t, size_t> writers_;       ///< inode 号 -> 正在直写的 write_file 数
+    std::unordered_set<uint64_t> fenced_;                 ///< 暂停写入的 inode（见 fence_writes）
+    std::mutex wb_mutex_;                                 ///< 保护 dirty_、flushing_、writers_、fenced_
+    std::condition_variable flush_cv_;                    ///< 同一 inode 的刷写串行进行；栅栏解除时唤醒写入
 
-    VolumeContext* resolve_context(const std::string& volume_uuid);
+    /// 后台刷写线程：按 max_dirty_age 周期性刷写驻留超时的脏缓冲
+    std::thread flusher_;
+    std::condition_variable flusher_cv_;
+    bool flusher_stop_ = false;                           ///< 受 wb_mutex_ 保护
+    std::function<void(const std::shared_ptr<Inode>&)> flush_listener_;
+
+    /// 按 inode 号分段的锁，保护 inode 对象的块映射与大小（见 lock_inode）
+    static constexpr size_t kInodeLockStripes = 64;
+    std::array<std::mutex, kInodeLockStripes> inode_locks_;
+
+    /// 返回卷上下文副本（未绑定专用网关时填入默认网关）；卷未注册返回空
+    std::optional<VolumeContext> resolve_context(const std::string& volume_uuid) const;
     bool ensure_blocks(const std::shared_ptr<Inode>& inode,
                        Volume& volume,
                        size_t total_blocks_needed,
                        size_t& bytes_allocated);
-    void dispatch_requests(VolumeContext& ctx,
+    size_t build_requests(const VolumeContext& ctx,
+                          const std::shared_ptr<Inode>& inode,
+                          IOType type,
+                          size_t offset,
+                          char* buf,
+                          size_t count,
+                          std::vector<IORequest>& requests) const;
+    void dispatch_requests(const VolumeContext& ctx,
                            std::vector<IORequest>& requests);
+    ssize_t write_through(const std::shared_ptr<Inode>& inode,
+                          size_t offset,
+                          const char* buf,
+                          size_t count);
+    bool write_back(DirtyBuffer& buffer);
+    bool flush_detached(std::unique_lock<std::mutex>& lk,
+                        uint64_t inode_no,
+                        std::shared_ptr<Inode>* flushed = nullptr);
+    void flusher_loop();
+    void stop_flusher();
 
 public:
+    VolumeManager() = default;
+    ~VolumeManager();
+
+    VolumeManager(const VolumeManager&) = delete;
+    VolumeManager& operator=(const VolumeManager&) = delete;
+
     /**
      * @brief 注册卷并可选绑定 I/O 网关。
      * @param volume 目标卷（必须有效且具备 uuid）。
@@ -58,7 +138,26 @@ public:
     void set_default_gateway(std::shared_ptr<IIOGateway> gateway);
 
     /**
-     * @brief 按 inode 的卷信息执行写入。
+     * @brief 设置写回缓冲参数；开启时启动后台刷写线程，关闭时停止线程并刷写全部脏数据。
+     * @param options 新配置。
+     */
+    void set_write_back_options(const WriteBackOptions& options);
+
+    /**
+     * @brief 设置后台刷写完成回调，调用方在其中持久化 inode 新分配的块映射。
+     * @param listener 回调；为空表示不通知。回调在刷写线程上调用，调用时持有该 inode 的
+     *        lock_inode 锁、不持有其他锁。
+     */
+    void set_flush_listener(std::function<void(const std::shared_ptr<Inode>&)> listener);
+
+    /**
+     * @brief 获取当前写回缓冲参数。
+     * @return 配置副本。
+     */
+    WriteBackOptions write_back_options();
+
+    /**
+     * @brief 按 inode 的卷信息执行写入；启用写回时数据先进入脏缓冲，块分配推迟到刷写。
      * @param inode 目标 inode（需包含 volume_id、block_segments 等信息）。
      * @param offset 文件内写偏移。
      * @param buf 数据指针。
@@ -71,7 +170,18 @@ public:
                        size_t count);
 
     /**
-     * @brief 按 inode 的卷信息执行读取。
+     * @brief 绕过写回缓冲直接分配块并下发写请求，供分层迁移等后台拷贝使用。
+     *
+     * 后台拷贝的目标 inode 与前台文件同号，走写回缓冲会与前台脏数据混在一起。
+     * @return 实际写入字节；失败返回 -1。
+     */
+    ssize_t write_file_direct(const std::shared_ptr<Inode>& inode,
+                              size_t offset,
+                              const char* buf,
+                              size_t count);
+
+    /**
+     * @brief 按 inode 的卷信息执行读取，尚未刷写的脏数据会覆盖到结果中。
      * @param inode 目标 inode。
      * @param offset 文件内读偏移。
      * @param buf 输出缓冲区。
@@ -89,4 +199,56 @@ public:
      * @return 若成功释放至少一个块段返回 true。
      */
     bool release_inode_blocks(const std::shared_ptr<Inode>& inode);
+
+    /**
+     * @brief 刷写指定 inode 的脏数据：一次性分配所需块并批量下发。
+     * @param inode 目标 inode。
+     * @return 无脏数据或刷写成功返回 true。
+     */
+    bool flush_inode(const std::shared_ptr<Inode>& inode);
+
+    /**
+     * @brief 刷写所有驻留时间超过 max_dirty_age 的脏缓冲。
+     * @return 本次完成刷写的 inode（调用方负责持久化其块映射）。
+     */
+    std::vector<std::shared_ptr<Inode>> flush_expired();
+
+    /**
+     * @brief 刷写全部脏缓冲。
+     * @return 本次完成刷写的 inode。
+     */
+    std::vector<std::shared_ptr<Inode>> flush_all();
+
+    /**
+     * @brief 查询 inode 当前是否有未刷写数据。
+     * @param inode_no inode 号。
+     */
+    bool has_dirty(uint64_t inode_no);
+
+    /**
+     * @brief 暂停 inode 的写入，供迁移在提交块映射期间使用。
+     *
+     * inode 有未刷写数据、正在刷写或有 write_file 正在下发时失败；成功后该 inode 的
+     * write_file 阻塞到 release_fence 为止（write_file_direct 不受影响）。
+     * @param inode_no inode 号。
+     * @return 成功设置栅栏返回 true。
+     */
+    bool fence_writes(uint64_t inode_no);
+
+    /**
+     * @brief 解除 fence_writes 设置的栅栏并唤醒等待的写入。
+     * @param inode_no inode 号。
+     */
+    void release_fence(uint64_t inode_no);
+
+    /**
+     * @brief 锁住 inode 对象的块映射与大小。
+     *
+     * 块分配、按块映射构造 I/O 请求、释放块和修改文件大小都在该锁下进行，后台刷写线程
+     * 与前台读写因此不会同时改动同一个 Inode。调用方读取或持久化共享的 Inode 对象
+     * （如 MdsServer::WriteInode）时也应持有它；持锁期间不能再调用本类的读写与刷写方法。
+     * @param inode_no inode 号。
+     * @return 已加锁的 unique_lock。
+     */
+    std::unique_lock<std::mutex> lock_inode(uint64_t inode_no);
 };
\ No newline at end of file
@@ -3,13 +3,18 @@
 #include <algorithm>
 #include <ctime>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <thread>
 
+#include <nlohmann/json.hpp>
+
+#include "../inode/InodeBatchReader.h"
 #include "../inode/InodeStorage.h"
+#include "../../common/JsonCheckpoint.h"
 #include "../../debug/ZBLog.h"
 #include "../../srm/image_manager/ImageManager.h"
+#include "../../srm/optical_manager/BurnScheduler.h"
+#include "../../srm/optical_manager/DiscLocationCatalog.h"
 #ifdef INODE_DISK_SLOT_SIZE
 #undef INODE_DISK_SLOT_SIZE
 #endif
@@ -18,28 +23,6 @@ namespace {
 
 namespace fs = std::filesystem;
 
-constexpr int kTimestampYearBase = 2000;
-
-std::chrono::system_clock::time_point to_time_point(const InodeTimestamp& ts) {
-	std::tm tm{};
-	int year = kTimestampYearBase + static_cast<int>(ts.year);
-	if (year < 1970) {
-		year = 1970;
-	}
-	tm.tm_year = year - 1900;
-	tm.tm_mon = std::max(0, static_cast<int>(ts.month) - 1);
-	tm.tm_mday = std::max(1, static_cast<int>(ts.day));
-	tm.tm_hour = static_cast<int>(ts.hour);
-	tm.tm_min = static_cast<int>(ts.minute);
-	tm.tm_sec = 0;
-	tm.tm_isdst = -1;
-	std::time_t tt = std::mktime(&tm);
-	if (tt == -1) {
-		return std::chrono::system_clock::time_point{};
-	}
-	return std::chrono::system_clock::from_time_t(tt);
-}
-
 bool inode_in_range(uint64_t ino, const ColdScanRange& range) {
 	if (range.start_ino != 0 && ino < range.start_ino) {
 		return false;
@@ -50,15 +33,20 @@ bool inode_in_range(uint64_t ino, const ColdScanRange& range) {
 	return true;
 }
 
-bool is_cold_default(const Inode& inode, const ColdCollectorConfig& cfg) {
-	const auto now = std::chrono::system_clock::now();
-	const auto access_tp = to_time_point(inode.fa_time);
-	if (access_tp.time_since_epoch().count() == 0) {
-		return false;
-	}
-	return now - access_tp >= cfg.cold_threshold;
+// 按年月日时分排序的时间戳键，比 mktime 便宜得多，扫描时逐槽比较用
+uint32_t timestamp_key(const InodeTimestamp& t) {
+	return (static_cast<uint32_t>(t.year) & 0xFF) << 24 | (static_cast<uint32_t>(t.month) & 0x3F) << 18 |
+		   (static_cast<uint32_t>(t.day) & 0x3F) << 12 | (static_cast<uint32_t>(t.hour) & 0x3F) << 6 |
+		   (static_cast<uint32_t>(t.minute) & 0x3F);
 }
 
+// 一片批文件的扫描结果，由解码线程填充、调用线程按顺序合并
+struct ScanChunk {
+	uint64_t end = 0;                             // 片的结束偏移
+	std::vector<uint64_t> inspected;              // 落在扫描区间内的槽，记其结束偏移
+	std::vector<std::pair<size_t, Inode>> cold;   // (在 inspected 中的下标, 冷 inode)
+};
+
 } // namespace
 
 ColdDataCollectorService::ColdDataCollectorService(MdsServer* mds,
@@ -100,6 +88,52 @@ void ColdDataCollectorService::set_scheduler(std::shared_ptr<IImageAggregationSc
 	scheduler_ = std::move(scheduler);
 }
 
+void ColdDataCollectorService::set_burn_scheduler(std::shared_ptr<BurnScheduler> burn_scheduler) {
+	std::lock_guard<std::mutex> lock(hook_mtx_);
+	burn_scheduler_ = std::move(burn_scheduler);
+}
+
+void ColdDataCollectorService::set_location_catalog(std::shared_ptr<DiscLocationCatalog> catalog) {
+	std::lock_guard<std::mutex> lock(hook_mtx_);
+	location_catalog_ = std::move(catalog);
+}
+
+void ColdDataCollectorService::on_image_burned(uint64_t image_id, const std::string& library_id,
+											   const std::string& disc_id, bool ok) {
+	std::vector<ArchivedFile> files;
+	{
+		std::lock_guard<std::mutex> lock(burning_mtx_);
+		auto it = burning_images_.find(image_id);
+		if (it == burning_images_.end()) {
+			return;
+		}
+		files = std::move(it->second);
+		burning_images_.erase(it);
+	}
+	std::shared_ptr<DiscLocationCatalog> catalog;
+	{
+		std::lock_guard<std::mutex> lock(hook_mtx_);
+		catalog = location_catalog_;
+	}
+	if (!ok || !catalog) {
+		return;
+	}
+	uint32_t disc = 0;
+	uint32_t library = 0;
+	if (!DiscLocationCatalog::ParseDiscId(disc_id, &disc) || !DiscLocationCatalog::ParseLibraryId(library_id, &library)) {
+		LOGW("collector: unexpected disc/library id " << disc_id << " / " << library_id);
+		return;
+	}
+	std::vector<DiscLocationCatalog::FileExtent> extents;
+	extents.reserve(files.size());
+	for (const auto& f : files) {
+		extents.push_back({f.inode, f.offset, f.size});
+	}
+	if (!catalog->CommitImage(image_id, disc, library, extents)) {
+		LOGW("collector: failed to record locations of image " << image_id);
+	}
+}
+
 ColdScanResult ColdDataCollectorService::run_single_scan_for_test() {
 	return scan_once();
 }
@@ -154,41 +188,157 @@ ColdScanResult ColdDataCollectorService::scan_once() {
 		}
 	}
 	std::sort(batch_files.begin(), batch_files.end());
+	if (batch_files.empty() || cfg.max_inodes_per_round == 0) {
+		return result;
+	}
 
-	std::vector<uint8_t> buffer(InodeStorage::INODE_DISK_SLOT_SIZE, 0);
-	size_t inspected = 0;
-	for (const auto& path : batch_files) {
-		if (inspected >= cfg.max_inodes_per_round) {
-			break;
-		}
-		std::ifstream in(path, std::ios::binary);
-		if (!in) {
-			LOGW("collector: failed to open batch file " << path);
-			continue;
+	// 从上一轮停下的位置继续：批文件按名字有序，游标所在文件被删除时落到其后的第一个文件
+	std::lock_guard<std::mutex> cursor_lock(cursor_mtx_);
+	if (!cursor_loaded_) {
+		load_cursor(cfg.cursor_checkpoint_path);
+		cursor_loaded_ = true;
+	}
+	const uint64_t slot_size = InodeStorage::INODE_DISK_SLOT_SIZE;
+	size_t idx = std::lower_bound(batch_files.begin(), batch_files.end(), cursor_.file,
+								  [](const fs::path& p, const std::string& name) {
+									  return p.filename().string() < name;
+								  }) - batch_files.begin();
+	uint64_t start_offset = 0;
+	if (idx < batch_files.size() && batch_files[idx].filename().string() == cursor_.file) {
+		start_offset = cursor_.offset - cursor_.offset % slot_size;
+	}
+
+	// 默认判定只看访问时间：now - fa_time >= 阈值 等价于 fa_time 不晚于 now - 阈值（分钟精度）
+	const auto cold_before = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now() - cfg.cold_threshold);
+	const uint32_t cold_key = timestamp_key(InodeTimestamp(cold_before));
+	// 解码在工作线程上进行：默认判定只读槽头部，只有冷 inode 或自定义 selector 才完整反序列化
+	auto decode = [&](const InodeSlotView& slot, ScanChunk& chunk) {
+		chunk.end = slot.file_offset() + slot_size;
+		if (!slot.valid() || !inode_in_range(slot.inode(), cfg.scan_range)) {
+			return;
 		}
-		while (inspected < cfg.max_inodes_per_round && in.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
-			size_t offset = 0;
-			Inode inode;
-			if (!Inode::deserialize(buffer.data(), offset, inode, buffer.size())) {
-				continue;
-			}
-			if (!inode_in_range(inode.inode, cfg.scan_range)) {
-				continue;
+		const size_t index = chunk.inspected.size();
+		chunk.inspected.push_back(chunk.end);
+		Inode inode;
+		if (selector) {
+			if (slot.decode(inode) && selector->is_cold(inode, cfg)) {
+				chunk.cold.emplace_back(index, std::move(inode));
 			}
+		} else if (timestamp_key(slot.fa_time()) <= cold_key && slot.decode(inode)) {
+			chunk.cold.emplace_back(index, std::move(inode));
+		}
+	};
+
+	InodeBatchReader::Options reader_opts;
+	reader_opts.threads = cfg.scan_threads;
+	if (cfg.scan_chunk_bytes > 0) {
+		reader_opts.chunk_bytes = cfg.scan_chunk_bytes;
+	}
+	InodeBatchReader reader(reader_opts);
+	size_t inspected = 0;
+	bool batch_full = false;
+	auto merge = [&](ScanChunk&& chunk) {
+		size_t next_cold = 0;
+		for (size_t k = 0; k < chunk.inspected.size(); ++k) {
+			cursor_.offset = chunk.inspected[k];
 			++inspected;
-			bool cold = selector ? selector->is_cold(inode, cfg) : is_cold_default(inode, cfg);
-			if (cold) {
+			if (next_cold < chunk.cold.size() && chunk.cold[next_cold].first == k) {
+				Inode& inode = chunk.cold[next_cold++].second;
 				result.cold_inodes.push_back(inode.inode);
-				result.inode_records.push_back(inode);
-				if (result.cold_inodes.size() >= cfg.max_batch_size) {
-					return result;
-				}
+				result.inode_records.push_back(std::move(inode));
+				batch_full = result.cold_inodes.size() >= cfg.max_batch_size;
+			}
+			if (inspected >= cfg.max_inodes_per_round || batch_full) {
+				return false;
 			}
 		}
+		cursor_.offset = chunk.end;
+		return true;
+	};
+
+	for (; idx < batch_files.size(); ++idx, start_offset = 0) {
+		const auto& path = batch_files[idx];
+		cursor_.file = path.filename().string();
+		cursor_.offset = start_offset;
+		const uint64_t file_size = fs::file_size(path, ec);
+		if (ec) {
+			ec.clear();
+			LOGW("collector: failed to stat batch file " << path);
+			continue;
+		}
+		// 每次只映射本轮剩余额度对应的槽数，避免解码线程读到额度之外
+		bool mapped = true;
+		for (uint64_t pos = start_offset;
+			 mapped && inspected < cfg.max_inodes_per_round && !batch_full && pos + slot_size <= file_size;) {
+			const uint64_t window = (cfg.max_inodes_per_round - inspected) * slot_size;
+			mapped = reader.scan<ScanChunk>(path.string(), pos, pos + window, decode, merge);
+			pos += window;
+		}
+		if (!mapped) {
+			LOGW("collector: failed to map batch file " << path);
+			continue;
+		}
+		if (inspected < cfg.max_inodes_per_round && !batch_full) {
+			continue;
+		}
+		// 额度用完：文件还有完整的槽没读则游标停在文件内，否则指向下一个文件
+		if (cursor_.offset + slot_size > file_size) {
+			++idx;
+		}
+		break;
+	}
+	if (idx >= batch_files.size()) {
+		// 扫完最后一个批文件，下一轮从头开始新的一遍（期间新增的批文件也会被扫到）
+		cursor_ = ColdScanCursor{std::string(), 0, cursor_.passes + 1};
+		LOGI("collector: finished scan pass " << cursor_.passes << " over " << batch_files.size() << " batch files");
+	} else if (cursor_.file != batch_files[idx].filename().string()) {
+		cursor_ = ColdScanCursor{batch_files[idx].filename().string(), 0, cursor_.passes};
 	}
+	save_cursor(cfg.cursor_checkpoint_path);
 	return result;
 }
 
+ColdScanCursor ColdDataCollectorService::scan_cursor() const {
+	std::lock_guard<std::mutex> lock(cursor_mtx_);
+	return cursor_;
+}
+
+void ColdDataCollectorService::load_cursor(const std::string& path) {
+	if (path.empty()) {
+		return;
+	}
+	nlohmann::json root;
+	std::string error;
+	if (!LoadJsonCheckpoint(path, root, error)) {
+		if (!error.empty()) {
+			LOGW("collector: ignore broken cursor checkpoint " << path << ": " << error);
+		}
+		return;
+	}
+	try {
+		cursor_.file = root.value("file", std::string());
+		cursor_.offset = root.value("offset", uint64_t{0});
+		cursor_.passes = root.value("passes", uint64_t{0});
+	} catch (const std::exception& ex) {
+		LOGW("collector: ignore broken cursor checkpoint " << path << ": " << ex.what());
+		cursor_ = ColdScanCursor{};
+	}
+}
+
+void ColdDataCollectorService::save_cursor(const std::string& path) {
+	if (path.empty()) {
+		return;
+	}
+	nlohmann::json root;
+	root["file"] = cursor_.file;
+	root["offset"] = cursor_.offset;
+	root["passes"] = cursor_.passes;
+	std::string error;
+	if (!SaveJsonCheckpoint(path, root, error)) {
+		LOGW("collector: failed to write cursor checkpoint " << path << ": " << error);
+	}
+}
+
 void ColdDataCollectorService::submit_to_image_manager(const ColdScanResult& result) {
 	if (result.cold_inodes.empty()) {
 		return;
@@ -212,12 +362,57 @@ void ColdDataCollectorService::submit_to_image_manager(const ColdScanResult& res
 			LOGW("collector: sim_image_write_file failed for inode " << inode.inode);
 		}
 	}
+	// 只生成达到填充率的镜像，装不满的文件留在 ImageManager 中等待下一批冷数据
+	auto images = image_mgr_->flush(false);
+	if (!images.empty()) {
+		LOGI("collector: built " << images.size() << " disc images, "
+			 << image_mgr_->get_stats().pending_files << " files still pending");
+	}
+	std::shared_ptr<BurnScheduler> burner;
+	bool track_locations = false;
+	{
+		std::lock_guard<std::mutex> lock(hook_mtx_);
+		burner = burn_scheduler_;
+		track_locations = location_catalog_ != nullptr;
+	}
+	if (!burner) {
+		return;
+	}
+	for (const auto& image : images) {
+		// 模拟镜像没有落盘，刻录结果不代表文件真的在光盘上，不记录位置
+		if (track_locations && !image.path.empty()) {
+			std::vector<ArchivedFile> files;
+			files.reserve(image.files.size());
+			for (const auto& f : image.files) {
+				files.push_back({f.inode, f.offset, f.size});
+			}
+			std::lock_guard<std::mutex> lock(burning_mtx_);
+			burning_images_[image.image_id] = std::move(files);
+		}
+		BurnScheduler::BurnJob job{image.image_id, image.image_bytes, image.path};
+		// 暂存区满时在此阻塞，扫描随之放慢（反压）
+		bool queued = burner->submit(job, std::chrono::seconds(1));
+		while (!queued && running_.load() && burner->isRunning()) {
+			queued = burner->submit(job, std::chrono::seconds(1));
+		}
+		if (!queued) {
+			LOGW("collector: image " << image.image_id << " not queued for burning");
+			std::lock_guard<std::mutex> lock(burning_mtx_);
+			burning_images_.erase(image.image_id);
+		}
+	}
 }
 
 void ColdDataCollectorService::queue_burn_request(const ColdScanResult& result) {
 	if (result.cold_inodes.empty()) {
 		return;
 	}
+	{
+		std::lock_guard<std::mutex> lock(hook_mtx_);
+		if (burn_scheduler_) {
+			return;  // 镜像已在 submit_to_image_manager 中提交给刻录调度器
+		}
+	}
 	ColdCollectorConfig cfg = snapshot_config();
 	std::vector<uint64_t> ids = result.cold_inodes;
 	std::thread([cfg, ids = std::move(ids)]() {
@@ -9,12 +9,15 @@
 #include <optional>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "../inode/inode.h"
 
 class MdsServer;
 class ImageManager;
+class BurnScheduler;
+class DiscLocationCatalog;
 namespace srm {
 using ImageManager = ::ImageManager;
 }
@@ -30,6 +33,13 @@ struct ColdScanResult {
 	std::chrono::system_clock::time_point collected_at;  // 扫描时间戳
 };
 
+// 跨轮次推进的扫描游标：下一轮从 file 的 offset 字节处继续，扫完最后一个批文件后回到开头。
+struct ColdScanCursor {
+	std::string file;     // 批文件名（不含目录），空表示从第一个文件开始
+	uint64_t offset = 0;  // 文件内字节偏移，按 inode 槽对齐
+	uint64_t passes = 0;  // 已完整扫过全部批文件的遍数
+};
+
 struct ColdCollectorConfig {
 	ColdScanRange scan_range{0, 0};              // 限定扫描的 inode 区间
 	std::chrono::hours scan_interval{24};        // 后台线程每次扫描的间隔
@@ -39,12 +49,15 @@ struct ColdCollectorConfig {
 	std::chrono::seconds delay_before_burn{300}; // 聚合完成后等待多久再发刻录请求
 	std::string inode_directory = "/mnt/md0/inode"; // 批量生成的 inode 文件所在目录
 	uint64_t image_flush_threshold_bytes = 10ULL * 1024 * 1024 * 1024; // 累计文件大小达到该值触发镜像封装
+	std::string cursor_checkpoint_path;          // 扫描游标检查点文件，为空则游标只保存在内存中
+	size_t scan_threads = 0;                     // 批文件解码线程数，0 取硬件并发数
+	size_t scan_chunk_bytes = 0;                 // 每个解码任务的字节数，0 取 InodeBatchReader 的默认值
 };
 
 class IColdInodeSelector {
 public:
 	virtual ~IColdInodeSelector() = default;
-	// 返回 true 代表根据配置判断 inode 为冷数据。
+	// 返回 true 代表根据配置判断 inode 为冷数据。会在多个扫描线程上并发调用。
 	virtual bool is_cold(const Inode& inode, const ColdCollectorConfig& cfg) const = 0;
 };
 
@@ -76,9 +89,19 @@ public:
 	void set_selector(std::shared_ptr<IColdInodeSelector> selector);
 	// 注入自定义镜像调度策略（默认直接调用 ImageManager）。
 	void set_scheduler(std::shared_ptr<IImageAggregationScheduler> scheduler);
+	// 注入刻录调度器：生成的镜像提交给它刻录，暂存区满时收集线程阻塞等待。
+	void set_burn_scheduler(std::shared_ptr<BurnScheduler> burn_scheduler);
+	// 注入 inode -> 光盘位置目录：落盘的镜像刻录成功后（on_image_burned）其中文件的位置整批写入，
+	// 模拟镜像不记录。
+	void set_location_catalog(std::shared_ptr<DiscLocationCatalog> catalog);
+	// 刻录结果回调，由刻录调度器的完成回调转发过来。
+	void on_image_burned(uint64_t image_id, const std::string& library_id,
+						 const std::string& disc_id, bool ok);
 
 	// 仅用于测试/排障：立即执行一次扫描并返回结果（不会提交至 ImageManager）。
 	ColdScanResult run_single_scan_for_test();
+	// 当前扫描游标；检查点在首次扫描时加载。
+	ColdScanCursor scan_cursor() const;
 
 private:
 	void run_loop();                                    // 线程入口
@@ -88,18 +111,34 @@ private:
 	void submit_to_image_manager(const ColdScanResult& result); // 调用 ImageManager 进行聚合
 	void queue_burn_request(const ColdScanResult& result);      // 根据结果排程刻录
 	ColdCollectorConfig snapshot_config() const;        // 读取当前配置的线程安全副本
+	void load_cursor(const std::string& path);          // 从检查点恢复游标（调用方持有 cursor_mtx_）
+	void save_cursor(const std::string& path);          // 原子写出游标检查点（调用方持有 cursor_mtx_）
 
 	MdsServer* mds_;
 	srm::ImageManager* image_mgr_;
 	std::shared_ptr<IColdInodeSelector> selector_;
 	std::shared_ptr<IImageAggregationScheduler> scheduler_;
+	std::shared_ptr<BurnScheduler> burn_scheduler_;
+	std::shared_ptr<DiscLocationCatalog> location_catalog_;
 	mutable std::mutex hook_mtx_;
 
+	struct ArchivedFile {
+		uint64_t inode;
+		uint64_t offset;  // 在镜像（光盘）内的偏移
+		uint64_t size;
+	};
+	std::unordered_map<uint64_t, std::vector<ArchivedFile>> burning_images_; // 已提交刻录、尚未完成的镜像
+	std::mutex burning_mtx_;
+
 	ColdCollectorConfig config_;
 	std::thread worker_;
 	mutable std::mutex config_mtx_;
 	std::atomic<bool> running_{false};
 
+	ColdScanCursor cursor_;
+	bool cursor_loaded_ = false;
+	mutable std::mutex cursor_mtx_;
+
 	std::vector<Inode> pending_inodes_;
 	uint64_t pending_bytes_ = 0;
 };
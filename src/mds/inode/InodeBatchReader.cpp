@@ -0,0 +1,199 @@
+#include "InodeBatchReader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t InodeSlotView::file_size() const {
+    const auto size = read_union<FileSize>(kFileSizeOffset);
+    uint64_t value = size.fields.file_size;
+    switch (size.fields.size_unit) {
+    case 1: return value * 1024ULL;
+    case 2: return value * 1024ULL * 1024ULL;
+    case 3: return value * 1024ULL * 1024ULL * 1024ULL;
+    default: return value;
+    }
+}
+
+InodeTimestamp InodeSlotView::read_timestamp(size_t offset) const {
+    // InodeTimestamp 的默认构造要取当前时间，这里从一个现成对象拷贝后覆盖位域
+    static const InodeTimestamp proto(static_cast<std::time_t>(0));
+    InodeTimestamp ts = proto;
+    std::memcpy(&ts, data_ + offset, sizeof(ts));
+    return ts;
+}
+
+bool InodeSlotView::valid() const {
+    const size_t filename_len = data_[4];
+    const size_t digest_len = data_[5];
+    size_t off = kFixedSize + filename_len + digest_len;
+    if (off + 1 > kSlotSize) return false;
+    off += 1 + data_[off];
+    if (off + sizeof(uint32_t) > kSlotSize) return false;
+    const uint32_t segment_count = read<uint32_t>(off);
+    off += sizeof(uint32_t);
+    return segment_count <= (kSlotSize - off) / sizeof(BlockSegment);
+}
+
+bool InodeSlotView::decode(Inode& out) const {
+    // deserialize 不检查卷 ID 长度，先校验一遍，避免读出槽外
+    if (!valid()) return false;
+    size_t offset = 0;
+    return Inode::deserialize(data_, offset, out, kSlotSize);
+}
+
+InodeBatchReader::InodeBatchReader(Options opts)
+    : threads_(opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency())),
+      chunk_bytes_(std::max<size_t>(opts.chunk_bytes - opts.chunk_bytes % InodeSlotView::kSlotSize,
+                                    InodeSlotView::kSlotSize)) {}
+
+bool InodeBatchReader::run(const std::string& path,
+                           uint64_t begin,
+                           uint64_t end,
+                           const std::function<void(size_t)>& prepare,
+                           const std::function<void(size_t, const uint8_t*, uint64_t, uint64_t)>& process,
+                           const std::function<bool(size_t)>& commit) {
+    constexpr uint64_t slot = InodeSlotView::kSlotSize;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const uint64_t file_end = static_cast<uint64_t>(st.st_size) - static_cast<uint64_t>(st.st_size) % slot;
+    end = std::min(end, file_end);
+    begin -= begin % slot;
+    if (begin >= end) {
+        ::close(fd);
+        prepare(0);
+        return true;
+    }
+
+    // mmap 的偏移须按页对齐
+    const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+    const uint64_t map_off = begin - begin % page;
+    const size_t map_len = static_cast<size_t>(end - map_off);
+    void* addr = ::mmap(nullptr, map_len, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(map_off));
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(addr, map_len, MADV_SEQUENTIAL);
+    const uint8_t* mapped = static_cast<const uint8_t*>(addr);
+    auto chunk_range = [&](size_t i, uint64_t* lo, uint64_t* hi) {
+        *lo = begin + i * chunk_bytes_;
+        *hi = std::min<uint64_t>(*lo + chunk_bytes_, end);
+    };
+
+    const size_t chunks = static_cast<size_t>((end - begin + chunk_bytes_ - 1) / chunk_bytes_);
+    prepare(chunks);
+    const size_t workers = std::min(threads_, chunks);
+    std::exception_ptr error;
+    if (workers <= 1) {
+        try {
+            for (size_t i = 0; i < chunks; ++i) {
+                uint64_t lo = 0, hi = 0;
+                chunk_range(i, &lo, &hi);
+                process(i, mapped + (lo - map_off), lo, hi);
+                if (!commit(i)) {
+                    break;
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+    } else {
+        // 工作线程按序领片，最多领先合并进度 window 片；调用线程按片顺序等待并合并
+        const size_t window = 2 * workers;
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::vector<char> done(chunks, 0);
+        size_t next = 0;
+        size_t committed = 0;
+        bool stop = false;
+        auto worker = [&] {
+            for (;;) {
+                size_t i = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cv.wait(lock, [&] { return stop || next >= chunks || next < committed + window; });
+                    if (stop || next >= chunks) {
+                        return;
+                    }
+                    i = next++;
+                }
+                uint64_t lo = 0, hi = 0;
+                chunk_range(i, &lo, &hi);
+                try {
+                    process(i, mapped + (lo - map_off), lo, hi);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    stop = true;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    done[i] = 1;
+                }
+                cv.notify_all();
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(workers);
+        for (size_t t = 0; t < workers; ++t) {
+            pool.emplace_back(worker);
+        }
+        for (size_t i = 0; i < chunks; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return done[i] || stop; });
+                if (stop) {
+                    break;
+                }
+            }
+            bool more = false;
+            try {
+                more = commit(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                committed = i + 1;
+                stop = stop || !more;
+            }
+            cv.notify_all();
+            if (!more) {
+                break;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& t : pool) {
+            t.join();
+        }
+    }
+    ::munmap(addr, map_len);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return true;
+}
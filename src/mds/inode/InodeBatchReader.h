@@ -0,0 +1,135 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "inode.h"
+#include "InodeStorage.h"
+
+/**
+ * @brief 批文件中一个 inode 槽的只读视图。
+ *
+ * 定长头部（位置、类型、大小、inode 号、时间戳）按需直接从槽里取，不分配内存；
+ * 文件名、卷、块段等变长部分只在 decode() 时解析。布局与 Inode::serialize 一致。
+ */
+class InodeSlotView {
+public:
+    static constexpr size_t kSlotSize = InodeStorage::INODE_DISK_SLOT_SIZE;
+
+    InodeSlotView(const uint8_t* data, uint64_t file_offset) : data_(data), file_offset_(file_offset) {}
+
+    // 槽在批文件中的字节偏移
+    uint64_t file_offset() const { return file_offset_; }
+    const uint8_t* data() const { return data_; }
+
+    uint64_t inode() const { return read<uint64_t>(kInodeOffset); }
+    uint16_t node_id() const { return read_union<LocationId>(kLocationOffset).fields.node_id; }
+    uint8_t node_type() const { return read_union<LocationId>(kLocationOffset).fields.node_type; }
+    uint8_t file_type() const { return read_union<FileMode>(kFileModeOffset).fields.file_type; }
+    uint64_t file_size() const;  // 与 Inode::getFileSize 相同的换算
+
+    InodeTimestamp fm_time() const { return read_timestamp(kFmTimeOffset); }
+    InodeTimestamp fa_time() const { return read_timestamp(kFaTimeOffset); }
+
+    /**
+     * @brief 只做越界检查、不拷贝数据，结果与 Inode::deserialize 能否成功一致。
+     */
+    bool valid() const;
+
+    /**
+     * @brief 完整反序列化整个槽。
+     */
+    bool decode(Inode& out) const;
+
+private:
+    static constexpr size_t kLocationOffset = 0;
+    static constexpr size_t kFileModeOffset = 6;
+    static constexpr size_t kFileSizeOffset = 8;
+    static constexpr size_t kInodeOffset = 10;
+    static constexpr size_t kFmTimeOffset = kInodeOffset + sizeof(uint64_t) + Inode::kNamespaceIdLen;
+    static constexpr size_t kFaTimeOffset = kFmTimeOffset + sizeof(InodeTimestamp);
+    static constexpr size_t kFixedSize = kFmTimeOffset + 4 * sizeof(InodeTimestamp);
+
+    // 借用 Inode 中的位域联合体解码，位序与序列化时一致
+    using LocationId = decltype(Inode::location_id);
+    using FileMode = decltype(Inode::file_mode);
+    using FileSize = decltype(Inode::file_size);
+
+    template <typename U>
+    U read_union(size_t offset) const {
+        U u;
+        std::memcpy(&u.raw, data_ + offset, sizeof(u.raw));
+        return u;
+    }
+    template <typename T>
+    T read(size_t offset) const {
+        T v;
+        std::memcpy(&v, data_ + offset, sizeof(T));
+        return v;
+    }
+    InodeTimestamp read_timestamp(size_t offset) const;
+
+    const uint8_t* data_;
+    uint64_t file_offset_;
+};
+
+/**
+ * @brief inode 批文件的并行读取器。
+ *
+ * 以只读 mmap 打开批文件，把 [begin, end) 区间按 chunk_bytes 切片分给工作线程解码，
+ * 调用线程再按文件顺序逐片合并结果，因此合并结果与单线程顺序扫描完全一致。
+ * 工作线程最多领先合并进度 2 × threads 片，内存占用与文件大小无关。
+ */
+class InodeBatchReader {
+public:
+    struct Options {
+        size_t threads = 0;                  ///< 解码线程数，0 表示取硬件并发数，1 表示在调用线程内完成
+        size_t chunk_bytes = 4ULL << 20;     ///< 每片字节数，向下对齐到槽大小
+    };
+
+    InodeBatchReader() : InodeBatchReader(Options{}) {}
+    explicit InodeBatchReader(Options opts);
+
+    size_t threads() const { return threads_; }
+
+    /**
+     * @brief 扫描批文件的 [begin, end) 字节区间（按槽对齐，end 超出文件时截到文件末尾的整槽）。
+     *
+     * @param decode 在工作线程上调用：decode(view, acc)，把槽解码到本片的累加器 Acc 中；
+     *               需要可并发调用。
+     * @param merge 在调用线程上按片顺序调用：merge(std::move(acc))，返回 false 时停止，
+     *              后续片不再合并。
+     * @return 文件无法打开/映射返回 false；merge 提前停止不算失败。
+     */
+    template <typename Acc, typename Decode, typename Merge>
+    bool scan(const std::string& path, uint64_t begin, uint64_t end, Decode&& decode, Merge&& merge) {
+        std::vector<Acc> results;
+        return run(
+            path, begin, end,
+            [&](size_t chunks) { results.resize(chunks); },
+            [&](size_t chunk, const uint8_t* data, uint64_t lo, uint64_t hi) {
+                Acc& acc = results[chunk];
+                for (uint64_t off = lo; off < hi; off += InodeSlotView::kSlotSize) {
+                    decode(InodeSlotView(data + (off - lo), off), acc);
+                }
+            },
+            [&](size_t chunk) {
+                Acc acc = std::move(results[chunk]);
+                results[chunk] = Acc{};
+                return merge(std::move(acc));
+            });
+    }
+
+private:
+    // process(chunk, data, lo, hi)：data 指向文件偏移 lo 处，[lo, hi) 为整槽区间
+    bool run(const std::string& path,
+             uint64_t begin,
+             uint64_t end,
+             const std::function<void(size_t)>& prepare,
+             const std::function<void(size_t, const uint8_t*, uint64_t, uint64_t)>& process,
+             const std::function<bool(size_t)>& commit);
+
+    size_t threads_;
+    size_t chunk_bytes_;
+};
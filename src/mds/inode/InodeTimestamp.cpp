@@ -15,15 +15,30 @@ int decode_year_offset(uint32_t stored) {
 
 } // namespace
 
-InodeTimestamp::InodeTimestamp() {
-    std::time_t t = std::time(nullptr);
-    std::tm* now = std::localtime(&t);
-    int full_year = now->tm_year + 1900;
+InodeTimestamp::InodeTimestamp() : InodeTimestamp(std::time(nullptr)) {}
+
+InodeTimestamp::InodeTimestamp(std::time_t t) {
+    std::tm tm{};
+    localtime_r(&t, &tm);
+    int full_year = tm.tm_year + 1900;
     year   = encode_year_offset(full_year);
-    month  = now->tm_mon + 1;
-    day    = now->tm_mday;
-    hour   = now->tm_hour;
-    minute = now->tm_min;
+    month  = tm.tm_mon + 1;
+    day    = tm.tm_mday;
+    hour   = tm.tm_hour;
+    minute = tm.tm_min;
+}
+
+std::time_t InodeTimestamp::to_time_t() const {
+    std::tm tm{};
+    int full_year = decode_year_offset(year);
+    if (full_year < 1970) full_year = 1970;
+    tm.tm_year = full_year - 1900;
+    tm.tm_mon  = month > 0 ? static_cast<int>(month) - 1 : 0;
+    tm.tm_mday = day > 0 ? static_cast<int>(day) : 1;
+    tm.tm_hour = static_cast<int>(hour);
+    tm.tm_min  = static_cast<int>(minute);
+    tm.tm_isdst = -1;
+    return std::mktime(&tm);
 }
 
 void InodeTimestamp::print() const {
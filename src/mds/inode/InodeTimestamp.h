@@ -12,5 +12,7 @@ public:
     uint32_t minute : 6; // 6比特
 
     InodeTimestamp();
+    explicit InodeTimestamp(std::time_t t);  // 按本地时间编码，精确到分钟
+    std::time_t to_time_t() const;           // 按本地时间解码，失败返回 -1
     void print() const;
 };
@@ -0,0 +1,299 @@
+#include "LayoutStore.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+#include "../../common/Crc32c.h"
+#include "../../common/FileUtil.h"
+
+namespace {
+
+// 记录尾部校验 " #xxxxxxxx"：空格、'#'、8 位十六进制 CRC32C。
+constexpr size_t kCrcSuffixLen = 10;
+
+std::string FrameRecord(const std::string& body) {
+    char suffix[kCrcSuffixLen + 2];
+    std::snprintf(suffix, sizeof(suffix), " #%08x\n", Crc32c(body.data(), body.size()));
+    return body + suffix;
+}
+
+// 拆出校验后缀。无后缀（旧格式）时 framed 为 false，body 为整行。
+bool CheckFrame(const std::string& line, std::string& body, bool& framed) {
+    framed = line.size() >= kCrcSuffixLen && line[line.size() - kCrcSuffixLen] == ' ' &&
+             line[line.size() - kCrcSuffixLen + 1] == '#';
+    if (!framed) {
+        body = line;
+        return true;
+    }
+    body = line.substr(0, line.size() - kCrcSuffixLen);
+    const std::string hex = line.substr(line.size() - kCrcSuffixLen + 2);
+    if (hex.find_first_not_of("0123456789abcdef") != std::string::npos) {
+        return false;
+    }
+    return static_cast<uint32_t>(std::stoul(hex, nullptr, 16)) == Crc32c(body.data(), body.size());
+}
+
+std::string SetRecord(uint64_t ino, const FileLayout& layout) {
+    std::ostringstream line;
+    line << "SET " << ino << ' ' << layout.chunk_size << ' ' << layout.node_ids.size();
+    for (const auto& id : layout.node_ids) {
+        line << ' ' << id;
+    }
+    if (layout.erasure_coded()) {
+        line << " EC " << layout.ec_data << ' ' << layout.ec_parity << ' ' << layout.ec_cell_size;
+    }
+    if (layout.replicas > 1) {
+        line << " R " << layout.replicas;
+    }
+    return line.str();
+}
+
+void ApplyRecord(const std::string& body, std::unordered_map<uint64_t, FileLayout>& layouts) {
+    std::istringstream ss(body);
+    std::string op;
+    uint64_t ino = 0;
+    if (!(ss >> op >> ino)) {
+        return;
+    }
+    if (op == "DEL") {
+        layouts.erase(ino);
+        return;
+    }
+    if (op != "SET") {
+        return;
+    }
+    FileLayout layout;
+    size_t count = 0;
+    if (!(ss >> layout.chunk_size >> count)) {
+        return;
+    }
+    layout.node_ids.reserve(count);
+    std::string node;
+    while (layout.node_ids.size() < count && ss >> node) {
+        layout.node_ids.push_back(node);
+    }
+    // 带 EC/R 标记但字段不全（或标记未知）的记录视为无效。
+    std::string tag;
+    bool bad_tag = false;
+    while (!bad_tag && ss >> tag) {
+        if (tag == "EC") {
+            bad_tag = !(ss >> layout.ec_data >> layout.ec_parity >> layout.ec_cell_size) ||
+                      !layout.erasure_coded();
+        } else if (tag == "R") {
+            bad_tag = !(ss >> layout.replicas) || layout.replicas == 0;
+        } else {
+            bad_tag = true;
+        }
+    }
+    if (bad_tag) {
+        return;
+    }
+    if (layout.node_ids.size() == count && layout.chunk_size > 0 && count > 0) {
+        layouts[ino] = std::move(layout);
+    }
+}
+
+} // namespace
+
+LayoutStore::LayoutStore(std::string log_path)
+    : log_path_(std::move(log_path)) {}
+
+LayoutStore::~LayoutStore() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool LayoutStore::load() {
+    std::lock_guard<std::mutex> lk(mu_);
+    layouts_.clear();
+    records_ = 0;
+    log_size_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    std::error_code ec;
+    if (!std::filesystem::exists(log_path_, ec)) {
+        return !ec && open_log_locked();
+    }
+    std::ifstream in(log_path_, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "[LayoutStore] open failed: " << log_path_ << std::endl;
+        return false;
+    }
+    std::ostringstream buf;
+    buf << in.rdbuf();
+    const std::string data = buf.str();
+    in.close();
+
+    bool legacy = false;
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const size_t nl = data.find('\n', pos);
+        if (nl == std::string::npos) {
+            break;  // 缺换行：崩溃时写了一半的尾部记录
+        }
+        std::string body;
+        bool framed = false;
+        if (!CheckFrame(data.substr(pos, nl - pos), body, framed)) {
+            if (nl + 1 == data.size()) {
+                break;  // 尾部记录校验不符，同样按写了一半处理
+            }
+            std::cerr << "[LayoutStore] corrupt record at offset " << pos << " in " << log_path_
+                      << std::endl;
+            layouts_.clear();
+            return false;
+        }
+        legacy = legacy || !framed;
+        ApplyRecord(body, layouts_);
+        ++records_;
+        pos = nl + 1;
+    }
+    if (pos < data.size()) {
+        std::cerr << "[LayoutStore] dropping torn tail (" << data.size() - pos << " bytes) of "
+                  << log_path_ << std::endl;
+        if (::truncate(log_path_.c_str(), static_cast<off_t>(pos)) != 0) {
+            std::cerr << "[LayoutStore] truncate failed: " << std::strerror(errno) << std::endl;
+            layouts_.clear();
+            return false;
+        }
+    }
+    log_size_ = pos;
+    if (!open_log_locked()) {
+        layouts_.clear();
+        return false;
+    }
+    // 旧格式日志整体重写一次，之后所有记录都带校验。
+    if (legacy || (records_ > kCompactMinRecords && records_ > 2 * layouts_.size())) {
+        compact_locked();
+    }
+    return true;
+}
+
+bool LayoutStore::reset() {
+    std::lock_guard<std::mutex> lk(mu_);
+    layouts_.clear();
+    records_ = 0;
+    log_size_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    std::error_code ec;
+    std::filesystem::remove(log_path_, ec);
+    if (ec) {
+        return false;
+    }
+    return open_log_locked();
+}
+
+bool LayoutStore::set(uint64_t ino, const FileLayout& layout) {
+    if (layout.chunk_size == 0 || layout.node_ids.empty()) {
+        return false;
+    }
+    const std::string line = SetRecord(ino, layout);
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!append_line(line)) {
+        return false;
+    }
+    layouts_[ino] = layout;
+    return true;
+}
+
+bool LayoutStore::erase(uint64_t ino) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (layouts_.erase(ino) == 0) {
+        return false;
+    }
+    return append_line("DEL " + std::to_string(ino));
+}
+
+bool LayoutStore::get(uint64_t ino, FileLayout& out) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = layouts_.find(ino);
+    if (it == layouts_.end()) {
+        return false;
+    }
+    out = it->second;
+    return true;
+}
+
+bool LayoutStore::open_log_locked() {
+    int fd = ::open(log_path_.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[LayoutStore] open failed: " << log_path_ << ": " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // 新建的日志要让目录项也落盘。
+    if (st.st_size == 0) {
+        SyncDir(std::filesystem::path(log_path_).parent_path().string());
+    }
+    fd_ = fd;
+    log_size_ = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+bool LayoutStore::append_line(const std::string& line) {
+    if (fd_ < 0 && !open_log_locked()) {
+        return false;
+    }
+    const std::string rec = FrameRecord(line);
+    if (!WriteAll(fd_, rec.data(), rec.size()) || ::fdatasync(fd_) != 0) {
+        std::cerr << "[LayoutStore] append failed: " << log_path_ << ": " << std::strerror(errno)
+                  << std::endl;
+        // 截掉写了一半的记录，免得下一条接在它后面。
+        if (::ftruncate(fd_, static_cast<off_t>(log_size_)) != 0) {
+            std::cerr << "[LayoutStore] truncate failed: " << std::strerror(errno) << std::endl;
+        }
+        return false;
+    }
+    log_size_ += rec.size();
+    ++records_;
+    if (records_ > kCompactMinRecords && records_ > 2 * layouts_.size()) {
+        compact_locked();
+    }
+    return true;
+}
+
+bool LayoutStore::compact_locked() {
+    std::string snapshot;
+    for (const auto& [ino, layout] : layouts_) {
+        snapshot += FrameRecord(SetRecord(ino, layout));
+    }
+    const std::string tmp = log_path_ + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0;
+    ok = ok && WriteAll(fd, snapshot.data(), snapshot.size()) && ::fsync(fd) == 0;
+    if (fd >= 0) {
+        ok = ::close(fd) == 0 && ok;
+    }
+    ok = ok && ::rename(tmp.c_str(), log_path_.c_str()) == 0;
+    if (!ok) {
+        std::cerr << "[LayoutStore] compaction failed: " << std::strerror(errno) << std::endl;
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    SyncDir(std::filesystem::path(log_path_).parent_path().string());
+    // 旧 fd 仍指向被替换掉的日志，重新打开快照继续追加。
+    ::close(fd_);
+    fd_ = -1;
+    records_ = layouts_.size();
+    return open_log_locked();
+}
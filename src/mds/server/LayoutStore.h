@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// FileLayout
+// 功能: 描述一个文件如何切分成定长 chunk 并条带化到多个存储节点。
+//  - chunk_size: 每个 chunk 的字节数；第 i 个 chunk 覆盖 [i*chunk_size, (i+1)*chunk_size)。
+//  - node_ids: 条带节点列表，第 i 个 chunk 存放在 node_ids[i % node_ids.size()] 上。
+//  - ec_data/ec_parity/ec_cell_size: 非零时按 RS(k, m) 纠删码存放，数据按 ec_cell_size
+//    切成行，每行 k 个数据单元 + m 个校验单元，分布在一组 k + m 个分片 chunk 上。
+//  - replicas: 非纠删码文件每个 chunk 的副本数，第 i 个 chunk 的副本依次放在
+//    node_ids[(i + r) % node_ids.size()] 上；0/1 表示单副本。
+struct FileLayout {
+    uint64_t chunk_size{0};
+    std::vector<std::string> node_ids;
+    uint32_t ec_data{0};
+    uint32_t ec_parity{0};
+    uint64_t ec_cell_size{0};
+    uint32_t replicas{0};
+
+    bool erasure_coded() const { return ec_data > 0 && ec_parity > 0 && ec_cell_size > 0; }
+};
+
+// LayoutStore
+// 功能: 按 inode 号保存文件布局，持久化为追加写的文本日志（SET/DEL 记录），
+//       启动时重放日志恢复内存映射。布局只在创建/删除文件时变化，日志量很小。
+//       纠删码布局在 SET 记录末尾追加 "EC k m cell"，多副本布局追加 "R n"，
+//       旧日志无这些字段仍可读。
+//       每条记录以 " #<crc32c>" 结尾（8 位十六进制，覆盖之前的文本）再换行；
+//       追加经常开的 fd 写入并 fdatasync 后才返回。重放时缺换行或校验不符的
+//       尾部记录视为崩溃写了一半，丢弃并截掉；中间记录校验不符视为损坏，load 失败。
+//       无校验后缀的旧记录照常读取。失效记录多于存活布局时把日志压缩为快照
+//       （临时文件 fsync 后 rename，再 fsync 目录）。
+class LayoutStore {
+public:
+    explicit LayoutStore(std::string log_path);
+    ~LayoutStore();
+
+    LayoutStore(const LayoutStore&) = delete;
+    LayoutStore& operator=(const LayoutStore&) = delete;
+
+    // 从日志重放布局并打开日志供追加；文件不存在视为空表。
+    // 日志无法读取、中间记录损坏或无法打开追加时返回 false。
+    bool load();
+
+    // 清空内存与日志（用于 create_new 启动）。
+    bool reset();
+
+    // 记录 ino 的布局（覆盖已有记录）。
+    bool set(uint64_t ino, const FileLayout& layout);
+
+    // 删除 ino 的布局；不存在时返回 false。
+    bool erase(uint64_t ino);
+
+    // 查询 ino 的布局；不存在时返回 false。
+    bool get(uint64_t ino, FileLayout& out) const;
+
+private:
+    // 压缩门限：日志记录数超过该值且超过存活布局数的两倍时重写快照。
+    static constexpr size_t kCompactMinRecords = 1024;
+
+    bool open_log_locked();
+    bool append_line(const std::string& line);
+    bool compact_locked();
+
+    std::string log_path_;
+    mutable std::mutex mu_;
+    std::unordered_map<uint64_t, FileLayout> layouts_;
+    int fd_{-1};
+    uint64_t log_size_{0};  // 已完整写入的日志字节数，追加失败时截回这里
+    size_t records_{0};     // 日志中的记录数（含已失效的）
+};
@@ -66,10 +66,29 @@ static uint32_t inode_timestamp_key(const InodeTimestamp& t) {
     return key;
 }
 
+// 迁移提交前的校验：数据位置、大小和修改时间都没变才算同一份数据
+static bool same_layout(const Inode& a, const Inode& b) {
+    if (a.getVolumeUUID() != b.getVolumeUUID() || a.file_size.raw != b.file_size.raw ||
+        inode_timestamp_key(a.fm_time) != inode_timestamp_key(b.fm_time)) {
+        return false;
+    }
+    const auto& sa = a.getBlocks();
+    const auto& sb = b.getBlocks();
+    if (sa.size() != sb.size()) return false;
+    for (size_t i = 0; i < sa.size(); ++i) {
+        if (sa[i].logical_start != sb[i].logical_start || sa[i].start_block != sb[i].start_block ||
+            sa[i].block_count != sb[i].block_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
 MdsServer::MdsServer(bool create_new)
     : meta_(std::make_unique<MetadataManager>(INODE_STORAGE_PATH, INODE_BITMAP_PATH, create_new)),
       dir_store_(std::make_unique<DirStore>("./mds_meta")),
-      dir_lock_table_()
+      dir_lock_table_(),
+      inode_lock_table_()
 {
     // 可选：CreateRoot() 或 RebuildInodeTable()
 }
@@ -91,6 +110,10 @@ void MdsServer::set_volume_manager(std::shared_ptr<VolumeManager> manager) {
     volume_manager_ = std::move(manager);
 }
 
+std::shared_ptr<VolumeManager> MdsServer::volume_manager() const {
+    return volume_manager_;
+}
+
 void MdsServer::set_handle_observer(std::weak_ptr<IHandleObserver> observer) {
     handle_observer_ = std::move(observer);
 }
@@ -109,10 +132,12 @@ bool MdsServer::RegisterVolume(const std::shared_ptr<Volume>& vol,
 MdsServer::MdsServer(const std::string& inode_path,
                      const std::string& bitmap_path,
                      const std::string& dir_store_base,
-                     bool create_new)
-    : meta_(std::make_unique<MetadataManager>(inode_path, bitmap_path, create_new)),
+                     bool create_new,
+                     const std::string& kv_path)
+    : meta_(std::make_unique<MetadataManager>(inode_path, bitmap_path, create_new, 2, true, kv_path)),
     dir_store_(std::make_unique<DirStore>(dir_store_base)),
-    dir_lock_table_()
+    dir_lock_table_(),
+    inode_lock_table_()
 {
     // 可选：CreateRoot() 或 RebuildInodeTable()
 }
@@ -483,11 +508,45 @@ bool MdsServer::ReadInode(uint64_t ino, Inode& out) {
 }
 
 bool MdsServer::WriteInode(uint64_t ino, const Inode& in) {
+    DirectoryLockGuard inode_guard(inode_lock_table_, ino, DirectoryLockMode::kExclusive);
+    return write_inode_unlocked(ino, in);
+}
+
+bool MdsServer::write_inode_unlocked(uint64_t ino, const Inode& in) {
     if (!meta_) return false;
     auto st = meta_->get_inode_storage();
     return st ? st->write_inode(ino, in) : false;
 }
 
+bool MdsServer::RelocateInode(uint64_t ino,
+                              const Inode& expected,
+                              const std::string& volume_id,
+                              const std::vector<BlockSegment>& blocks,
+                              uint8_t node_type) {
+    // 比较与写回之间不能插入其他写入，否则会用旧内容覆盖刚写入的大小或块段
+    DirectoryLockGuard inode_guard(inode_lock_table_, ino, DirectoryLockMode::kExclusive);
+    Inode current;
+    if (!ReadInode(ino, current) || !same_layout(current, expected)) {
+        return false;
+    }
+    // 写回缓冲里的数据不反映在 inode 上，必须在 inode 锁内判定；栅栏挡住提交期间的新写入
+    if (volume_manager_ && !volume_manager_->fence_writes(ino)) {
+        return false;
+    }
+    current.setVolumeId(volume_id);
+    current.clearBlocks();
+    current.appendBlocks(blocks);
+    current.setNodeType(node_type);
+    const bool ok = write_inode_unlocked(ino, current);
+    if (ok) {
+        notify_handle_observer(ino);
+    }
+    if (volume_manager_) {
+        volume_manager_->release_fence(ino);
+    }
+    return ok;
+}
+
 // ========== 冷数据扫描（不依赖客户端 AccessTracker，基于 atime 全量排序） ==========
 
 std::vector<uint64_t> MdsServer::CollectColdInodes(size_t max_candidates, size_t /*min_age_windows*/) {
@@ -600,8 +659,12 @@ void MdsServer::ClearInodeTable() {
 }
 
 bool MdsServer::TruncateFile(const std::string& path) {
+    const uint64_t ino = LookupIno(path);
+    if (ino == static_cast<uint64_t>(-1)) return false;
+    // 加锁后再读 inode，释放的一定是当前的块（不会是分层迁移刚换掉的旧块）
+    DirectoryLockGuard inode_guard(inode_lock_table_, ino, DirectoryLockMode::kExclusive);
     auto inode = FindInodeByPath(path);
-    if (!inode) return false;
+    if (!inode || inode->inode != ino) return false;
     bool released = false;
     if (volume_manager_) {
         released = volume_manager_->release_inode_blocks(inode);
@@ -619,8 +682,7 @@ bool MdsServer::TruncateFile(const std::string& path) {
     inode->setFcTime(now);
 
     notify_handle_observer(inode->inode);
-    return meta_ && meta_->get_inode_storage()
-        && meta_->get_inode_storage()->write_inode(inode->inode, *inode);
+    return write_inode_unlocked(inode->inode, *inode);
 }
 
 void MdsServer::notify_handle_observer(uint64_t inode) {
@@ -41,6 +41,8 @@ private:
     std::unordered_map<std::string, uint64_t> inode_table_;
     mutable std::shared_mutex mtx_namespace_;
     mds::DirectoryLockTable dir_lock_table_;
+    // 单个 inode 的读-改-写（WriteInode、RelocateInode、TruncateFile）按 inode 互斥
+    mds::DirectoryLockTable inode_lock_table_;
     // 可选的卷注册/分配组件
     std::shared_ptr<IVolumeRegistry> volume_registry_;
     std::unique_ptr<VolumeAllocator> volume_allocator_;
@@ -55,6 +57,9 @@ private:
      * 此方法会尝试 lock() 弱引用的观察者并调用其 CloseHandlesForInode。
      */
     void notify_handle_observer(uint64_t inode);
+
+    // 不加锁写回 inode，调用方持有 inode_lock_table_ 中该 inode 的锁
+    bool write_inode_unlocked(uint64_t ino, const Inode& in);
     
 public:
     /**
@@ -69,11 +74,13 @@ public:
      * @param bitmap_path 位图文件路径。
      * @param dir_store_base 目录存储根路径。
      * @param create_new 是否创建全新存储。
+     * @param kv_path 路径 -> inode 映射的 KV 存储目录。
      */
     MdsServer(const std::string& inode_path,
               const std::string& bitmap_path,
               const std::string& dir_store_base,
-              bool create_new);
+              bool create_new,
+              const std::string& kv_path = "/tmp/zbstorage_kv");
 
     /**
      * @brief 创建根目录。
@@ -222,6 +229,26 @@ public:
      */
     bool WriteInode(uint64_t ino, const Inode& in);
 
+    /**
+     * @brief 把 inode 的数据位置整体切换到新卷（分层迁移的提交点）。
+     *
+     * 持有该 inode 的锁重新读取 inode，若卷、块段、大小或修改时间与 expected 不一致
+     * （拷贝期间被改写），或注入的卷管理器中该 inode 有未刷写、正在下发的数据，则放弃；
+     * 否则在写入栅栏下一次写回新的 volume_id、块段和节点类型，并通知句柄观察者关闭
+     * 仍持有旧块映射的句柄。
+     * @param ino inode 号。
+     * @param expected 开始拷贝时读到的 inode。
+     * @param volume_id 目标卷 UUID。
+     * @param blocks 目标卷上的块段。
+     * @param node_type 目标节点类型（0:SSD 1:HDD）。
+     * @return 切换成功返回 true。
+     */
+    bool RelocateInode(uint64_t ino,
+                       const Inode& expected,
+                       const std::string& volume_id,
+                       const std::vector<BlockSegment>& blocks,
+                       uint8_t node_type);
+
     /**
      * @brief 根据冷热标准收集冷 inode。
      * @param max_candidates 最大数量。
@@ -264,6 +291,11 @@ public:
      */
     void set_volume_manager(std::shared_ptr<VolumeManager> manager);
 
+    /**
+     * @brief 获取当前注入的卷管理器（可能为 nullptr）。
+     */
+    std::shared_ptr<VolumeManager> volume_manager() const;
+
     /**
      * @brief 注册/注销句柄观察者回调。
      *
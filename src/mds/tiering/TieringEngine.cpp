@@ -0,0 +1,364 @@
+#include "TieringEngine.h"
+
+#include <algorithm>
+#include <ctime>
+#include <exception>
+
+#include <nlohmann/json.hpp>
+
+#include "../server/Server.h"
+#include "../../common/JsonCheckpoint.h"
+#include "../../debug/ZBLog.h"
+#include "../../fs/block/BlockManager.h"
+#include "../../fs/volume/VolumeManager.h"
+#include "../../srm/image_manager/ImageManager.h"
+
+namespace {
+
+constexpr uint8_t kNodeTypeHdd = 1;
+
+} // namespace
+
+BandwidthBudget::BandwidthBudget(uint64_t bytes_per_sec) : rate_(bytes_per_sec) {}
+
+void BandwidthBudget::set_rate(uint64_t bytes_per_sec) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	rate_ = bytes_per_sec;
+}
+
+std::chrono::steady_clock::duration BandwidthBudget::reserve(uint64_t bytes) {
+	std::lock_guard<std::mutex> lock(mtx_);
+	if (rate_ == 0 || bytes == 0) {
+		return std::chrono::steady_clock::duration::zero();
+	}
+	const auto now = std::chrono::steady_clock::now();
+	const auto start = std::max(now, next_free_);
+	next_free_ = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+							 std::chrono::duration<double>(static_cast<double>(bytes) / static_cast<double>(rate_)));
+	return start - now;
+}
+
+TieringEngine::TieringEngine(MdsServer* mds,
+							 std::shared_ptr<IVolumeRegistry> registry,
+							 std::shared_ptr<VolumeManager> volumes,
+							 srm::ImageManager* image_mgr,
+							 TieringConfig cfg)
+	: mds_(mds),
+	  registry_(std::move(registry)),
+	  volumes_(std::move(volumes)),
+	  image_mgr_(image_mgr),
+	  config_(std::move(cfg)) {}
+
+TieringEngine::~TieringEngine() { stop(); }
+
+void TieringEngine::start() {
+	bool expected = false;
+	if (!running_.compare_exchange_strong(expected, true)) {
+		return;
+	}
+	stop_requested_ = false;
+	worker_ = std::thread(&TieringEngine::run_loop, this);
+}
+
+void TieringEngine::stop() {
+	if (!running_.load()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(wake_mtx_);
+		stop_requested_ = true;
+	}
+	wake_cv_.notify_all();
+	if (worker_.joinable()) {
+		worker_.join();
+	}
+	stop_requested_ = false;
+	running_ = false;
+}
+
+void TieringEngine::update_config(const TieringConfig& cfg) {
+	std::lock_guard<std::mutex> lock(config_mtx_);
+	config_ = cfg;
+}
+
+TieringConfig TieringEngine::snapshot_config() const {
+	std::lock_guard<std::mutex> lock(config_mtx_);
+	return config_;
+}
+
+TieringRoundStats TieringEngine::last_round() const {
+	std::lock_guard<std::mutex> lock(stats_mtx_);
+	return last_round_;
+}
+
+TieringCursor TieringEngine::scan_cursor() const {
+	std::lock_guard<std::mutex> lock(cursor_mtx_);
+	return cursor_;
+}
+
+void TieringEngine::load_cursor(const std::string& path) {
+	if (path.empty()) {
+		return;
+	}
+	nlohmann::json root;
+	std::string error;
+	if (!LoadJsonCheckpoint(path, root, error)) {
+		if (!error.empty()) {
+			LOGW("tiering: ignore broken cursor checkpoint " << path << ": " << error);
+		}
+		return;
+	}
+	try {
+		cursor_.next_ino = root.value("next_ino", uint64_t{0});
+		cursor_.passes = root.value("passes", uint64_t{0});
+	} catch (const std::exception& ex) {
+		LOGW("tiering: ignore broken cursor checkpoint " << path << ": " << ex.what());
+		cursor_ = TieringCursor{};
+	}
+}
+
+void TieringEngine::save_cursor(const std::string& path) {
+	if (path.empty()) {
+		return;
+	}
+	nlohmann::json root;
+	root["next_ino"] = cursor_.next_ino;
+	root["passes"] = cursor_.passes;
+	std::string error;
+	if (!SaveJsonCheckpoint(path, root, error)) {
+		LOGW("tiering: failed to write cursor checkpoint " << path << ": " << error);
+	}
+}
+
+void TieringEngine::run_loop() {
+	while (!stop_requested_.load()) {
+		run_once();
+		TieringConfig cfg = snapshot_config();
+		std::unique_lock<std::mutex> lock(wake_mtx_);
+		wake_cv_.wait_for(lock, cfg.scan_interval, [this] { return stop_requested_.load(); });
+	}
+}
+
+bool TieringEngine::throttle(std::chrono::steady_clock::duration wait) {
+	if (wait <= std::chrono::steady_clock::duration::zero()) {
+		return !stop_requested_.load();
+	}
+	std::unique_lock<std::mutex> lock(wake_mtx_);
+	return !wake_cv_.wait_for(lock, wait, [this] { return stop_requested_.load(); });
+}
+
+BandwidthBudget& TieringEngine::node_budget(const std::string& node_id, uint64_t rate) {
+	std::lock_guard<std::mutex> lock(budget_mtx_);
+	auto& budget = node_budgets_[node_id];
+	if (!budget) {
+		budget = std::make_unique<BandwidthBudget>(rate);
+	} else {
+		budget->set_rate(rate);
+	}
+	return *budget;
+}
+
+std::shared_ptr<Volume> TieringEngine::pick_hdd_volume(const std::string& prefer_node,
+													   size_t blocks,
+													   double reserve_ratio) {
+	std::shared_ptr<Volume> best;
+	size_t best_free = 0;
+	bool best_local = false;
+	for (const auto& vol : registry_->list(VolumeType::HDD)) {
+		if (!vol) {
+			continue;
+		}
+		const size_t total = vol->total_blocks();
+		const size_t free = total - vol->used_blocks();
+		const auto reserve = static_cast<size_t>(reserve_ratio * static_cast<double>(total));
+		if (free < blocks + reserve) {
+			continue;
+		}
+		// 优先同节点（不走网络），其次空闲最多
+		const bool local = vol->storage_node_id() == prefer_node;
+		if (!best || (local && !best_local) || (local == best_local && free > best_free)) {
+			best = vol;
+			best_free = free;
+			best_local = local;
+		}
+	}
+	return best;
+}
+
+void TieringEngine::free_segments(const std::string& volume_uuid, const std::vector<BlockSegment>& segments) {
+	auto vol = registry_->find_by_uuid(volume_uuid);
+	if (!vol) {
+		LOGW("tiering: volume " << volume_uuid << " missing, leaked " << segments.size() << " segments");
+		return;
+	}
+	for (const auto& seg : segments) {
+		try {
+			vol->safe_free_blocks(seg);
+		} catch (const std::exception& ex) {
+			LOGW("tiering: free " << seg.to_string() << " on " << volume_uuid << " failed: " << ex.what());
+		}
+	}
+}
+
+TieringEngine::Outcome TieringEngine::demote_to_hdd(const Candidate& c, const TieringConfig& cfg) {
+	const Inode& snapshot = c.inode;
+	auto src = registry_->find_by_uuid(snapshot.getVolumeUUID());
+	if (!src) {
+		return Outcome::Failed;
+	}
+	size_t blocks = 0;
+	for (const auto& seg : snapshot.getBlocks()) {
+		blocks += seg.block_count;
+	}
+	auto dst = pick_hdd_volume(src->storage_node_id(), blocks, cfg.hdd_reserve_ratio);
+	if (!dst) {
+		LOGW("tiering: no HDD volume can take inode " << c.ino << " (" << blocks << " blocks)");
+		return Outcome::Failed;
+	}
+	// 提前跳过有未刷写数据的文件，省去白拷贝；提交时 RelocateInode 在 inode 锁内再判定
+	if (volumes_->has_dirty(c.ino)) {
+		return Outcome::Busy;
+	}
+
+	// 拷到一个指向目标卷的副本上，块映射在提交前不对外可见
+	auto source = std::make_shared<Inode>(snapshot);
+	auto staging = std::make_shared<Inode>(snapshot);
+	staging->clearBlocks();
+	staging->setVolumeId(dst->uuid());
+	BandwidthBudget& src_node = node_budget(src->storage_node_id(), cfg.node_bytes_per_sec);
+	BandwidthBudget& dst_node = node_budget(dst->storage_node_id(), cfg.node_bytes_per_sec);
+
+	// inode 里的文件大小是 14 位数值加单位的近似值，按已映射的整块拷贝才不会截掉尾部
+	const uint64_t size = static_cast<uint64_t>(blocks) * BLOCK_SIZE;
+	const size_t chunk = std::max<size_t>(cfg.copy_chunk_bytes, 1);
+	std::vector<char> buf(static_cast<size_t>(std::min<uint64_t>(chunk, size)));
+	bool copied = true;
+	try {
+		for (uint64_t off = 0; off < size;) {
+			const size_t n = static_cast<size_t>(std::min<uint64_t>(chunk, size - off));
+			auto wait = std::max(ssd_read_budget_.reserve(n), hdd_write_budget_.reserve(n));
+			wait = std::max(wait, src_node.reserve(n));
+			wait = std::max(wait, dst_node.reserve(n));
+			if (!throttle(wait) ||
+				volumes_->read_file(source, off, buf.data(), n) != static_cast<ssize_t>(n) ||
+				volumes_->write_file_direct(staging, off, buf.data(), n) != static_cast<ssize_t>(n)) {
+				copied = false;
+				break;
+			}
+			off += n;
+		}
+	} catch (const std::exception& ex) {
+		LOGW("tiering: copy of inode " << c.ino << " failed: " << ex.what());
+		copied = false;
+	}
+	if (!copied) {
+		free_segments(dst->uuid(), staging->getBlocks());
+		return Outcome::Failed;
+	}
+
+	if (!mds_->RelocateInode(c.ino, snapshot, dst->uuid(), staging->getBlocks(), kNodeTypeHdd)) {
+		free_segments(dst->uuid(), staging->getBlocks());
+		return Outcome::Busy;
+	}
+	free_segments(snapshot.getVolumeUUID(), snapshot.getBlocks());
+	return Outcome::Demoted;
+}
+
+TieringRoundStats TieringEngine::run_once() {
+	TieringRoundStats stats;
+	if (!mds_ || !registry_ || !volumes_) {
+		return stats;
+	}
+	TieringConfig cfg = snapshot_config();
+	ssd_read_budget_.set_rate(cfg.ssd_read_bytes_per_sec);
+	hdd_write_budget_.set_rate(cfg.hdd_write_bytes_per_sec);
+
+	std::unordered_set<std::string> ssd_volumes;
+	for (const auto& vol : registry_->list(VolumeType::SSD)) {
+		if (vol) {
+			ssd_volumes.insert(vol->uuid());
+		}
+	}
+
+	const std::time_t now = std::time(nullptr);
+	const auto warm_age = std::chrono::duration_cast<std::chrono::seconds>(cfg.warm_threshold).count();
+	const auto cold_age = std::chrono::duration_cast<std::chrono::seconds>(cfg.cold_threshold).count();
+	uint64_t end = mds_->GetTotalInodes();
+	if (cfg.end_ino != 0) {
+		end = std::min<uint64_t>(end, cfg.end_ino + 1);
+	}
+
+	// 从上一轮停下的 inode 继续，单轮额度小于 inode 总数时也能轮流覆盖整个区间
+	std::unique_lock<std::mutex> cursor_lock(cursor_mtx_);
+	if (!cursor_loaded_) {
+		load_cursor(cfg.cursor_checkpoint_path);
+		cursor_loaded_ = true;
+	}
+	uint64_t ino = cfg.start_ino;
+	if (cursor_.next_ino > cfg.start_ino && cursor_.next_ino < end) {
+		ino = cursor_.next_ino;
+	}
+
+	std::vector<Candidate> demote;
+	for (; ino < end && stats.inspected < cfg.max_inodes_per_round; ++ino) {
+		if (!mds_->IsInodeAllocated(ino)) {
+			continue;
+		}
+		Inode inode;
+		if (!mds_->ReadInode(ino, inode) ||
+			inode.file_mode.fields.file_type != static_cast<uint16_t>(FileType::Regular)) {
+			continue;
+		}
+		stats.inspected++;
+		const std::time_t accessed = inode.fa_time.to_time_t();
+		if (accessed == -1 || now - accessed < warm_age) {
+			continue;
+		}
+		if (now - accessed >= cold_age && image_mgr_ &&
+			image_mgr_->sim_image_write_file(inode) == IMAGE_OP_SUCCESS) {
+			stats.cold_submitted++;
+		}
+		if (ssd_volumes.count(inode.getVolumeUUID()) && !inode.getBlocks().empty()) {
+			demote.push_back(Candidate{ino, accessed, std::move(inode)});
+		}
+	}
+
+	if (ino >= end) {
+		cursor_ = TieringCursor{cfg.start_ino, cursor_.passes + 1};
+	} else {
+		cursor_.next_ino = ino;
+	}
+	save_cursor(cfg.cursor_checkpoint_path);
+	cursor_lock.unlock();
+
+	// 最久未访问的先迁
+	std::sort(demote.begin(), demote.end(),
+			  [](const Candidate& a, const Candidate& b) { return a.accessed < b.accessed; });
+	if (demote.size() > cfg.max_migrations_per_round) {
+		demote.resize(cfg.max_migrations_per_round);
+	}
+	for (const auto& c : demote) {
+		if (stop_requested_.load()) {
+			break;
+		}
+		switch (demote_to_hdd(c, cfg)) {
+			case Outcome::Demoted:
+				stats.demoted++;
+				stats.demoted_bytes += c.inode.getFileSize();
+				break;
+			case Outcome::Busy:
+				stats.skipped_busy++;
+				break;
+			case Outcome::Failed:
+				stats.failed++;
+				break;
+		}
+	}
+	LOGI("tiering: inspected " << stats.inspected << ", demoted " << stats.demoted
+		 << " (" << stats.demoted_bytes << " bytes), cold " << stats.cold_submitted
+		 << ", busy " << stats.skipped_busy << ", failed " << stats.failed);
+
+	std::lock_guard<std::mutex> lock(stats_mtx_);
+	last_round_ = stats;
+	return stats;
+}
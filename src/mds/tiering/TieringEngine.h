@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../inode/inode.h"
+#include "../../fs/volume/VolumeRegistry.h"
+
+class MdsServer;
+class VolumeManager;
+class ImageManager;
+namespace srm {
+using ImageManager = ::ImageManager;
+}
+
+// 迁移带宽预算：按速率给每次拷贝排一个开始时间，返回调用方还需等待多久。
+class BandwidthBudget {
+public:
+	explicit BandwidthBudget(uint64_t bytes_per_sec = 0); // 0 表示不限速
+	void set_rate(uint64_t bytes_per_sec);
+	std::chrono::steady_clock::duration reserve(uint64_t bytes);
+
+private:
+	std::mutex mtx_;
+	uint64_t rate_;
+	std::chrono::steady_clock::time_point next_free_{};
+};
+
+// 分层扫描游标：每轮从上一轮停下的 inode 继续，扫到区间末尾后回到起点
+struct TieringCursor {
+	uint64_t next_ino = 0; // 下一轮检查的第一个 inode 号，不在扫描区间内时从 start_ino 开始
+	uint64_t passes = 0;   // 已完整扫过整个区间的遍数
+};
+
+struct TieringConfig {
+	uint64_t start_ino = 0;                      // 起始 inode 号（包含）
+	uint64_t end_ino = 0;                        // 结束 inode 号（包含），0 代表扫到最大
+	std::string cursor_checkpoint_path;          // 扫描游标检查点文件，为空则游标只保存在内存中
+	std::chrono::hours warm_threshold{24 * 7};   // 超过此值未访问的 SSD 文件降到 HDD
+	std::chrono::hours cold_threshold{24 * 180}; // 超过此值未访问的文件交给光盘镜像打包
+	std::chrono::seconds scan_interval{3600};    // 后台线程每轮间隔
+	size_t max_inodes_per_round = 100'000;       // 单轮最多检查多少个 inode
+	size_t max_migrations_per_round = 1'000;     // 单轮最多迁移多少个文件
+	size_t copy_chunk_bytes = 8ULL << 20;        // 单次拷贝的字节数
+	uint64_t ssd_read_bytes_per_sec = 400ULL << 20;  // SSD 层迁移读带宽上限，0 不限
+	uint64_t hdd_write_bytes_per_sec = 200ULL << 20; // HDD 层迁移写带宽上限，0 不限
+	uint64_t node_bytes_per_sec = 100ULL << 20;      // 单个存储节点的迁移读写带宽上限，0 不限
+	double hdd_reserve_ratio = 0.05;             // HDD 卷保留的空闲比例，不足时不再接收迁移
+};
+
+struct TieringRoundStats {
+	size_t inspected = 0;     // 检查过的文件
+	size_t demoted = 0;       // SSD -> HDD 迁移成功
+	uint64_t demoted_bytes = 0;
+	size_t cold_submitted = 0; // 交给镜像打包器的冷文件
+	size_t skipped_busy = 0;   // 拷贝期间被改写或有未刷写数据，下轮再试
+	size_t failed = 0;
+};
+
+// SSD -> HDD -> 光盘 的自动分层。
+// 每轮按 MDS 中的访问时间给文件分温度：
+//   - 热：不动；
+//   - 温：仍在 SSD 卷上的，按最久未访问优先拷到 HDD 卷，MdsServer::RelocateInode 一次切换
+//     inode 的卷和块段（拷贝期间文件被改写则放弃），成功后释放 SSD 上的旧块；
+//   - 冷：交给光盘镜像打包器（镜像生成与刻录仍由冷数据收集器驱动）；还在 SSD 上的同时降到 HDD。
+// 迁移拷贝按 SSD 读、HDD 写、源/目标节点四个带宽预算节流，给前台 I/O 留出带宽。
+class TieringEngine {
+public:
+	TieringEngine(MdsServer* mds,
+				  std::shared_ptr<IVolumeRegistry> registry,
+				  std::shared_ptr<VolumeManager> volumes,
+				  srm::ImageManager* image_mgr,
+				  TieringConfig cfg);
+	~TieringEngine();
+
+	// 启动后台线程（幂等）。
+	void start();
+	// 请求停止线程并阻塞等待退出；正在进行的拷贝会被中止。
+	void stop();
+	void update_config(const TieringConfig& cfg);
+
+	// 同步执行一轮分层。
+	TieringRoundStats run_once();
+	TieringRoundStats last_round() const;
+	TieringCursor scan_cursor() const;
+
+private:
+	enum class Outcome { Demoted, Busy, Failed };
+
+	struct Candidate {
+		uint64_t ino;
+		std::time_t accessed;
+		Inode inode;
+	};
+
+	void run_loop();
+	Outcome demote_to_hdd(const Candidate& c, const TieringConfig& cfg);
+	std::shared_ptr<Volume> pick_hdd_volume(const std::string& prefer_node, size_t blocks, double reserve_ratio);
+	BandwidthBudget& node_budget(const std::string& node_id, uint64_t rate);
+	bool throttle(std::chrono::steady_clock::duration wait); // 等待期间 stop 时返回 false
+	void free_segments(const std::string& volume_uuid, const std::vector<BlockSegment>& segments);
+	TieringConfig snapshot_config() const;
+	void load_cursor(const std::string& path); // 从检查点恢复游标（调用方持有 cursor_mtx_）
+	void save_cursor(const std::string& path); // 原子写出游标检查点（调用方持有 cursor_mtx_）
+
+	MdsServer* mds_;
+	std::shared_ptr<IVolumeRegistry> registry_;
+	std::shared_ptr<VolumeManager> volumes_;
+	srm::ImageManager* image_mgr_;
+
+	TieringConfig config_;
+	mutable std::mutex config_mtx_;
+
+	BandwidthBudget ssd_read_budget_;
+	BandwidthBudget hdd_write_budget_;
+	std::unordered_map<std::string, std::unique_ptr<BandwidthBudget>> node_budgets_;
+	std::mutex budget_mtx_;
+
+	TieringRoundStats last_round_;
+	mutable std::mutex stats_mtx_;
+
+	TieringCursor cursor_;
+	bool cursor_loaded_ = false;
+	mutable std::mutex cursor_mtx_;
+
+	std::thread worker_;
+	std::atomic<bool> running_{false};
+	std::atomic<bool> stop_requested_{false};
+	std::mutex wake_mtx_;
+	std::condition_variable wake_cv_;
+};
@@ -12,6 +12,16 @@
 #include "mds.pb.h"
 #include "../../../src/mds/server/Server.h"
 #include "../../../src/fs/volume/VolumeRegistry.h"
+#include "../../../src/mds/server/LayoutStore.h"
+#include "../../../src/mds/collector/collector.h"
+#include "../../../src/mds/tiering/TieringEngine.h"
+#include "../../../src/fs/io/LocalStorageGateway.h"
+#include "../../../src/fs/volume/VolumeManager.h"
+#include "../../../src/srm/storage_manager/StorageResource.h"
+#include "../../../src/srm/image_manager/ImageManager.h"
+#include "../../../src/srm/optical_manager/BurnScheduler.h"
+#include "../../../src/srm/optical_manager/DiscLocationCatalog.h"
+#include "../../../src/srm/optical_manager/DiscManager.h"
 #include "common/StatusUtils.h"
 #include "common/LogRedirect.h"
 
@@ -22,7 +32,25 @@ DEFINE_string(mds_data_dir, "/tmp/mds_rpc", "Base dir for inode/bitmap/dir_store
 DEFINE_bool(mds_create_new, true, "Create new metadata store");
 DEFINE_string(node_alloc_policy, "prefer_real", "Node allocation policy: prefer_real|prefer_virtual|round_robin");
 DEFINE_bool(enable_volume_registry, false, "Enable legacy volume registry/allocator");
+DEFINE_int32(stripe_width, 4, "Number of nodes a new file's chunks are striped across");
+DEFINE_int32(chunk_size_mb, 64, "Chunk size of new files in MiB");
+DEFINE_int32(ec_data, 0, "Default erasure code data fragments k for new files (0 = no erasure coding)");
+DEFINE_int32(ec_parity, 0, "Default erasure code parity fragments m for new files");
+DEFINE_int32(ec_cell_kb, 1024, "Erasure code cell size in KiB (must divide the chunk size)");
+DEFINE_int32(replicas, 1, "Default copies of each chunk of new non-erasure-coded files");
 DEFINE_string(log_file, "", "Log file path (append). Empty = stdout/stderr");
+DEFINE_bool(cold_archive, false, "Pack cold files into disc images and burn them to the optical libraries");
+DEFINE_string(cold_inode_dir, "/mnt/md0/inode", "Directory of inode batch files scanned for cold files");
+DEFINE_string(cold_image_dir, "", "Directory where disc images are written before burning "
+              "(empty = only plan images, no disc locations are recorded; "
+              "needs --enable_volume_registry to read file data)");
+DEFINE_int32(cold_threshold_hours, 24 * 180, "Files not accessed for this long are archived to disc");
+DEFINE_int32(optical_libraries, 1, "Number of optical disc libraries used for burning");
+DEFINE_int32(optical_drives, 12, "Drives per optical disc library");
+DEFINE_double(burn_time_scale, 1.0, "Real seconds per simulated burn second (0 = do not wait)");
+DEFINE_bool(enable_tiering, false, "Move idle files from SSD to HDD volumes (needs --enable_volume_registry)");
+DEFINE_int32(tiering_interval_sec, 3600, "Seconds between tiering rounds");
+DEFINE_int32(tiering_warm_hours, 24 * 7, "SSD files not accessed for this long move to HDD");
 
 namespace {
 
@@ -78,7 +106,7 @@ void SerializeVolume(const Volume& vol, rpc::VolumeBlob* out) {
 class MdsServiceImpl : public rpc::MdsService {
 public:
     MdsServiceImpl(const std::string& base_dir, bool create_new)
-        : base_dir_(base_dir) {
+        : base_dir_(base_dir), layouts_(base_dir + "/layouts.log") {
         std::error_code ec;
         std::filesystem::create_directories(base_dir_, ec);
         const std::string inode_path = base_dir_ + "/inode.dat";
@@ -98,6 +126,11 @@ public:
             std::filesystem::remove_all("/tmp/zbstorage_kv", ec);
             std::filesystem::create_directories("/tmp/zbstorage_kv", ec);
         }
+        // 布局日志损坏或无法打开时不再继续：否则已有文件的条带信息全部丢失。
+        if (!(create_new ? layouts_.reset() : layouts_.load())) {
+            std::cerr << "Failed to open layout log under " << base_dir_ << std::endl;
+            return;
+        }
         mds_ = std::make_shared<MdsServer>(inode_path, bitmap_path, dir_store, create_new);
         if (FLAGS_enable_volume_registry) {
             mds_->set_volume_registry(make_file_volume_registry(base_dir_));
@@ -144,6 +177,14 @@ public:
             LogRequest("CreateFile", request->path(), response);
             return;
         }
+        // 先确定布局：纠删码要求条带内节点数 >= k + m，不满足时不创建文件。
+        FileLayout layout;
+        std::string layout_err;
+        if (!BuildLayout(node_id, request, layout, layout_err)) {
+            StatusUtils::SetStatus(response, rpc::STATUS_NODE_NOT_FOUND, layout_err);
+            LogRequest("CreateFile", request->path(), response);
+            return;
+        }
         if (!mds_->CreateFile(request->path(), static_cast<mode_t>(request->mode()))) {
             StatusUtils::SetStatus(response, rpc::STATUS_IO_ERROR, "create file failed");
             LogRequest("CreateFile", request->path(), response);
@@ -161,6 +202,17 @@ public:
             LogRequest("CreateFile", request->path(), response);
             return;
         }
+        if (!layouts_.set(inode->inode, layout)) {
+            // 没有布局的文件会被客户端当作旧式单 chunk 文件读写，撤销创建后再报错，
+            // 调用方可以原样重试。
+            if (!mds_->RemoveFile(request->path())) {
+                std::cerr << "[MDS RPC] rollback of " << request->path()
+                          << " after layout write failure failed" << std::endl;
+            }
+            StatusUtils::SetStatus(response, rpc::STATUS_IO_ERROR, "write layout failed");
+            LogRequest("CreateFile", request->path(), response);
+            return;
+        }
         StatusUtils::SetStatus(response, rpc::STATUS_SUCCESS, "");
         LogRequest("CreateFile", request->path(), response);
     }
@@ -175,6 +227,7 @@ public:
         response->mutable_status()->CopyFrom(ToStatus(ok));
         if (ok && ino != static_cast<uint64_t>(-1)) {
             response->add_detached_inodes(ino);
+            layouts_.erase(ino);
         }
         LogRequest("RemoveFile", request->path(), response->mutable_status());
     }
@@ -292,6 +345,22 @@ public:
         SerializeInode(*inode, response->mutable_inode());
         response->set_volume_id(inode->getVolumeUUID());
         response->set_node_id(inode->getVolumeUUID());
+        FileLayout layout;
+        if (layouts_.get(inode->inode, layout)) {
+            auto* out = response->mutable_layout();
+            out->set_chunk_size(layout.chunk_size);
+            for (const auto& id : layout.node_ids) {
+                out->add_node_ids(id);
+            }
+            if (layout.erasure_coded()) {
+                out->set_ec_data(layout.ec_data);
+                out->set_ec_parity(layout.ec_parity);
+                out->set_ec_cell_size(layout.ec_cell_size);
+            }
+            if (layout.replicas > 1) {
+                out->set_replicas(layout.replicas);
+            }
+        }
         StatusUtils::SetStatus(response->mutable_status(), rpc::STATUS_SUCCESS, "");
         LogRequest("FindInode", request->path(), response->mutable_status());
     }
@@ -385,6 +454,10 @@ public:
                                               static_cast<VolumeType>(request->type()),
                                               &index,
                                               request->persist_now());
+        // 分层引擎与冷归档同时在用这个 VolumeManager；它的卷表由 volumes_mutex_ 保护，可在 brpc 线程上注册
+        if (ok && local_volumes_) {
+            local_volumes_->register_volume(vol);
+        }
         response->mutable_status()->CopyFrom(ToStatus(ok));
         response->set_index(ok ? index : -1);
         LogRequest("RegisterVolume", vol ? vol->uuid() : "<null>", response->mutable_status());
@@ -434,6 +507,12 @@ public:
         }
     }
 
+    // 构造失败（布局日志无法恢复）时为 false，服务不可用。
+    bool ok() const { return mds_ != nullptr; }
+    const std::string& base_dir() const { return base_dir_; }
+    std::shared_ptr<MdsServer> server() const { return mds_; }
+    void set_local_volumes(std::shared_ptr<VolumeManager> volumes) { local_volumes_ = std::move(volumes); }
+
 private:
     std::string PickNodeId() {
         std::lock_guard<std::mutex> lk(node_mu_);
@@ -466,14 +545,279 @@ private:
         return node_order_.front();
     }
 
+    // 新文件布局：条带由分配策略选出的节点及其后同类型的已注册节点组成，最多
+    // --stripe_width 个；请求或 MDS 默认开启纠删码时，条带至少包含 k + m 个同类节点，
+    // cell 大小须整除 chunk 大小。非纠删码文件按请求或 --replicas 设置副本数，
+    // 副本数不超过条带节点数。
+    bool BuildLayout(const std::string& first, const rpc::PathModeRequest* request,
+                     FileLayout& layout, std::string& err) {
+        layout = FileLayout{};
+        layout.chunk_size = static_cast<uint64_t>(std::max(1, FLAGS_chunk_size_mb)) << 20;
+        int k = FLAGS_ec_data;
+        int m = FLAGS_ec_parity;
+        if (request->has_layout()) {
+            k = static_cast<int>(request->layout().ec_data());
+            m = static_cast<int>(request->layout().ec_parity());
+        }
+        if (k <= 0 || m <= 0) {
+            const int replicas = request->replicas() > 0 ? static_cast<int>(request->replicas())
+                                                         : std::max(1, FLAGS_replicas);
+            const size_t width = static_cast<size_t>(std::max(FLAGS_stripe_width, replicas));
+            layout.node_ids = PickStripeNodes(first, std::max<size_t>(1, width));
+            if (replicas > 1) {
+                if (layout.node_ids.size() < static_cast<size_t>(replicas)) {
+                    std::cerr << "[MDS RPC] only " << layout.node_ids.size() << " nodes for "
+                              << replicas << " replicas" << std::endl;
+                }
+                layout.replicas = static_cast<uint32_t>(
+                    std::min(layout.node_ids.size(), static_cast<size_t>(replicas)));
+            }
+            return true;
+        }
+        if (k + m > 255) {
+            err = "unsupported erasure code RS(" + std::to_string(k) + "," + std::to_string(m) + ")";
+            return false;
+        }
+        const size_t width = static_cast<size_t>(std::max(FLAGS_stripe_width, k + m));
+        layout.node_ids = PickStripeNodes(first, width);
+        if (layout.node_ids.size() < static_cast<size_t>(k + m)) {
+            err = "RS(" + std::to_string(k) + "," + std::to_string(m) + ") needs " +
+                  std::to_string(k + m) + " nodes, have " + std::to_string(layout.node_ids.size());
+            return false;
+        }
+        uint64_t cell = static_cast<uint64_t>(std::max(4, FLAGS_ec_cell_kb)) << 10;
+        if (cell > layout.chunk_size || layout.chunk_size % cell != 0) {
+            cell = layout.chunk_size;
+        }
+        layout.ec_data = static_cast<uint32_t>(k);
+        layout.ec_parity = static_cast<uint32_t>(m);
+        layout.ec_cell_size = cell;
+        return true;
+    }
+
+    std::vector<std::string> PickStripeNodes(const std::string& first, size_t width) {
+        std::vector<std::string> stripe{first};
+        std::lock_guard<std::mutex> lk(node_mu_);
+        auto first_it = nodes_.find(first);
+        auto pos = std::find(node_order_.begin(), node_order_.end(), first);
+        if (first_it == nodes_.end() || pos == node_order_.end()) {
+            return stripe;
+        }
+        const size_t start = static_cast<size_t>(pos - node_order_.begin());
+        for (size_t i = 1; i < node_order_.size() && stripe.size() < width; ++i) {
+            const auto& id = node_order_[(start + i) % node_order_.size()];
+            auto it = nodes_.find(id);
+            if (it != nodes_.end() && it->second.node_type() == first_it->second.node_type()) {
+                stripe.push_back(id);
+            }
+        }
+        return stripe;
+    }
+
     std::string base_dir_;
     std::shared_ptr<MdsServer> mds_;
+    LayoutStore layouts_;
+    std::shared_ptr<VolumeManager> local_volumes_;
     std::mutex node_mu_;
     std::unordered_map<std::string, rpc::NodeInfo> nodes_;
     std::vector<std::string> node_order_;
     size_t rr_cursor_{0};
 };
 
+namespace {
+
+// 本机卷：卷数据经本机 StorageResource 读写，按卷注册表登记到一个 VolumeManager 并注入 MDS。
+// 分层迁移与冷归档读文件数据共用，比两者都晚析构。
+struct LocalVolumes {
+    StorageResource resource;
+    std::shared_ptr<VolumeManager> volumes;
+
+    ~LocalVolumes() {
+        if (g_storage_resource == &resource) g_storage_resource = nullptr;
+    }
+};
+
+std::unique_ptr<LocalVolumes> OpenLocalVolumes(MdsServiceImpl& svc, const char* needed_by) {
+    auto registry = svc.server()->volume_registry();
+    if (!registry) {
+        std::cerr << needed_by << " needs --enable_volume_registry" << std::endl;
+        return nullptr;
+    }
+    auto local = std::make_unique<LocalVolumes>();
+    local->resource.loadFromFile(false, false);
+    if (!g_storage_resource) {
+        g_storage_resource = &local->resource;
+    }
+    local->volumes = std::make_shared<VolumeManager>();
+    local->volumes->set_default_gateway(std::make_shared<LocalStorageGateway>());
+    for (auto type : {VolumeType::SSD, VolumeType::HDD}) {
+        for (const auto& vol : registry->list(type)) {
+            local->volumes->register_volume(vol);
+        }
+    }
+    svc.server()->set_volume_manager(local->volumes);
+    svc.set_local_volumes(local->volumes);
+    return local;
+}
+
+// 冷数据归档：收集器把冷文件打包成镜像交给刻录调度器，刻完后文件位置写入光盘位置目录。
+// 空白盘从持久化的光盘状态表分配，交给刻录前先落盘，重启后不会重刻已用过的盘。
+// 成员按依赖顺序析构：先停收集器，再停刻录调度器。
+struct ColdArchive {
+    std::unique_ptr<ImageManager> images;
+    std::shared_ptr<DiscLocationCatalog> catalog;
+    DiscManager discs;
+    std::mutex discs_mu;
+    std::shared_ptr<BurnScheduler> burner;
+    std::unique_ptr<ColdDataCollectorService> collector;
+
+    ~ColdArchive() {
+        if (collector) collector->stop();
+        if (burner) burner->stop();
+    }
+};
+
+std::unique_ptr<ColdArchive> StartColdArchive(MdsServiceImpl& svc) {
+    const std::string dir = svc.base_dir() + "/cold_archive";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    auto archive = std::make_unique<ColdArchive>();
+
+    // 镜像号持久化，重启后不复用。未给出 --cold_image_dir 时只装箱不落盘，
+    // 刻录的是模拟镜像，不能据此记录文件在光盘上的位置
+    ImageManager::Options image_opts;
+    image_opts.output_dir = FLAGS_cold_image_dir;
+    image_opts.id_file = dir + "/next_image_id";
+    archive->images = std::make_unique<ImageManager>(image_opts);
+    // 先恢复镜像号上界与已落盘镜像，收集器起来后才不会复用旧镜像号
+    if (archive->images->load_catalog() < 0) {
+        std::cerr << "Failed to load image catalog under " << dir << std::endl;
+        return nullptr;
+    }
+    if (!FLAGS_cold_image_dir.empty()) {
+        // 文件数据经 MDS 注入的卷管理器读取（见 OpenLocalVolumes），没有它镜像里只会是空洞
+        std::shared_ptr<MdsServer> server = svc.server();
+        if (!server->volume_manager()) {
+            std::cerr << "--cold_image_dir needs the local volume manager" << std::endl;
+            return nullptr;
+        }
+        archive->images->set_source_reader([server](const Inode& inode, uint64_t offset, char* dst, size_t len) {
+            auto volumes = server->volume_manager();
+            if (!volumes) {
+                return static_cast<ssize_t>(-1);
+            }
+            return volumes->read_file(std::make_shared<Inode>(inode), offset, dst, len);
+        });
+        archive->catalog = std::make_shared<DiscLocationCatalog>(dir + "/disc_locations.dat");
+        if (!archive->catalog->Open()) {
+            std::cerr << "Failed to open disc location catalog under " << dir << std::endl;
+            return nullptr;
+        }
+    }
+
+    const uint32_t library_count = static_cast<uint32_t>(std::max(1, FLAGS_optical_libraries));
+    archive->discs.snapshot_file = dir + "/disc_table.bin";
+    if (std::filesystem::exists(archive->discs.snapshot_file, ec) && !archive->discs.loadSnapshot()) {
+        std::cerr << "Failed to load disc table " << archive->discs.snapshot_file << std::endl;
+        return nullptr;
+    }
+    // 首次启动或新增了光盘库：补上这些库的空白盘
+    const size_t known_discs = archive->discs.totalDiscCount();
+    for (uint32_t lib = 0; lib < library_count; ++lib) {
+        for (uint32_t slot = 0; slot < OPTICAL_LIBRARY_DISC_NUM; ++slot) {
+            const uint32_t disc = lib * OPTICAL_LIBRARY_DISC_NUM + slot;
+            if (!archive->discs.hasDisc(disc)) {
+                archive->discs.addDisc(disc, DiscStatus::Blank);
+            }
+        }
+    }
+    if (archive->discs.totalDiscCount() != known_discs && !archive->discs.saveSnapshot()) {
+        std::cerr << "Failed to save disc table " << archive->discs.snapshot_file << std::endl;
+        return nullptr;
+    }
+
+    std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries;
+    for (uint32_t i = 0; i < library_count; ++i) {
+        libraries.push_back(std::make_shared<OpticalDiscLibrary>(
+            DiscLocationCatalog::FormatLibraryId(i), OPTICAL_LIBRARY_DISC_NUM,
+            static_cast<uint32_t>(std::max(1, FLAGS_optical_drives)), OPTICAL_LIBRARY_LOAD_TIME));
+    }
+    BurnScheduler::Options burn_opts;
+    burn_opts.time_scale = FLAGS_burn_time_scale;
+    archive->burner = std::make_shared<BurnScheduler>(std::move(libraries), burn_opts);
+    ColdArchive* state = archive.get();
+    archive->burner->setDiscAllocator([state](OpticalDiscLibrary& lib) -> std::string {
+        uint32_t lib_idx = 0;
+        if (!DiscLocationCatalog::ParseLibraryId(lib.library_id, &lib_idx)) {
+            return "";
+        }
+        std::lock_guard<std::mutex> lk(state->discs_mu);
+        const uint32_t disc = state->discs.acquireBlankDisc(lib_idx);
+        if (disc == DiscManager::kNoDisc) {
+            return "";
+        }
+        // 盘的 InUse 状态落盘后才交出去；写不进去就不刻，免得重启后再分到这张盘
+        if (!state->discs.saveSnapshot()) {
+            std::cerr << "Failed to save disc table, not burning disc " << disc << std::endl;
+            state->discs.setDiscStatus(disc, DiscStatus::Blank);
+            return "";
+        }
+        return DiscLocationCatalog::FormatDiscId(disc);
+    });
+
+    ColdCollectorConfig cfg;
+    cfg.inode_directory = FLAGS_cold_inode_dir;
+    cfg.cold_threshold = std::chrono::hours(std::max(1, FLAGS_cold_threshold_hours));
+    cfg.cursor_checkpoint_path = dir + "/scan_cursor";
+    archive->collector = std::make_unique<ColdDataCollectorService>(svc.server().get(), archive->images.get(), cfg);
+    if (archive->catalog) {
+        archive->collector->set_location_catalog(archive->catalog);
+    }
+    archive->collector->set_burn_scheduler(archive->burner);
+
+    ColdDataCollectorService* collector = archive->collector.get();
+    archive->burner->setCompletionCallback([collector, state](const BurnScheduler::BurnResult& r) {
+        // 刻失败的盘保持 InUse，不再分配
+        uint32_t disc = 0;
+        if (r.ok && DiscLocationCatalog::ParseDiscId(r.disc_id, &disc)) {
+            std::lock_guard<std::mutex> lk(state->discs_mu);
+            state->discs.setDiscStatus(disc, DiscStatus::Finalized);
+            state->discs.addUsedBytes(disc, r.job.image_bytes);
+            state->discs.saveSnapshot();
+        }
+        collector->on_image_burned(r.job.image_id, r.library_id, r.disc_id, r.ok);
+    });
+    archive->burner->start();
+    archive->collector->start();
+    return archive;
+}
+
+// SSD -> HDD 自动分层：卷数据经本机卷（LocalVolumes）读写，迁移提交走 MdsServer::RelocateInode
+struct Tiering {
+    std::unique_ptr<TieringEngine> engine;
+
+    ~Tiering() {
+        if (engine) engine->stop();
+    }
+};
+
+std::unique_ptr<Tiering> StartTiering(MdsServiceImpl& svc, const LocalVolumes& local) {
+    auto registry = svc.server()->volume_registry();
+    auto tiering = std::make_unique<Tiering>();
+
+    TieringConfig cfg;
+    cfg.scan_interval = std::chrono::seconds(std::max(1, FLAGS_tiering_interval_sec));
+    cfg.warm_threshold = std::chrono::hours(std::max(1, FLAGS_tiering_warm_hours));
+    cfg.cold_threshold = std::chrono::hours(std::max(1, FLAGS_cold_threshold_hours));
+    cfg.cursor_checkpoint_path = svc.base_dir() + "/tiering_cursor";
+    // 冷文件由 --cold_archive 的收集器打包刻录，分层引擎只做 SSD -> HDD 迁移
+    tiering->engine = std::make_unique<TieringEngine>(svc.server().get(), registry, local.volumes, nullptr, cfg);
+    tiering->engine->start();
+    return tiering;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
     if (!RedirectLogs(FLAGS_log_file)) {
@@ -482,6 +826,32 @@ int main(int argc, char* argv[]) {
     }
     brpc::Server server;
     MdsServiceImpl svc(FLAGS_mds_data_dir, FLAGS_mds_create_new);
+    if (!svc.ok()) {
+        return -1;
+    }
+    // 本机卷先于分层和归档建立、最后析构：分层经它迁移数据，归档落盘镜像时经它读取文件数据
+    std::unique_ptr<LocalVolumes> local;
+    if (FLAGS_enable_tiering || (FLAGS_cold_archive && !FLAGS_cold_image_dir.empty())) {
+        local = OpenLocalVolumes(svc, FLAGS_enable_tiering ? "--enable_tiering" : "--cold_image_dir");
+        if (!local) {
+            return -1;
+        }
+    }
+    // 归档随后析构、先停
+    std::unique_ptr<Tiering> tiering;
+    if (FLAGS_enable_tiering) {
+        tiering = StartTiering(svc, *local);
+        if (!tiering) {
+            return -1;
+        }
+    }
+    std::unique_ptr<ColdArchive> archive;
+    if (FLAGS_cold_archive) {
+        archive = StartColdArchive(svc);
+        if (!archive) {
+            return -1;
+        }
+    }
     if (server.AddService(&svc, brpc::SERVER_DOESNT_OWN_SERVICE) != 0) {
         std::cerr << "Failed to add mds service" << std::endl;
         return -1;
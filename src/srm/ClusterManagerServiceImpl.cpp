@@ -23,3 +23,14 @@ void ClusterManagerServiceImpl::Heartbeat(::google::protobuf::RpcController*,
     }
     manager_->HandleHeartbeat(request, response);
 }
+
+void ClusterManagerServiceImpl::ListNodes(::google::protobuf::RpcController*,
+                                          const storagenode::ListNodesRequest* request,
+                                          storagenode::ListNodesResponse* response,
+                                          ::google::protobuf::Closure* done) {
+    brpc::ClosureGuard guard(done);
+    if (!manager_) {
+        return;
+    }
+    manager_->HandleListNodes(request, response);
+}
@@ -20,6 +20,11 @@ public:
                    storagenode::HeartbeatResponse* response,
                    ::google::protobuf::Closure* done) override;
 
+    void ListNodes(::google::protobuf::RpcController* controller,
+                   const storagenode::ListNodesRequest* request,
+                   storagenode::ListNodesResponse* response,
+                   ::google::protobuf::Closure* done) override;
+
 private:
     std::shared_ptr<StorageNodeManager> manager_;
 };
@@ -5,18 +5,30 @@
 void NodeRegistry::Upsert(NodeContext ctx) {
     std::unique_lock<std::shared_mutex> lk(mu_);
     ctx.last_heartbeat = std::chrono::steady_clock::now();
+    auto it = nodes_.find(ctx.node_id);
+    if (it == nodes_.end() || it->second.ip != ctx.ip || it->second.port != ctx.port ||
+        it->second.type != ctx.type || it->second.state != ctx.state) {
+        epoch_.fetch_add(1, std::memory_order_acq_rel);
+    }
     nodes_[ctx.node_id] = std::move(ctx);
 }
 
 bool NodeRegistry::UpdateHeartbeat(const std::string& node_id,
-                                   std::chrono::steady_clock::time_point now) {
+                                   std::chrono::steady_clock::time_point now,
+                                   uint64_t in_flight_io,
+                                   double cpu_usage) {
     std::unique_lock<std::shared_mutex> lk(mu_);
     auto it = nodes_.find(node_id);
     if (it == nodes_.end()) {
         return false;
     }
     it->second.last_heartbeat = now;
-    it->second.state = NodeState::Online;
+    it->second.in_flight_io = in_flight_io;
+    it->second.cpu_usage = cpu_usage;
+    if (it->second.state != NodeState::Online) {
+        it->second.state = NodeState::Online;
+        epoch_.fetch_add(1, std::memory_order_acq_rel);
+    }
     return true;
 }
 
@@ -26,7 +38,10 @@ bool NodeRegistry::MarkOffline(const std::string& node_id) {
     if (it == nodes_.end()) {
         return false;
     }
-    it->second.state = NodeState::Offline;
+    if (it->second.state != NodeState::Offline) {
+        it->second.state = NodeState::Offline;
+        epoch_.fetch_add(1, std::memory_order_acq_rel);
+    }
     return true;
 }
 
@@ -54,3 +69,15 @@ std::vector<NodeContext> NodeRegistry::Snapshot() const {
     }
     return out;
 }
+
+std::vector<NodeContext> NodeRegistry::Snapshot(uint64_t& epoch) const {
+    std::vector<NodeContext> out;
+    std::shared_lock<std::shared_mutex> lk(mu_);
+    // Writers bump the epoch under the exclusive lock, so it is stable here.
+    epoch = epoch_.load(std::memory_order_acquire);
+    out.reserve(nodes_.size());
+    for (const auto& kv : nodes_) {
+        out.push_back(kv.second);
+    }
+    return out;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <shared_mutex>
 #include <string>
@@ -35,6 +36,9 @@ struct NodeContext {
     SimulationParams sim_params{};
     NodeState state{NodeState::Online};
     std::chrono::steady_clock::time_point last_heartbeat;
+    // Load reported with the last heartbeat.
+    uint64_t in_flight_io{0};
+    double cpu_usage{0.0};
 };
 
 class NodeRegistry {
@@ -42,13 +46,22 @@ public:
     NodeRegistry() = default;
 
     void Upsert(NodeContext ctx);
-    bool UpdateHeartbeat(const std::string& node_id, std::chrono::steady_clock::time_point now);
+    // Load changes do not bump the epoch.
+    bool UpdateHeartbeat(const std::string& node_id, std::chrono::steady_clock::time_point now,
+                         uint64_t in_flight_io = 0, double cpu_usage = 0.0);
     bool MarkOffline(const std::string& node_id);
     bool Exists(const std::string& node_id) const;
     bool Get(const std::string& node_id, NodeContext& out) const;
     std::vector<NodeContext> Snapshot() const;
+    // Snapshot together with the epoch it corresponds to.
+    std::vector<NodeContext> Snapshot(uint64_t& epoch) const;
+
+    // Bumped on every change clients route by: a node added, its endpoint or
+    // type changed, or its online state flipped. Capacity updates do not count.
+    uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
 
 private:
     mutable std::shared_mutex mu_;
+    std::atomic<uint64_t> epoch_{1};
     std::unordered_map<std::string, NodeContext> nodes_;
 };
@@ -91,7 +91,9 @@ void StorageNodeManager::HandleHeartbeat(const storagenode::HeartbeatRequest* re
         return;
     }
     bool ok = registry_.UpdateHeartbeat(request->node_id(),
-                                        std::chrono::steady_clock::now());
+                                        std::chrono::steady_clock::now(),
+                                        request->in_flight_io(),
+                                        request->cpu_usage());
     if (!ok) {
         StatusUtils::SetStatus(response->mutable_status(), rpc::STATUS_NODE_NOT_FOUND, "node not registered");
         response->set_require_rereg(true);
@@ -101,6 +103,39 @@ void StorageNodeManager::HandleHeartbeat(const storagenode::HeartbeatRequest* re
     response->set_require_rereg(false);
 }
 
+void StorageNodeManager::HandleListNodes(const storagenode::ListNodesRequest* request,
+                                         storagenode::ListNodesResponse* response) const {
+    if (!request || !response) {
+        return;
+    }
+    StatusUtils::SetStatus(response->mutable_status(), rpc::STATUS_SUCCESS, "");
+    uint64_t epoch = 0;
+    auto snapshot = registry_.Snapshot(epoch);
+    response->set_epoch(epoch);
+    for (const auto& ctx : snapshot) {
+        if (ctx.state == NodeState::Offline) {
+            continue;
+        }
+        auto* load = response->add_loads();
+        load->set_node_id(ctx.node_id);
+        load->set_in_flight_io(ctx.in_flight_io);
+        load->set_cpu_usage(ctx.cpu_usage);
+    }
+    if (request->known_epoch() != 0 && request->known_epoch() == epoch) {
+        response->set_unchanged(true);
+        return;
+    }
+    response->set_unchanged(false);
+    for (const auto& ctx : snapshot) {
+        auto* ep = response->add_nodes();
+        ep->set_node_id(ctx.node_id);
+        ep->set_ip(ctx.ip);
+        ep->set_port(ctx.port);
+        ep->set_is_virtual(ctx.type == NodeType::Virtual);
+        ep->set_online(ctx.state != NodeState::Offline);
+    }
+}
+
 void StorageNodeManager::HealthLoop() {
     while (running_) {
         const auto now = std::chrono::steady_clock::now();
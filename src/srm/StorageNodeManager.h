@@ -31,6 +31,10 @@ public:
     void HandleHeartbeat(const storagenode::HeartbeatRequest* request,
                          storagenode::HeartbeatResponse* response);
 
+    // Endpoint table for clients that route data I/O directly to nodes.
+    void HandleListNodes(const storagenode::ListNodesRequest* request,
+                         storagenode::ListNodesResponse* response) const;
+
     bool GetNode(const std::string& node_id, NodeContext& ctx) const;
     // Optional: pre-register a virtual node with simulation parameters.
     void AddVirtualNode(const std::string& node_id, const SimulationParams& params, uint64_t capacity_bytes = 0);
@@ -22,6 +22,11 @@ public:
 
     brpc::Controller* controller() { return real_cntl_.get(); }
     storagenode::WriteReply* real_resp() { return real_resp_.get(); }
+    // Rewritten request (resolved chain) that must outlive the call.
+    void set_request(std::unique_ptr<storagenode::WriteRequest> req, uint32_t extra_replicas) {
+        real_req_ = std::move(req);
+        extra_replicas_ = extra_replicas;
+    }
 
     void Run() override {
         if (!client_resp_) {
@@ -38,6 +43,7 @@ public:
             msg = real_cntl_->ErrorText();
         } else if (real_resp_) {
             client_resp_->set_bytes_written(real_resp_->bytes_written());
+            client_resp_->set_replicas(real_resp_->replicas() + extra_replicas_);
             StatusUtils::SetStatus(client_resp_->mutable_status(),
                                    StatusUtils::NormalizeCode(real_resp_->status().code()),
                                    real_resp_->status().message());
@@ -60,15 +66,19 @@ private:
     ::google::protobuf::Closure* client_done_{nullptr};
     std::unique_ptr<brpc::Controller> real_cntl_;
     std::unique_ptr<storagenode::WriteReply> real_resp_;
+    std::unique_ptr<storagenode::WriteRequest> real_req_;
+    uint32_t extra_replicas_{0};
 };
 
 class RealNodeReadCallback : public ::google::protobuf::Closure {
 public:
     RealNodeReadCallback(storagenode::ReadReply* client_resp,
+                         brpc::Controller* client_cntl,
                          ::google::protobuf::Closure* client_done,
                          std::unique_ptr<brpc::Controller> real_cntl,
                          std::unique_ptr<storagenode::ReadReply> real_resp)
         : client_resp_(client_resp),
+          client_cntl_(client_cntl),
           client_done_(client_done),
           real_cntl_(std::move(real_cntl)),
           real_resp_(std::move(real_resp)) {}
@@ -92,6 +102,10 @@ public:
         } else if (real_resp_) {
             client_resp_->set_bytes_read(real_resp_->bytes_read());
             client_resp_->mutable_data()->swap(*real_resp_->mutable_data());
+            if (client_cntl_) {
+                // Hand the node's IOBuf blocks to the client reply by reference.
+                client_cntl_->response_attachment().swap(real_cntl_->response_attachment());
+            }
             client_resp_->set_checksum(real_resp_->checksum());
             StatusUtils::SetStatus(client_resp_->mutable_status(),
                                    StatusUtils::NormalizeCode(real_resp_->status().code()),
@@ -112,6 +126,7 @@ public:
 
 private:
     storagenode::ReadReply* client_resp_{nullptr};
+    brpc::Controller* client_cntl_{nullptr};
     ::google::protobuf::Closure* client_done_{nullptr};
     std::unique_ptr<brpc::Controller> real_cntl_;
     std::unique_ptr<storagenode::ReadReply> real_resp_;
@@ -172,7 +187,7 @@ private:
 
 void RequestDispatcher::DispatchWrite(const storagenode::WriteRequest* req,
                                       storagenode::WriteReply* resp,
-                                      brpc::Controller*,
+                                      brpc::Controller* cntl,
                                       ::google::protobuf::Closure* done) {
     if (!req || !resp) {
         if (done) done->Run();
@@ -183,10 +198,13 @@ void RequestDispatcher::DispatchWrite(const storagenode::WriteRequest* req,
         if (done) done->Run();
         return;
     }
+    const size_t payload_size = cntl && !cntl->request_attachment().empty()
+                                    ? cntl->request_attachment().size()
+                                    : req->data().size();
     std::cout << "[Gateway] WriteReq node=" << req->node_id()
               << " chunk=" << req->chunk_id()
               << " offset=" << req->offset()
-              << " size=" << req->data().size() << std::endl;
+              << " size=" << payload_size << std::endl;
     NodeContext ctx;
     if (!manager_ || !manager_->GetNode(req->node_id(), ctx)) {
         FillStatus(resp->mutable_status(), rpc::STATUS_NODE_NOT_FOUND, "unknown node");
@@ -201,7 +219,26 @@ void RequestDispatcher::DispatchWrite(const storagenode::WriteRequest* req,
             if (done) done->Run();
             return;
         }
-        virtual_engine_->SimulateWrite(req, resp);
+        virtual_engine_->SimulateWrite(req, cntl ? &cntl->request_attachment() : nullptr, resp);
+        if (resp->status().code() == rpc::STATUS_SUCCESS) {
+            // Stripes never mix node types, so a virtual primary has virtual replicas.
+            uint32_t copies = 1;
+            for (const auto& next : req->chain()) {
+                storagenode::WriteRequest sub(*req);
+                sub.set_node_id(next.node_id());
+                sub.clear_chain();
+                storagenode::WriteReply sub_resp;
+                virtual_engine_->SimulateWrite(&sub, cntl ? &cntl->request_attachment() : nullptr,
+                                               &sub_resp);
+                if (sub_resp.status().code() != rpc::STATUS_SUCCESS) {
+                    FillStatus(resp->mutable_status(), StatusUtils::NormalizeCode(sub_resp.status().code()),
+                               "replica " + next.node_id() + ": " + sub_resp.status().message());
+                    break;
+                }
+                ++copies;
+            }
+            resp->set_replicas(copies);
+        }
         std::cout << "[Gateway] WriteResp node=" << req->node_id()
                   << " chunk=" << req->chunk_id()
                   << " bytes=" << resp->bytes_written()
@@ -217,17 +254,32 @@ void RequestDispatcher::DispatchWrite(const storagenode::WriteRequest* req,
         if (done) done->Run();
         return;
     }
+    std::unique_ptr<storagenode::WriteRequest> resolved;
+    uint32_t virtual_copies = 0;
+    if (req->chain_size() > 0) {
+        resolved = std::make_unique<storagenode::WriteRequest>(*req);
+        virtual_copies = ResolveChain(resolved.get(), cntl ? &cntl->request_attachment() : nullptr);
+    }
     auto real_cntl = std::make_unique<brpc::Controller>();
-    real_cntl->set_timeout_ms(3000);
+    // A chain is acknowledged only after its last node, so give it one timeout per hop.
+    real_cntl->set_timeout_ms(3000 * (1 + (resolved ? resolved->chain_size() : 0)));
+    if (cntl) {
+        // Forward the payload blocks by reference; the gateway never touches the bytes.
+        real_cntl->request_attachment().swap(cntl->request_attachment());
+    }
     auto real_resp = std::make_unique<storagenode::WriteReply>();
     auto* callback = new RealNodeWriteCallback(resp, done, std::move(real_cntl), std::move(real_resp));
-    stub->Write(callback->controller(), req, callback->real_resp(), callback);
+    const storagenode::WriteRequest* real_req = resolved ? resolved.get() : req;
+    if (resolved) {
+        callback->set_request(std::move(resolved), virtual_copies);
+    }
+    stub->Write(callback->controller(), real_req, callback->real_resp(), callback);
     // Ownership of callback and internal state handled within callback.
 }
 
 void RequestDispatcher::DispatchRead(const storagenode::ReadRequest* req,
                                      storagenode::ReadReply* resp,
-                                     brpc::Controller*,
+                                     brpc::Controller* cntl,
                                      ::google::protobuf::Closure* done) {
     if (!req || !resp) {
         if (done) done->Run();
@@ -256,7 +308,7 @@ void RequestDispatcher::DispatchRead(const storagenode::ReadRequest* req,
             if (done) done->Run();
             return;
         }
-        virtual_engine_->SimulateRead(req, resp);
+        virtual_engine_->SimulateRead(req, resp, cntl ? &cntl->response_attachment() : nullptr);
         std::cout << "[Gateway] ReadResp node=" << req->node_id()
                   << " chunk=" << req->chunk_id()
                   << " bytes=" << resp->bytes_read()
@@ -275,7 +327,7 @@ void RequestDispatcher::DispatchRead(const storagenode::ReadRequest* req,
     auto real_cntl = std::make_unique<brpc::Controller>();
     real_cntl->set_timeout_ms(3000);
     auto real_resp = std::make_unique<storagenode::ReadReply>();
-    auto* callback = new RealNodeReadCallback(resp, done, std::move(real_cntl), std::move(real_resp));
+    auto* callback = new RealNodeReadCallback(resp, cntl, done, std::move(real_cntl), std::move(real_resp));
     stub->Read(callback->controller(), req, callback->real_resp(), callback);
 }
 
@@ -353,6 +405,40 @@ storagenode::StorageService_Stub* RequestDispatcher::GetStub(const NodeContext&
     return stub_ptr;
 }
 
+uint32_t RequestDispatcher::ResolveChain(storagenode::WriteRequest* req,
+                                        const butil::IOBuf* attachment) {
+    uint32_t virtual_copies = 0;
+    google::protobuf::RepeatedPtrField<storagenode::ReplicaTarget> chain;
+    chain.Swap(req->mutable_chain());
+    for (auto& next : chain) {
+        NodeContext ctx;
+        if (!manager_ || !manager_->GetNode(next.node_id(), ctx)) {
+            // Left without an address: the node reports this hop as failed.
+            req->add_chain()->CopyFrom(next);
+            continue;
+        }
+        if (ctx.type == NodeType::Virtual) {
+            if (!virtual_engine_) {
+                continue;
+            }
+            storagenode::WriteRequest sub(*req);
+            sub.set_node_id(next.node_id());
+            sub.clear_chain();
+            storagenode::WriteReply sub_resp;
+            virtual_engine_->SimulateWrite(&sub, attachment, &sub_resp);
+            if (sub_resp.status().code() == rpc::STATUS_SUCCESS) {
+                ++virtual_copies;
+            }
+            continue;
+        }
+        if (next.addr().empty()) {
+            next.set_addr(ctx.ip + ":" + std::to_string(ctx.port));
+        }
+        req->add_chain()->CopyFrom(next);
+    }
+    return virtual_copies;
+}
+
 void RequestDispatcher::FillStatus(rpc::Status* status, rpc::StatusCode code, const std::string& msg) {
     StatusUtils::SetStatus(status, code, msg);
 }
@@ -47,5 +47,9 @@ private:
     StubMap stubs_;
 
     storagenode::StorageService_Stub* GetStub(const NodeContext& ctx);
+    // Prepares req's replication chain for a real primary: fills in addresses
+    // of real nodes and writes virtual replicas through the engine, dropping
+    // them from the chain. Returns the number of virtual copies written.
+    uint32_t ResolveChain(storagenode::WriteRequest* req, const butil::IOBuf* attachment);
     void FillStatus(rpc::Status* status, rpc::StatusCode code, const std::string& msg);
 };
@@ -0,0 +1,755 @@
+#include "ImageManager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <thread>
+
+#include "../../common/Crc32c.h"
+
+namespace {
+
+constexpr char kImageMagic[8] = {'Z', 'B', 'D', 'I', 'S', 'C', '0', '1'};
+constexpr uint32_t kImageVersion = 1;
+
+// 镜像头，位于镜像和 .idx 文件的开头
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;
+    uint64_t image_id;
+    uint64_t file_count;
+    uint64_t index_bytes;
+    uint64_t data_offset;
+    uint64_t image_bytes;
+    uint32_t index_crc;
+    uint32_t header_crc;  // 计算时本字段为 0
+};
+static_assert(sizeof(ImageHeader) == 64, "image header layout");
+
+constexpr uint64_t kHeaderBytes = sizeof(ImageHeader);
+// 索引项：inode(8) offset(8) size(8) path_len(2) path
+constexpr uint64_t kEntryFixedBytes = 26;
+// 镜像号按段预留，每分配这么多个镜像号才写一次 id_file
+constexpr uint64_t kImageIdBlock = 1024;
+
+uint64_t align_up(uint64_t v, uint64_t a) {
+    return a > 1 ? (v + a - 1) / a * a : v;
+}
+
+template <typename T>
+void put_pod(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool get_pod(const std::string& in, size_t& pos, T* v) {
+    if (pos + sizeof(T) > in.size()) {
+        return false;
+    }
+    std::memcpy(v, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// header + 索引
+std::string encode_index(const DiscImage& image) {
+    std::string index;
+    for (const auto& f : image.files) {
+        put_pod(index, f.inode);
+        put_pod(index, f.offset);
+        put_pod(index, f.size);
+        put_pod(index, static_cast<uint16_t>(f.path.size()));
+        index.append(f.path);
+    }
+    ImageHeader h{};
+    std::memcpy(h.magic, kImageMagic, sizeof(kImageMagic));
+    h.version = kImageVersion;
+    h.header_bytes = static_cast<uint32_t>(kHeaderBytes);
+    h.image_id = image.image_id;
+    h.file_count = image.files.size();
+    h.index_bytes = index.size();
+    h.data_offset = image.data_offset;
+    h.image_bytes = image.image_bytes;
+    h.index_crc = Crc32c(index.data(), index.size());
+    h.header_crc = Crc32c(&h, sizeof(h));
+    std::string out;
+    out.reserve(kHeaderBytes + index.size());
+    put_pod(out, h);
+    out.append(index);
+    return out;
+}
+
+bool write_all(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool write_file_atomic(const std::string& path, const std::string& data) {
+    const std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write_all(fd, data.data(), data.size()) && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+ImageManager::ImageManager() : ImageManager(Options{}) {}
+
+ImageManager::ImageManager(Options opts) : opts_(std::move(opts)) {
+    if (opts_.alignment == 0) {
+        opts_.alignment = 1;
+    }
+    opts_.io_buffer_bytes = align_up(std::max<size_t>(opts_.io_buffer_bytes, 4096), 4096);
+    opts_.io_buffers = std::max<size_t>(opts_.io_buffers, 2);
+}
+
+void ImageManager::set_source_reader(SourceReader reader) {
+    std::lock_guard<std::mutex> lock(mu_);
+    reader_ = std::move(reader);
+}
+
+std::string ImageManager::parent_directory(const std::string& path) {
+    auto pos = path.find_last_of('/');
+    if (pos == std::string::npos || pos == 0) {
+        return "/";
+    }
+    return path.substr(0, pos);
+}
+
+std::string ImageManager::image_path(uint64_t image_id, const char* ext) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "image_%08llu%s", static_cast<unsigned long long>(image_id), ext);
+    return (std::filesystem::path(opts_.output_dir) / name).string();
+}
+
+uint64_t ImageManager::file_cost(uint64_t size, size_t path_len) const {
+    return align_up(size, opts_.alignment) + kEntryFixedBytes + path_len;
+}
+
+int ImageManager::sim_image_write_file(const Inode& inode) {
+    if (inode.filename.empty() || inode.filename.size() > UINT16_MAX) {
+        return IMAGE_OP_INVALID;
+    }
+    const uint64_t size = inode.getFileSize();
+    const uint64_t cost = file_cost(size, inode.filename.size());
+    // header 和数据区起点对齐最多占用 kHeaderBytes + alignment
+    if (cost + kHeaderBytes + opts_.alignment > opts_.image_capacity) {
+        return IMAGE_OP_TOO_LARGE;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    if (locations_.count(inode.inode) || !pending_ids_.insert(inode.inode).second) {
+        return IMAGE_OP_SUCCESS;
+    }
+    PendingFile f;
+    f.inode = inode;
+    f.dir = parent_directory(inode.filename);
+    f.size = size;
+    f.cost = cost;
+    pending_.push_back(std::move(f));
+    pending_bytes_ += size;
+    return IMAGE_OP_SUCCESS;
+}
+
+std::vector<ImageManager::PlannedImage> ImageManager::plan_locked(bool force) {
+    std::vector<PlannedImage> out;
+    if (pending_.empty()) {
+        return out;
+    }
+    const uint64_t budget = opts_.image_capacity - kHeaderBytes - opts_.alignment;
+    const double target = opts_.min_fill * static_cast<double>(opts_.image_capacity);
+
+    struct Group {
+        std::vector<size_t> files;  // pending_ 下标
+        uint64_t cost = 0;
+    };
+    struct Bin {
+        std::vector<Group> groups;
+        uint64_t cost = 0;
+    };
+    auto full = [&](const Bin& b) { return static_cast<double>(b.cost + kHeaderBytes) >= target; };
+
+    // 1. 按路径排序后按目录分组，超过一张盘的目录切片
+    std::vector<size_t> order(pending_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return pending_[a].inode.filename < pending_[b].inode.filename;
+    });
+    std::vector<Bin> bins;
+    std::vector<Group> items;
+    for (size_t i = 0; i < order.size();) {
+        size_t j = i;
+        while (j < order.size() && pending_[order[j]].dir == pending_[order[i]].dir) {
+            ++j;
+        }
+        Group g;
+        for (size_t k = i; k < j; ++k) {
+            const PendingFile& f = pending_[order[k]];
+            if (g.cost + f.cost > budget) {
+                // 整盘大小的切片直接成为一张镜像，剩余空间留给第 3 步补齐
+                Bin b;
+                b.cost = g.cost;
+                b.groups.push_back(std::move(g));
+                bins.push_back(std::move(b));
+                g = Group{};
+            }
+            g.files.push_back(order[k]);
+            g.cost += f.cost;
+        }
+        items.push_back(std::move(g));
+        i = j;
+    }
+
+    // 2. best-fit-decreasing
+    std::stable_sort(items.begin(), items.end(),
+                     [](const Group& a, const Group& b) { return a.cost > b.cost; });
+    std::multimap<uint64_t, size_t> by_free;
+    for (size_t i = 0; i < bins.size(); ++i) {
+        by_free.emplace(budget - bins[i].cost, i);
+    }
+    for (auto& g : items) {
+        size_t idx;
+        auto it = by_free.lower_bound(g.cost);
+        if (it == by_free.end()) {
+            idx = bins.size();
+            bins.emplace_back();
+        } else {
+            idx = it->second;
+            by_free.erase(it);
+        }
+        Bin& b = bins[idx];
+        b.cost += g.cost;
+        b.groups.push_back(std::move(g));
+        by_free.emplace(budget - b.cost, idx);
+    }
+
+    // 3. 从最空的镜像向较满的未满镜像搬运：先整组，再逐个文件
+    std::vector<size_t> by_cost(bins.size());
+    std::iota(by_cost.begin(), by_cost.end(), 0);
+    std::sort(by_cost.begin(), by_cost.end(),
+              [&](size_t a, size_t b) { return bins[a].cost > bins[b].cost; });
+    for (size_t i = 0; i < by_cost.size(); ++i) {
+        Bin& r = bins[by_cost[i]];
+        for (size_t j = by_cost.size(); j-- > i + 1 && !full(r);) {
+            Bin& d = bins[by_cost[j]];
+            if (d.groups.empty()) {
+                continue;
+            }
+            std::sort(d.groups.begin(), d.groups.end(),
+                      [](const Group& a, const Group& b) { return a.cost > b.cost; });
+            for (auto it = d.groups.begin(); it != d.groups.end() && !full(r);) {
+                if (it->cost <= budget - r.cost) {
+                    r.cost += it->cost;
+                    d.cost -= it->cost;
+                    r.groups.push_back(std::move(*it));
+                    it = d.groups.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (full(r) || d.groups.empty()) {
+                continue;
+            }
+            // 按文件大小降序挑放得下的文件；搬走的文件在接收方单独成组
+            std::vector<std::pair<size_t, size_t>> cands;  // (组, 组内位置)
+            for (size_t gi = 0; gi < d.groups.size(); ++gi) {
+                for (size_t fi = 0; fi < d.groups[gi].files.size(); ++fi) {
+                    cands.emplace_back(gi, fi);
+                }
+            }
+            std::sort(cands.begin(), cands.end(), [&](const auto& a, const auto& b) {
+                return pending_[d.groups[a.first].files[a.second]].cost >
+                       pending_[d.groups[b.first].files[b.second]].cost;
+            });
+            Group moved;
+            std::vector<std::vector<bool>> taken(d.groups.size());
+            for (size_t gi = 0; gi < d.groups.size(); ++gi) {
+                taken[gi].assign(d.groups[gi].files.size(), false);
+            }
+            for (const auto& c : cands) {
+                if (full(r)) {
+                    break;
+                }
+                const size_t fidx = d.groups[c.first].files[c.second];
+                const uint64_t cost = pending_[fidx].cost;
+                if (cost <= budget - r.cost) {
+                    r.cost += cost;
+                    d.cost -= cost;
+                    d.groups[c.first].cost -= cost;
+                    moved.files.push_back(fidx);
+                    moved.cost += cost;
+                    taken[c.first][c.second] = true;
+                }
+            }
+            if (moved.files.empty()) {
+                continue;
+            }
+            r.groups.push_back(std::move(moved));
+            std::vector<Group> rest;
+            for (size_t gi = 0; gi < d.groups.size(); ++gi) {
+                Group g;
+                g.cost = d.groups[gi].cost;
+                for (size_t fi = 0; fi < d.groups[gi].files.size(); ++fi) {
+                    if (!taken[gi][fi]) {
+                        g.files.push_back(d.groups[gi].files[fi]);
+                    }
+                }
+                if (!g.files.empty()) {
+                    rest.push_back(std::move(g));
+                }
+            }
+            d.groups = std::move(rest);
+        }
+    }
+
+    // 4. 生成达标的镜像，其余文件留在池中
+    std::vector<bool> planned(pending_.size(), false);
+    for (auto& b : bins) {
+        if (b.groups.empty() || (!force && !full(b))) {
+            continue;
+        }
+        PlannedImage plan;
+        if (!allocate_image_id_locked(&plan.image.image_id)) {
+            break;  // 其余文件留在池中
+        }
+        plan.image.capacity = opts_.image_capacity;
+        std::vector<size_t> files;
+        for (const auto& g : b.groups) {
+            files.insert(files.end(), g.files.begin(), g.files.end());
+        }
+        // 镜像内按路径排列，同一目录的文件连续存放
+        std::sort(files.begin(), files.end(), [&](size_t x, size_t y) {
+            return pending_[x].inode.filename < pending_[y].inode.filename;
+        });
+        for (size_t idx : files) {
+            ImageFileEntry e;
+            e.inode = pending_[idx].inode.inode;
+            e.size = pending_[idx].size;
+            e.path = pending_[idx].inode.filename;
+            plan.image.files.push_back(std::move(e));
+            plan.sources.push_back(pending_[idx].inode);
+            planned[idx] = true;
+        }
+        layout(plan);
+        out.push_back(std::move(plan));
+    }
+
+    std::vector<PendingFile> rest;
+    rest.reserve(pending_.size());
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        if (planned[i]) {
+            pending_ids_.erase(pending_[i].inode.inode);
+            pending_bytes_ -= pending_[i].size;
+        } else {
+            rest.push_back(std::move(pending_[i]));
+        }
+    }
+    pending_ = std::move(rest);
+    return out;
+}
+
+void ImageManager::layout(PlannedImage& plan) const {
+    DiscImage& image = plan.image;
+    uint64_t index_bytes = 0;
+    for (const auto& f : image.files) {
+        index_bytes += kEntryFixedBytes + f.path.size();
+    }
+    image.data_offset = align_up(kHeaderBytes + index_bytes, opts_.alignment);
+    uint64_t pos = image.data_offset;
+    for (auto& f : image.files) {
+        f.offset = pos;
+        pos += align_up(f.size, opts_.alignment);
+    }
+    image.image_bytes = pos;
+}
+
+int ImageManager::write_image(PlannedImage& plan) {
+    DiscImage& image = plan.image;
+    const auto started = std::chrono::steady_clock::now();
+    if (opts_.output_dir.empty()) {
+        // 模拟模式：读源与写镜像流水线并行，耗时取决于较慢的一侧
+        const double mbps = std::min(opts_.source_read_mbps, opts_.image_write_mbps);
+        image.build_seconds = mbps > 0 ? image.image_bytes / (mbps * 1024.0 * 1024.0) : 0.0;
+        return IMAGE_OP_SUCCESS;
+    }
+    SourceReader reader;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        reader = reader_;
+    }
+    if (!reader) {
+        std::cerr << "[ImageManager] no source reader, cannot build image " << image.image_id << std::endl;
+        return IMAGE_OP_IO_ERROR;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(opts_.output_dir, ec);
+
+    const std::string path = image_path(image.image_id, ".img");
+    const std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[ImageManager] open " << tmp << " failed: " << std::strerror(errno) << std::endl;
+        return IMAGE_OP_IO_ERROR;
+    }
+    // 预分配整张镜像，让文件在本地盘上尽量连续
+    (void)::posix_fallocate(fd, 0, static_cast<off_t>(image.image_bytes));
+
+    const std::string head = encode_index(image);
+    const size_t buf_bytes = opts_.io_buffer_bytes;
+    std::vector<std::vector<char>> bufs(opts_.io_buffers, std::vector<char>(buf_bytes));
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<size_t> free_bufs;
+    std::deque<std::pair<size_t, size_t>> filled;  // (缓冲块, 长度)
+    for (size_t i = 0; i < bufs.size(); ++i) {
+        free_bufs.push_back(i);
+    }
+    bool done = false;
+    bool failed = false;
+
+    // 读线程：按镜像内顺序填充缓冲块，源文件以整块大小顺序读取
+    std::thread producer([&]() {
+        auto take = [&]() -> long {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return failed || !free_bufs.empty(); });
+            if (failed) {
+                return -1;
+            }
+            size_t b = free_bufs.front();
+            free_bufs.pop_front();
+            return static_cast<long>(b);
+        };
+        auto finish = [&](bool ok) {
+            std::lock_guard<std::mutex> lk(m);
+            if (!ok) {
+                failed = true;
+            }
+            done = true;
+            cv.notify_all();
+        };
+        long cur = take();
+        size_t len = 0;
+        auto push = [&]() -> bool {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                filled.emplace_back(static_cast<size_t>(cur), len);
+            }
+            cv.notify_all();
+            len = 0;
+            cur = take();
+            return cur >= 0;
+        };
+        auto put = [&](const char* p, uint64_t n) -> bool {
+            while (n > 0) {
+                if (len == buf_bytes && !push()) {
+                    return false;
+                }
+                size_t step = static_cast<size_t>(std::min<uint64_t>(n, buf_bytes - len));
+                if (p) {
+                    std::memcpy(bufs[cur].data() + len, p, step);
+                    p += step;
+                } else {
+                    std::memset(bufs[cur].data() + len, 0, step);
+                }
+                len += step;
+                n -= step;
+            }
+            return true;
+        };
+        if (cur < 0 || !put(head.data(), head.size()) || !put(nullptr, image.data_offset - head.size())) {
+            finish(false);
+            return;
+        }
+        for (size_t i = 0; i < image.files.size(); ++i) {
+            const ImageFileEntry& f = image.files[i];
+            uint64_t off = 0;
+            while (off < f.size) {
+                if (len == buf_bytes && !push()) {
+                    finish(false);
+                    return;
+                }
+                size_t want = static_cast<size_t>(std::min<uint64_t>(f.size - off, buf_bytes - len));
+                ssize_t n = reader(plan.sources[i], off, bufs[cur].data() + len, want);
+                if (n <= 0) {
+                    std::cerr << "[ImageManager] read inode " << f.inode << " at " << off << " failed" << std::endl;
+                    finish(false);
+                    return;
+                }
+                len += static_cast<size_t>(n);
+                off += static_cast<uint64_t>(n);
+            }
+            if (!put(nullptr, align_up(f.size, opts_.alignment) - f.size)) {
+                finish(false);
+                return;
+            }
+        }
+        if (len > 0) {
+            std::lock_guard<std::mutex> lk(m);
+            filled.emplace_back(static_cast<size_t>(cur), len);
+        }
+        finish(true);
+    });
+
+    // 写线程（当前线程）：对镜像文件做一次从头到尾的顺序写
+    uint64_t written = 0;
+    for (;;) {
+        std::pair<size_t, size_t> item;
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return failed || !filled.empty() || done; });
+            if (failed || filled.empty()) {
+                break;
+            }
+            item = filled.front();
+            filled.pop_front();
+        }
+        bool ok = write_all(fd, bufs[item.first].data(), item.second);
+        std::lock_guard<std::mutex> lk(m);
+        if (!ok) {
+            std::cerr << "[ImageManager] write " << tmp << " failed: " << std::strerror(errno) << std::endl;
+            failed = true;
+        } else {
+            written += item.second;
+            free_bufs.push_back(item.first);
+        }
+        cv.notify_all();
+    }
+    producer.join();
+
+    bool ok = !failed && written == image.image_bytes && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (ok && ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ok = false;
+    }
+    // 索引另存一份 .idx，启动时不必读取镜像文件即可恢复目录
+    if (ok && !write_file_atomic(image_path(image.image_id, ".idx"), head)) {
+        ::unlink(path.c_str());
+        ok = false;
+    }
+    if (!ok) {
+        ::unlink(tmp.c_str());
+        return IMAGE_OP_IO_ERROR;
+    }
+    image.path = path;
+    image.build_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return IMAGE_OP_SUCCESS;
+}
+
+void ImageManager::register_locked(const DiscImage& image) {
+    for (const auto& f : image.files) {
+        locations_[f.inode] = ImageLocation{image.image_id, f.offset, f.size};
+        dir_images_[parent_directory(f.path)].insert(image.image_id);
+    }
+    next_image_id_ = std::max(next_image_id_, image.image_id + 1);
+    stats_.images++;
+    stats_.files += image.files.size();
+    stats_.image_bytes += image.image_bytes;
+    stats_.capacity_bytes += image.capacity;
+}
+
+std::vector<DiscImage> ImageManager::flush(bool force) {
+    std::vector<PlannedImage> plans;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        plans = plan_locked(force);
+    }
+    std::vector<DiscImage> built;
+    for (auto& plan : plans) {
+        int rc = write_image(plan);
+        std::lock_guard<std::mutex> lock(mu_);
+        if (rc == IMAGE_OP_SUCCESS) {
+            register_locked(plan.image);
+            built.push_back(std::move(plan.image));
+            continue;
+        }
+        // 写失败：文件回到待打包池，下次 flush 重新装箱
+        for (size_t i = 0; i < plan.sources.size(); ++i) {
+            const Inode& inode = plan.sources[i];
+            if (!pending_ids_.insert(inode.inode).second) {
+                continue;
+            }
+            PendingFile f;
+            f.inode = inode;
+            f.dir = parent_directory(inode.filename);
+            f.size = plan.image.files[i].size;
+            f.cost = file_cost(f.size, inode.filename.size());
+            pending_bytes_ += f.size;
+            pending_.push_back(std::move(f));
+        }
+    }
+    return built;
+}
+
+bool ImageManager::read_index(const std::string& path, DiscImage* out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    std::string buf(kHeaderBytes, '\0');
+    bool ok = ::pread(fd, &buf[0], kHeaderBytes, 0) == static_cast<ssize_t>(kHeaderBytes);
+    ImageHeader h{};
+    if (ok) {
+        std::memcpy(&h, buf.data(), sizeof(h));
+        const uint32_t crc = h.header_crc;
+        h.header_crc = 0;
+        ok = std::memcmp(h.magic, kImageMagic, sizeof(kImageMagic)) == 0 && h.version == kImageVersion &&
+             h.header_bytes == kHeaderBytes && Crc32c(&h, sizeof(h)) == crc &&
+             h.index_bytes <= h.data_offset && h.data_offset <= h.image_bytes;
+    }
+    std::string index;
+    if (ok) {
+        index.resize(h.index_bytes);
+        ok = ::pread(fd, &index[0], index.size(), kHeaderBytes) == static_cast<ssize_t>(index.size()) &&
+             Crc32c(index.data(), index.size()) == h.index_crc;
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+    DiscImage image;
+    image.image_id = h.image_id;
+    image.data_offset = h.data_offset;
+    image.image_bytes = h.image_bytes;
+    size_t pos = 0;
+    for (uint64_t i = 0; i < h.file_count; ++i) {
+        ImageFileEntry e;
+        uint16_t path_len = 0;
+        if (!get_pod(index, pos, &e.inode) || !get_pod(index, pos, &e.offset) ||
+            !get_pod(index, pos, &e.size) || !get_pod(index, pos, &path_len) ||
+            pos + path_len > index.size()) {
+            return false;
+        }
+        e.path.assign(index.data() + pos, path_len);
+        pos += path_len;
+        image.files.push_back(std::move(e));
+    }
+    *out = std::move(image);
+    return true;
+}
+
+std::string ImageManager::id_file() const {
+    if (!opts_.id_file.empty() || opts_.output_dir.empty()) {
+        return opts_.id_file;
+    }
+    return (std::filesystem::path(opts_.output_dir) / "next_image_id").string();
+}
+
+bool ImageManager::allocate_image_id_locked(uint64_t* id) {
+    const std::string file = id_file();
+    if (!file.empty() && next_image_id_ >= id_limit_) {
+        const uint64_t limit = next_image_id_ + kImageIdBlock;
+        const auto dir = std::filesystem::path(file).parent_path();
+        std::error_code ec;
+        if (!dir.empty()) {
+            std::filesystem::create_directories(dir, ec);
+        }
+        if (!write_file_atomic(file, std::to_string(limit) + "\n")) {
+            std::cerr << "[ImageManager] write " << file << " failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        id_limit_ = limit;
+    }
+    *id = next_image_id_++;
+    return true;
+}
+
+int ImageManager::load_catalog() {
+    const std::string file = id_file();
+    if (!file.empty()) {
+        std::ifstream in(file);
+        uint64_t limit = 0;
+        if (in.is_open() && !(in >> limit)) {
+            // 上界丢了就可能复用镜像号，宁可不启动
+            std::cerr << "[ImageManager] corrupt image id file " << file << std::endl;
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(mu_);
+        next_image_id_ = std::max(next_image_id_, limit);
+    }
+    if (opts_.output_dir.empty()) {
+        return 0;
+    }
+    std::error_code ec;
+    std::filesystem::directory_iterator it(opts_.output_dir, ec);
+    if (ec) {
+        return ec == std::errc::no_such_file_or_directory ? 0 : -1;
+    }
+    int loaded = 0;
+    std::lock_guard<std::mutex> lock(mu_);
+    for (const auto& entry : it) {
+        if (entry.path().extension() != ".idx") {
+            continue;
+        }
+        DiscImage image;
+        if (!read_index(entry.path().string(), &image)) {
+            std::cerr << "[ImageManager] skip corrupt index " << entry.path() << std::endl;
+            continue;
+        }
+        image.capacity = opts_.image_capacity;
+        image.path = image_path(image.image_id, ".img");
+        register_locked(image);
+        ++loaded;
+    }
+    return loaded;
+}
+
+bool ImageManager::locate(uint64_t inode, ImageLocation* out) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = locations_.find(inode);
+    if (it == locations_.end()) {
+        return false;
+    }
+    if (out) {
+        *out = it->second;
+    }
+    return true;
+}
+
+std::vector<uint64_t> ImageManager::images_for_directory(const std::string& dir) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = dir_images_.find(dir);
+    if (it == dir_images_.end()) {
+        return {};
+    }
+    return std::vector<uint64_t>(it->second.begin(), it->second.end());
+}
+
+ImageManager::Stats ImageManager::get_stats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    Stats s = stats_;
+    s.pending_files = pending_.size();
+    s.pending_bytes = pending_bytes_;
+    return s;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../../mds/inode/inode.h"
+#include "../../storagenode/StorageTypes.h"
+
+// 返回码
+constexpr int IMAGE_OP_SUCCESS = 0;
+constexpr int IMAGE_OP_INVALID = -1;    // 参数非法（如无文件名）
+constexpr int IMAGE_OP_TOO_LARGE = -2;  // 单个文件放不进一张镜像
+constexpr int IMAGE_OP_IO_ERROR = -3;   // 读源数据或写镜像失败
+
+// 镜像内的一个文件
+struct ImageFileEntry {
+    uint64_t inode = 0;
+    uint64_t offset = 0;  // 在镜像内的字节偏移（按 alignment 对齐）
+    uint64_t size = 0;
+    std::string path;
+};
+
+// 一张光盘镜像。布局：
+//   [header 64B][index: 每个文件 inode/offset/size/路径][补零到对齐]
+//   [文件 0 数据][补零][文件 1 数据][补零]...
+// 装箱时已经确定了全部文件，所以索引放在镜像开头，整张镜像可以从头到尾
+// 一次顺序写出；回调时先读开头的索引即可定位文件。同一目录的文件在镜像内
+// 按路径连续存放。
+struct DiscImage {
+    uint64_t image_id = 0;
+    uint64_t capacity = 0;
+    uint64_t data_offset = 0;
+    uint64_t image_bytes = 0;  // 镜像总长度，不超过 capacity
+    std::vector<ImageFileEntry> files;
+    std::string path;          // 落盘路径，模拟模式下为空
+    double build_seconds = 0;  // 生成耗时（模拟模式为按带宽估算值）
+
+    double fill() const { return capacity ? static_cast<double>(image_bytes) / capacity : 0.0; }
+};
+
+// 文件在光盘镜像中的位置
+struct ImageLocation {
+    uint64_t image_id = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+};
+
+// 冷数据光盘镜像打包器。
+// 收集器把冷文件交给 sim_image_write_file 放入待打包池，flush 时按目录分组
+// 做 best-fit-decreasing 装箱：
+//   1. 待打包文件按路径排序，按所在目录分组；超过一张盘的目录按路径切成整盘大小的片；
+//   2. 目录组按大小降序，放入剩余空间最小且放得下的镜像（best fit），放不下则新开一张；
+//   3. 未达到 min_fill 的镜像从最空的镜像里先整组、再逐个文件地搬入文件补满；
+//   4. 填充率达到 min_fill 的镜像被生成，其余文件留在池中等待后续冷文件（force 时全部生成）。
+// 目录整组装箱保证回调一个目录时涉及的光盘尽量少；逐文件补齐保证填充率。
+// 生成镜像时由读线程按镜像内顺序大块读取源文件，写线程对镜像文件做一次顺序写。
+class ImageManager {
+public:
+    struct Options {
+        uint64_t image_capacity = OPTICAL_DISC_CAPACITY;
+        double min_fill = 0.98;
+        uint64_t alignment = 4096;
+        std::string output_dir;                 // 为空时只装箱不落盘（模拟模式）
+        // 镜像号计数的持久化文件，保证重启后不复用镜像号；为空时取 <output_dir>/next_image_id，
+        // 模拟模式下需显式给出，否则镜像号只在进程内递增
+        std::string id_file;
+        size_t io_buffer_bytes = 16ULL << 20;   // 每次顺序读写的块大小
+        size_t io_buffers = 4;                  // 读写线程之间的缓冲块数
+        double source_read_mbps = HDD_DEFAULT_READ_MBPS;  // 模拟模式估算耗时
+        double image_write_mbps = HDD_DEFAULT_WRITE_MBPS;
+    };
+
+    struct Stats {
+        uint64_t images = 0;
+        uint64_t files = 0;
+        uint64_t image_bytes = 0;     // 已生成镜像的总长度
+        uint64_t capacity_bytes = 0;  // 已生成镜像的总容量
+        size_t pending_files = 0;
+        uint64_t pending_bytes = 0;
+        double mean_fill() const {
+            return capacity_bytes ? static_cast<double>(image_bytes) / capacity_bytes : 0.0;
+        }
+    };
+
+    // 从源卷读取文件数据：返回读到的字节数，<=0 表示失败
+    using SourceReader = std::function<ssize_t(const Inode& inode, uint64_t offset, char* dst, size_t len)>;
+
+    ImageManager();
+    explicit ImageManager(Options opts);
+
+    ImageManager(const ImageManager&) = delete;
+    ImageManager& operator=(const ImageManager&) = delete;
+
+    void set_source_reader(SourceReader reader);
+
+    // 恢复镜像号计数，并从 output_dir 下的 .idx 文件恢复文件位置目录；
+    // 返回加载的镜像数，失败返回 -1
+    int load_catalog();
+
+    // 把一个冷文件加入待打包池；已在池中或已在镜像中的 inode 直接返回成功
+    int sim_image_write_file(const Inode& inode);
+
+    // 装箱并生成达到 min_fill 的镜像；force 为 true 时池中剩余文件也全部生成。
+    // 返回本次生成成功的镜像，写失败的镜像中的文件回到待打包池。
+    std::vector<DiscImage> flush(bool force = false);
+
+    bool locate(uint64_t inode, ImageLocation* out) const;
+    // 目录（不含子目录）中的文件分布在哪些镜像上
+    std::vector<uint64_t> images_for_directory(const std::string& dir) const;
+
+    Stats get_stats() const;
+    const Options& options() const { return opts_; }
+
+    // 解析镜像文件或 .idx 文件开头的 header 和索引
+    static bool read_index(const std::string& path, DiscImage* out);
+    static std::string parent_directory(const std::string& path);
+
+private:
+    struct PendingFile {
+        Inode inode;
+        std::string dir;
+        uint64_t size = 0;
+        uint64_t cost = 0;  // 数据对齐后的长度 + 索引项长度
+    };
+    struct PlannedImage {
+        DiscImage image;
+        std::vector<Inode> sources;  // 与 image.files 一一对应
+    };
+
+    uint64_t file_cost(uint64_t size, size_t path_len) const;
+    // 装箱，调用方持有 mu_；被规划的文件从待打包池中移除
+    std::vector<PlannedImage> plan_locked(bool force);
+    void layout(PlannedImage& plan) const;
+    int write_image(PlannedImage& plan);
+    void register_locked(const DiscImage& image);
+    // 分配镜像号；用到已落盘的上界时先把上界推进一段并落盘，落盘失败返回 false
+    bool allocate_image_id_locked(uint64_t* id);
+    std::string id_file() const;
+    std::string image_path(uint64_t image_id, const char* ext) const;
+
+    Options opts_;
+    SourceReader reader_;
+
+    mutable std::mutex mu_;
+    std::vector<PendingFile> pending_;
+    std::unordered_set<uint64_t> pending_ids_;
+    uint64_t pending_bytes_ = 0;
+    uint64_t next_image_id_ = 1;
+    uint64_t id_limit_ = 0;  // id_file 中的上界，小于它的镜像号可能已被分配过
+    std::unordered_map<uint64_t, ImageLocation> locations_;
+    std::unordered_map<std::string, std::set<uint64_t>> dir_images_;
+    Stats stats_;
+};
@@ -0,0 +1,286 @@
+#include "BurnScheduler.h"
+
+#include "DiscLocationCatalog.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+constexpr double kNever = SimClock::kNever;
+}
+
+double BurnScheduler::LibraryStats::throughputMBps() const {
+    const double span = last_burn_end - first_load;
+    if (span <= 0) return 0.0;
+    return static_cast<double>(burned_bytes) / span / (1024.0 * 1024.0);
+}
+
+BurnScheduler::BurnScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries)
+    : BurnScheduler(std::move(libraries), Options{}) {}
+
+BurnScheduler::BurnScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries, Options opts)
+    : opts_(opts), clock_(opts.time_scale) {
+    for (auto& lib : libraries) {
+        if (!lib) continue;
+        Library entry;
+        entry.lib = lib;
+        entry.stats.library_id = lib->library_id;
+        entry.stats.drive_count = lib->drive_count;
+        for (uint32_t i = 0; i < lib->drive_count; ++i) {
+            Drive d;
+            d.lib = libraries_.size();
+            d.index = i;
+            drives_.push_back(d);
+        }
+        libraries_.push_back(std::move(entry));
+    }
+}
+
+BurnScheduler::~BurnScheduler() {
+    stop();
+}
+
+void BurnScheduler::setDiscAllocator(DiscAllocator allocator) {
+    std::lock_guard<std::mutex> lock(mu_);
+    allocator_ = std::move(allocator);
+}
+
+void BurnScheduler::setCompletionCallback(CompletionCallback callback) {
+    std::lock_guard<std::mutex> lock(mu_);
+    callback_ = std::move(callback);
+}
+
+void BurnScheduler::start() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_) return;
+    running_ = true;
+    stop_ = false;
+    worker_ = std::thread(&BurnScheduler::run, this);
+}
+
+void BurnScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!running_) return;
+        stop_ = true;
+    }
+    cv_.notify_all();
+    space_cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> lock(mu_);
+    running_ = false;
+    space_cv_.notify_all();
+}
+
+bool BurnScheduler::isRunning() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return running_ && !stop_;
+}
+
+bool BurnScheduler::submit(const BurnJob& job, std::chrono::milliseconds max_wait) {
+    std::unique_lock<std::mutex> lock(mu_);
+    auto fits = [&] {
+        return stop_ || staged_bytes_ == 0 ||
+               staged_bytes_ + job.image_bytes <= opts_.staging_budget_bytes;
+    };
+    if (max_wait == std::chrono::milliseconds::max()) {
+        space_cv_.wait(lock, fits);
+    } else if (!space_cv_.wait_for(lock, max_wait, fits)) {
+        return false;
+    }
+    if (stop_) return false;
+    BurnResult r;
+    r.job = job;
+    r.submitted_at = clock_.now();
+    queue_.push_back(std::move(r));
+    staged_bytes_ += job.image_bytes;
+    ++outstanding_;
+    lock.unlock();
+    cv_.notify_all();
+    return true;
+}
+
+bool BurnScheduler::hasCapacity(uint64_t bytes) const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return staged_bytes_ == 0 || staged_bytes_ + bytes <= opts_.staging_budget_bytes;
+}
+
+void BurnScheduler::drain() {
+    std::unique_lock<std::mutex> lock(mu_);
+    space_cv_.wait(lock, [&] { return outstanding_ == 0 || !running_ || stop_; });
+}
+
+BurnScheduler::Stats BurnScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    Stats s = stats_;
+    s.queued_images = queue_.size();
+    s.staged_bytes = staged_bytes_;
+    for (const auto& lib : libraries_) {
+        s.libraries.push_back(lib.stats);
+    }
+    return s;
+}
+
+double BurnScheduler::now() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return clock_.now();
+}
+
+// 默认按库号取该库默认槽位中的光盘（见 OpticalDiscLibrary::hasDisc 的编号规则）
+std::string BurnScheduler::allocateDisc(Library& lib) {
+    if (allocator_) return allocator_(*lib.lib);
+    uint32_t lib_idx = 0;
+    if (!DiscLocationCatalog::ParseLibraryId(lib.lib->library_id, &lib_idx)) return "";
+    while (lib.next_slot < OPTICAL_LIBRARY_DISC_NUM) {
+        const uint64_t disc = static_cast<uint64_t>(lib_idx) * OPTICAL_LIBRARY_DISC_NUM + lib.next_slot++;
+        if (disc > UINT32_MAX) return "";
+        const std::string id = DiscLocationCatalog::FormatDiscId(static_cast<uint32_t>(disc));
+        if (lib.lib->hasDisc(id) >= 0) return id;
+    }
+    return "";
+}
+
+bool BurnScheduler::assignLocked(std::vector<BurnResult>& done) {
+    bool progress = false;
+    auto fail = [&](BurnResult r, const char* why) {
+        std::cerr << "[BurnScheduler] 镜像 " << r.job.image_id << " 刻录失败: " << why << std::endl;
+        staged_bytes_ -= r.job.image_bytes;
+        stats_.failed_images++;
+        done.push_back(std::move(r));
+        progress = true;
+    };
+    auto pop_front = [&] {
+        BurnResult r = std::move(queue_.front());
+        queue_.pop_front();
+        return r;
+    };
+    while (!queue_.empty()) {
+        const BurnResult& front = queue_.front();
+        if (front.job.image_bytes > OPTICAL_DISC_CAPACITY) {
+            fail(pop_front(), "超过光盘容量");
+            continue;
+        }
+        // 选最早能开刻的光驱：机械手空闲、托盘空出、镜像到达三者取最晚为装盘开始时间
+        Drive* best = nullptr;
+        double best_start = kNever;
+        double best_ready = kNever;
+        bool any_library = false;
+        for (auto& d : drives_) {
+            Library& lib = libraries_[d.lib];
+            if (lib.exhausted) continue;
+            any_library = true;
+            if (d.tray) continue;
+            const double start = std::max({lib.robot_free_at, d.tray_free_at, front.submitted_at});
+            const double burn_free = d.burning ? d.burning->result.burn_end : d.last_burn_end;
+            const double ready = std::max(start + lib.lib->load_unload_time, burn_free);
+            if (ready < best_ready || (ready == best_ready && start < best_start)) {
+                best = &d;
+                best_start = start;
+                best_ready = ready;
+            }
+        }
+        if (!any_library) {
+            fail(pop_front(), "所有光盘库都没有空白盘");
+            continue;
+        }
+        if (!best) break;  // 所有托盘都被占用，等待刻录推进
+
+        Library& lib = libraries_[best->lib];
+        const std::string disc_id = allocateDisc(lib);
+        if (disc_id.empty()) {
+            lib.exhausted = true;
+            continue;
+        }
+        BurnResult r = pop_front();
+        progress = true;
+        const double total = lib.lib->burnToDisc(disc_id, r.job.image_bytes);
+        if (total < 0) {
+            fail(std::move(r), "库中找不到分配的光盘");
+            continue;
+        }
+        Task task;
+        task.result = std::move(r);
+        task.result.library_id = lib.lib->library_id;
+        task.result.drive = best->index;
+        task.result.disc_id = disc_id;
+        task.result.load_start = best_start;
+        task.load_end = best_start + lib.lib->load_unload_time;
+        task.burn_seconds = std::max(0.0, total - lib.lib->load_unload_time);
+        lib.robot_free_at = task.load_end;
+        if (!lib.started) {
+            // 同库装盘由机械手串行执行，第一次装盘即最早
+            lib.started = true;
+            lib.stats.first_load = best_start;
+        }
+        best->tray = std::move(task);
+    }
+    return progress;
+}
+
+bool BurnScheduler::stepLocked(double t, std::vector<BurnResult>& done) {
+    bool progress = false;
+    for (auto& d : drives_) {
+        if (d.burning && d.burning->result.burn_end <= t) {
+            Task& task = *d.burning;
+            task.result.ok = true;
+            Library& lib = libraries_[d.lib];
+            lib.stats.burned_images++;
+            lib.stats.burned_bytes += task.result.job.image_bytes;
+            lib.stats.busy_seconds += task.burn_seconds;
+            lib.stats.last_burn_end = std::max(lib.stats.last_burn_end, task.result.burn_end);
+            stats_.burned_images++;
+            stats_.burned_bytes += task.result.job.image_bytes;
+            staged_bytes_ -= task.result.job.image_bytes;
+            d.last_burn_end = task.result.burn_end;
+            done.push_back(std::move(task.result));
+            d.burning.reset();
+            progress = true;
+        }
+    }
+    for (auto& d : drives_) {
+        if (!d.burning && d.tray && d.tray->load_end <= t) {
+            Task task = std::move(*d.tray);
+            d.tray.reset();
+            task.result.burn_start = std::max(task.load_end, d.last_burn_end);
+            task.result.burn_end = task.result.burn_start + task.burn_seconds;
+            // 盘进入光驱后机械手即可为下一张盘取盘
+            d.tray_free_at = task.result.burn_start;
+            d.burning = std::move(task);
+            progress = true;
+        }
+    }
+    if (assignLocked(done)) progress = true;
+    return progress;
+}
+
+double BurnScheduler::nextEventLocked() const {
+    double next = kNever;
+    for (const auto& d : drives_) {
+        if (d.burning) {
+            next = std::min(next, d.burning->result.burn_end);
+        } else if (d.tray) {
+            next = std::min(next, d.tray->load_end);
+        }
+    }
+    return next;
+}
+
+void BurnScheduler::run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    clock_.run<BurnResult>(
+        lock, cv_, stop_,
+        [this](double t, std::vector<BurnResult>& done) { return stepLocked(t, done); },
+        [this] { return nextEventLocked(); },
+        [this](std::unique_lock<std::mutex>& held, std::vector<BurnResult>& done) {
+            // 暂存空间先释放；回调在锁外执行，完成后才计入 drain
+            space_cv_.notify_all();
+            CompletionCallback callback = callback_;
+            if (callback) {
+                held.unlock();
+                for (const auto& r : done) callback(r);
+                held.lock();
+            }
+            outstanding_ -= done.size();
+            space_cv_.notify_all();
+        });
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "../../storagenode/optical/OpticalDiscLibrary.h"
+#include "SimClock.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 多光驱刻录调度器。
+// 已封装的镜像进入一个全局队列，调度线程把镜像分配给所有光盘库中最早能开始装盘的光驱。
+// 每个光驱有一个“待刻托盘”：机械手在当前光盘刻录期间就把下一张空白盘取出待命，
+// 当前盘刻完即可开刻，装卸盘时间与刻录重叠。同一光盘库的机械手一次只能搬一张盘。
+// 耗时按 OpticalDiscLibrary 的模型（load_unload_time、burnToDisc）在模拟时钟（SimClock）上推进，
+// time_scale > 0 时按比例映射到真实时间。
+// 排队和刻录中镜像的总大小超过 staging_budget_bytes 时 submit 阻塞，对收集器形成反压。
+class BurnScheduler {
+public:
+    struct Options {
+        uint64_t staging_budget_bytes = 20 * OPTICAL_DISC_CAPACITY;  // 本地暂存待刻镜像的空间
+        double time_scale = 1.0;  // 真实秒数 = 模拟秒数 × time_scale；0 表示不等待
+    };
+
+    struct BurnJob {
+        uint64_t image_id = 0;
+        uint64_t image_bytes = 0;
+        std::string image_path;
+    };
+
+    // 一次刻录的结果，时间均为模拟时钟（秒）
+    struct BurnResult {
+        BurnJob job;
+        std::string library_id;
+        uint32_t drive = 0;
+        std::string disc_id;
+        bool ok = false;
+        double submitted_at = 0;
+        double load_start = 0;
+        double burn_start = 0;
+        double burn_end = 0;
+    };
+
+    struct LibraryStats {
+        std::string library_id;
+        uint32_t drive_count = 0;
+        uint64_t burned_images = 0;
+        uint64_t burned_bytes = 0;
+        double first_load = 0;
+        double last_burn_end = 0;
+        double busy_seconds = 0;  // 所有光驱刻录时间之和
+        // 库的平均写入带宽（MB/s），理论上限为 drive_count × OPTICAL_DISC_WRITE_MBPS
+        double throughputMBps() const;
+    };
+
+    struct Stats {
+        uint64_t queued_images = 0;
+        uint64_t staged_bytes = 0;  // 排队 + 装盘 + 刻录中
+        uint64_t burned_images = 0;
+        uint64_t burned_bytes = 0;
+        uint64_t failed_images = 0;
+        std::vector<LibraryStats> libraries;
+    };
+
+    // 返回库中一张空白盘的 id，没有空白盘时返回空串
+    using DiscAllocator = std::function<std::string(OpticalDiscLibrary&)>;
+    using CompletionCallback = std::function<void(const BurnResult&)>;
+
+    explicit BurnScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries);
+    BurnScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries, Options opts);
+    ~BurnScheduler();
+
+    BurnScheduler(const BurnScheduler&) = delete;
+    BurnScheduler& operator=(const BurnScheduler&) = delete;
+
+    // 需在 start 之前设置。默认分配器只在内存里记每个库的槽位游标，重启后从头分配；
+    // 已刻过的盘不能再分配时，传入基于持久化光盘状态表的分配器
+    void setDiscAllocator(DiscAllocator allocator);
+    void setCompletionCallback(CompletionCallback callback);
+
+    void start();
+    // 停止调度线程；尚未刻完的镜像留在队列中
+    void stop();
+    bool isRunning() const;
+
+    // 暂存空间不足时最多等待 max_wait；超时或调度器已停止返回 false。
+    // 暂存区为空时超过预算的单个镜像也会被接收。
+    bool submit(const BurnJob& job,
+                std::chrono::milliseconds max_wait = std::chrono::milliseconds::max());
+    bool trySubmit(const BurnJob& job) { return submit(job, std::chrono::milliseconds(0)); }
+    // 暂存空间是否还能再放一个 bytes 大小的镜像
+    bool hasCapacity(uint64_t bytes) const;
+
+    // 等待所有已提交的镜像刻录完成
+    void drain();
+
+    Stats getStats() const;
+    // 当前模拟时钟（秒）
+    double now() const;
+
+private:
+    struct Task {
+        BurnResult result;
+        double load_end = 0;
+        double burn_seconds = 0;
+    };
+    struct Drive {
+        size_t lib = 0;
+        uint32_t index = 0;
+        std::optional<Task> tray;     // 已取出/正在装载的下一张盘
+        std::optional<Task> burning;  // 正在刻录
+        double tray_free_at = 0;      // 托盘空出的时间
+        double last_burn_end = 0;
+    };
+    struct Library {
+        std::shared_ptr<OpticalDiscLibrary> lib;
+        double robot_free_at = 0;
+        bool exhausted = false;  // 没有空白盘
+        bool started = false;
+        int next_slot = 0;       // 默认分配器的游标
+        LibraryStats stats;
+    };
+
+    void run();
+    // 推进到模拟时间 t：完成刻录、开始刻录、为空托盘分配镜像。有进展返回 true
+    bool stepLocked(double t, std::vector<BurnResult>& done);
+    bool assignLocked(std::vector<BurnResult>& done);
+    double nextEventLocked() const;
+    std::string allocateDisc(Library& lib);
+
+    Options opts_;
+    std::vector<Library> libraries_;
+    std::vector<Drive> drives_;
+    DiscAllocator allocator_;
+    CompletionCallback callback_;
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;       // 唤醒调度线程
+    std::condition_variable space_cv_; // 暂存空间释放 / 全部完成
+    std::deque<BurnResult> queue_;
+    uint64_t staged_bytes_ = 0;
+    uint64_t outstanding_ = 0;         // 已提交未结束的镜像数
+    SimClock clock_;
+    bool running_ = false;
+    bool stop_ = false;
+    Stats stats_;
+    std::thread worker_;
+};
@@ -0,0 +1,419 @@
+#include "DiscLocationCatalog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+#include "../../common/Crc32c.h"
+#include "../../common/FileUtil.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'Z', 'B', 'L', 'O', 'C', 'A', 'T', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kOpCommit = 1;
+constexpr uint32_t kOpErase = 2;
+constexpr double kMaxLoad = 0.7;
+
+std::string ParentDir(const std::string& path) {
+    return std::filesystem::path(path).parent_path().string();
+}
+
+size_t RoundUpPow2(size_t n) {
+    size_t p = 16;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// journal 批次头：op、条目数、镜像号、盘号、库号、CRC（覆盖 crc 之前的字段和全部条目）
+struct BatchHeader {
+    uint32_t op;
+    uint32_t count;
+    uint64_t image_id;
+    uint32_t disc;
+    uint32_t library;
+    uint32_t reserved;
+    uint32_t crc;
+};
+static_assert(sizeof(BatchHeader) == 32, "journal batch header layout");
+constexpr size_t kEntryBytes = 24;  // inode, offset, size
+
+uint32_t BatchCrc(const std::string& batch) {
+    uint32_t crc = Crc32c(batch.data(), offsetof(BatchHeader, crc));
+    return Crc32cExtend(crc, batch.data() + sizeof(BatchHeader), batch.size() - sizeof(BatchHeader));
+}
+
+// 校验一个完整的批次
+bool DecodeBatch(const std::string& batch, BatchHeader* out) {
+    if (batch.size() < sizeof(BatchHeader)) return false;
+    std::memcpy(out, batch.data(), sizeof(BatchHeader));
+    return (out->op == kOpCommit || out->op == kOpErase) &&
+           batch.size() == sizeof(BatchHeader) + static_cast<size_t>(out->count) * kEntryBytes &&
+           BatchCrc(batch) == out->crc;
+}
+
+}  // namespace
+
+struct DiscLocationCatalog::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;
+    uint64_t slots;
+    uint64_t count;
+    char reserved[32];
+};
+
+struct DiscLocationCatalog::Record {
+    uint64_t inode;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t image_id;
+    uint32_t disc;
+    uint32_t library;
+};
+
+DiscLocationCatalog::DiscLocationCatalog(std::string path, size_t initial_slots)
+    : path_(std::move(path)), journal_path_(path_ + ".journal"), initial_slots_(RoundUpPow2(initial_slots)) {
+    static_assert(sizeof(Header) == 64, "catalog header layout");
+    static_assert(sizeof(Record) == 40, "catalog record layout");
+}
+
+DiscLocationCatalog::~DiscLocationCatalog() {
+    Unmap();
+}
+
+bool DiscLocationCatalog::ParseDiscId(const std::string& id, uint32_t* out) {
+    if (id.size() <= 5 || id.compare(0, 5, "disc_") != 0) return false;
+    uint64_t v = 0;
+    for (size_t i = 5; i < id.size(); ++i) {
+        if (id[i] < '0' || id[i] > '9') return false;
+        v = v * 10 + static_cast<uint64_t>(id[i] - '0');
+        if (v > UINT32_MAX) return false;
+    }
+    *out = static_cast<uint32_t>(v);
+    return true;
+}
+
+std::string DiscLocationCatalog::FormatDiscId(uint32_t disc) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "disc_%010u", disc);
+    return buf;
+}
+
+bool DiscLocationCatalog::ParseLibraryId(const std::string& id, uint32_t* out) {
+    if (id.size() <= 4 || id.compare(0, 4, "lib_") != 0) return false;
+    uint64_t v = 0;
+    for (size_t i = 4; i < id.size(); ++i) {
+        if (id[i] < '0' || id[i] > '9') return false;
+        v = v * 10 + static_cast<uint64_t>(id[i] - '0');
+        if (v > UINT32_MAX) return false;
+    }
+    *out = static_cast<uint32_t>(v);
+    return true;
+}
+
+std::string DiscLocationCatalog::FormatLibraryId(uint32_t library) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "lib_%05u", library);
+    return buf;
+}
+
+DiscLocationCatalog::Record* DiscLocationCatalog::Slot(size_t i) const {
+    return reinterpret_cast<Record*>(base_ + sizeof(Header)) + i;
+}
+
+bool DiscLocationCatalog::MapFile(const std::string& path, size_t slots, bool create) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        std::cerr << "DiscLocationCatalog: open " << path << " failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    size_t bytes = 0;
+    if (create) {
+        bytes = sizeof(Header) + slots * sizeof(Record);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            return false;
+        }
+    } else {
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        bytes = static_cast<size_t>(st.st_size);
+    }
+    void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    Header* h = static_cast<Header*>(p);
+    if (create) {
+        std::memcpy(h->magic, kMagic, sizeof(kMagic));
+        h->version = kVersion;
+        h->record_bytes = sizeof(Record);
+        h->slots = slots;
+        h->count = 0;
+        // 新表的文件头和目录项先落盘，崩溃后不会留下没有文件头的表
+        if (::msync(p, sizeof(Header), MS_SYNC) != 0 || !SyncDir(ParentDir(path))) {
+            std::cerr << "DiscLocationCatalog: sync new catalog " << path << " failed: "
+                      << std::strerror(errno) << std::endl;
+            ::munmap(p, bytes);
+            ::close(fd);
+            return false;
+        }
+    } else if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+               h->record_bytes != sizeof(Record) || h->slots == 0 || (h->slots & (h->slots - 1)) != 0 ||
+               sizeof(Header) + h->slots * sizeof(Record) != bytes) {
+        std::cerr << "DiscLocationCatalog: bad catalog file " << path << std::endl;
+        ::munmap(p, bytes);
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    base_ = static_cast<char*>(p);
+    mapped_bytes_ = bytes;
+    mask_ = static_cast<size_t>(h->slots) - 1;
+    return true;
+}
+
+void DiscLocationCatalog::Unmap() {
+    if (base_) {
+        ::munmap(base_, mapped_bytes_);
+        base_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    mapped_bytes_ = 0;
+    mask_ = 0;
+}
+
+bool DiscLocationCatalog::Open() {
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    Unmap();
+    const bool exists = ::access(path_.c_str(), F_OK) == 0;
+    if (!MapFile(path_, initial_slots_, !exists)) return false;
+    return ReplayJournal();
+}
+
+size_t DiscLocationCatalog::Probe(uint64_t inode) const {
+    size_t i = static_cast<size_t>(Mix64(inode)) & mask_;
+    while (Slot(i)->inode != 0 && Slot(i)->inode != inode) {
+        i = (i + 1) & mask_;
+    }
+    return i;
+}
+
+bool DiscLocationCatalog::FindInode(uint64_t inode, Location* out) const {
+    if (inode == 0) return false;
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    if (!base_) return false;
+    const Record* r = Slot(Probe(inode));
+    if (r->inode != inode) return false;
+    if (out) {
+        out->library = r->library;
+        out->disc = r->disc;
+        out->image_id = r->image_id;
+        out->offset = r->offset;
+        out->size = r->size;
+    }
+    return true;
+}
+
+void DiscLocationCatalog::Upsert(uint64_t inode, const Location& loc) {
+    Record* r = Slot(Probe(inode));
+    if (r->inode == 0) {
+        reinterpret_cast<Header*>(base_)->count++;
+    }
+    r->offset = loc.offset;
+    r->size = loc.size;
+    r->image_id = loc.image_id;
+    r->disc = loc.disc;
+    r->library = loc.library;
+    r->inode = inode;
+}
+
+bool DiscLocationCatalog::Grow(size_t need) {
+    const size_t slots = mask_ + 1;
+    if (static_cast<double>(need) <= kMaxLoad * static_cast<double>(slots)) return true;
+    return Rebuild(RoundUpPow2(static_cast<size_t>(static_cast<double>(need) / kMaxLoad) + 1));
+}
+
+bool DiscLocationCatalog::Rebuild(size_t new_slots) {
+    const int old_fd = fd_;
+    char* old_base = base_;
+    const size_t old_bytes = mapped_bytes_;
+    const size_t old_mask = mask_;
+    const std::string tmp = path_ + ".grow";
+    if (!MapFile(tmp, new_slots, true)) {
+        fd_ = old_fd;
+        base_ = old_base;
+        mapped_bytes_ = old_bytes;
+        mask_ = old_mask;
+        return false;
+    }
+    const Record* old_records = reinterpret_cast<const Record*>(old_base + sizeof(Header));
+    for (size_t i = 0; i <= old_mask; ++i) {
+        const Record& r = old_records[i];
+        if (r.inode == 0) continue;
+        Upsert(r.inode, Location{r.library, r.disc, r.image_id, r.offset, r.size});
+    }
+    // 新表落盘后再替换旧文件；中途崩溃时旧文件 + journal 仍然完整
+    if (!Sync() || ::rename(tmp.c_str(), path_.c_str()) != 0) {
+        ::munmap(base_, mapped_bytes_);
+        ::close(fd_);
+        ::unlink(tmp.c_str());
+        fd_ = old_fd;
+        base_ = old_base;
+        mapped_bytes_ = old_bytes;
+        mask_ = old_mask;
+        return false;
+    }
+    ::munmap(old_base, old_bytes);
+    ::close(old_fd);
+    // rename 落盘前不能截断 journal：失败时调用方保留 journal，下次打开重放
+    if (!SyncDir(ParentDir(path_))) {
+        std::cerr << "DiscLocationCatalog: sync dir of " << path_ << " failed: " << std::strerror(errno)
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool DiscLocationCatalog::Sync() {
+    return ::msync(base_, mapped_bytes_, MS_SYNC) == 0;
+}
+
+bool DiscLocationCatalog::WriteJournal(const std::string& batch) {
+    int fd = ::open(journal_path_.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+    const bool created = fd < 0 && errno == ENOENT;
+    if (created) fd = ::open(journal_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = WriteAll(fd, batch.data(), batch.size()) && ::fdatasync(fd) == 0;
+    ::close(fd);
+    // 首次创建的 journal 连同目录项落盘，否则崩溃后整批记录随文件一起丢失
+    if (ok && created) ok = SyncDir(ParentDir(journal_path_));
+    return ok;
+}
+
+void DiscLocationCatalog::Apply(const std::string& batch) {
+    BatchHeader h;
+    std::memcpy(&h, batch.data(), sizeof(h));
+    const char* p = batch.data() + sizeof(h);
+    for (uint32_t i = 0; i < h.count; ++i, p += kEntryBytes) {
+        FileExtent f;
+        std::memcpy(&f.inode, p, 8);
+        std::memcpy(&f.offset, p + 8, 8);
+        std::memcpy(&f.size, p + 16, 8);
+        if (h.op == kOpCommit) {
+            Upsert(f.inode, Location{h.library, h.disc, h.image_id, f.offset, f.size});
+            continue;
+        }
+        // 线性探测的删除：把后面不在自己原位的记录前移补洞
+        size_t i_hole = Probe(f.inode);
+        if (Slot(i_hole)->inode != f.inode) continue;
+        size_t j = i_hole;
+        for (;;) {
+            j = (j + 1) & mask_;
+            Record* r = Slot(j);
+            if (r->inode == 0) break;
+            const size_t home = static_cast<size_t>(Mix64(r->inode)) & mask_;
+            const bool stays = i_hole <= j ? (i_hole < home && home <= j) : (i_hole < home || home <= j);
+            if (stays) continue;
+            *Slot(i_hole) = *r;
+            i_hole = j;
+        }
+        std::memset(Slot(i_hole), 0, sizeof(Record));
+        reinterpret_cast<Header*>(base_)->count--;
+    }
+}
+
+bool DiscLocationCatalog::ReplayJournal() {
+    int fd = ::open(journal_path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return errno == ENOENT;
+    std::string batch;
+    char buf[1 << 16];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        batch.append(buf, static_cast<size_t>(n));
+    }
+    ::close(fd);
+    if (!batch.empty()) {
+        BatchHeader h;
+        if (DecodeBatch(batch, &h)) {
+            if (h.op == kOpCommit && !Grow(reinterpret_cast<Header*>(base_)->count + h.count)) return false;
+            Apply(batch);
+            if (!Sync()) return false;
+        } else {
+            std::cerr << "DiscLocationCatalog: discarding incomplete journal batch" << std::endl;
+        }
+    }
+    return ::truncate(journal_path_.c_str(), 0) == 0;
+}
+
+bool DiscLocationCatalog::CommitImage(uint64_t image_id, uint32_t disc, uint32_t library,
+                                      const std::vector<FileExtent>& files) {
+    std::string batch(sizeof(BatchHeader) + files.size() * kEntryBytes, '\0');
+    BatchHeader h{kOpCommit, static_cast<uint32_t>(files.size()), image_id, disc, library, 0, 0};
+    char* p = &batch[sizeof(BatchHeader)];
+    for (const auto& f : files) {
+        if (f.inode == 0) return false;
+        std::memcpy(p, &f.inode, 8);
+        std::memcpy(p + 8, &f.offset, 8);
+        std::memcpy(p + 16, &f.size, 8);
+        p += kEntryBytes;
+    }
+    std::memcpy(&batch[0], &h, sizeof(h));
+    h.crc = BatchCrc(batch);
+    std::memcpy(&batch[0], &h, sizeof(h));
+
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    if (!base_) return false;
+    if (!WriteJournal(batch)) return false;
+    const size_t count = reinterpret_cast<Header*>(base_)->count;
+    if (!Grow(count + files.size())) return false;
+    Apply(batch);
+    if (!Sync()) return false;
+    return ::truncate(journal_path_.c_str(), 0) == 0;
+}
+
+bool DiscLocationCatalog::Erase(uint64_t inode) {
+    if (inode == 0) return false;
+    std::string batch(sizeof(BatchHeader) + kEntryBytes, '\0');
+    BatchHeader h{kOpErase, 1, 0, 0, 0, 0, 0};
+    std::memcpy(&batch[sizeof(BatchHeader)], &inode, 8);
+    std::memcpy(&batch[0], &h, sizeof(h));
+    h.crc = BatchCrc(batch);
+    std::memcpy(&batch[0], &h, sizeof(h));
+
+    std::unique_lock<std::shared_mutex> lock(mu_);
+    if (!base_ || Slot(Probe(inode))->inode != inode) return false;
+    if (!WriteJournal(batch)) return false;
+    Apply(batch);
+    return Sync() && ::truncate(journal_path_.c_str(), 0) == 0;
+}
+
+size_t DiscLocationCatalog::size() const {
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    if (!base_) return 0;
+    return static_cast<size_t>(reinterpret_cast<const Header*>(base_)->count);
+}
+
+size_t DiscLocationCatalog::capacity() const {
+    std::shared_lock<std::shared_mutex> lock(mu_);
+    return base_ ? mask_ + 1 : 0;
+}
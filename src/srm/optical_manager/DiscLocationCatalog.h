@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+// inode -> 光盘位置 的持久化目录。
+// 数据文件是一张 mmap 的开放寻址哈希表（线性探测），每个已归档文件占一条 40 字节的
+// 定长记录：inode、镜像内偏移、大小、64 位镜像号、光盘号、光盘库号，盘号和库号都存整数
+// （disc_0000100001 -> 100001，lib_00005 -> 5），查找不需要解析字符串。
+// 一张镜像刻录完成后 CommitImage 先把整批记录连同 CRC 写入 <path>.journal 并落盘，
+// 再写哈希表、msync，最后清空 journal；启动时重放完整的 journal，残缺的丢弃，
+// 所以一张镜像的记录要么全部可见要么全部不可见。
+class DiscLocationCatalog {
+public:
+    struct Location {
+        uint32_t library = 0;
+        uint32_t disc = 0;
+        uint64_t image_id = 0;
+        uint64_t offset = 0;  // 在光盘（镜像）内的字节偏移
+        uint64_t size = 0;
+    };
+
+    struct FileExtent {
+        uint64_t inode = 0;  // 0 保留为空槽
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
+
+    explicit DiscLocationCatalog(std::string path, size_t initial_slots = 1 << 16);
+    ~DiscLocationCatalog();
+
+    DiscLocationCatalog(const DiscLocationCatalog&) = delete;
+    DiscLocationCatalog& operator=(const DiscLocationCatalog&) = delete;
+
+    // 打开或创建数据文件并重放 journal
+    bool Open();
+
+    bool FindInode(uint64_t inode, Location* out) const;
+    // 一张镜像的全部文件作为一个事务写入；已存在的 inode 被覆盖（重新归档）
+    bool CommitImage(uint64_t image_id, uint32_t disc, uint32_t library,
+                     const std::vector<FileExtent>& files);
+    bool Erase(uint64_t inode);
+
+    size_t size() const;
+    size_t capacity() const;
+
+    // disc_%010u / lib_%05u 与整数互转；格式不对时返回 false
+    static bool ParseDiscId(const std::string& id, uint32_t* out);
+    static std::string FormatDiscId(uint32_t disc);
+    static bool ParseLibraryId(const std::string& id, uint32_t* out);
+    static std::string FormatLibraryId(uint32_t library);
+
+private:
+    struct Header;
+    struct Record;
+
+    bool MapFile(const std::string& path, size_t slots, bool create);
+    void Unmap();
+    bool Grow(size_t need);
+    // 把全部记录重新插入一张 new_slots 槽的新表，落盘后替换数据文件
+    bool Rebuild(size_t new_slots);
+    Record* Slot(size_t i) const;
+    size_t Probe(uint64_t inode) const;  // 命中或第一个空槽
+    void Upsert(uint64_t inode, const Location& loc);
+    bool Sync();
+    bool WriteJournal(const std::string& batch);
+    bool ReplayJournal();
+    void Apply(const std::string& batch);
+
+    std::string path_;
+    std::string journal_path_;
+    size_t initial_slots_;
+
+    mutable std::shared_mutex mu_;
+    int fd_{-1};
+    char* base_{nullptr};
+    size_t mapped_bytes_{0};
+    size_t mask_{0};
+};
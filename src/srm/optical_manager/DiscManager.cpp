@@ -1,190 +1,387 @@
 #include "DiscManager.h"
-#include "storagenode/optical/OpticalDisc.h"
+#include "DiscLocationCatalog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include <fstream>
-#include <iostream>
-#include <cstdio>    // snprintf
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
+#include <iostream>
 
-void DiscManager::addDisc(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status) {
-    all_discs[std::string(disc->device_id)] = disc;
-    setDiscStatus(disc, status);
-    switch (status) {
-        case DiscStatus::Blank:     blank_discs.insert(std::string(disc->device_id)); break;
-        case DiscStatus::InUse:     inuse_discs.insert(std::string(disc->device_id)); break;
-        case DiscStatus::Finalized: finalized_discs.insert(std::string(disc->device_id)); break;
-        case DiscStatus::Recycled:  recycled_discs.insert(std::string(disc->device_id)); break;
-        case DiscStatus::Lost:      lost_discs.insert(std::string(disc->device_id)); break;
-    }
+#include "../../common/FileUtil.h"
+
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'Z', 'B', 'D', 'I', 'S', 'C', 'T', '1'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+// 快照文件头；其后依次为 status[n]（补齐到 8 字节）、capacity[n]、used[n]、disc[n]、library[n]、slot[n]、
+// order[total]（各状态链表从头到尾的下标，按状态依次拼接）
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t slots;
+    uint64_t total;
+};
+
+size_t align8(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+size_t snapshotBytes(size_t n, size_t total) {
+    return sizeof(SnapshotHeader) + align8(n) + n * (sizeof(uint64_t) * 2 + sizeof(uint32_t) * 3) +
+           total * sizeof(uint32_t);
 }
 
-void DiscManager::setDiscStatus(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status) {
-    std::string id = std::string(disc->device_id);
-    blank_discs.erase(id);
-    inuse_discs.erase(id);
-    finalized_discs.erase(id);
-    recycled_discs.erase(id);
-    lost_discs.erase(id);
-
-    switch (status) {
-        case DiscStatus::Blank:     blank_discs.insert(id); break;
-        case DiscStatus::InUse:     inuse_discs.insert(id); break;
-        case DiscStatus::Finalized: finalized_discs.insert(id); break;
-        case DiscStatus::Recycled:  recycled_discs.insert(id); break;
-        case DiscStatus::Lost:      lost_discs.insert(id); break;
-    }
-    // 同步状态到对象本身（可选）
-    disc->status = status;
+template <typename T>
+void readColumn(const char*& p, std::vector<T>& out, size_t n) {
+    out.resize(n);
+    std::memcpy(out.data(), p, n * sizeof(T));
+    p += n * sizeof(T);
 }
 
-size_t DiscManager::totalDiscCount() const    { return all_discs.size(); }
-size_t DiscManager::blankDiscCount() const    { return blank_discs.size(); }
-size_t DiscManager::inuseDiscCount() const    { return inuse_discs.size(); }
-size_t DiscManager::finalizedDiscCount() const{ return finalized_discs.size(); }
-size_t DiscManager::recycledDiscCount() const { return recycled_discs.size(); }
-size_t DiscManager::lostDiscCount() const     { return lost_discs.size(); }
-
-std::shared_ptr<OpticalDisc> DiscManager::findDisc(const std::string& id) {
-    // 解析 disc_xxxxxyyyyy：xxxxx 为批次，yyyyy 为索引
-    size_t pos = id.find_last_of('_');
-    if (pos == std::string::npos) return nullptr;
-    std::string num_str = id.substr(pos + 1);
-    if (num_str.empty()) return nullptr;
-
-    int num = std::stoi(num_str);
-    int batch_idx = num / 100000;
-    int idx = num % 100000;
-
-    std::cout << "查找光盘: " << id << "，批次: " << batch_idx << "，索引: " << idx << std::endl;
-
-    size_t batch_pos = current_binary_file.find("disc_batch_");
-    if (batch_pos == std::string::npos) return nullptr;
-
-    // 从当前文件名提取当前批次号
-    size_t start = batch_pos + std::strlen("disc_batch_");
-    size_t dot   = current_binary_file.find(".bin", start);
-    if (dot == std::string::npos) return nullptr;
-    int current_idx = std::stoi(current_binary_file.substr(start, dot - start));
-    std::cout << "当前批次索引: " << current_idx << std::endl;
-
-    auto print_disc_info = [&](const std::shared_ptr<OpticalDisc>& disc, const std::string& file) {
-        std::cout << "[DiscManager] 找到光盘: " << disc->device_id
-                  << " 所在库: " << disc->library_id
-                  << " 容量: "  << disc->capacity
-                  << " 状态: "  << static_cast<int>(disc->status)
-                  << " 写速: "  << disc->write_throughput_MBps
-                  << " 读速: "  << disc->read_throughput_MBps
-                  << " 文件: "  << file << std::endl;
-    };
+}  // namespace
 
-    if (batch_idx == current_idx) {
-        if (idx >= 0 && static_cast<size_t>(idx) < cache_discs.size()) {
-            if (id == cache_discs[idx]->device_id) {
-                print_disc_info(cache_discs[idx], current_binary_file);
-                return cache_discs[idx];
-            }
+uint8_t DiscManager::statusIndex(DiscStatus status) {
+    return static_cast<uint8_t>(status);
+}
+
+uint32_t DiscManager::indexOf(uint32_t disc) const {
+    auto it = std::upper_bound(runs_.begin(), runs_.end(), disc,
+                               [](uint32_t d, const Run& r) { return d < r.first; });
+    if (it == runs_.begin()) return kNoDisc;
+    --it;
+    if (disc - it->first >= it->count) return kNoDisc;
+    return it->index + (disc - it->first);
+}
+
+uint32_t DiscManager::allocateIndex(uint32_t disc) {
+    const uint32_t idx = static_cast<uint32_t>(status_.size());
+    auto it = std::upper_bound(runs_.begin(), runs_.end(), disc,
+                               [](uint32_t d, const Run& r) { return d < r.first; });
+    if (it != runs_.begin()) {
+        Run& prev = *std::prev(it);
+        if (disc - prev.first == prev.count && prev.index + prev.count == idx) {
+            prev.count++;
+        } else {
+            runs_.insert(it, Run{disc, 1, idx});
         }
-        return nullptr;
     } else {
-        // 切换批次文件并加载
-        saveCacheToBin();
-        std::string target_file = current_binary_file;
-        target_file.replace(start, dot - start, std::to_string(batch_idx));
-        current_binary_file = target_file;
-
-        loadCacheFromBin();
-        std::cout << "加载光盘缓存成功: " << current_binary_file << std::endl;
-        std::cout << "当前缓存光盘数量: " << cache_discs.size() << std::endl;
-
-        if (idx >= 0 && static_cast<size_t>(idx) < cache_discs.size()) {
-            std::cout << "查找光盘: " << id << " 索引: " << idx
-                      << "，缓存对应: " << cache_discs[idx]->device_id << std::endl;
-            if (id == cache_discs[idx]->device_id) {
-                print_disc_info(cache_discs[idx], current_binary_file);
-                return cache_discs[idx];
+        runs_.insert(it, Run{disc, 1, idx});
+    }
+    status_.push_back(kAbsent);
+    capacity_.push_back(0);
+    used_.push_back(0);
+    disc_.push_back(disc);
+    library_.push_back(0);
+    slot_.push_back(0);
+    next_.push_back(kNoDisc);
+    prev_.push_back(kNoDisc);
+    return idx;
+}
+
+bool DiscManager::rebuildRuns() {
+    runs_.clear();
+    for (uint32_t i = 0; i < disc_.size(); ++i) {
+        if (!runs_.empty()) {
+            Run& last = runs_.back();
+            if (disc_[i] - last.first == last.count) {
+                last.count++;
+                continue;
             }
         }
-        return nullptr;
+        runs_.push_back(Run{disc_[i], 1, i});
+    }
+    std::sort(runs_.begin(), runs_.end(), [](const Run& a, const Run& b) { return a.first < b.first; });
+    for (size_t i = 1; i < runs_.size(); ++i) {
+        if (runs_[i].first - runs_[i - 1].first < runs_[i - 1].count) return false;
     }
+    return true;
 }
 
-void DiscManager::recycleDisc(const std::string& id) {
-    auto it = all_discs.find(id);
-    if (it != all_discs.end()) {
-        setDiscStatus(it->second, DiscStatus::Recycled);
+void DiscManager::linkTail(uint32_t idx, uint8_t status) {
+    status_[idx] = status;
+    prev_[idx] = tail_[status];
+    next_[idx] = kNoDisc;
+    if (tail_[status] != kNoDisc) {
+        next_[tail_[status]] = idx;
+    } else {
+        head_[status] = idx;
+    }
+    tail_[status] = idx;
+    count_[status]++;
+}
+
+void DiscManager::unlink(uint32_t idx) {
+    const uint8_t status = status_[idx];
+    if (prev_[idx] != kNoDisc) {
+        next_[prev_[idx]] = next_[idx];
+    } else {
+        head_[status] = next_[idx];
+    }
+    if (next_[idx] != kNoDisc) {
+        prev_[next_[idx]] = prev_[idx];
+    } else {
+        tail_[status] = prev_[idx];
+    }
+    next_[idx] = prev_[idx] = kNoDisc;
+    count_[status]--;
+}
+
+void DiscManager::addDisc(uint32_t disc, DiscStatus status, uint64_t capacity) {
+    if (disc == kNoDisc) return;
+    uint32_t idx = indexOf(disc);
+    if (idx == kNoDisc) idx = allocateIndex(disc);
+    if (status_[idx] != kAbsent) {
+        unlink(idx);
+    } else {
+        total_++;
+    }
+    capacity_[idx] = capacity;
+    used_[idx] = 0;
+    library_[idx] = disc / OPTICAL_LIBRARY_DISC_NUM;
+    slot_[idx] = disc % OPTICAL_LIBRARY_DISC_NUM;
+    linkTail(idx, statusIndex(status));
+}
+
+void DiscManager::addDisc(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status) {
+    uint32_t num = 0;
+    if (!disc || !DiscLocationCatalog::ParseDiscId(disc->device_id, &num)) {
+        std::cerr << "[DiscManager] 无法识别的光盘号: " << (disc ? disc->device_id : "") << std::endl;
         return;
     }
-    auto disc = findDisc(id);
-    if (disc) setDiscStatus(disc, DiscStatus::Recycled);
+    addDisc(num, status, disc->capacity);
+    uint32_t library = 0;
+    if (DiscLocationCatalog::ParseLibraryId(disc->library_id, &library)) {
+        library_[indexOf(num)] = library;
+    }
+    disc->status = status;
+}
+
+bool DiscManager::setDiscStatus(uint32_t disc, DiscStatus status) {
+    if (!hasDisc(disc)) return false;
+    const uint32_t idx = indexOf(disc);
+    const uint8_t s = statusIndex(status);
+    if (status_[idx] == s) return true;
+    unlink(idx);
+    linkTail(idx, s);
+    return true;
+}
+
+void DiscManager::setDiscStatus(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status) {
+    uint32_t num = 0;
+    if (!disc || !DiscLocationCatalog::ParseDiscId(disc->device_id, &num)) return;
+    if (setDiscStatus(num, status)) {
+        // 同步状态到对象本身（可选）
+        disc->status = status;
+    }
+}
+
+bool DiscManager::addUsedBytes(uint32_t disc, uint64_t bytes) {
+    if (!hasDisc(disc)) return false;
+    const uint32_t idx = indexOf(disc);
+    if (used_[idx] + bytes > capacity_[idx]) return false;
+    used_[idx] += bytes;
+    return true;
+}
+
+bool DiscManager::hasDisc(uint32_t disc) const {
+    const uint32_t idx = indexOf(disc);
+    return idx != kNoDisc && status_[idx] != kAbsent;
+}
+
+DiscStatus DiscManager::discStatus(uint32_t disc) const { return static_cast<DiscStatus>(status_[indexOf(disc)]); }
+uint64_t DiscManager::discCapacity(uint32_t disc) const { return capacity_[indexOf(disc)]; }
+uint64_t DiscManager::discUsedBytes(uint32_t disc) const { return used_[indexOf(disc)]; }
+uint32_t DiscManager::discLibrary(uint32_t disc) const  { return library_[indexOf(disc)]; }
+uint32_t DiscManager::discSlot(uint32_t disc) const     { return slot_[indexOf(disc)]; }
+
+uint32_t DiscManager::nextBlankDisc() const {
+    const uint32_t idx = head_[statusIndex(DiscStatus::Blank)];
+    return idx == kNoDisc ? kNoDisc : disc_[idx];
+}
+
+uint32_t DiscManager::acquireBlankDisc() {
+    const uint32_t disc = nextBlankDisc();
+    if (disc != kNoDisc) setDiscStatus(disc, DiscStatus::InUse);
+    return disc;
+}
+
+uint32_t DiscManager::acquireBlankDisc(uint32_t library) {
+    uint32_t idx = head_[statusIndex(DiscStatus::Blank)];
+    while (idx != kNoDisc && library_[idx] != library) idx = next_[idx];
+    if (idx == kNoDisc) return kNoDisc;
+    const uint32_t disc = disc_[idx];
+    setDiscStatus(disc, DiscStatus::InUse);
+    return disc;
+}
+
+size_t DiscManager::totalDiscCount() const    { return total_; }
+size_t DiscManager::blankDiscCount() const    { return count_[statusIndex(DiscStatus::Blank)]; }
+size_t DiscManager::inuseDiscCount() const    { return count_[statusIndex(DiscStatus::InUse)]; }
+size_t DiscManager::finalizedDiscCount() const{ return count_[statusIndex(DiscStatus::Finalized)]; }
+size_t DiscManager::recycledDiscCount() const { return count_[statusIndex(DiscStatus::Recycled)]; }
+size_t DiscManager::lostDiscCount() const     { return count_[statusIndex(DiscStatus::Lost)]; }
+
+std::shared_ptr<OpticalDisc> DiscManager::findDisc(const std::string& id) const {
+    uint32_t num = 0;
+    if (!DiscLocationCatalog::ParseDiscId(id, &num) || !hasDisc(num)) return nullptr;
+    const uint32_t idx = indexOf(num);
+    auto disc = std::make_shared<OpticalDisc>(id, DiscLocationCatalog::FormatLibraryId(library_[idx]),
+                                              capacity_[idx], OPTICAL_DISC_WRITE_MBPS, OPTICAL_DISC_READ_MBPS);
+    disc->status = static_cast<DiscStatus>(status_[idx]);
+    return disc;
+}
+
+void DiscManager::recycleDisc(const std::string& id) {
+    uint32_t num = 0;
+    if (DiscLocationCatalog::ParseDiscId(id, &num)) {
+        setDiscStatus(num, DiscStatus::Recycled);
+    }
 }
 
 void DiscManager::generateBlankDiscs(int count) {
-    const int batch_size  = 100000;
-    int batch_count       = (count + batch_size - 1) / batch_size; // ceil
-    int written_total     = 0;
-
-    for (int batch = 0; batch < batch_count; ++batch) {
-        std::string filename = "/mnt/md0/node/disc/disc_batch_" + std::to_string(batch) + ".bin";
-        std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
-        if (!ofs.is_open()) {
-            std::cerr << "[DiscManager] 无法打开文件: " << filename << std::endl;
-            continue;
-        }
-        int discs_in_this_file = std::min(batch_size, count - written_total);
-        for (int i = 0; i < discs_in_this_file; ++i, ++written_total) {
-            char id_buf[32], lib_buf[16];
-            std::snprintf(id_buf, sizeof(id_buf), "disc_%05d%05d", batch, i); // 10位补零
-            int lib_idx = written_total / 20000; // 每 2 万光盘分配一个库
-            std::snprintf(lib_buf, sizeof(lib_buf), "lib_%05d", lib_idx);
-
-            // 注意 OpticalDisc 构造参数顺序：id, library_id, capacity, write_tp, read_tp
-            OpticalDisc disc(id_buf, lib_buf, OPTICAL_DISC_CAPACITY,
-                             OPTICAL_DISC_WRITE_MBPS, OPTICAL_DISC_READ_MBPS);
-
-            ofs.write(reinterpret_cast<const char*>(&disc), sizeof(disc));
-        }
-        ofs.close();
+    if (count <= 0) return;
+    const size_t n = status_.size() + static_cast<size_t>(count);
+    for (auto* column : {&capacity_, &used_}) column->reserve(n);
+    for (auto* column : {&disc_, &library_, &slot_, &next_, &prev_}) column->reserve(n);
+    status_.reserve(n);
+    for (int i = 0; i < count; ++i) {
+        addDisc(static_cast<uint32_t>(i), DiscStatus::Blank, OPTICAL_DISC_CAPACITY);
     }
+    saveSnapshot();
 }
 
-void DiscManager::saveCacheToBin() {
-    if (current_binary_file.empty()) return;
-    std::ofstream ofs(current_binary_file, std::ios::binary | std::ios::trunc);
-    if (!ofs.is_open()) {
-        std::cerr << "[DiscManager] 无法写入文件: " << current_binary_file << std::endl;
-        return;
+bool DiscManager::saveSnapshot() const {
+    if (snapshot_file.empty()) return false;
+    const std::string tmp = snapshot_file + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "[DiscManager] 无法写入文件: " << tmp << std::endl;
+        return false;
+    }
+    const size_t n = status_.size();
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    h.version = kSnapshotVersion;
+    h.slots = n;
+    h.total = total_;
+    std::vector<uint32_t> order;
+    order.reserve(total_);
+    for (size_t s = 0; s < kStatusCount; ++s) {
+        for (uint32_t idx = head_[s]; idx != kNoDisc; idx = next_[idx]) order.push_back(idx);
     }
-    for (const auto& disc : cache_discs) {
-        ofs.write(reinterpret_cast<const char*>(disc.get()), sizeof(OpticalDisc));
+    const char pad[8] = {};
+    bool ok = WriteAll(fd, &h, sizeof(h)) &&
+              WriteAll(fd, status_.data(), n) &&
+              WriteAll(fd, pad, align8(n) - n) &&
+              WriteAll(fd, capacity_.data(), n * sizeof(uint64_t)) &&
+              WriteAll(fd, used_.data(), n * sizeof(uint64_t)) &&
+              WriteAll(fd, disc_.data(), n * sizeof(uint32_t)) &&
+              WriteAll(fd, library_.data(), n * sizeof(uint32_t)) &&
+              WriteAll(fd, slot_.data(), n * sizeof(uint32_t)) &&
+              WriteAll(fd, order.data(), order.size() * sizeof(uint32_t));
+    // 临时文件先落盘再 rename，rename 后再落盘目录项：
+    // 崩溃后看到的要么是旧快照，要么是完整的新快照
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), snapshot_file.c_str()) != 0) {
+        std::cerr << "[DiscManager] 保存快照失败: " << snapshot_file << ": " << std::strerror(errno) << std::endl;
+        std::remove(tmp.c_str());
+        return false;
     }
-    ofs.close();
+    if (!SyncDir(std::filesystem::path(snapshot_file).parent_path().string())) {
+        std::cerr << "[DiscManager] 同步快照目录失败: " << snapshot_file << std::endl;
+        return false;
+    }
+    return true;
 }
 
-// 读取文件到 cache_discs
-void DiscManager::loadCacheFromBin() {
-    cache_discs.clear();
-    std::ifstream ifs(current_binary_file, std::ios::binary);
-    if (!ifs.is_open()) {
-        std::cerr << "[DiscManager] 无法打开文件: " << current_binary_file << std::endl;
-        return;
+bool DiscManager::loadSnapshot() {
+    int fd = ::open(snapshot_file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "[DiscManager] 无法打开文件: " << snapshot_file << std::endl;
+        return false;
     }
-    while (true) {
-        OpticalDisc disc("", "", 0, 0.0, 0.0);
-        ifs.read(reinterpret_cast<char*>(&disc), sizeof(disc));
-        if (static_cast<size_t>(ifs.gcount()) != sizeof(disc)) break;
-
-        auto ptr = std::make_shared<OpticalDisc>(
-            std::string(disc.device_id),
-            std::string(disc.library_id),
-            disc.capacity,
-            disc.write_throughput_MBps,
-            disc.read_throughput_MBps
-        );
-        ptr->status = disc.status;
-        cache_discs.push_back(ptr);
-    }
-    ifs.close();
-    std::cout << "[DiscManager] 已加载光盘缓存: " << current_binary_file
-              << "，数量: " << cache_discs.size() << std::endl;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+    const size_t bytes = static_cast<size_t>(st.st_size);
+    void* map = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const char* p = static_cast<const char*>(map);
+    SnapshotHeader h;
+    std::memcpy(&h, p, sizeof(h));
+    auto reject = [&] {
+        std::cerr << "[DiscManager] 快照格式不正确: " << snapshot_file << std::endl;
+        ::munmap(map, bytes);
+        return false;
+    };
+    if (std::memcmp(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        h.version != kSnapshotVersion || h.slots > kNoDisc || h.total > h.slots ||
+        snapshotBytes(h.slots, h.total) != bytes) {
+        return reject();
+    }
+    const size_t n = h.slots;
+    std::vector<uint8_t> status(p + sizeof(h), p + sizeof(h) + n);
+    p += sizeof(h) + align8(n);
+    std::vector<uint64_t> capacity, used;
+    std::vector<uint32_t> disc, library, slot, order;
+    readColumn(p, capacity, n);
+    readColumn(p, used, n);
+    readColumn(p, disc, n);
+    readColumn(p, library, n);
+    readColumn(p, slot, n);
+    readColumn(p, order, h.total);
+    ::munmap(map, bytes);
+
+    status_ = std::move(status);
+    capacity_ = std::move(capacity);
+    used_ = std::move(used);
+    disc_ = std::move(disc);
+    library_ = std::move(library);
+    slot_ = std::move(slot);
+    if (!rebuildRuns()) {
+        const std::string path = snapshot_file;
+        *this = DiscManager();
+        snapshot_file = path;
+        std::cerr << "[DiscManager] 快照中光盘号重复: " << snapshot_file << std::endl;
+        return false;
+    }
+
+    // 按快照记录的顺序重建各状态链表；顺序里缺失的盘（快照损坏）按下标补在各自链表尾部
+    const size_t slots = status_.size();
+    next_.assign(slots, kNoDisc);
+    prev_.assign(slots, kNoDisc);
+    for (size_t s = 0; s < kStatusCount; ++s) {
+        head_[s] = tail_[s] = kNoDisc;
+        count_[s] = 0;
+    }
+    total_ = 0;
+    std::vector<bool> linked(slots, false);
+    auto link = [&](uint32_t idx) {
+        if (idx >= slots || linked[idx]) return;
+        const uint8_t s = status_[idx];
+        if (s == kAbsent) return;
+        linked[idx] = true;
+        if (s >= kStatusCount) {
+            status_[idx] = kAbsent;
+            return;
+        }
+        linkTail(idx, s);
+        total_++;
+    };
+    for (uint32_t idx : order) link(idx);
+    for (uint32_t idx = 0; idx < slots; ++idx) link(idx);
+    std::cout << "[DiscManager] 已加载光盘状态表: " << snapshot_file
+              << "，数量: " << total_ << std::endl;
+    return true;
 }
@@ -1,27 +1,47 @@
 #pragma once
 #include "storagenode/optical/OpticalDisc.h"
-#include <map>
-#include <set>
-#include <vector>
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <iostream>
+#include <vector>
 
+// 光盘状态表。
+// 光盘号即 disc_%010u 中的整数。每张盘按加入顺序分到一个紧凑下标，用列式数组
+// （状态字节、容量、已用字节、光盘号、库号、槽位）保存，每张盘约 37 字节，
+// 不再为每张盘建字符串树节点和 OpticalDisc 对象。
+// 生成的光盘号基本连续，光盘号到下标的映射按“连续段”记录（段首光盘号、长度、首个下标），
+// 有序数组二分查找；光盘号再稀疏也只按实际盘数占用内存。
+// 每种状态维护一条按下标串起的双向链表，改状态、取下一张空白盘都是 O(1)。
+// 快照是一个平铺的二进制文件：文件头后依次是各列数组和各状态链表的顺序，
+// 整列写出，加载时 mmap 后整列拷贝，空白盘的分配顺序在重启后保持不变。
 class DiscManager {
 public:
-    std::map<std::string, std::shared_ptr<OpticalDisc>> all_discs;
-    std::vector<std::shared_ptr<OpticalDisc>> cache_discs; // 缓存一个二进制文件的光盘
-    std::string current_binary_file = "/mnt/md0/node/disc/disc_batch_0.bin"; // 当前二进制文件名
+    static constexpr uint32_t kNoDisc = UINT32_MAX;
+    static constexpr size_t kStatusCount = 5;
 
-    // 维护状态索引、查找、回收等（只存光盘id）
-    std::set<std::string> blank_discs;     // 空闲光盘id
-    std::set<std::string> inuse_discs;     // 正在使用的光盘id
-    std::set<std::string> finalized_discs; // 已刻录完成的光盘id
-    std::set<std::string> recycled_discs;  // 已回收的光盘id
-    std::set<std::string> lost_discs;      // 丢失的光盘id
+    std::string snapshot_file = "/mnt/md0/node/disc/disc_table.bin"; // 状态表快照文件
 
+    // 光盘号已存在时覆盖其状态和容量；库号/槽位由光盘号推出
+    void addDisc(uint32_t disc, DiscStatus status = DiscStatus::Blank,
+                 uint64_t capacity = OPTICAL_DISC_CAPACITY);
     void addDisc(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status = DiscStatus::Blank);
+    bool setDiscStatus(uint32_t disc, DiscStatus status);
     void setDiscStatus(const std::shared_ptr<OpticalDisc>& disc, DiscStatus status);
+    bool addUsedBytes(uint32_t disc, uint64_t bytes);
+
+    bool hasDisc(uint32_t disc) const;
+    DiscStatus discStatus(uint32_t disc) const;  // 调用方需保证 hasDisc
+    uint64_t discCapacity(uint32_t disc) const;
+    uint64_t discUsedBytes(uint32_t disc) const;
+    uint32_t discLibrary(uint32_t disc) const;
+    uint32_t discSlot(uint32_t disc) const;
+
+    // 下一张空白盘（最早加入空白链表的一张），没有时返回 kNoDisc
+    uint32_t nextBlankDisc() const;
+    // 取出下一张空白盘并置为 InUse
+    uint32_t acquireBlankDisc();
+    // 同上，但只取库 library 中的盘；沿空白链表查找，跳过其他库的空白盘
+    uint32_t acquireBlankDisc(uint32_t library);
 
     size_t totalDiscCount() const;
     size_t blankDiscCount() const;
@@ -30,17 +50,49 @@ public:
     size_t recycledDiscCount() const;
     size_t lostDiscCount() const;
 
-    std::shared_ptr<OpticalDisc> findDisc(const std::string& id);
+    // 返回按状态表内容构造的 OpticalDisc 副本；修改状态请走 setDiscStatus
+    std::shared_ptr<OpticalDisc> findDisc(const std::string& id) const;
     void recycleDisc(const std::string& id);
+    // 生成光盘号 0..count-1 的空白盘，每 OPTICAL_LIBRARY_DISC_NUM 张一个库
     void generateBlankDiscs(int count = 1000);
 
-    void saveCacheToBin();
-    void loadCacheFromBin();
+    bool saveSnapshot() const;
+    bool loadSnapshot();
+
+private:
+    static constexpr uint8_t kAbsent = 0xFF;
+
+    // 光盘号 [first, first + count) 对应下标 [index, index + count)
+    struct Run {
+        uint32_t first;
+        uint32_t count;
+        uint32_t index;
+    };
+
+    // 光盘号对应的下标，没有时返回 kNoDisc
+    uint32_t indexOf(uint32_t disc) const;
+    // 为新光盘号分配下标：紧接在最后分配的段之后时延长该段，否则新开一段
+    uint32_t allocateIndex(uint32_t disc);
+    // 按 disc_ 列重建光盘号映射；光盘号重复时返回 false
+    bool rebuildRuns();
+    void linkTail(uint32_t idx, uint8_t status);
+    void unlink(uint32_t idx);
+    static uint8_t statusIndex(DiscStatus status);
+
+    // 列式状态表，按下标
+    std::vector<uint8_t> status_;     // DiscStatus 的值，kAbsent 表示没有这张盘
+    std::vector<uint64_t> capacity_;
+    std::vector<uint64_t> used_;
+    std::vector<uint32_t> disc_;      // 光盘号
+    std::vector<uint32_t> library_;
+    std::vector<uint32_t> slot_;
+    std::vector<Run> runs_;           // 按段首光盘号排序
 
-    ~DiscManager() {
-        if (!cache_discs.empty()) {
-            std::cout << "缓存光盘信息已保存到二进制文件" << std::endl;
-            // 这里只是声明析构行为；实际写入逻辑应在 .cpp 实现中完成
-        }
-    }
+    // 每种状态一条双向链表
+    std::vector<uint32_t> next_;
+    std::vector<uint32_t> prev_;
+    uint32_t head_[kStatusCount] = {kNoDisc, kNoDisc, kNoDisc, kNoDisc, kNoDisc};
+    uint32_t tail_[kStatusCount] = {kNoDisc, kNoDisc, kNoDisc, kNoDisc, kNoDisc};
+    size_t count_[kStatusCount] = {};
+    size_t total_ = 0;
 };
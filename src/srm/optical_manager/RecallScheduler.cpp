@@ -0,0 +1,348 @@
+#include "RecallScheduler.h"
+
+#include "DiscLocationCatalog.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+constexpr double kNever = SimClock::kNever;
+}
+
+bool RecallScheduler::StagingCache::covers(const std::string& disc, uint64_t offset, uint64_t length) {
+    auto dit = index_.find(disc);
+    if (dit == index_.end()) return false;
+    auto& extents = dit->second;
+    const uint64_t end = offset + length;
+    uint64_t pos = offset;
+    std::vector<std::list<Entry>::iterator> used;
+    while (pos < end) {
+        auto it = extents.upper_bound(pos);
+        if (it == extents.begin()) return false;
+        --it;
+        const Entry& e = *it->second;
+        if (e.offset + e.length <= pos) return false;
+        used.push_back(it->second);
+        pos = e.offset + e.length;
+    }
+    for (auto it : used) {
+        lru_.splice(lru_.end(), lru_, it);
+    }
+    return true;
+}
+
+void RecallScheduler::StagingCache::insert(const std::string& disc, uint64_t offset, uint64_t length) {
+    if (length == 0 || length > capacity_) return;
+    auto& extents = index_[disc];
+    auto it = extents.find(offset);
+    if (it != extents.end()) {
+        if (it->second->length >= length) {
+            lru_.splice(lru_.end(), lru_, it->second);
+            return;
+        }
+        used_ -= it->second->length;
+        lru_.erase(it->second);
+        extents.erase(it);
+    }
+    lru_.push_back(Entry{disc, offset, length});
+    extents[offset] = std::prev(lru_.end());
+    used_ += length;
+    evict();
+}
+
+void RecallScheduler::StagingCache::evict() {
+    while (used_ > capacity_ && !lru_.empty()) {
+        const Entry& e = lru_.front();
+        auto dit = index_.find(e.disc);
+        dit->second.erase(e.offset);
+        if (dit->second.empty()) index_.erase(dit);
+        used_ -= e.length;
+        lru_.pop_front();
+    }
+}
+
+RecallScheduler::RecallScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries)
+    : RecallScheduler(std::move(libraries), Options{}) {}
+
+RecallScheduler::RecallScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries, Options opts)
+    : opts_(opts), cache_(opts.staging_cache_bytes), clock_(opts.time_scale) {
+    for (auto& lib : libraries) {
+        if (!lib) continue;
+        for (uint32_t i = 0; i < lib->drive_count; ++i) {
+            Drive d;
+            d.lib = libraries_.size();
+            d.index = i;
+            drives_.push_back(d);
+        }
+        uint32_t library = 0;
+        if (DiscLocationCatalog::ParseLibraryId(lib->library_id, &library)) {
+            library_index_[library] = static_cast<int>(libraries_.size());
+        }
+        Library entry;
+        entry.lib = lib;
+        libraries_.push_back(std::move(entry));
+    }
+}
+
+RecallScheduler::~RecallScheduler() {
+    stop();
+}
+
+void RecallScheduler::setCompletionCallback(CompletionCallback callback) {
+    std::lock_guard<std::mutex> lock(mu_);
+    callback_ = std::move(callback);
+}
+
+void RecallScheduler::start() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (running_) return;
+    running_ = true;
+    stop_ = false;
+    worker_ = std::thread(&RecallScheduler::run, this);
+}
+
+void RecallScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!running_) return;
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> lock(mu_);
+    running_ = false;
+    done_cv_.notify_all();
+}
+
+bool RecallScheduler::isRunning() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return running_ && !stop_;
+}
+
+int RecallScheduler::findLibrary(const std::string& disc_id) {
+    auto it = disc_library_.find(disc_id);
+    if (it != disc_library_.end()) return it->second;
+    int found = -1;
+    for (size_t i = 0; i < libraries_.size(); ++i) {
+        try {
+            if (libraries_[i].lib->hasDisc(disc_id) >= 0) {
+                found = static_cast<int>(i);
+                break;
+            }
+        } catch (...) {
+            break;  // id 格式不对
+        }
+    }
+    disc_library_[disc_id] = found;
+    return found;
+}
+
+bool RecallScheduler::submit(const RecallRequest& req) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (stop_) return false;
+    RecallResult r;
+    r.request = req;
+    r.submitted_at = clock_.now();
+    ++outstanding_;
+    const int lib = findLibrary(req.disc_id);
+    if (lib < 0) {
+        std::cerr << "[RecallScheduler] 找不到光盘 " << req.disc_id << std::endl;
+        r.completed_at = r.submitted_at;
+        ready_.push_back(std::move(r));
+    } else if (cache_.covers(req.disc_id, req.offset, req.length)) {
+        r.ok = true;
+        r.from_cache = true;
+        r.library_id = libraries_[lib].lib->library_id;
+        r.completed_at = r.submitted_at;
+        ready_.push_back(std::move(r));
+    } else {
+        DiscQueue& q = pending_[req.disc_id];
+        if (q.requests.empty()) {
+            q.lib = static_cast<size_t>(lib);
+            q.oldest = r.submitted_at;
+            libraries_[lib].discs.insert(req.disc_id);
+        }
+        q.bytes += req.length;
+        q.requests.push_back(Pending{std::move(r)});
+    }
+    lock.unlock();
+    cv_.notify_all();
+    return true;
+}
+
+bool RecallScheduler::submitInode(uint64_t request_id, uint64_t inode, const DiscLocationCatalog& catalog) {
+    DiscLocationCatalog::Location loc;
+    if (!catalog.FindInode(inode, &loc)) return false;
+    RecallRequest req;
+    req.request_id = request_id;
+    req.disc_id = DiscLocationCatalog::FormatDiscId(loc.disc);
+    req.offset = loc.offset;
+    req.length = loc.size;
+    {
+        // 目录已给出库号，预先填入盘 -> 库缓存，submit 不再调用 hasDisc
+        std::lock_guard<std::mutex> lock(mu_);
+        auto it = library_index_.find(loc.library);
+        if (it != library_index_.end()) disc_library_.emplace(req.disc_id, it->second);
+    }
+    return submit(req);
+}
+
+void RecallScheduler::drain() {
+    std::unique_lock<std::mutex> lock(mu_);
+    done_cv_.wait(lock, [&] { return outstanding_ == 0 || !running_ || stop_; });
+}
+
+RecallScheduler::Stats RecallScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    Stats s = stats_;
+    s.pending = 0;
+    for (const auto& kv : pending_) s.pending += kv.second.requests.size();
+    s.cached_bytes = cache_.bytes();
+    return s;
+}
+
+double RecallScheduler::now() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return clock_.now();
+}
+
+// 把一张盘上的全部待读请求交给光驱：按偏移排序，重叠或相邻的请求合并成一次顺序读
+void RecallScheduler::dispatchLocked(Drive& d, const std::string& disc_id, double t) {
+    auto qit = pending_.find(disc_id);
+    DiscQueue q = std::move(qit->second);
+    pending_.erase(qit);
+    Library& lib = libraries_[d.lib];
+    lib.discs.erase(disc_id);
+
+    double pos = std::max(t, d.free_at);
+    if (d.mounted != disc_id) {
+        // 机械手换盘：卸下旧盘、装入新盘
+        const double start = std::max(pos, lib.robot_free_at);
+        pos = start + lib.lib->load_unload_time;
+        lib.robot_free_at = pos;
+        d.mounted = disc_id;
+        stats_.mounts++;
+    }
+
+    std::sort(q.requests.begin(), q.requests.end(), [](const Pending& a, const Pending& b) {
+        return a.result.request.offset < b.result.request.offset;
+    });
+    d.extents.clear();
+    d.next = 0;
+    for (auto& p : q.requests) {
+        const RecallRequest& req = p.result.request;
+        p.result.library_id = lib.lib->library_id;
+        p.result.drive = d.index;
+        if (!d.extents.empty()) {
+            Extent& last = d.extents.back();
+            if (req.offset <= last.offset + last.length) {
+                last.length = std::max(last.length, req.offset + req.length - last.offset);
+                last.requests.push_back(std::move(p.result));
+                continue;
+            }
+        }
+        Extent e;
+        e.offset = req.offset;
+        e.length = req.length;
+        e.requests.push_back(std::move(p.result));
+        d.extents.push_back(std::move(e));
+    }
+    for (size_t i = 0; i < d.extents.size(); ++i) {
+        Extent& e = d.extents[i];
+        const double read = lib.lib->readFromDisc(disc_id, e.offset, e.length) - lib.lib->load_unload_time;
+        pos += (i > 0 ? opts_.seek_seconds : 0.0) + std::max(0.0, read);
+        e.end = pos;
+        stats_.bytes_read += e.length;
+    }
+    d.free_at = pos;
+}
+
+bool RecallScheduler::stepLocked(double t, std::vector<RecallResult>& done) {
+    bool progress = false;
+    if (!ready_.empty()) {
+        for (auto& r : ready_) {
+            if (r.ok) {
+                stats_.completed++;
+                stats_.cache_hits++;
+            } else {
+                stats_.failed++;
+            }
+            done.push_back(std::move(r));
+        }
+        ready_.clear();
+        progress = true;
+    }
+    // 完成已读到的区间，读出的数据进入暂存缓存
+    for (auto& d : drives_) {
+        while (d.busy() && d.extents[d.next].end <= t) {
+            Extent& e = d.extents[d.next++];
+            cache_.insert(d.mounted, e.offset, e.length);
+            for (auto& r : e.requests) {
+                r.ok = true;
+                r.completed_at = e.end;
+                stats_.completed++;
+                stats_.last_completion = std::max(stats_.last_completion, e.end);
+                done.push_back(std::move(r));
+            }
+            progress = true;
+        }
+    }
+    // 空闲光驱在本库待读盘中按 服务时间 - 老化 选盘：本驱已装的盘不计装盘时间，
+    // 已装在其他光驱里的盘留给那个光驱
+    for (auto& d : drives_) {
+        if (d.busy()) continue;
+        Library& lib = libraries_[d.lib];
+        if (lib.discs.empty()) continue;
+        std::unordered_set<std::string> elsewhere;
+        for (const auto& other : drives_) {
+            if (&other != &d && other.lib == d.lib && !other.mounted.empty()) elsewhere.insert(other.mounted);
+        }
+        const double mount_wait = std::max(0.0, lib.robot_free_at - t) + lib.lib->load_unload_time;
+        const std::string* best = nullptr;
+        double best_score = kNever;
+        for (const auto& disc : lib.discs) {
+            if (elsewhere.count(disc)) continue;
+            const DiscQueue& q = pending_.at(disc);
+            const double service = (disc == d.mounted ? 0.0 : mount_wait) +
+                                   static_cast<double>(q.bytes) / (OPTICAL_DISC_READ_MBPS * 1024.0 * 1024.0) +
+                                   opts_.seek_seconds * static_cast<double>(q.requests.size());
+            const double score = service - opts_.aging_weight * (t - q.oldest);
+            if (score < best_score || (score == best_score && disc < *best)) {
+                best = &disc;
+                best_score = score;
+            }
+        }
+        if (best) {
+            const std::string disc = *best;
+            dispatchLocked(d, disc, t);
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+double RecallScheduler::nextEventLocked() const {
+    double next = kNever;
+    for (const auto& d : drives_) {
+        if (d.busy()) next = std::min(next, d.extents[d.next].end);
+    }
+    return next;
+}
+
+void RecallScheduler::run() {
+    std::unique_lock<std::mutex> lock(mu_);
+    clock_.run<RecallResult>(
+        lock, cv_, stop_,
+        [this](double t, std::vector<RecallResult>& done) { return stepLocked(t, done); },
+        [this] { return nextEventLocked(); },
+        [this](std::unique_lock<std::mutex>& held, std::vector<RecallResult>& done) {
+            CompletionCallback callback = callback_;
+            if (callback) {
+                held.unlock();
+                for (const auto& r : done) callback(r);
+                held.lock();
+            }
+            outstanding_ -= done.size();
+            done_cv_.notify_all();
+        });
+}
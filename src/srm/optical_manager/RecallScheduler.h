@@ -0,0 +1,173 @@
+#pragma once
+#include "../../storagenode/optical/OpticalDiscLibrary.h"
+#include "SimClock.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class DiscLocationCatalog;
+
+// 光盘回调（读取）调度器。
+// 回调请求按光盘聚合：一张盘装入光驱后，把该盘上所有待读请求按偏移排序、合并相邻区间，
+// 一次顺序扫过，装卸盘时间由整批请求分摊。光驱空闲时先继续读已装在本驱的盘，
+// 否则在本库待读的盘中选 “服务时间 - aging_weight × 等待时间” 最小的一张
+// （短作业优先 + 老化，避免大批量回调饿死零散请求）。
+// 读出的区间写入 HDD 暂存缓存，后续落在缓存里的请求不再装盘。
+// 时间模型与 BurnScheduler 相同：按 OpticalDiscLibrary 的参数在同样的模拟时钟（SimClock）上推进。
+class RecallScheduler {
+public:
+    struct Options {
+        double time_scale = 1.0;          // 真实秒数 = 模拟秒数 × time_scale；0 表示不等待
+        double aging_weight = 1.0;        // 每等待 1 秒抵消多少秒服务时间
+        double seek_seconds = 0.05;       // 同一张盘上不连续区间之间的寻道时间
+        uint64_t staging_cache_bytes = HDD_DEFAULT_CAPACITY / 8;  // HDD 暂存缓存容量
+    };
+
+    struct RecallRequest {
+        uint64_t request_id = 0;
+        std::string disc_id;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    // 时间均为模拟时钟（秒）
+    struct RecallResult {
+        RecallRequest request;
+        bool ok = false;
+        bool from_cache = false;  // 直接命中暂存缓存
+        std::string library_id;
+        uint32_t drive = 0;
+        double submitted_at = 0;
+        double completed_at = 0;
+    };
+
+    struct Stats {
+        uint64_t pending = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t cache_hits = 0;
+        uint64_t mounts = 0;
+        uint64_t bytes_read = 0;
+        uint64_t cached_bytes = 0;
+        double last_completion = 0;
+    };
+
+    using CompletionCallback = std::function<void(const RecallResult&)>;
+
+    explicit RecallScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries);
+    RecallScheduler(std::vector<std::shared_ptr<OpticalDiscLibrary>> libraries, Options opts);
+    ~RecallScheduler();
+
+    RecallScheduler(const RecallScheduler&) = delete;
+    RecallScheduler& operator=(const RecallScheduler&) = delete;
+
+    // 需在 start 之前设置
+    void setCompletionCallback(CompletionCallback callback);
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // 调度器已停止时返回 false；找不到光盘的请求以失败结果回调
+    bool submit(const RecallRequest& req);
+    // 按 inode 回调整个文件：在位置目录中直接查到盘和库，不需要扫描镜像或逐库查盘。
+    // 目录里没有该 inode 时返回 false（不产生回调结果）
+    bool submitInode(uint64_t request_id, uint64_t inode, const DiscLocationCatalog& catalog);
+    // 等待所有已提交的请求完成
+    void drain();
+
+    Stats getStats() const;
+    double now() const;
+
+private:
+    struct Pending {
+        RecallResult result;
+    };
+    struct DiscQueue {
+        size_t lib = 0;
+        std::vector<Pending> requests;
+        uint64_t bytes = 0;
+        double oldest = 0;
+    };
+    // 合并后的一段连续读取
+    struct Extent {
+        uint64_t offset = 0;
+        uint64_t length = 0;
+        double end = 0;
+        std::vector<RecallResult> requests;
+    };
+    struct Drive {
+        size_t lib = 0;
+        uint32_t index = 0;
+        std::string mounted;          // 当前在驱内的盘
+        std::vector<Extent> extents;  // 本批待完成的区间，按读取顺序
+        size_t next = 0;
+        double free_at = 0;
+        bool busy() const { return next < extents.size(); }
+    };
+    struct Library {
+        std::shared_ptr<OpticalDiscLibrary> lib;
+        double robot_free_at = 0;
+        std::unordered_set<std::string> discs;  // 有待读请求的盘
+    };
+
+    // HDD 暂存缓存：按区间 LRU 淘汰
+    class StagingCache {
+    public:
+        explicit StagingCache(uint64_t capacity) : capacity_(capacity) {}
+        bool covers(const std::string& disc, uint64_t offset, uint64_t length);
+        void insert(const std::string& disc, uint64_t offset, uint64_t length);
+        uint64_t bytes() const { return used_; }
+
+    private:
+        struct Entry {
+            std::string disc;
+            uint64_t offset;
+            uint64_t length;
+        };
+        void evict();
+
+        uint64_t capacity_;
+        uint64_t used_ = 0;
+        std::list<Entry> lru_;  // 尾部最新
+        std::unordered_map<std::string, std::map<uint64_t, std::list<Entry>::iterator>> index_;
+    };
+
+    void run();
+    bool stepLocked(double t, std::vector<RecallResult>& done);
+    void dispatchLocked(Drive& d, const std::string& disc_id, double t);
+    double nextEventLocked() const;
+    int findLibrary(const std::string& disc_id);
+
+    Options opts_;
+    std::vector<Library> libraries_;
+    std::vector<Drive> drives_;
+    std::unordered_map<std::string, int> disc_library_;  // 盘所在库的缓存
+    std::unordered_map<uint32_t, int> library_index_;     // 目录里的库号 -> libraries_ 下标
+    CompletionCallback callback_;
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    std::unordered_map<std::string, DiscQueue> pending_;
+    std::vector<RecallResult> ready_;  // 命中缓存或失败，待回调
+    StagingCache cache_;
+    uint64_t outstanding_ = 0;
+    SimClock clock_;
+    bool running_ = false;
+    bool stop_ = false;
+    Stats stats_;
+    std::thread worker_;
+};
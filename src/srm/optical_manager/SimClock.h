@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// 光盘库调度器（BurnScheduler、RecallScheduler）共用的模拟时钟和调度线程主循环。
+// time_scale > 0 时模拟时间随真实时间推进：真实秒数 = 模拟秒数 × time_scale；
+// time_scale <= 0 时不等待，没有可做的事就把时钟直接拨到下一个事件。
+// 除构造外的方法都需在调度器的锁内调用。
+class SimClock {
+public:
+    static constexpr double kNever = std::numeric_limits<double>::infinity();
+
+    explicit SimClock(double time_scale)
+        : time_scale_(time_scale), epoch_(std::chrono::steady_clock::now()) {}
+
+    // 当前模拟时钟（秒）
+    double now() const {
+        if (time_scale_ <= 0) return clock_;
+        const double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_).count();
+        return real / time_scale_;
+    }
+
+    // 调度线程主循环，stop 置位后返回。每轮 step(t, done) 推进到模拟时间 t 并返回是否有进展；
+    // 有结果完成时交给 deliver(lock, done)，回调可在其中临时解锁执行；
+    // 没有进展时等到 next_event() 给出的下一个事件，或被 cv 唤醒（新的提交、停止）
+    template <typename Result, typename Step, typename NextEvent, typename Deliver>
+    void run(std::unique_lock<std::mutex>& lock, std::condition_variable& cv, const bool& stop,
+             Step step, NextEvent next_event, Deliver deliver) {
+        while (!stop) {
+            std::vector<Result> done;
+            const bool progress = step(now(), done);
+            if (!done.empty()) {
+                deliver(lock, done);
+                continue;
+            }
+            if (progress) continue;
+            const double next = next_event();
+            if (next == kNever) {
+                cv.wait(lock);
+            } else if (time_scale_ <= 0) {
+                clock_ = std::max(clock_, next);
+            } else {
+                auto wake = epoch_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                         std::chrono::duration<double>(next * time_scale_));
+                cv.wait_until(lock, wake);
+            }
+        }
+    }
+
+private:
+    double time_scale_;
+    double clock_ = 0;  // time_scale <= 0 时的模拟时钟
+    std::chrono::steady_clock::time_point epoch_;
+};
@@ -0,0 +1,595 @@
+#include "CapacitySimulator.h"
+
+#include "../../storagenode/hard_disc/HDD.h"
+#include "../../storagenode/hard_disc/SSD.h"
+#include "../../storagenode/optical/OpticalDiscLibrary.h"
+#include "../optical_manager/DiscLocationCatalog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+// 与各设备模型相同的换算：MB/s -> 字节/秒
+double BytesPerSec(double mbps) { return mbps * 1024.0 * 1024.0; }
+
+constexpr size_t kIngestWindowSlots = 64 * 1024;
+}  // namespace
+
+CapacitySimConfig CapacitySimConfig::fromModels(const OpticalDiscLibrary& library,
+                                                const HardDiskDrive& hdd,
+                                                const SolidStateDrive& ssd) {
+    CapacitySimConfig cfg;
+    cfg.drives_per_library = library.drive_count;
+    cfg.load_unload_seconds = library.load_unload_time;
+    cfg.ssd_write_MBps = ssd.write_throughput_MBps;
+    cfg.hdd_write_MBps = hdd.write_throughput_MBps;
+    cfg.hdd_staging_bytes = hdd.capacity;
+    return cfg;
+}
+
+CapacitySimConfig CapacitySimConfig::fromJson(const nlohmann::json& j) {
+    CapacitySimConfig cfg;
+    auto read = [&j](const char* key, auto& field) { field = j.value(key, field); };
+    read("libraries", cfg.libraries);
+    read("drives_per_library", cfg.drives_per_library);
+    read("robots_per_library", cfg.robots_per_library);
+    read("discs_per_library", cfg.discs_per_library);
+    read("load_unload_seconds", cfg.load_unload_seconds);
+    read("seek_seconds", cfg.seek_seconds);
+    read("image_bytes", cfg.image_bytes);
+    read("disc_write_MBps", cfg.disc_write_MBps);
+    read("disc_read_MBps", cfg.disc_read_MBps);
+    read("ssd_devices", cfg.ssd_devices);
+    read("ssd_write_MBps", cfg.ssd_write_MBps);
+    read("hdd_devices", cfg.hdd_devices);
+    read("hdd_write_MBps", cfg.hdd_write_MBps);
+    read("hdd_staging_bytes", cfg.hdd_staging_bytes);
+    read("flush_partial_image", cfg.flush_partial_image);
+    return cfg;
+}
+
+// ---------------- LatencyHistogram ----------------
+
+void LatencyHistogram::add(double seconds) {
+    ++count_;
+    if (seconds > 0) {
+        sum_ += seconds;
+        max_ = std::max(max_, seconds);
+    }
+    size_t idx = 0;
+    if (seconds >= std::ldexp(1.0, kMinExp)) {
+        int e = 0;
+        const double m = std::frexp(seconds, &e);  // seconds = m * 2^e，m ∈ [0.5, 1)
+        const int sub = std::min(kSubBuckets - 1, static_cast<int>((m * 2 - 1) * kSubBuckets));
+        const int64_t k = static_cast<int64_t>(e - 1 - kMinExp) * kSubBuckets + sub;
+        idx = static_cast<size_t>(std::min<int64_t>(k + 1, static_cast<int64_t>(kBuckets) - 1));
+    }
+    ++buckets_[idx];
+}
+
+double LatencyHistogram::quantile(double q) const {
+    if (count_ == 0) return 0;
+    const uint64_t target =
+        std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i];
+        if (seen < target) continue;
+        if (i == 0) return 0;
+        const size_t k = i - 1;
+        const int exp = kMinExp + static_cast<int>(k / kSubBuckets);
+        const double upper = std::ldexp(1.0 + static_cast<double>(k % kSubBuckets + 1) / kSubBuckets, exp);
+        return std::min(upper, max_);
+    }
+    return max_;
+}
+
+nlohmann::json LatencyHistogram::to_json() const {
+    nlohmann::json j;
+    j["count"] = count_;
+    j["mean"] = mean();
+    j["p50"] = quantile(0.5);
+    j["p90"] = quantile(0.9);
+    j["p99"] = quantile(0.99);
+    j["p999"] = quantile(0.999);
+    j["max"] = max_;
+    return j;
+}
+
+nlohmann::json CapacitySimReport::to_json() const {
+    nlohmann::json j;
+    j["makespan"] = makespan;
+    j["events"] = events;
+    j["wall_seconds"] = wall_seconds;
+    j["events_per_sec"] = wall_seconds > 0 ? static_cast<double>(events) / wall_seconds : 0;
+
+    auto& in = j["ingest"];
+    in["files"] = ingest_files;
+    in["bytes"] = ingest_bytes;
+    in["ssd_queue_delay"] = ssd_queue_delay.to_json();
+    in["hdd_queue_delay"] = hdd_queue_delay.to_json();
+    in["sealed_images"] = sealed_images;
+    in["burned_images"] = burned_images;
+    in["burned_bytes"] = burned_bytes;
+    in["unburned_bytes"] = unburned_bytes;
+    in["burn_queue_delay"] = burn_queue_delay.to_json();
+    in["peak_backlog_bytes"] = peak_backlog_bytes;
+    in["mean_backlog_bytes"] = mean_backlog_bytes;
+    in["peak_staging_bytes"] = peak_staging_bytes;
+    in["staging_overflow_seconds"] = staging_overflow_seconds;
+
+    auto& rc = j["recall"];
+    rc["requests"] = recalls;
+    rc["bytes"] = recall_bytes;
+    rc["failed"] = recall_failed;
+    rc["mounts"] = mounts;
+    rc["queue_delay"] = recall_queue_delay.to_json();
+    rc["latency"] = recall_latency.to_json();
+
+    j["drive_utilization"] = drive_utilization;
+    j["robot_utilization"] = robot_utilization;
+    j["libraries"] = nlohmann::json::array();
+    for (const auto& lib : libraries) {
+        nlohmann::json l;
+        l["burned_images"] = lib.burned_images;
+        l["recalls"] = lib.recalls;
+        l["mounts"] = lib.mounts;
+        l["drive_utilization"] = lib.drive_utilization;
+        l["robot_utilization"] = lib.robot_utilization;
+        j["libraries"].push_back(std::move(l));
+    }
+    return j;
+}
+
+// ---------------- 数据源 ----------------
+
+InodeBatchIngestSource::InodeBatchIngestSource(const std::string& inode_dir,
+                                               double files_per_sec,
+                                               InodeBatchReader::Options reader_opts)
+    : files_per_sec_(files_per_sec), reader_(reader_opts) {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(inode_dir, ec)) {
+        if (ec) break;
+        if (entry.is_regular_file(ec)) {
+            files_.push_back(entry.path());
+        }
+    }
+    std::sort(files_.begin(), files_.end());
+}
+
+bool InodeBatchIngestSource::refill() {
+    const uint64_t window = kIngestWindowSlots * InodeSlotView::kSlotSize;
+    while (file_idx_ < files_.size()) {
+        sizes_.clear();
+        pos_ = 0;
+        const auto& path = files_[file_idx_];
+        std::error_code ec;
+        const uint64_t file_bytes = fs::file_size(path, ec);
+        const uint64_t end = file_offset_ + window;
+        const bool ok = !ec && reader_.scan<std::vector<uint64_t>>(
+            path.string(), file_offset_, end,
+            [](const InodeSlotView& slot, std::vector<uint64_t>& acc) {
+                if (slot.file_type() == static_cast<uint8_t>(FileType::Regular) && slot.valid()) {
+                    acc.push_back(slot.file_size());
+                }
+            },
+            [this](std::vector<uint64_t>&& acc) {
+                sizes_.insert(sizes_.end(), acc.begin(), acc.end());
+                return true;
+            });
+        if (!ok || end >= file_bytes) {
+            ++file_idx_;
+            file_offset_ = 0;
+        } else {
+            file_offset_ = end;
+        }
+        if (!sizes_.empty()) return true;
+    }
+    return false;
+}
+
+bool InodeBatchIngestSource::next(IngestItem& item) {
+    if (pos_ >= sizes_.size() && !refill()) return false;
+    item.at = files_per_sec_ > 0 ? static_cast<double>(emitted_) / files_per_sec_ : 0;
+    item.bytes = sizes_[pos_++];
+    ++emitted_;
+    return true;
+}
+
+TraceRecallSource::TraceRecallSource(const std::string& path) : in_(path) {}
+
+bool TraceRecallSource::next(RecallItem& item) {
+    std::string line;
+    while (std::getline(in_, line)) {
+        const size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        std::istringstream ss(line);
+        std::string disc;
+        double at = 0;
+        uint64_t bytes = 0;
+        if (!(ss >> at >> disc >> bytes) || at < 0) {
+            ++malformed_;
+            continue;
+        }
+        uint32_t parsed = 0;
+        if (DiscLocationCatalog::ParseDiscId(disc, &parsed)) {
+            item.disc = parsed;
+        } else if (!disc.empty() && disc.find_first_not_of("0123456789") == std::string::npos) {
+            try {
+                item.disc = std::stoull(disc);
+            } catch (const std::out_of_range&) {
+                ++malformed_;
+                continue;
+            }
+        } else {
+            ++malformed_;
+            continue;
+        }
+        item.at = at;
+        item.bytes = bytes;
+        return true;
+    }
+    return false;
+}
+
+// ---------------- CapacitySimulator ----------------
+
+void CapacitySimulator::DevicePool::reset(uint32_t devices) {
+    free_at_.assign(std::max<uint32_t>(devices, 1), 0.0);
+}
+
+double CapacitySimulator::DevicePool::reserve(double now, double duration) {
+    auto later = std::greater<double>();
+    std::pop_heap(free_at_.begin(), free_at_.end(), later);
+    const double start = std::max(now, free_at_.back());
+    free_at_.back() = start + duration;
+    std::push_heap(free_at_.begin(), free_at_.end(), later);
+    return start;
+}
+
+CapacitySimulator::CapacitySimulator(CapacitySimConfig cfg)
+    : cfg_(cfg),
+      disc_write_Bps_(BytesPerSec(cfg.disc_write_MBps)),
+      disc_read_Bps_(BytesPerSec(cfg.disc_read_MBps)),
+      ssd_write_Bps_(BytesPerSec(cfg.ssd_write_MBps)),
+      hdd_write_Bps_(BytesPerSec(cfg.hdd_write_MBps)) {
+    cfg_.robots_per_library = std::max<uint32_t>(cfg_.robots_per_library, 1);
+    cfg_.image_bytes = std::max<uint64_t>(cfg_.image_bytes, 1);
+}
+
+void CapacitySimulator::push(double time, uint32_t type, uint32_t arg, uint64_t value) {
+    heap_.push_back(Event{time, seq_++, type, arg, value});
+    std::push_heap(heap_.begin(), heap_.end(), [](const Event& a, const Event& b) {
+        return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+    });
+}
+
+void CapacitySimulator::pullIngest() {
+    IngestItem item;
+    if (ingest_ && !ingest_done_ && ingest_->next(item)) {
+        push(std::max(item.at, now_), kIngestArrive, 0, item.bytes);
+        return;
+    }
+    ingest_done_ = true;
+    if (ingest_in_flight_ == 0) {
+        sealImages(now_, cfg_.flush_partial_image);
+        dispatchBurns(now_);
+    }
+}
+
+void CapacitySimulator::pullRecall() {
+    if (recall_src_ && recall_src_->next(next_recall_)) {
+        push(std::max(next_recall_.at, now_), kRecallArrive, 0, 0);
+    }
+}
+
+void CapacitySimulator::adjustBacklog(double now, int64_t backlog_delta, int64_t staging_delta) {
+    const double dt = now - last_backlog_change_;
+    backlog_area_ += static_cast<double>(backlog_bytes_) * dt;
+    if (staging_bytes_ > cfg_.hdd_staging_bytes) {
+        report_.staging_overflow_seconds += dt;
+    }
+    last_backlog_change_ = now;
+    backlog_bytes_ = static_cast<uint64_t>(static_cast<int64_t>(backlog_bytes_) + backlog_delta);
+    staging_bytes_ = static_cast<uint64_t>(static_cast<int64_t>(staging_bytes_) + staging_delta);
+    report_.peak_backlog_bytes = std::max(report_.peak_backlog_bytes, backlog_bytes_);
+    report_.peak_staging_bytes = std::max(report_.peak_staging_bytes, staging_bytes_);
+}
+
+void CapacitySimulator::onStaged(double now, uint64_t bytes) {
+    --ingest_in_flight_;
+    adjustBacklog(now, 0, static_cast<int64_t>(bytes));
+    unsealed_bytes_ += bytes;
+    sealImages(now, cfg_.flush_partial_image && ingest_done_ && ingest_in_flight_ == 0);
+    dispatchBurns(now);
+}
+
+void CapacitySimulator::sealImages(double now, bool flush) {
+    while (unsealed_bytes_ >= cfg_.image_bytes) {
+        burn_queue_.push_back(Image{now, cfg_.image_bytes});
+        unsealed_bytes_ -= cfg_.image_bytes;
+        ++report_.sealed_images;
+    }
+    if (flush && unsealed_bytes_ > 0) {
+        burn_queue_.push_back(Image{now, unsealed_bytes_});
+        unsealed_bytes_ = 0;
+        ++report_.sealed_images;
+    }
+}
+
+void CapacitySimulator::enqueueRecall(double now, const RecallItem& item) {
+    const uint64_t lib_idx = item.disc / std::max<uint32_t>(cfg_.discs_per_library, 1);
+    if (lib_idx >= libs_.size()) {
+        ++report_.recall_failed;
+        return;
+    }
+    Library& lib = libs_[lib_idx];
+    auto& reqs = lib.pending[item.disc];
+    if (reqs.empty()) {
+        lib.disc_fifo.push_back(item.disc);
+    }
+    reqs.push_back(PendingRecall{now, item.bytes});
+    dispatchLibrary(static_cast<uint32_t>(lib_idx), now);
+}
+
+double CapacitySimulator::acquire(Library& lib, uint32_t drive, uint64_t disc, double now) {
+    Drive& d = drives_[drive];
+    if (d.mounted == disc) return now;
+    // 换盘：占用最早空闲的机械手
+    auto robot = std::min_element(lib.robot_free.begin(), lib.robot_free.end());
+    const double begin = std::max(now, *robot);
+    *robot = begin + cfg_.load_unload_seconds;
+    lib.robot_busy_seconds += cfg_.load_unload_seconds;
+    if (d.mounted != kNoDisc) lib.mounted.erase(d.mounted);
+    d.mounted = disc;
+    lib.mounted[disc] = drive;
+    ++lib.mounts;
+    return begin + cfg_.load_unload_seconds;
+}
+
+bool CapacitySimulator::startRecall(uint32_t drive, uint64_t disc, double now) {
+    Library& lib = libs_[drives_[drive].lib];
+    auto it = lib.pending.find(disc);
+    if (it == lib.pending.end()) return false;
+    std::vector<PendingRecall> reqs = std::move(it->second);
+    lib.pending.erase(it);
+
+    double t = acquire(lib, drive, disc, now);
+    for (size_t i = 0; i < reqs.size(); ++i) {
+        if (i > 0) t += cfg_.seek_seconds;
+        t += static_cast<double>(reqs[i].bytes) / disc_read_Bps_;
+        report_.recall_queue_delay.add(now - reqs[i].at);
+        report_.recall_latency.add(t - reqs[i].at);
+        report_.recall_bytes += reqs[i].bytes;
+    }
+    report_.recalls += reqs.size();
+    lib.recalls += reqs.size();
+
+    Drive& d = drives_[drive];
+    d.busy = true;
+    d.busy_seconds += t - now;
+    push(t, kDriveFree, drive, 0);
+    return true;
+}
+
+void CapacitySimulator::startBurn(uint32_t drive, double now) {
+    const Image image = burn_queue_[burn_head_++];
+    if (burn_head_ * 2 > burn_queue_.size() && burn_head_ > 1024) {
+        burn_queue_.erase(burn_queue_.begin(), burn_queue_.begin() + static_cast<std::ptrdiff_t>(burn_head_));
+        burn_head_ = 0;
+    }
+    report_.burn_queue_delay.add(now - image.sealed_at);
+
+    Drive& d = drives_[drive];
+    Library& lib = libs_[d.lib];
+    const uint64_t blank = static_cast<uint64_t>(d.lib) * cfg_.discs_per_library + lib.blanks_used++;
+    const double end = acquire(lib, drive, blank, now) + static_cast<double>(image.bytes) / disc_write_Bps_;
+    d.busy = true;
+    d.busy_seconds += end - now;
+    push(end, kDriveFree, drive, image.bytes);
+}
+
+void CapacitySimulator::dispatchLibrary(uint32_t lib_idx, double now) {
+    Library& lib = libs_[lib_idx];
+    size_t pos = lib.fifo_head;
+    while (!lib.idle.empty() && pos < lib.disc_fifo.size()) {
+        const uint64_t disc = lib.disc_fifo[pos];
+        if (!lib.pending.count(disc)) {
+            // 已被服务过的盘，在队头时顺手丢掉
+            if (pos == lib.fifo_head) ++lib.fifo_head;
+            ++pos;
+            continue;
+        }
+        uint32_t drive = lib.idle.back();
+        auto mit = lib.mounted.find(disc);
+        if (mit != lib.mounted.end()) {
+            if (drives_[mit->second].busy) {
+                // 盘在忙碌的光驱里，等它读完当前批次后自己接着读
+                ++pos;
+                continue;
+            }
+            drive = mit->second;
+        }
+        lib.idle.erase(std::find(lib.idle.begin(), lib.idle.end(), drive));
+        --idle_drives_;
+        startRecall(drive, disc, now);
+        if (pos == lib.fifo_head) ++lib.fifo_head;
+        ++pos;
+    }
+    while (lib.fifo_head < lib.disc_fifo.size() && !lib.pending.count(lib.disc_fifo[lib.fifo_head])) {
+        ++lib.fifo_head;
+    }
+    if (lib.fifo_head > 1024 && lib.fifo_head * 2 > lib.disc_fifo.size()) {
+        lib.disc_fifo.erase(lib.disc_fifo.begin(), lib.disc_fifo.begin() + static_cast<std::ptrdiff_t>(lib.fifo_head));
+        lib.fifo_head = 0;
+    }
+}
+
+void CapacitySimulator::dispatchBurns(double now) {
+    const uint32_t n = static_cast<uint32_t>(libs_.size());
+    while (burn_head_ < burn_queue_.size() && idle_drives_ > 0) {
+        bool started = false;
+        for (uint32_t i = 0; i < n; ++i) {
+            const uint32_t lib_idx = (burn_cursor_ + i) % n;
+            Library& lib = libs_[lib_idx];
+            if (lib.idle.empty() || lib.blanks_used >= cfg_.discs_per_library) continue;
+            const uint32_t drive = lib.idle.back();
+            lib.idle.pop_back();
+            --idle_drives_;
+            startBurn(drive, now);
+            burn_cursor_ = (lib_idx + 1) % n;
+            started = true;
+            break;
+        }
+        if (!started) break;
+    }
+}
+
+void CapacitySimulator::releaseDrive(uint32_t drive) {
+    Drive& d = drives_[drive];
+    d.busy = false;
+    libs_[d.lib].idle.push_back(drive);
+    ++idle_drives_;
+}
+
+CapacitySimReport CapacitySimulator::run(IngestSource* ingest, RecallSource* recalls) {
+    const auto wall_start = std::chrono::steady_clock::now();
+    report_ = CapacitySimReport{};
+    ingest_ = ingest;
+    recall_src_ = recalls;
+    now_ = 0;
+    heap_.clear();
+    seq_ = 0;
+    burn_queue_.clear();
+    burn_head_ = 0;
+    burn_cursor_ = 0;
+    unsealed_bytes_ = 0;
+    ingest_in_flight_ = 0;
+    ingest_done_ = false;
+    backlog_bytes_ = 0;
+    staging_bytes_ = 0;
+    backlog_area_ = 0;
+    last_backlog_change_ = 0;
+    ssd_.reset(cfg_.ssd_devices);
+    hdd_.reset(cfg_.hdd_devices);
+
+    drives_.assign(static_cast<size_t>(cfg_.libraries) * cfg_.drives_per_library, Drive{});
+    libs_.assign(cfg_.libraries, Library{});
+    idle_drives_ = static_cast<uint32_t>(drives_.size());
+    for (uint32_t l = 0; l < cfg_.libraries; ++l) {
+        Library& lib = libs_[l];
+        lib.robot_free.assign(cfg_.robots_per_library, 0.0);
+        for (uint32_t i = cfg_.drives_per_library; i-- > 0;) {
+            const uint32_t drive = l * cfg_.drives_per_library + i;
+            drives_[drive].lib = l;
+            lib.idle.push_back(drive);  // 小号光驱在栈顶，先被使用
+        }
+    }
+
+    pullIngest();
+    pullRecall();
+
+    const auto later = [](const Event& a, const Event& b) {
+        return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+    };
+    while (!heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), later);
+        const Event ev = heap_.back();
+        heap_.pop_back();
+        now_ = ev.time;
+        ++report_.events;
+
+        switch (ev.type) {
+        case kIngestArrive: {
+            ++report_.ingest_files;
+            report_.ingest_bytes += ev.value;
+            adjustBacklog(now_, static_cast<int64_t>(ev.value), 0);
+            const double duration = static_cast<double>(ev.value) / ssd_write_Bps_;
+            const double start = ssd_.reserve(now_, duration);
+            report_.ssd_queue_delay.add(start - now_);
+            ++ingest_in_flight_;
+            push(start + duration, kSsdWritten, 0, ev.value);
+            pullIngest();
+            break;
+        }
+        case kSsdWritten: {
+            const double duration = static_cast<double>(ev.value) / hdd_write_Bps_;
+            const double start = hdd_.reserve(now_, duration);
+            report_.hdd_queue_delay.add(start - now_);
+            push(start + duration, kStaged, 0, ev.value);
+            break;
+        }
+        case kStaged:
+            onStaged(now_, ev.value);
+            break;
+        case kRecallArrive: {
+            const RecallItem item = next_recall_;
+            pullRecall();
+            enqueueRecall(now_, item);
+            break;
+        }
+        case kDriveFree: {
+            Drive& d = drives_[ev.arg];
+            Library& lib = libs_[d.lib];
+            if (ev.value > 0) {
+                ++report_.burned_images;
+                ++lib.burned_images;
+                report_.burned_bytes += ev.value;
+                adjustBacklog(now_, -static_cast<int64_t>(ev.value), -static_cast<int64_t>(ev.value));
+            }
+            // 已装在本驱的盘又有新请求时直接接着读，不换盘
+            if (d.mounted != kNoDisc && lib.pending.count(d.mounted)) {
+                startRecall(ev.arg, d.mounted, now_);
+                dispatchLibrary(d.lib, now_);
+                break;
+            }
+            releaseDrive(ev.arg);
+            dispatchLibrary(d.lib, now_);
+            dispatchBurns(now_);
+            break;
+        }
+        }
+    }
+
+    adjustBacklog(now_, 0, 0);
+    report_.makespan = now_;
+    report_.mean_backlog_bytes = now_ > 0 ? backlog_area_ / now_ : 0;
+    report_.unburned_bytes = backlog_bytes_;
+
+    double drive_busy = 0;
+    double robot_busy = 0;
+    report_.libraries.resize(libs_.size());
+    for (size_t l = 0; l < libs_.size(); ++l) {
+        auto& out = report_.libraries[l];
+        out.burned_images = libs_[l].burned_images;
+        out.recalls = libs_[l].recalls;
+        out.mounts = libs_[l].mounts;
+        out.robot_busy_seconds = libs_[l].robot_busy_seconds;
+        for (uint32_t i = 0; i < cfg_.drives_per_library; ++i) {
+            out.drive_busy_seconds += drives_[l * cfg_.drives_per_library + i].busy_seconds;
+        }
+        if (now_ > 0) {
+            out.drive_utilization = cfg_.drives_per_library
+                                        ? out.drive_busy_seconds / (now_ * cfg_.drives_per_library)
+                                        : 0;
+            out.robot_utilization = out.robot_busy_seconds / (now_ * cfg_.robots_per_library);
+        }
+        drive_busy += out.drive_busy_seconds;
+        robot_busy += out.robot_busy_seconds;
+        report_.mounts += out.mounts;
+    }
+    if (now_ > 0 && !drives_.empty()) {
+        report_.drive_utilization = drive_busy / (now_ * static_cast<double>(drives_.size()));
+        report_.robot_utilization = robot_busy / (now_ * cfg_.robots_per_library * static_cast<double>(libs_.size()));
+    }
+    report_.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+    ingest_ = nullptr;
+    recall_src_ = nullptr;
+    return std::move(report_);
+}
@@ -0,0 +1,322 @@
+#pragma once
+#include "../../storagenode/StorageTypes.h"
+#include "../../mds/inode/InodeBatchReader.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+class OpticalDiscLibrary;
+class HardDiskDrive;
+class SolidStateDrive;
+
+// 容量规划用的离散事件模拟器。
+// 把 SSD/HDD/光盘库各自的耗时模型（吞吐率、装卸盘时间）放到同一条模拟时钟上：
+//   - 写入流：文件到达 -> SSD 写入 -> 拷到 HDD 暂存 -> 凑满一张盘封装成镜像 -> 排队等光驱刻录；
+//   - 回调流：请求到达 -> 在盘所在的库排队 -> 光驱装盘（机械手装卸）-> 读出。
+// 同一张盘上排队的回调在一次装盘内顺序读完（与 RecallScheduler 一致），光驱空闲时优先服务本库回调，
+// 其次刻录。SSD/HDD 层按设备池先到先服务，机械手按库预约。
+// 事件是定长的 POD，放在二叉堆里；输入按需从数据源拉取，堆里每个数据源最多只有一个待到达事件，
+// 因此内存只与资源数和排队长度有关，与回放的文件总数无关。
+struct CapacitySimConfig {
+    uint32_t libraries = 1;
+    uint32_t drives_per_library = OPTICAL_LIBRARY_DRIVE_COUNT;
+    uint32_t robots_per_library = 1;
+    uint32_t discs_per_library = OPTICAL_LIBRARY_DISC_NUM;   // 每库空白盘数，刻满后该库不再接收刻录
+    double load_unload_seconds = OPTICAL_LIBRARY_LOAD_TIME;  // 换一次盘的机械手时间
+    double seek_seconds = 0.05;                              // 同一次装盘内相邻两个回调之间的寻道时间
+    uint64_t image_bytes = OPTICAL_DISC_CAPACITY;            // 每张镜像（每张盘）的大小
+    double disc_write_MBps = OPTICAL_DISC_WRITE_MBPS;
+    double disc_read_MBps = OPTICAL_DISC_READ_MBPS;
+
+    uint32_t ssd_devices = 1;
+    double ssd_write_MBps = SSD_DEFAULT_WRITE_MBPS;
+    uint32_t hdd_devices = 1;
+    double hdd_write_MBps = HDD_DEFAULT_WRITE_MBPS;
+    uint64_t hdd_staging_bytes = HDD_DEFAULT_CAPACITY;  // 只用于报告暂存溢出，不对写入限流
+
+    bool flush_partial_image = true;  // 写入流结束后把不满一张盘的余量也封装刻录
+
+    // 直接取设备模型对象上的参数；库数量、设备数量等拓扑仍用默认值，由调用方再改
+    static CapacitySimConfig fromModels(const OpticalDiscLibrary& library,
+                                        const HardDiskDrive& hdd,
+                                        const SolidStateDrive& ssd);
+
+    // 从 JSON 对象读取，键名与字段名相同；缺省的键保留默认值，类型不符时抛 nlohmann::json 异常
+    static CapacitySimConfig fromJson(const nlohmann::json& j);
+};
+
+// 对数分桶直方图：每个 2 的幂区间再分 kSubBuckets 份，分位数相对误差约 1/kSubBuckets，
+// 内存固定，适合上亿个样本。
+class LatencyHistogram {
+public:
+    void add(double seconds);
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ / static_cast<double>(count_) : 0; }
+    double max() const { return max_; }
+    double quantile(double q) const;
+    nlohmann::json to_json() const;
+
+private:
+    static constexpr int kSubBuckets = 32;
+    static constexpr int kMinExp = -20;  // ~1us
+    static constexpr int kMaxExp = 40;   // ~3.5 万年
+    static constexpr size_t kBuckets = static_cast<size_t>(kMaxExp - kMinExp) * kSubBuckets + 1;
+
+    std::vector<uint64_t> buckets_ = std::vector<uint64_t>(kBuckets, 0);  // 0 号桶存 0 及极小值
+    uint64_t count_ = 0;
+    double sum_ = 0;
+    double max_ = 0;
+};
+
+struct CapacitySimReport {
+    struct Library {
+        uint64_t burned_images = 0;
+        uint64_t recalls = 0;
+        uint64_t mounts = 0;
+        double drive_busy_seconds = 0;
+        double robot_busy_seconds = 0;
+        double drive_utilization = 0;
+        double robot_utilization = 0;
+    };
+
+    double makespan = 0;  // 最后一个事件的模拟时间（秒）
+    uint64_t events = 0;
+    double wall_seconds = 0;
+
+    // 写入流
+    uint64_t ingest_files = 0;
+    uint64_t ingest_bytes = 0;
+    LatencyHistogram ssd_queue_delay;
+    LatencyHistogram hdd_queue_delay;
+    uint64_t sealed_images = 0;
+    uint64_t burned_images = 0;
+    uint64_t burned_bytes = 0;
+    uint64_t unburned_bytes = 0;       // 结束时仍未上盘（没有空白盘或未封装）
+    LatencyHistogram burn_queue_delay;  // 镜像封装到拿到光驱
+    uint64_t peak_backlog_bytes = 0;    // 已到达未上盘的字节数峰值
+    double mean_backlog_bytes = 0;      // 按时间加权
+    uint64_t peak_staging_bytes = 0;    // HDD 上已暂存未上盘的字节数峰值
+    double staging_overflow_seconds = 0;  // 暂存超过 hdd_staging_bytes 的累计时间
+
+    // 回调流
+    uint64_t recalls = 0;
+    uint64_t recall_bytes = 0;
+    uint64_t recall_failed = 0;  // 盘号超出库范围
+    uint64_t mounts = 0;
+    LatencyHistogram recall_queue_delay;  // 到达到分到光驱
+    LatencyHistogram recall_latency;      // 到达到读完
+
+    double drive_utilization = 0;
+    double robot_utilization = 0;
+    std::vector<Library> libraries;
+
+    nlohmann::json to_json() const;
+};
+
+struct IngestItem {
+    double at = 0;
+    uint64_t bytes = 0;
+};
+
+struct RecallItem {
+    double at = 0;
+    uint64_t disc = 0;  // 全局盘号，所在库 = disc / discs_per_library
+    uint64_t bytes = 0;
+};
+
+// 数据源按到达时间非递减给出条目；早于当前模拟时间的条目按当前时间处理
+class IngestSource {
+public:
+    virtual ~IngestSource() = default;
+    virtual bool next(IngestItem& item) = 0;
+};
+
+class RecallSource {
+public:
+    virtual ~RecallSource() = default;
+    virtual bool next(RecallItem& item) = 0;
+};
+
+class VectorIngestSource : public IngestSource {
+public:
+    explicit VectorIngestSource(std::vector<IngestItem> items) : items_(std::move(items)) {}
+    bool next(IngestItem& item) override {
+        if (pos_ >= items_.size()) return false;
+        item = items_[pos_++];
+        return true;
+    }
+
+private:
+    std::vector<IngestItem> items_;
+    size_t pos_ = 0;
+};
+
+class VectorRecallSource : public RecallSource {
+public:
+    explicit VectorRecallSource(std::vector<RecallItem> items) : items_(std::move(items)) {}
+    bool next(RecallItem& item) override {
+        if (pos_ >= items_.size()) return false;
+        item = items_[pos_++];
+        return true;
+    }
+
+private:
+    std::vector<RecallItem> items_;
+    size_t pos_ = 0;
+};
+
+// 回放 inode 批文件目录：按文件名顺序读出所有普通文件 inode，以 files_per_sec 的速率匀速到达
+// （0 表示全部在 0 时刻到达）。批文件用 InodeBatchReader 分窗口读取，不整体载入内存。
+class InodeBatchIngestSource : public IngestSource {
+public:
+    InodeBatchIngestSource(const std::string& inode_dir,
+                           double files_per_sec,
+                           InodeBatchReader::Options reader_opts = {});
+    bool next(IngestItem& item) override;
+    uint64_t files() const { return emitted_; }
+
+private:
+    bool refill();
+
+    std::vector<std::filesystem::path> files_;
+    size_t file_idx_ = 0;
+    uint64_t file_offset_ = 0;
+    double files_per_sec_;
+    InodeBatchReader reader_;
+    std::vector<uint64_t> sizes_;
+    size_t pos_ = 0;
+    uint64_t emitted_ = 0;
+};
+
+// 文本回调轨迹，每行 "<到达秒数> <盘号> <字节数>"，盘号可写成数字或 disc_XXXXXXXXXX；
+// 空行和 # 开头的行忽略，格式错误的行跳过并计数。
+class TraceRecallSource : public RecallSource {
+public:
+    explicit TraceRecallSource(const std::string& path);
+    bool ok() const { return static_cast<bool>(in_); }
+    bool next(RecallItem& item) override;
+    uint64_t malformed() const { return malformed_; }
+
+private:
+    std::ifstream in_;
+    uint64_t malformed_ = 0;
+};
+
+class CapacitySimulator {
+public:
+    explicit CapacitySimulator(CapacitySimConfig cfg);
+
+    // 两个数据源都可为空；一次运行从空系统开始
+    CapacitySimReport run(IngestSource* ingest, RecallSource* recalls);
+
+private:
+    enum EventType : uint32_t {
+        kIngestArrive,
+        kSsdWritten,
+        kStaged,
+        kRecallArrive,
+        kDriveFree,
+    };
+
+    struct Event {
+        double time;
+        uint64_t seq;    // 同一时刻按入堆顺序处理，保证结果确定
+        uint32_t type;
+        uint32_t arg;    // kDriveFree: 光驱下标
+        uint64_t value;  // 字节数
+    };
+
+    struct PendingRecall {
+        double at;
+        uint64_t bytes;
+    };
+
+    struct Drive {
+        uint32_t lib = 0;
+        uint64_t mounted = kNoDisc;
+        bool busy = false;
+        double busy_seconds = 0;
+    };
+
+    struct Library {
+        std::vector<uint32_t> idle;          // 空闲光驱下标
+        std::vector<double> robot_free;      // 每个机械手的空闲时刻
+        double robot_busy_seconds = 0;
+        uint32_t blanks_used = 0;
+        // 有待读请求的盘：按第一次到达排队，队列里已被服务的盘惰性删除
+        std::vector<uint64_t> disc_fifo;
+        size_t fifo_head = 0;
+        std::unordered_map<uint64_t, std::vector<PendingRecall>> pending;
+        std::unordered_map<uint64_t, uint32_t> mounted;  // 盘 -> 光驱
+        uint64_t burned_images = 0;
+        uint64_t recalls = 0;
+        uint64_t mounts = 0;
+    };
+
+    struct Image {
+        double sealed_at;
+        uint64_t bytes;
+    };
+
+    // 先到先服务的设备池：返回开始服务的时刻
+    class DevicePool {
+    public:
+        void reset(uint32_t devices);
+        double reserve(double now, double duration);
+
+    private:
+        std::vector<double> free_at_;  // 小顶堆
+    };
+
+    static constexpr uint64_t kNoDisc = UINT64_MAX;
+
+    void push(double time, uint32_t type, uint32_t arg, uint64_t value);
+    void pullIngest();
+    void pullRecall();
+    void onStaged(double now, uint64_t bytes);
+    void sealImages(double now, bool flush);
+    void enqueueRecall(double now, const RecallItem& item);
+    void dispatchLibrary(uint32_t lib, double now);
+    void dispatchBurns(double now);
+    bool startRecall(uint32_t drive, uint64_t disc, double now);
+    void startBurn(uint32_t drive, double now);
+    double acquire(Library& lib, uint32_t drive, uint64_t disc, double now);
+    void releaseDrive(uint32_t drive);
+    void adjustBacklog(double now, int64_t backlog_delta, int64_t staging_delta);
+
+    CapacitySimConfig cfg_;
+    double disc_write_Bps_;
+    double disc_read_Bps_;
+    double ssd_write_Bps_;
+    double hdd_write_Bps_;
+
+    // 以下为单次运行的状态
+    IngestSource* ingest_ = nullptr;
+    RecallSource* recall_src_ = nullptr;
+    RecallItem next_recall_;  // 堆里唯一的待到达回调
+    double now_ = 0;
+    std::vector<Event> heap_;
+    uint64_t seq_ = 0;
+    std::vector<Drive> drives_;
+    std::vector<Library> libs_;
+    uint32_t idle_drives_ = 0;
+    uint32_t burn_cursor_ = 0;  // 刻录按库轮转分配
+    DevicePool ssd_;
+    DevicePool hdd_;
+    std::vector<Image> burn_queue_;
+    size_t burn_head_ = 0;
+    uint64_t unsealed_bytes_ = 0;
+    uint64_t ingest_in_flight_ = 0;
+    bool ingest_done_ = false;
+    uint64_t backlog_bytes_ = 0;
+    uint64_t staging_bytes_ = 0;
+    double backlog_area_ = 0;
+    double last_backlog_change_ = 0;
+    CapacitySimReport report_;
+};
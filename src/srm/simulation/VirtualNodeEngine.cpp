@@ -17,6 +17,7 @@ VirtualNodeEngine::VirtualNodeEngine(SimulationConfig cfg)
       failure_dist_(0.0, 1.0) {}
 
 void VirtualNodeEngine::SimulateWrite(const storagenode::WriteRequest* req,
+                                      const butil::IOBuf* attachment,
                                       storagenode::WriteReply* resp) {
     if (!resp) {
         return;
@@ -27,13 +28,26 @@ void VirtualNodeEngine::SimulateWrite(const storagenode::WriteRequest* req,
     }
     AddLatency();
     // Compute checksum to mimic work
-    (void)butil::crc32c::Value(req->data().data(), req->data().size());
-    resp->set_bytes_written(static_cast<uint64_t>(req->data().size()));
+    uint64_t written = 0;
+    if (attachment && !attachment->empty()) {
+        uint32_t crc = 0;
+        for (size_t i = 0; i < attachment->backing_block_num(); ++i) {
+            auto block = attachment->backing_block(i);
+            crc = butil::crc32c::Extend(crc, block.data(), block.size());
+        }
+        (void)crc;
+        written = attachment->size();
+    } else {
+        (void)butil::crc32c::Value(req->data().data(), req->data().size());
+        written = req->data().size();
+    }
+    resp->set_bytes_written(written);
     FillStatus(resp->mutable_status(), rpc::STATUS_SUCCESS, "");
 }
 
 void VirtualNodeEngine::SimulateRead(const storagenode::ReadRequest* req,
-                                     storagenode::ReadReply* resp) {
+                                     storagenode::ReadReply* resp,
+                                     butil::IOBuf* attachment) {
     if (!resp) {
         return;
     }
@@ -44,10 +58,13 @@ void VirtualNodeEngine::SimulateRead(const storagenode::ReadRequest* req,
     AddLatency();
     uint64_t len = req && req->length() > 0 ? req->length() : cfg_.default_read_size;
     std::string data(static_cast<size_t>(len), '\0');
-    resp->mutable_data()->swap(data);
     resp->set_bytes_read(len);
-    resp->set_checksum(butil::crc32c::Value(resp->data().data(),
-                                            static_cast<size_t>(len)));
+    resp->set_checksum(butil::crc32c::Value(data.data(), data.size()));
+    if (attachment && req && req->attachment()) {
+        attachment->append(data);
+    } else {
+        resp->mutable_data()->swap(data);
+    }
     FillStatus(resp->mutable_status(), rpc::STATUS_SUCCESS, "");
 }
 
@@ -3,6 +3,8 @@
 #include <random>
 #include <string>
 
+#include <butil/iobuf.h>
+
 #include "SimulationConfig.h"
 #include "storage_node.pb.h"
 
@@ -10,11 +12,15 @@ class VirtualNodeEngine {
 public:
     explicit VirtualNodeEngine(SimulationConfig cfg);
 
+    // attachment carries the payload when non-empty; req->data() otherwise.
     void SimulateWrite(const storagenode::WriteRequest* req,
+                       const butil::IOBuf* attachment,
                        storagenode::WriteReply* resp);
 
+    // Fills attachment instead of resp->data when req->attachment() is set.
     void SimulateRead(const storagenode::ReadRequest* req,
-                      storagenode::ReadReply* resp);
+                      storagenode::ReadReply* resp,
+                      butil::IOBuf* attachment);
 
     void SimulateTruncate(const storagenode::TruncateRequest* req,
                           storagenode::TruncateReply* resp);
@@ -94,18 +94,12 @@ bool InodeBatchMonitor::ProcessFile(const std::string& filename, std::unordered_
         return false;
     }
     const fs::path path = fs::path(dir_) / filename;
-    std::ifstream in(path, std::ios::binary);
-    if (!in.is_open()) {
-        return false;
-    }
-    in.seekg(0, std::ios::end);
-    const std::streamoff end_pos = in.tellg();
-    if (end_pos <= 0) {
+    std::error_code ec;
+    const uint64_t slot_size = InodeSlotView::kSlotSize;
+    uint64_t file_size = fs::file_size(path, ec);
+    if (ec || file_size == 0) {
         return false;
     }
-
-    const uint64_t slot_size = InodeStorage::INODE_DISK_SLOT_SIZE;
-    uint64_t file_size = static_cast<uint64_t>(end_pos);
     file_size -= (file_size % slot_size);
 
     uint64_t offset = 0;
@@ -121,27 +115,37 @@ bool InodeBatchMonitor::ProcessFile(const std::string& filename, std::unordered_
         return false;
     }
 
-    in.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
-    std::vector<uint8_t> slot(static_cast<size_t>(slot_size));
+    // The ledger only needs location and size, so workers decode just those header fields.
+    // Usage is applied in file order because device consumption depends on it.
+    struct Usage {
+        uint8_t node_type;
+        uint16_t node_index;
+        uint64_t bytes;
+    };
     bool any_touched = false;
-    while (offset + slot_size <= file_size) {
-        in.read(reinterpret_cast<char*>(slot.data()), static_cast<std::streamsize>(slot_size));
-        if (in.gcount() != static_cast<std::streamsize>(slot_size)) {
-            break;
-        }
-        size_t off = 0;
-        Inode inode;
-        if (Inode::deserialize(slot.data(), off, inode, slot_size)) {
-            std::string node_id;
-            if (ledger_->ApplyInode(inode, &node_id) && !node_id.empty()) {
-                touched->insert(node_id);
-                any_touched = true;
+    const bool ok = reader_.scan<std::vector<Usage>>(
+        path.string(), offset, file_size,
+        [](const InodeSlotView& slot, std::vector<Usage>& out) {
+            if (slot.valid()) {
+                out.push_back({slot.node_type(), slot.node_id(), slot.file_size()});
             }
-        }
-        offset += slot_size;
+        },
+        [&](std::vector<Usage>&& batch) {
+            for (const auto& usage : batch) {
+                std::string node_id;
+                if (ledger_->ApplyUsage(usage.node_type, usage.node_index, usage.bytes, &node_id) &&
+                    !node_id.empty()) {
+                    touched->insert(node_id);
+                    any_touched = true;
+                }
+            }
+            return true;
+        });
+    if (!ok) {
+        return false;
     }
 
-    offsets_[filename] = offset;
+    offsets_[filename] = file_size;
     checkpoint_dirty_ = true;
     return any_touched;
 }
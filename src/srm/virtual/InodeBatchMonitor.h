@@ -10,6 +10,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "mds/inode/InodeBatchReader.h"
 #include "virtual/VirtualNodeLedger.h"
 
 class InodeBatchMonitor {
@@ -44,6 +45,7 @@ private:
     std::atomic<bool> running_{false};
     std::thread thread_;
 
+    InodeBatchReader reader_;
     std::unordered_map<std::string, uint64_t> offsets_;
     bool checkpoint_dirty_{false};
 };
@@ -278,9 +278,15 @@ bool VirtualNodeLedger::GetNodeCapacity(const std::string& node_id, uint64_t* to
 }
 
 bool VirtualNodeLedger::ApplyInode(const Inode& inode, std::string* out_node_id) {
-    const uint8_t type = static_cast<uint8_t>(inode.location_id.fields.node_type & 0x03);
-    const uint16_t idx = inode.location_id.fields.node_id;
-    const uint64_t bytes = inode.getFileSize();
+    return ApplyUsage(static_cast<uint8_t>(inode.location_id.fields.node_type),
+                      inode.location_id.fields.node_id,
+                      inode.getFileSize(),
+                      out_node_id);
+}
+
+bool VirtualNodeLedger::ApplyUsage(uint8_t node_type, uint16_t node_index, uint64_t bytes, std::string* out_node_id) {
+    const uint8_t type = static_cast<uint8_t>(node_type & 0x03);
+    const uint16_t idx = node_index;
 
     std::lock_guard<std::mutex> lk(mu_);
     const std::string node_id = ResolveNodeId(idx, type);
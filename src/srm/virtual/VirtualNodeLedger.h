@@ -26,6 +26,8 @@ public:
 
     // Apply inode allocation; returns resolved node_id when success.
     bool ApplyInode(const Inode& inode, std::string* out_node_id);
+    // Same as ApplyInode, for callers that only decoded the location and size fields.
+    bool ApplyUsage(uint8_t node_type, uint16_t node_index, uint64_t bytes, std::string* out_node_id);
 
     bool TakeDirty();
 
@@ -11,6 +11,7 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
+#include <stdlib.h>
 #include <unistd.h>
 #endif
 
@@ -21,6 +22,20 @@ uint64_t NowMs() {
         std::chrono::system_clock::now().time_since_epoch()).count());
 }
 
+// 1-minute load average per CPU; 0 where it is not available.
+double CpuUsage() {
+#ifdef _WIN32
+    return 0.0;
+#else
+    double load = 0.0;
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (getloadavg(&load, 1) != 1 || cpus <= 0) {
+        return 0.0;
+    }
+    return load / static_cast<double>(cpus);
+#endif
+}
+
 } // namespace
 
 NodeAgent::NodeAgent(std::string srm_addr,
@@ -132,10 +147,10 @@ bool NodeAgent::DoHeartbeat() {
 
     req.set_node_id(node_id_);
     req.set_timestamp_ms(NowMs());
-    // TODO: add real metrics when available
-    req.set_cpu_usage(0.0);
+    // Clients use cpu_usage and in_flight_io to choose between replicas.
+    req.set_cpu_usage(CpuUsage());
     req.set_mem_usage(0.0);
-    req.set_in_flight_io(0);
+    req.set_in_flight_io(in_flight_probe_ ? in_flight_probe_() : 0);
 
     stub_->Heartbeat(&cntl, &req, &resp, nullptr);
     if (cntl.Failed()) {
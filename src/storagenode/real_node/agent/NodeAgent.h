@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <thread>
@@ -26,6 +27,10 @@ public:
     void Start();
     void Stop();
 
+    // Source of the in-flight request count reported with each heartbeat.
+    // Set before Start().
+    void SetInFlightProbe(std::function<uint64_t()> probe) { in_flight_probe_ = std::move(probe); }
+
 private:
     void Run();
     bool DoRegister();
@@ -47,4 +52,5 @@ private:
     std::thread worker_;
     std::atomic<bool> running_{false};
     std::string node_id_;
+    std::function<uint64_t()> in_flight_probe_;
 };
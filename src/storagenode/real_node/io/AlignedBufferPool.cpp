@@ -0,0 +1,45 @@
+#include "AlignedBufferPool.h"
+
+#include <cstdlib>
+#include <iostream>
+
+AlignedBufferPool::AlignedBufferPool(size_t count, size_t size, size_t alignment)
+    : size_(size), alignment_(alignment) {
+    if (count == 0 || size == 0) {
+        return;
+    }
+    void* slab = nullptr;
+    if (::posix_memalign(&slab, alignment_, count * size_) != 0) {
+        std::cerr << "[AlignedBufferPool] failed to allocate " << count << "x" << size_
+                  << " bytes" << std::endl;
+        return;
+    }
+    slab_ = static_cast<char*>(slab);
+    free_.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        free_.push_back(slab_ + i * size_);
+    }
+}
+
+AlignedBufferPool::~AlignedBufferPool() {
+    std::free(slab_);
+}
+
+char* AlignedBufferPool::Acquire() {
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [this] { return !free_.empty(); });
+    char* buf = free_.back();
+    free_.pop_back();
+    return buf;
+}
+
+void AlignedBufferPool::Release(char* buf) {
+    if (!buf) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        free_.push_back(buf);
+    }
+    cv_.notify_one();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Fixed set of aligned I/O buffers carved from one slab, used by IOEngine's
+// O_DIRECT path. Acquire blocks while all buffers are in use, which caps the
+// memory spent on in-flight direct I/O at count * size.
+class AlignedBufferPool {
+public:
+    AlignedBufferPool(size_t count, size_t size, size_t alignment);
+    ~AlignedBufferPool();
+
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+    // False when the slab could not be allocated.
+    bool ok() const { return slab_ != nullptr; }
+
+    char* Acquire();
+    void Release(char* buf);
+
+    size_t buffer_size() const { return size_; }
+    size_t alignment() const { return alignment_; }
+
+private:
+    size_t size_;
+    size_t alignment_;
+    char* slab_{nullptr};
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<char*> free_;
+};
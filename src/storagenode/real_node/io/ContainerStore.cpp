@@ -0,0 +1,958 @@
+#include "ContainerStore.h"
+
+#include <fcntl.h>
+#include <linux/falloc.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <unordered_set>
+
+#include "common/Crc32c.h"
+#include "common/FileUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t kRecordMagic = 0x5a42434e;  // "NCBZ"
+
+constexpr uint8_t kWrite = 1;     // offset = chunk offset
+constexpr uint8_t kTruncate = 2;  // offset = new size
+constexpr uint8_t kRemove = 3;    // offset = horizon, see Collect
+constexpr uint8_t kReplace = 4;   // offset = size; payload = extent table + data
+constexpr uint8_t kSeal = 5;
+
+// All on-disk integers are in host byte order, like the chunk manifest.
+struct RecordHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved[3];
+    uint64_t chunk_id;
+    uint64_t offset;
+    uint32_t length;    // payload bytes after the header
+    uint32_t data_crc;  // CRC32C of the payload
+    uint32_t reserved2;
+    uint32_t crc;       // CRC32C of the header with crc = 0
+};
+static_assert(sizeof(RecordHeader) == 40, "container record header layout");
+
+// One entry per extent at the start of a REPLACE payload; the data of all
+// extents follows the table in the same order.
+struct ReplaceEntry {
+    uint64_t offset;
+    uint32_t length;
+    uint32_t reserved;
+};
+static_assert(sizeof(ReplaceEntry) == 16, "replace entry layout");
+
+constexpr uint64_t kHeaderBytes = sizeof(RecordHeader);
+constexpr uint64_t kHorizonHere = std::numeric_limits<uint64_t>::max();
+
+uint64_t RecordBytes(uint64_t payload) { return (kHeaderBytes + payload + 7) & ~uint64_t{7}; }
+
+uint32_t HeaderCrc(RecordHeader h) {
+    h.crc = 0;
+    return Crc32c(&h, sizeof(h));
+}
+
+bool ValidHeader(const RecordHeader& h, uint64_t pos, uint64_t file_size) {
+    return h.magic == kRecordMagic && h.type >= kWrite && h.type <= kSeal &&
+           pos + kHeaderBytes + h.length <= file_size && HeaderCrc(h) == h.crc;
+}
+
+struct ScannedRecord {
+    RecordHeader hdr;
+    uint64_t pos;
+};
+
+ssize_t PreadFull(int fd, char* dst, size_t length, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd, dst + done, length - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+// Writes every byte of iov at offset, in IOV_MAX batches and across short writes.
+bool PwritevFull(int fd, std::vector<iovec> iov, uint64_t offset) {
+    size_t first = 0;
+    while (first < iov.size()) {
+        if (iov[first].iov_len == 0) {
+            ++first;
+            continue;
+        }
+        const int cnt = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        ssize_t n = ::pwritev(fd, &iov[first], cnt, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        offset += static_cast<uint64_t>(n);
+        size_t left = static_cast<size_t>(n);
+        while (left > 0 && first < iov.size()) {
+            const size_t take = std::min(left, iov[first].iov_len);
+            iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + take;
+            iov[first].iov_len -= take;
+            left -= take;
+            if (iov[first].iov_len == 0) {
+                ++first;
+            }
+        }
+    }
+    return true;
+}
+
+// Reads the record headers of a container in order. A record that fails its
+// header check is skipped by searching forward for the next valid header, so
+// a write torn by a crash does not hide the ones completed after it. Stops at
+// a SEAL record or the end of the file.
+std::vector<ScannedRecord> ScanRecords(int fd, uint64_t file_size, bool& sealed) {
+    std::vector<ScannedRecord> out;
+    sealed = false;
+    uint64_t pos = 0;
+    std::vector<char> window;
+    while (pos + kHeaderBytes <= file_size) {
+        ScannedRecord rec{};
+        rec.pos = pos;
+        if (PreadFull(fd, reinterpret_cast<char*>(&rec.hdr), kHeaderBytes, pos) ==
+                static_cast<ssize_t>(kHeaderBytes) &&
+            ValidHeader(rec.hdr, pos, file_size)) {
+            if (rec.hdr.type == kSeal) {
+                sealed = true;
+                break;
+            }
+            out.push_back(rec);
+            pos += RecordBytes(rec.hdr.length);
+            continue;
+        }
+        // Resync: records start on 8-byte boundaries.
+        bool found = false;
+        constexpr size_t kWindow = 1 << 20;
+        window.resize(kWindow + kHeaderBytes);
+        for (uint64_t base = pos + 8; base + kHeaderBytes <= file_size && !found; base += kWindow) {
+            const size_t len = static_cast<size_t>(std::min<uint64_t>(kWindow + kHeaderBytes, file_size - base));
+            if (PreadFull(fd, window.data(), len, base) != static_cast<ssize_t>(len)) {
+                break;
+            }
+            for (size_t i = 0; i + kHeaderBytes <= len && i < kWindow; i += 8) {
+                RecordHeader h;
+                std::memcpy(&h, window.data() + i, kHeaderBytes);
+                if (ValidHeader(h, base + i, file_size)) {
+                    pos = base + i;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    return out;
+}
+
+bool PayloadIntact(int fd, const ScannedRecord& rec) {
+    std::vector<char> buf(std::min<uint64_t>(rec.hdr.length, 1 << 20));
+    uint32_t crc = 0;
+    uint64_t done = 0;
+    while (done < rec.hdr.length) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(buf.size(), rec.hdr.length - done));
+        if (PreadFull(fd, buf.data(), n, rec.pos + kHeaderBytes + done) != static_cast<ssize_t>(n)) {
+            return false;
+        }
+        crc = Crc32cExtend(crc, buf.data(), n);
+        done += n;
+    }
+    return crc == rec.hdr.data_crc;
+}
+
+} // namespace
+
+struct ContainerStore::Container {
+    uint32_t id{0};
+    int fd{-1};
+    std::string path;
+    uint64_t capacity{0};
+    // Guarded by alloc_mu_ until sealed, immutable afterwards.
+    uint64_t tail{0};
+    int pending{0};  // reserved appends not yet written
+    bool full{false};
+    bool sealing{false};
+    std::atomic<bool> sealed{false};
+
+    ~Container() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+ContainerStore::ContainerStore(std::string dir) : ContainerStore(std::move(dir), Options{}) {}
+
+ContainerStore::ContainerStore(std::string dir, Options opts) : dir_(std::move(dir)), opts_(opts) {}
+
+ContainerStore::~ContainerStore() {
+    {
+        std::lock_guard<std::mutex> lk(loop_mu_);
+        stop_ = true;
+    }
+    loop_cv_.notify_all();
+    if (gc_thread_.joinable()) {
+        gc_thread_.join();
+    }
+}
+
+std::shared_mutex& ContainerStore::StripeFor(uint64_t chunk_id) const {
+    return stripes_[(chunk_id * 0x9e3779b97f4a7c15ULL) >> 58];
+}
+
+std::string ContainerStore::ContainerPath(uint32_t id) const {
+    return dir_ + "/container_" + std::to_string(id) + ".dat";
+}
+
+std::shared_ptr<ContainerStore::Container> ContainerStore::OpenContainer(uint32_t id, bool create) {
+    auto c = std::make_shared<Container>();
+    c->id = id;
+    c->path = ContainerPath(id);
+    c->fd = ::open(c->path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (c->fd < 0) {
+        std::cerr << "ContainerStore: failed to open " << c->path << ": " << std::strerror(errno) << std::endl;
+        return nullptr;
+    }
+    return c;
+}
+
+bool ContainerStore::Open() {
+    const auto start = std::chrono::steady_clock::now();
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    std::vector<uint32_t> ids;
+    for (uint64_t id : ListNumberedFiles(dir_, "container_", ".dat", ec)) {
+        if (id <= std::numeric_limits<uint32_t>::max()) {
+            ids.push_back(static_cast<uint32_t>(id));
+        }
+    }
+    if (ec) {
+        std::cerr << "ContainerStore: failed to list " << dir_ << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::vector<std::shared_ptr<Container>> unsealed;
+    for (uint32_t id : ids) {
+        auto c = OpenContainer(id, false);
+        if (!c) {
+            ok = false;
+            continue;
+        }
+        bool sealed = false;
+        uint64_t tail = 0;
+        {
+            std::lock_guard<std::shared_mutex> lk(containers_mu_);
+            containers_[id] = c;
+        }
+        if (!Recover(*c, tail, sealed)) {
+            ok = false;
+        }
+        c->tail = tail;
+        c->capacity = std::max<uint64_t>(opts_.container_bytes, tail + kHeaderBytes);
+        if (sealed) {
+            c->full = true;
+            c->sealed.store(true, std::memory_order_release);
+        } else {
+            unsealed.push_back(c);
+        }
+        next_id_ = id + 1;
+    }
+    // Appends continue in the newest container; other leftovers of a crash are sealed.
+    for (auto& c : unsealed) {
+        if (c->id + 1 == next_id_ && c->tail + kHeaderBytes < c->capacity) {
+            if (::fallocate(c->fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(c->capacity)) != 0 &&
+                errno != EOPNOTSUPP) {
+                std::cerr << "ContainerStore: fallocate " << c->path << ": " << std::strerror(errno) << std::endl;
+            }
+            active_ = c;
+        } else {
+            c->full = true;
+            c->sealing = true;
+            Seal(c);
+        }
+    }
+
+    if (opts_.gc_interval_ms > 0) {
+        gc_thread_ = std::thread([this]() { GcLoop(); });
+    }
+    const auto stats = GetStats();
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "ContainerStore: " << stats.chunks << " chunks in " << stats.containers
+              << " containers under " << dir_ << " (live " << stats.live_bytes << " of "
+              << stats.file_bytes << " bytes) loaded in " << ms << " ms" << std::endl;
+    return ok;
+}
+
+bool ContainerStore::Recover(Container& c, uint64_t& tail, bool& sealed) {
+    struct stat st {};
+    if (::fstat(c.fd, &st) != 0) {
+        std::cerr << "ContainerStore: fstat " << c.path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    auto records = ScanRecords(c.fd, file_size, sealed);
+    tail = 0;
+    size_t dropped = 0;
+    std::unique_lock<std::shared_mutex> lk(index_mu_);
+    for (const auto& rec : records) {
+        const RecordHeader& h = rec.hdr;
+        // Only a container that was still being appended to can hold a torn payload.
+        if (!sealed && !PayloadIntact(c.fd, rec)) {
+            ++dropped;
+            continue;
+        }
+        tail = rec.pos + RecordBytes(h.length);
+        switch (h.type) {
+        case kWrite:
+            ApplyWrite(h.chunk_id, h.offset, Extent{c.id, h.length, rec.pos + kHeaderBytes});
+            break;
+        case kTruncate:
+            ApplyTruncate(h.chunk_id, h.offset);
+            break;
+        case kRemove:
+            ApplyRemove(h.chunk_id);
+            break;
+        case kReplace: {
+            uint64_t count = 0;
+            std::vector<ReplaceEntry> table;
+            if (h.length < sizeof(count) ||
+                PreadFull(c.fd, reinterpret_cast<char*>(&count), sizeof(count), rec.pos + kHeaderBytes) !=
+                    static_cast<ssize_t>(sizeof(count)) ||
+                count > (h.length - sizeof(count)) / sizeof(ReplaceEntry)) {
+                ++dropped;
+                break;
+            }
+            table.resize(count);
+            const size_t table_bytes = count * sizeof(ReplaceEntry);
+            if (PreadFull(c.fd, reinterpret_cast<char*>(table.data()), table_bytes,
+                          rec.pos + kHeaderBytes + sizeof(count)) != static_cast<ssize_t>(table_bytes)) {
+                ++dropped;
+                break;
+            }
+            ApplyRemove(h.chunk_id);
+            uint64_t pos = rec.pos + kHeaderBytes + sizeof(count) + table_bytes;
+            for (const auto& e : table) {
+                ApplyWrite(h.chunk_id, e.offset, Extent{c.id, e.length, pos});
+                pos += e.length;
+            }
+            ApplyTruncate(h.chunk_id, h.offset);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    if (!sealed && tail < file_size) {
+        // Drop the torn tail so that new appends do not sit behind junk.
+        std::cerr << "ContainerStore: " << c.path << " cut at " << tail << " of " << file_size
+                  << " bytes, " << dropped << " torn records dropped" << std::endl;
+        if (::ftruncate(c.fd, static_cast<off_t>(tail)) != 0) {
+            std::cerr << "ContainerStore: truncate failed: " << std::strerror(errno) << std::endl;
+        }
+    }
+    return true;
+}
+
+bool ContainerStore::Reserve(uint64_t bytes, Reservation& out) {
+    std::shared_ptr<Container> to_seal;
+    {
+        std::lock_guard<std::mutex> lk(alloc_mu_);
+        // Room for a SEAL record always stays free at the end.
+        if (!active_ || active_->tail + bytes + kHeaderBytes > active_->capacity) {
+            if (active_) {
+                active_->full = true;
+                if (active_->pending == 0 && !active_->sealing) {
+                    active_->sealing = true;
+                    to_seal = active_;
+                }
+                active_.reset();
+            }
+            auto c = OpenContainer(next_id_, true);
+            if (c) {
+                ++next_id_;
+                c->capacity = std::max<uint64_t>(opts_.container_bytes, bytes + kHeaderBytes);
+                if (::fallocate(c->fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(c->capacity)) != 0 &&
+                    errno != EOPNOTSUPP) {
+                    std::cerr << "ContainerStore: fallocate " << c->path << ": " << std::strerror(errno)
+                              << std::endl;
+                }
+                {
+                    std::lock_guard<std::shared_mutex> clk(containers_mu_);
+                    containers_[c->id] = c;
+                }
+                active_ = c;
+            }
+        }
+        if (active_) {
+            out.container = active_;
+            out.pos = active_->tail;
+            active_->tail += bytes;
+            ++active_->pending;
+        }
+    }
+    if (to_seal) {
+        QueueSeal(to_seal);
+    }
+    return out.container != nullptr;
+}
+
+void ContainerStore::FinishAppend(const std::shared_ptr<Container>& c) {
+    bool seal = false;
+    {
+        std::lock_guard<std::mutex> lk(alloc_mu_);
+        --c->pending;
+        if (c->full && c->pending == 0 && !c->sealing) {
+            c->sealing = true;
+            seal = true;
+        }
+    }
+    if (seal) {
+        QueueSeal(c);
+    }
+}
+
+void ContainerStore::QueueSeal(const std::shared_ptr<Container>& c) {
+    // Sealing flushes the whole container; keep that off the write path.
+    if (gc_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(loop_mu_);
+            seal_queue_.push_back(c);
+        }
+        loop_cv_.notify_one();
+        return;
+    }
+    Seal(c);
+}
+
+void ContainerStore::Seal(const std::shared_ptr<Container>& c) {
+    // Everything before the SEAL record is on disk, so recovery can trust the
+    // payloads of a sealed container without reading them.
+    if (::fdatasync(c->fd) != 0) {
+        std::cerr << "ContainerStore: fdatasync " << c->path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    RecordHeader h{};
+    h.magic = kRecordMagic;
+    h.type = kSeal;
+    h.crc = HeaderCrc(h);
+    if (!PwritevFull(c->fd, {iovec{&h, sizeof(h)}}, c->tail) || ::fdatasync(c->fd) != 0) {
+        std::cerr << "ContainerStore: failed to seal " << c->path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    // Release any preallocated space past the seal.
+    if (::ftruncate(c->fd, static_cast<off_t>(c->tail + kHeaderBytes)) != 0) {
+        std::cerr << "ContainerStore: truncate " << c->path << ": " << std::strerror(errno) << std::endl;
+    }
+    c->sealed.store(true, std::memory_order_release);
+}
+
+ContainerStore::Result ContainerStore::Append(uint8_t type, uint64_t chunk_id, uint64_t offset,
+                                              const iovec* iov, int iovcnt, size_t payload,
+                                              uint64_t* record_pos, uint32_t* container_id) {
+    Result r{};
+    if (payload > std::numeric_limits<uint32_t>::max()) {
+        r.bytes = -1;
+        r.err = EFBIG;
+        return r;
+    }
+    Reservation res;
+    if (!Reserve(RecordBytes(payload), res)) {
+        r.bytes = -1;
+        r.err = EIO;
+        return r;
+    }
+    RecordHeader h{};
+    h.magic = kRecordMagic;
+    h.type = type;
+    h.chunk_id = chunk_id;
+    h.offset = (type == kRemove && offset == kHorizonHere) ? res.container->id : offset;
+    h.length = static_cast<uint32_t>(payload);
+    uint32_t crc = 0;
+    std::vector<iovec> vec;
+    vec.reserve(static_cast<size_t>(iovcnt) + 1);
+    vec.push_back(iovec{&h, sizeof(h)});
+    for (int i = 0; i < iovcnt; ++i) {
+        crc = Crc32cExtend(crc, iov[i].iov_base, iov[i].iov_len);
+        vec.push_back(iov[i]);
+    }
+    h.data_crc = crc;
+    h.crc = HeaderCrc(h);
+    if (!PwritevFull(res.container->fd, std::move(vec), res.pos)) {
+        r.bytes = -1;
+        r.err = errno;
+    } else if (opts_.sync_on_write && ::fdatasync(res.container->fd) != 0) {
+        r.err = errno;
+    }
+    FinishAppend(res.container);
+    if (r.err == 0) {
+        r.bytes = static_cast<ssize_t>(payload);
+        *record_pos = res.pos;
+        *container_id = res.container->id;
+    }
+    return r;
+}
+
+bool ContainerStore::Contains(uint64_t chunk_id) const {
+    std::shared_lock<std::shared_mutex> lk(index_mu_);
+    return chunks_.count(chunk_id) != 0;
+}
+
+ContainerStore::Result ContainerStore::Write(uint64_t chunk_id, const void* data, size_t size, uint64_t offset) {
+    iovec iov{const_cast<void*>(data), size};
+    return Write(chunk_id, &iov, 1, offset);
+}
+
+ContainerStore::Result ContainerStore::Write(uint64_t chunk_id, const iovec* iov, int iovcnt, uint64_t offset) {
+    size_t payload = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        payload += iov[i].iov_len;
+    }
+    std::unique_lock<std::shared_mutex> stripe(StripeFor(chunk_id));
+    if (payload == 0) {
+        // Like opening a chunk file with O_CREAT: the chunk exists afterwards.
+        Result r{};
+        if (!Contains(chunk_id)) {
+            r = TruncateLocked(chunk_id, 0);
+            r.bytes = r.err == 0 ? 0 : -1;
+        }
+        return r;
+    }
+    uint64_t pos = 0;
+    uint32_t id = 0;
+    Result r = Append(kWrite, chunk_id, offset, iov, iovcnt, payload, &pos, &id);
+    if (r.err == 0) {
+        std::unique_lock<std::shared_mutex> lk(index_mu_);
+        ApplyWrite(chunk_id, offset, Extent{id, static_cast<uint32_t>(payload), pos + kHeaderBytes});
+    }
+    return r;
+}
+
+ContainerStore::Result ContainerStore::Truncate(uint64_t chunk_id, uint64_t size) {
+    std::unique_lock<std::shared_mutex> stripe(StripeFor(chunk_id));
+    return TruncateLocked(chunk_id, size);
+}
+
+ContainerStore::Result ContainerStore::TruncateLocked(uint64_t chunk_id, uint64_t size) {
+    uint64_t pos = 0;
+    uint32_t id = 0;
+    Result r = Append(kTruncate, chunk_id, size, nullptr, 0, 0, &pos, &id);
+    if (r.err == 0) {
+        std::unique_lock<std::shared_mutex> lk(index_mu_);
+        ApplyTruncate(chunk_id, size);
+    }
+    return r;
+}
+
+bool ContainerStore::Remove(uint64_t chunk_id) {
+    std::unique_lock<std::shared_mutex> stripe(StripeFor(chunk_id));
+    if (!Contains(chunk_id)) {
+        return false;
+    }
+    uint64_t pos = 0;
+    uint32_t id = 0;
+    if (Append(kRemove, chunk_id, kHorizonHere, nullptr, 0, 0, &pos, &id).err != 0) {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> lk(index_mu_);
+    ApplyRemove(chunk_id);
+    return true;
+}
+
+ContainerStore::Result ContainerStore::Read(uint64_t chunk_id, uint64_t offset, size_t length, char* dst) const {
+    struct Piece {
+        std::shared_ptr<Container> container;
+        uint64_t pos;
+        size_t length;
+        size_t dst_off;
+    };
+    Result r{};
+    std::vector<Piece> pieces;
+    size_t n = 0;
+    size_t covered = 0;
+    {
+        std::shared_lock<std::shared_mutex> lk(index_mu_);
+        auto it = chunks_.find(chunk_id);
+        if (it == chunks_.end()) {
+            r.bytes = -1;
+            r.err = ENOENT;
+            return r;
+        }
+        const Chunk& chunk = it->second;
+        n = offset >= chunk.size ? 0 : static_cast<size_t>(std::min<uint64_t>(length, chunk.size - offset));
+        const uint64_t end = offset + n;
+        auto e = chunk.extents.upper_bound(offset);
+        if (e != chunk.extents.begin()) {
+            --e;
+        }
+        std::shared_lock<std::shared_mutex> clk(containers_mu_);
+        for (; e != chunk.extents.end() && e->first < end; ++e) {
+            const uint64_t s = e->first;
+            const uint64_t t = s + e->second.length;
+            if (t <= offset) {
+                continue;
+            }
+            const uint64_t b = std::max(s, offset);
+            const uint64_t f = std::min(t, end);
+            // Every extent in the index points at a registered container.
+            pieces.push_back(Piece{containers_.at(e->second.container), e->second.pos + (b - s),
+                                   static_cast<size_t>(f - b), static_cast<size_t>(b - offset)});
+            covered += static_cast<size_t>(f - b);
+        }
+    }
+    if (covered < n) {
+        std::memset(dst, 0, n);
+    }
+    // A container collected meanwhile stays readable through the held fd.
+    for (const auto& p : pieces) {
+        ssize_t got = PreadFull(p.container->fd, dst + p.dst_off, p.length, p.pos);
+        if (got != static_cast<ssize_t>(p.length)) {
+            r.bytes = -1;
+            r.err = got < 0 ? errno : EIO;
+            return r;
+        }
+    }
+    r.bytes = static_cast<ssize_t>(n);
+    return r;
+}
+
+void ContainerStore::TrimLocked(Chunk& chunk, uint64_t begin, uint64_t end) {
+    auto it = chunk.extents.upper_bound(begin);
+    if (it != chunk.extents.begin()) {
+        --it;
+    }
+    while (it != chunk.extents.end() && it->first < end) {
+        const uint64_t s = it->first;
+        const Extent ext = it->second;
+        const uint64_t t = s + ext.length;
+        if (t <= begin) {
+            ++it;
+            continue;
+        }
+        const uint64_t cut_b = std::max(s, begin);
+        const uint64_t cut_e = std::min(t, end);
+        live_[ext.container] -= cut_e - cut_b;
+        it = chunk.extents.erase(it);
+        if (s < begin) {
+            chunk.extents.emplace(s, Extent{ext.container, static_cast<uint32_t>(begin - s), ext.pos});
+        }
+        if (t > end) {
+            it = chunk.extents.emplace(end, Extent{ext.container, static_cast<uint32_t>(t - end),
+                                                   ext.pos + (end - s)}).first;
+            ++it;
+        }
+    }
+}
+
+void ContainerStore::ApplyWrite(uint64_t chunk_id, uint64_t offset, const Extent& ext) {
+    Chunk& chunk = chunks_[chunk_id];
+    const uint64_t end = offset + ext.length;
+    TrimLocked(chunk, offset, end);
+    chunk.extents.emplace(offset, ext);
+    live_[ext.container] += ext.length;
+    chunk.size = std::max(chunk.size, end);
+}
+
+void ContainerStore::ApplyTruncate(uint64_t chunk_id, uint64_t size) {
+    Chunk& chunk = chunks_[chunk_id];
+    TrimLocked(chunk, size, std::numeric_limits<uint64_t>::max());
+    chunk.size = size;
+}
+
+void ContainerStore::ApplyRemove(uint64_t chunk_id) {
+    auto it = chunks_.find(chunk_id);
+    if (it == chunks_.end()) {
+        return;
+    }
+    for (const auto& e : it->second.extents) {
+        live_[e.second.container] -= e.second.length;
+    }
+    chunks_.erase(it);
+}
+
+ContainerStore::Result ContainerStore::ReadExtent(const Extent& ext, char* dst) const {
+    std::shared_ptr<Container> c;
+    {
+        std::shared_lock<std::shared_mutex> lk(containers_mu_);
+        auto it = containers_.find(ext.container);
+        if (it != containers_.end()) {
+            c = it->second;
+        }
+    }
+    Result r{};
+    if (!c || PreadFull(c->fd, dst, ext.length, ext.pos) != static_cast<ssize_t>(ext.length)) {
+        r.bytes = -1;
+        r.err = c ? EIO : ENOENT;
+        return r;
+    }
+    r.bytes = ext.length;
+    return r;
+}
+
+bool ContainerStore::MoveExtents(uint64_t chunk_id, uint32_t from, std::set<uint32_t>* written) {
+    std::unique_lock<std::shared_mutex> stripe(StripeFor(chunk_id));
+    std::vector<std::pair<uint64_t, Extent>> moving;
+    {
+        std::shared_lock<std::shared_mutex> lk(index_mu_);
+        auto it = chunks_.find(chunk_id);
+        if (it == chunks_.end()) {
+            return true;
+        }
+        for (const auto& e : it->second.extents) {
+            if (e.second.container == from) {
+                moving.push_back(e);
+            }
+        }
+    }
+    std::vector<char> buf;
+    for (const auto& m : moving) {
+        buf.resize(m.second.length);
+        if (ReadExtent(m.second, buf.data()).err != 0) {
+            return false;
+        }
+        iovec iov{buf.data(), buf.size()};
+        uint64_t pos = 0;
+        uint32_t id = 0;
+        if (Append(kWrite, chunk_id, m.first, &iov, 1, buf.size(), &pos, &id).err != 0) {
+            return false;
+        }
+        written->insert(id);
+        std::unique_lock<std::shared_mutex> lk(index_mu_);
+        ApplyWrite(chunk_id, m.first, Extent{id, m.second.length, pos + kHeaderBytes});
+    }
+    return true;
+}
+
+bool ContainerStore::Rewrite(uint64_t chunk_id, uint64_t horizon, std::set<uint32_t>* written) {
+    std::unique_lock<std::shared_mutex> stripe(StripeFor(chunk_id));
+    Chunk chunk;
+    bool exists = false;
+    {
+        std::shared_lock<std::shared_mutex> lk(index_mu_);
+        auto it = chunks_.find(chunk_id);
+        if (it != chunks_.end()) {
+            chunk = it->second;
+            exists = true;
+        }
+    }
+    uint64_t pos = 0;
+    uint32_t id = 0;
+    if (!exists) {
+        // A removed chunk: its REMOVE record is only needed while containers
+        // older than the one it was first written to may still hold records
+        // of the chunk.
+        bool older = false;
+        {
+            std::shared_lock<std::shared_mutex> lk(containers_mu_);
+            older = !containers_.empty() && containers_.begin()->first < horizon;
+        }
+        if (!older) {
+            return true;
+        }
+        if (Append(kRemove, chunk_id, horizon, nullptr, 0, 0, &pos, &id).err != 0) {
+            return false;
+        }
+        written->insert(id);
+        return true;
+    }
+
+    // One REPLACE record carries the whole chunk, so a crash never leaves the
+    // chunk half rewritten.
+    std::vector<ReplaceEntry> table;
+    table.reserve(chunk.extents.size());
+    size_t data_bytes = 0;
+    for (const auto& e : chunk.extents) {
+        table.push_back(ReplaceEntry{e.first, e.second.length, 0});
+        data_bytes += e.second.length;
+    }
+    uint64_t count = table.size();
+    std::vector<char> data(data_bytes);
+    size_t off = 0;
+    for (const auto& e : chunk.extents) {
+        if (ReadExtent(e.second, data.data() + off).err != 0) {
+            return false;
+        }
+        off += e.second.length;
+    }
+    iovec iov[3] = {{&count, sizeof(count)},
+                    {table.data(), table.size() * sizeof(ReplaceEntry)},
+                    {data.data(), data.size()}};
+    const size_t payload = iov[0].iov_len + iov[1].iov_len + iov[2].iov_len;
+    if (Append(kReplace, chunk_id, chunk.size, iov, 3, payload, &pos, &id).err != 0) {
+        return false;
+    }
+    written->insert(id);
+    std::unique_lock<std::shared_mutex> lk(index_mu_);
+    ApplyRemove(chunk_id);
+    uint64_t at = pos + kHeaderBytes + iov[0].iov_len + iov[1].iov_len;
+    for (const auto& e : table) {
+        ApplyWrite(chunk_id, e.offset, Extent{id, e.length, at});
+        at += e.length;
+    }
+    ApplyTruncate(chunk_id, chunk.size);
+    return true;
+}
+
+bool ContainerStore::Collect(const std::shared_ptr<Container>& c) {
+    bool sealed = false;
+    const auto records = ScanRecords(c->fd, c->tail, sealed);
+    std::vector<uint64_t> moves;
+    std::unordered_map<uint64_t, uint64_t> rewrites;  // chunk -> REMOVE horizon
+    std::unordered_set<uint64_t> seen;
+    for (const auto& rec : records) {
+        const RecordHeader& h = rec.hdr;
+        if (h.type == kWrite) {
+            if (seen.insert(h.chunk_id).second) {
+                moves.push_back(h.chunk_id);
+            }
+        } else {
+            // TRUNCATE/REMOVE/REPLACE discard older data of the chunk; dropping
+            // them could bring that data back on the next start.
+            auto& horizon = rewrites.emplace(h.chunk_id, c->id).first->second;
+            if (h.type == kRemove) {
+                horizon = std::min<uint64_t>(horizon, h.offset);
+            }
+        }
+    }
+    std::set<uint32_t> written;
+    for (const auto& rw : rewrites) {
+        if (!Rewrite(rw.first, rw.second, &written)) {
+            return false;
+        }
+    }
+    for (uint64_t chunk_id : moves) {
+        if (rewrites.count(chunk_id) == 0 && !MoveExtents(chunk_id, c->id, &written)) {
+            return false;
+        }
+    }
+    // The copies must be on disk before the only other copy is unlinked;
+    // without sync_on_write they may still sit in the page cache.
+    for (uint32_t id : written) {
+        std::shared_ptr<Container> dst;
+        {
+            std::shared_lock<std::shared_mutex> clk(containers_mu_);
+            auto it = containers_.find(id);
+            if (it != containers_.end()) {
+                dst = it->second;
+            }
+        }
+        if (dst && ::fdatasync(dst->fd) != 0) {
+            std::cerr << "ContainerStore: fdatasync " << dst->path << ": " << std::strerror(errno)
+                      << ", " << c->path << " not collected" << std::endl;
+            return false;
+        }
+    }
+    {
+        std::unique_lock<std::shared_mutex> lk(index_mu_);
+        auto it = live_.find(c->id);
+        if (it != live_.end() && it->second != 0) {
+            std::cerr << "ContainerStore: " << c->path << " still holds " << it->second
+                      << " live bytes, not collected" << std::endl;
+            return false;
+        }
+        live_.erase(c->id);
+        std::lock_guard<std::shared_mutex> clk(containers_mu_);
+        containers_.erase(c->id);
+    }
+    // Readers still holding the container keep the fd; the data goes away with it.
+    ::unlink(c->path.c_str());
+    return true;
+}
+
+size_t ContainerStore::CollectGarbage(double min_ratio) {
+    std::lock_guard<std::mutex> gc(gc_mu_);
+    if (min_ratio < 0) {
+        min_ratio = opts_.gc_garbage_ratio;
+    }
+    std::vector<std::shared_ptr<Container>> victims;
+    {
+        std::shared_lock<std::shared_mutex> lk(index_mu_);
+        std::shared_lock<std::shared_mutex> clk(containers_mu_);
+        for (const auto& kv : containers_) {
+            const auto& c = kv.second;
+            if (!c->sealed.load(std::memory_order_acquire) || c->tail == 0) {
+                continue;
+            }
+            auto it = live_.find(c->id);
+            const uint64_t live = it == live_.end() ? 0 : it->second;
+            if (1.0 - static_cast<double>(live) / static_cast<double>(c->tail) >= min_ratio) {
+                victims.push_back(c);
+            }
+        }
+    }
+    size_t collected = 0;
+    for (const auto& c : victims) {
+        const auto start = std::chrono::steady_clock::now();
+        if (Collect(c)) {
+            ++collected;
+            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "ContainerStore: collected " << c->path << " in " << ms << " ms" << std::endl;
+        }
+    }
+    return collected;
+}
+
+void ContainerStore::GcLoop() {
+    const auto interval = std::chrono::milliseconds(opts_.gc_interval_ms);
+    auto next_gc = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lk(loop_mu_);
+    while (true) {
+        loop_cv_.wait_until(lk, next_gc, [this]() { return stop_ || !seal_queue_.empty(); });
+        auto seals = std::move(seal_queue_);
+        seal_queue_.clear();
+        const bool stop = stop_;
+        lk.unlock();
+        for (const auto& c : seals) {
+            Seal(c);
+        }
+        if (stop) {
+            return;
+        }
+        if (std::chrono::steady_clock::now() >= next_gc) {
+            CollectGarbage();
+            next_gc = std::chrono::steady_clock::now() + interval;
+        }
+        lk.lock();
+    }
+}
+
+ContainerStore::Stats ContainerStore::GetStats() const {
+    Stats s;
+    std::shared_lock<std::shared_mutex> lk(index_mu_);
+    s.chunks = chunks_.size();
+    for (const auto& kv : live_) {
+        s.live_bytes += kv.second;
+    }
+    std::shared_lock<std::shared_mutex> clk(containers_mu_);
+    s.containers = containers_.size();
+    for (const auto& kv : containers_) {
+        struct stat st {};
+        if (::fstat(kv.second->fd, &st) == 0) {
+            s.file_bytes += static_cast<uint64_t>(st.st_size);
+        }
+    }
+    return s;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "IOEngine.h"
+
+// Chunk store that packs every chunk into a few large container files instead
+// of one file per chunk. Containers are append-only logs of records:
+//   WRITE(chunk, offset, data)  TRUNCATE(chunk, size)  REMOVE(chunk)
+//   REPLACE(chunk, size, extents)  SEAL
+// Every write is a single pwritev at the tail of the active container (space
+// preallocated with fallocate), and an in-memory index maps each chunk to its
+// live extents (container, position, length). The index is rebuilt on start
+// by scanning record headers; only containers that were not sealed (the ones
+// being appended to at a crash) also have their payload CRCs verified.
+//
+// Overwritten, truncated and removed bytes become garbage in the container
+// that holds them. A background thread collects sealed containers whose
+// garbage exceeds gc_garbage_ratio by re-appending their live extents and
+// deleting the file. Chunks with a TRUNCATE/REMOVE/REPLACE record in a
+// collected container are re-appended whole as one REPLACE record, so that
+// dropping the record cannot resurrect older data in another container.
+class ContainerStore {
+public:
+    struct Options {
+        uint64_t container_bytes{256ull << 20};
+        // Sealed containers with at least this share of dead bytes are collected.
+        double gc_garbage_ratio{0.5};
+        // 0 disables the background thread; containers are then sealed inline.
+        int gc_interval_ms{1000};
+        bool sync_on_write{false};
+    };
+
+    using Result = IOEngine::Result;
+
+    explicit ContainerStore(std::string dir);
+    ContainerStore(std::string dir, Options opts);
+    ~ContainerStore();
+
+    ContainerStore(const ContainerStore&) = delete;
+    ContainerStore& operator=(const ContainerStore&) = delete;
+
+    // Rebuilds the index from the containers in dir and starts the collector.
+    bool Open();
+
+    bool Contains(uint64_t chunk_id) const;
+    // Chunk offsets never written read as zeros; reads stop at the chunk size.
+    Result Read(uint64_t chunk_id, uint64_t offset, size_t length, char* dst) const;
+    Result Write(uint64_t chunk_id, const iovec* iov, int iovcnt, uint64_t offset);
+    Result Write(uint64_t chunk_id, const void* data, size_t size, uint64_t offset);
+    // Creates the chunk if needed.
+    Result Truncate(uint64_t chunk_id, uint64_t size);
+    bool Remove(uint64_t chunk_id);
+
+    // One collection pass over the sealed containers; returns how many were
+    // deleted. min_ratio < 0 uses gc_garbage_ratio.
+    size_t CollectGarbage(double min_ratio = -1.0);
+
+    struct Stats {
+        size_t chunks{0};
+        size_t containers{0};
+        uint64_t live_bytes{0};
+        uint64_t file_bytes{0};
+    };
+    Stats GetStats() const;
+
+private:
+    struct Container;
+    struct Extent {
+        uint32_t container{0};
+        uint32_t length{0};
+        uint64_t pos{0};  // file offset of the first byte
+    };
+    struct Chunk {
+        uint64_t size{0};
+        std::map<uint64_t, Extent> extents;  // by chunk offset, non-overlapping
+    };
+    struct Reservation {
+        std::shared_ptr<Container> container;
+        uint64_t pos{0};  // record start
+    };
+
+    static constexpr size_t kLockStripes = 64;
+
+    std::shared_mutex& StripeFor(uint64_t chunk_id) const;
+    std::string ContainerPath(uint32_t id) const;
+    std::shared_ptr<Container> OpenContainer(uint32_t id, bool create);
+    // Replays one container into the index; tail is the end of its last good record.
+    bool Recover(Container& c, uint64_t& tail, bool& sealed);
+
+    // Appends one record; the caller holds the chunk's stripe lock exclusively.
+    Result Append(uint8_t type, uint64_t chunk_id, uint64_t offset, const iovec* iov, int iovcnt,
+                  size_t payload, uint64_t* record_pos, uint32_t* container_id);
+    bool Reserve(uint64_t bytes, Reservation& out);
+    void FinishAppend(const std::shared_ptr<Container>& c);
+    void Seal(const std::shared_ptr<Container>& c);
+    // Seals on the background thread when there is one.
+    void QueueSeal(const std::shared_ptr<Container>& c);
+    Result TruncateLocked(uint64_t chunk_id, uint64_t size);
+
+    // Index updates; the caller holds index_mu_ exclusively.
+    void ApplyWrite(uint64_t chunk_id, uint64_t offset, const Extent& ext);
+    void ApplyTruncate(uint64_t chunk_id, uint64_t size);
+    void ApplyRemove(uint64_t chunk_id);
+    void TrimLocked(Chunk& chunk, uint64_t begin, uint64_t end);
+
+    Result ReadExtent(const Extent& ext, char* dst) const;
+    bool Collect(const std::shared_ptr<Container>& c);
+    // Re-appends the chunk's extents that live in container from. The
+    // containers appended to are added to written.
+    bool MoveExtents(uint64_t chunk_id, uint32_t from, std::set<uint32_t>* written);
+    // Re-appends the whole chunk as one REPLACE record, or for a removed chunk
+    // its REMOVE record while containers older than horizon exist.
+    bool Rewrite(uint64_t chunk_id, uint64_t horizon, std::set<uint32_t>* written);
+    void GcLoop();
+
+    std::string dir_;
+    Options opts_;
+
+    mutable std::shared_mutex stripes_[kLockStripes];  // taken before index_mu_
+
+    mutable std::shared_mutex index_mu_;
+    std::unordered_map<uint64_t, Chunk> chunks_;
+    std::unordered_map<uint32_t, uint64_t> live_;  // live extent bytes per container
+
+    // Taken last; readers pin a container through its shared_ptr.
+    mutable std::shared_mutex containers_mu_;
+    std::map<uint32_t, std::shared_ptr<Container>> containers_;
+
+    std::mutex alloc_mu_;  // taken inside a stripe lock, before containers_mu_
+    std::shared_ptr<Container> active_;
+    uint32_t next_id_{0};
+
+    std::mutex gc_mu_;  // one collection pass at a time
+    std::mutex loop_mu_;
+    std::condition_variable loop_cv_;
+    bool stop_{false};
+    std::vector<std::shared_ptr<Container>> seal_queue_;
+    std::thread gc_thread_;  // seals full containers and collects garbage
+};
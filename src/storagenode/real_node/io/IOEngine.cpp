@@ -1,42 +1,225 @@
 #include "IOEngine.h"
+#include "AlignedBufferPool.h"
+#include "UringBackend.h"
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <cstring>
 #include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
 #include <system_error>
+#include <unordered_map>
+
+#include "common/FileUtil.h"
 
 namespace fs = std::filesystem;
 
 namespace {
 
-std::string MakeKey(const std::string& path, int flags) {
-    return path + "#" + std::to_string(flags);
+uint64_t AlignDown(uint64_t v, uint64_t a) { return v & ~(a - 1); }
+uint64_t AlignUp(uint64_t v, uint64_t a) { return (v + a - 1) & ~(a - 1); }
+
+bool IsAligned(const void* p, uint64_t a) {
+    return (reinterpret_cast<uintptr_t>(p) & (a - 1)) == 0;
+}
+
+// pread/pwrite until the full length is transferred, EOF (reads) or an error.
+ssize_t PreadFull(int fd, char* dst, size_t length, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pread(fd, dst + done, length - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+ssize_t PwriteFull(int fd, const char* src, size_t length, uint64_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = ::pwrite(fd, src + done, length - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(done);
+}
+
+// Reads the aligned block at offset into dst, zero-filling whatever lies past EOF.
+bool LoadBlock(int fd, char* dst, size_t block, uint64_t offset) {
+    ssize_t n = PreadFull(fd, dst, block, offset);
+    if (n < 0) {
+        return false;
+    }
+    std::memset(dst + n, 0, block - static_cast<size_t>(n));
+    return true;
 }
 
+// Sequential reader over a caller's iovec array.
+class IovCursor {
+public:
+    IovCursor(const iovec* iov, int iovcnt) : iov_(iov), end_(iov + iovcnt) {}
+
+    void CopyTo(char* dst, size_t n) {
+        while (n > 0 && iov_ != end_) {
+            size_t take = std::min(n, iov_->iov_len - pos_);
+            std::memcpy(dst, static_cast<const char*>(iov_->iov_base) + pos_, take);
+            dst += take;
+            n -= take;
+            pos_ += take;
+            if (pos_ == iov_->iov_len) {
+                ++iov_;
+                pos_ = 0;
+            }
+        }
+    }
+
+private:
+    const iovec* iov_;
+    const iovec* end_;
+    size_t pos_{0};
+};
+
 } // namespace
 
+// One cached fd. refs/referenced are touched on the shared-lock hit path and on
+// lock-free release; everything else only changes under the shard's exclusive lock.
+struct IOEngine::FdSlot {
+    std::atomic<uint32_t> refs{0};
+    std::atomic<bool> referenced{false};  // CLOCK second-chance bit
+    uint64_t chunk_id{0};
+    int cache_flags{0};
+    int fd{-1};
+    int reg_slot{-1};
+    UringBackend* ring{nullptr};
+};
+
+struct IOEngine::FdShard {
+    struct Key {
+        uint64_t chunk_id;
+        int flags;
+        bool operator==(const Key& o) const { return chunk_id == o.chunk_id && flags == o.flags; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return static_cast<size_t>(k.chunk_id ^ (static_cast<uint64_t>(k.flags) << 40));
+        }
+    };
+
+    std::shared_mutex mu;
+    std::unordered_map<Key, uint32_t, KeyHash> index;
+    std::unique_ptr<FdSlot[]> slots;
+    uint32_t capacity{0};
+    uint32_t used{0};   // slots [0, used) have been handed out at least once
+    uint32_t hand{0};   // CLOCK hand
+    int reg_base{0};    // first registered-file index owned by this shard
+};
+
 IOEngine::Options::Options()
     : max_open_files(128),
-      sync_on_write(false) {}
+      fd_cache_shards(16),
+      sync_on_write(false),
+      use_io_uring(false),
+      io_uring_entries(256),
+      registered_buffer_count(0),
+      registered_buffer_size(64 << 10),
+      direct_io(false),
+      direct_io_alignment(4096),
+      aligned_buffer_count(16),
+      aligned_buffer_size(1 << 20),
+      drop_behind(false),
+      drop_behind_lag(8 << 20) {}
 
 IOEngine::IOEngine(std::string base_path, Options opts)
     : base_path_(std::move(base_path)), opts_(opts) {
     if (opts_.max_open_files == 0) {
         opts_.max_open_files = 1;
     }
+    if (opts_.fd_cache_shards == 0) {
+        opts_.fd_cache_shards = 1;
+    }
+    const size_t per_shard =
+        (opts_.max_open_files + opts_.fd_cache_shards - 1) / opts_.fd_cache_shards;
+    shards_.reserve(opts_.fd_cache_shards);
+    for (size_t i = 0; i < opts_.fd_cache_shards; ++i) {
+        auto shard = std::make_unique<FdShard>();
+        shard->capacity = static_cast<uint32_t>(per_shard);
+        shard->slots = std::make_unique<FdSlot[]>(per_shard);
+        shard->reg_base = static_cast<int>(i * per_shard);
+        shard->index.reserve(per_shard);
+        shards_.push_back(std::move(shard));
+    }
+
+    if (opts_.direct_io) {
+        const size_t a = opts_.direct_io_alignment;
+        bool valid = a > 0 && (a & (a - 1)) == 0 && opts_.aligned_buffer_size >= a;
+        if (valid) {
+            opts_.aligned_buffer_size = AlignDown(opts_.aligned_buffer_size, a);
+            direct_pool_ = std::make_unique<AlignedBufferPool>(
+                opts_.aligned_buffer_count, opts_.aligned_buffer_size, a);
+        }
+        if (!valid || !direct_pool_->ok()) {
+            std::cerr << "[IOEngine] direct I/O disabled: invalid alignment or buffer pool" << std::endl;
+            direct_pool_.reset();
+            opts_.direct_io = false;
+        } else if (opts_.use_io_uring) {
+            // Direct I/O is served synchronously from the aligned pool.
+            std::cerr << "[IOEngine] direct_io set, not starting io_uring" << std::endl;
+            opts_.use_io_uring = false;
+        }
+    }
+
+    if (opts_.use_io_uring) {
+        // Registered file indices map 1:1 onto cache slots; every ring gets the full
+        // (sparse) table and only fills the indices of slots whose file is on its device.
+        ring_file_slots_ = static_cast<unsigned>(per_shard * opts_.fd_cache_shards);
+        // Probe with the data root's ring; other devices get theirs on first open.
+        auto ring = MakeRing();
+        struct stat st{};
+        if (!ring->Available()) {
+            opts_.use_io_uring = false;
+        } else if (::stat(base_path_.c_str(), &st) == 0) {
+            rings_.emplace(st.st_dev, std::move(ring));
+        }
+    }
+    std::cout << "[IOEngine] base_path=" << base_path_
+              << " backend=" << (opts_.use_io_uring ? "io_uring" : "pread/pwrite")
+              << (opts_.direct_io ? "+O_DIRECT" : "")
+              << " fd_cache=" << opts_.fd_cache_shards << "x" << per_shard << std::endl;
 }
 
 IOEngine::~IOEngine() {
-    std::lock_guard<std::mutex> lk(fd_mu_);
-    for (auto& kv : fd_cache_) {
-        if (kv.second.fd >= 0) {
-            ::close(kv.second.fd);
+    // Drain in-flight ring operations first; their completions release fds and
+    // staging buffers through their ring, so rings stay alive until every reaper is joined.
+    for (auto& [dev, ring] : rings_) {
+        if (ring) {
+            ring->Shutdown();
+        }
+    }
+    rings_.clear();
+    for (auto& shard : shards_) {
+        std::unique_lock<std::shared_mutex> lk(shard->mu);
+        for (uint32_t i = 0; i < shard->used; ++i) {
+            if (shard->slots[i].fd >= 0) {
+                ::close(shard->slots[i].fd);
+                shard->slots[i].fd = -1;
+            }
         }
+        shard->index.clear();
     }
-    fd_cache_.clear();
-    lru_.clear();
 }
 
 int IOEngine::NormalizeFlags(int flags, bool write_access) const {
@@ -47,31 +230,79 @@ int IOEngine::NormalizeFlags(int flags, bool write_access) const {
     if ((f & (O_WRONLY | O_RDWR)) == 0 && write_access) {
         f |= O_WRONLY;
     }
-    if (opts_.sync_on_write && write_access) {
-        f |= O_DSYNC;
+    if (opts_.direct_io) {
+        // Partial-block writes read the surrounding block back first.
+        if (f & O_WRONLY) {
+            f = (f & ~O_WRONLY) | O_RDWR;
+        }
+        f |= O_DIRECT;
     }
+    // sync_on_write is honoured with one fdatasync per write (linked into the ring on
+    // the io_uring path) rather than O_DSYNC, so each write pays for a single flush.
     f |= O_CLOEXEC;
     return f;
 }
 
-int IOEngine::AcquireFd(const std::string& path,
-                        int flags,
-                        bool create_if_missing,
-                        int mode,
-                        int& err) {
+IOEngine::FdShard& IOEngine::ShardFor(uint64_t chunk_id) {
+    return *shards_[Mix64(chunk_id) % shards_.size()];
+}
+
+std::unique_ptr<UringBackend> IOEngine::MakeRing() const {
+    UringBackend::Options uopts;
+    uopts.entries = opts_.io_uring_entries;
+    uopts.file_slots = ring_file_slots_;
+    uopts.buffer_count = opts_.registered_buffer_count;
+    uopts.buffer_size = opts_.registered_buffer_size;
+    return std::make_unique<UringBackend>(uopts);
+}
+
+UringBackend* IOEngine::RingFor(int fd) {
+    if (!opts_.use_io_uring) {
+        return nullptr;
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lk(rings_mu_);
+    auto it = rings_.find(st.st_dev);
+    if (it == rings_.end()) {
+        auto ring = MakeRing();
+        if (!ring->Available()) {
+            // Remember the failure (null entry) so this device stays on pread/pwrite.
+            std::cerr << "[IOEngine] io_uring unavailable for device " << st.st_dev
+                      << ", using pread/pwrite" << std::endl;
+            ring.reset();
+        }
+        it = rings_.emplace(st.st_dev, std::move(ring)).first;
+    }
+    return it->second.get();
+}
+
+bool IOEngine::AcquireFd(uint64_t chunk_id,
+                         const std::string& path,
+                         int flags,
+                         bool create_if_missing,
+                         int mode,
+                         FdHandle& handle,
+                         int& err) {
     bool write_access = (flags & (O_WRONLY | O_RDWR)) != 0;
     int normalized = NormalizeFlags(flags, write_access);
-    int cache_flags = normalized & ~O_CREAT;
-    const std::string key = MakeKey(path, cache_flags);
-
-    std::lock_guard<std::mutex> lk(fd_mu_);
-    auto it = fd_cache_.find(key);
-    if (it != fd_cache_.end()) {
-        lru_.splice(lru_.begin(), lru_, it->second.lru_it);
-        it->second.lru_it = lru_.begin();
-        ++it->second.ref_count;
-        err = 0;
-        return it->second.fd;
+    const FdShard::Key key{chunk_id, normalized & ~O_CREAT};
+    FdShard& shard = ShardFor(chunk_id);
+
+    {
+        // Hit path: shared lock only, so readers of different chunks never serialize.
+        std::shared_lock<std::shared_mutex> lk(shard.mu);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            FdSlot& slot = shard.slots[it->second];
+            slot.refs.fetch_add(1, std::memory_order_acq_rel);
+            slot.referenced.store(true, std::memory_order_relaxed);
+            handle = FdHandle{slot.fd, slot.reg_slot, &slot, slot.ring};
+            err = 0;
+            return true;
+        }
     }
 
     if (create_if_missing) {
@@ -81,63 +312,97 @@ int IOEngine::AcquireFd(const std::string& path,
     } else {
         normalized &= ~O_CREAT;
     }
-
     int fd = ::open(path.c_str(), normalized, mode);
+    if (fd < 0 && errno == EINVAL && (normalized & O_DIRECT)) {
+        // Filesystem without O_DIRECT support (e.g. tmpfs): keep the aligned path, buffered.
+        fd = ::open(path.c_str(), normalized & ~O_DIRECT, mode);
+    }
     if (fd < 0) {
         err = errno;
-        return -1;
+        return false;
     }
+    if (opts_.drop_behind && !write_access) {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    UringBackend* ring = RingFor(fd);
 
-    lru_.push_front(key);
-    FDEntry entry;
-    entry.fd = fd;
-    entry.writable = write_access;
-    entry.lru_it = lru_.begin();
-    entry.ref_count = 1;
-    fd_cache_.emplace(key, entry);
+    std::unique_lock<std::shared_mutex> lk(shard.mu);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Another thread opened the same chunk while we were in open(2).
+        ::close(fd);
+        FdSlot& slot = shard.slots[it->second];
+        slot.refs.fetch_add(1, std::memory_order_acq_rel);
+        slot.referenced.store(true, std::memory_order_relaxed);
+        handle = FdHandle{slot.fd, slot.reg_slot, &slot, slot.ring};
+        err = 0;
+        return true;
+    }
 
-    EvictIfNeeded();
+    int idx = TakeSlotLocked(shard);
+    if (idx < 0) {
+        handle = FdHandle{fd, -1, nullptr, ring};
+        err = 0;
+        return true;
+    }
+    FdSlot& slot = shard.slots[idx];
+    slot.chunk_id = chunk_id;
+    slot.cache_flags = key.flags;
+    slot.fd = fd;
+    slot.reg_slot = -1;
+    slot.ring = ring;
+    if (ring && ring->UpdateFileSlot(shard.reg_base + idx, fd)) {
+        slot.reg_slot = shard.reg_base + idx;
+    }
+    slot.refs.store(1, std::memory_order_relaxed);
+    slot.referenced.store(true, std::memory_order_relaxed);
+    shard.index.emplace(key, static_cast<uint32_t>(idx));
+    handle = FdHandle{slot.fd, slot.reg_slot, &slot, slot.ring};
     err = 0;
-    return fd;
+    return true;
 }
 
-void IOEngine::ReleaseFd(const std::string& path, int flags) {
-    bool write_access = (flags & (O_WRONLY | O_RDWR)) != 0;
-    int normalized = NormalizeFlags(flags, write_access);
-    int cache_flags = normalized & ~O_CREAT;
-    const std::string key = MakeKey(path, cache_flags);
-
-    std::lock_guard<std::mutex> lk(fd_mu_);
-    auto it = fd_cache_.find(key);
-    if (it == fd_cache_.end()) {
-        return;
-    }
-    if (it->second.ref_count > 0) {
-        --it->second.ref_count;
+int IOEngine::TakeSlotLocked(FdShard& shard) {
+    if (shard.used < shard.capacity) {
+        return static_cast<int>(shard.used++);
     }
-    if (it->second.ref_count == 0) {
-        EvictIfNeeded();
+    // CLOCK: skip pinned slots, give recently used ones a second chance.
+    for (uint32_t step = 0; step < 2 * shard.capacity; ++step) {
+        uint32_t idx = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.capacity;
+        FdSlot& slot = shard.slots[idx];
+        if (slot.fd < 0) {
+            return static_cast<int>(idx);
+        }
+        if (slot.refs.load(std::memory_order_acquire) > 0) {
+            continue;
+        }
+        if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+        shard.index.erase(FdShard::Key{slot.chunk_id, slot.cache_flags});
+        if (slot.reg_slot >= 0 && slot.ring) {
+            slot.ring->UpdateFileSlot(slot.reg_slot, -1);
+        }
+        ::close(slot.fd);
+        slot.fd = -1;
+        slot.reg_slot = -1;
+        slot.ring = nullptr;
+        return static_cast<int>(idx);
     }
+    return -1;
 }
 
-void IOEngine::EvictIfNeeded() {
-    while (fd_cache_.size() > opts_.max_open_files && !lru_.empty()) {
-        const std::string& victim = lru_.back();
-        auto it = fd_cache_.find(victim);
-        if (it != fd_cache_.end()) {
-            if (it->second.ref_count > 0) {
-                lru_.splice(lru_.begin(), lru_, it->second.lru_it);
-                it->second.lru_it = lru_.begin();
-                return;
-            }
-            ::close(it->second.fd);
-            fd_cache_.erase(it);
-        }
-        lru_.pop_back();
+void IOEngine::ReleaseFd(const FdHandle& handle) {
+    if (handle.slot) {
+        handle.slot->refs.fetch_sub(1, std::memory_order_release);
+    } else if (handle.fd >= 0) {
+        ::close(handle.fd);
     }
 }
 
-IOEngine::Result IOEngine::Write(const std::string& path,
+IOEngine::Result IOEngine::Write(uint64_t chunk_id,
+                                 const std::string& path,
                                  const void* data,
                                  size_t size,
                                  uint64_t offset,
@@ -145,31 +410,20 @@ IOEngine::Result IOEngine::Write(const std::string& path,
                                  int mode) {
     Result r{};
     int err = 0;
-    int fd = AcquireFd(path, flags, /*create_if_missing=*/true, mode, err);
-    if (fd < 0) {
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/true, mode, h, err)) {
         r.bytes = -1;
         r.err = err;
         return r;
     }
 
-    ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
-    if (n < 0) {
-        r.bytes = -1;
-        r.err = errno;
-        ReleaseFd(path, flags);
-        return r;
-    }
-    r.bytes = n;
-    if (opts_.sync_on_write) {
-        if (::fsync(fd) != 0) {
-            r.err = errno;
-        }
-    }
-    ReleaseFd(path, flags);
+    r = PwriteFd(chunk_id, h.fd, data, size, offset);
+    ReleaseFd(h);
     return r;
 }
 
-IOEngine::Result IOEngine::Read(const std::string& path,
+IOEngine::Result IOEngine::Read(uint64_t chunk_id,
+                                const std::string& path,
                                 uint64_t offset,
                                 size_t length,
                                 std::string& out,
@@ -178,47 +432,469 @@ IOEngine::Result IOEngine::Read(const std::string& path,
     out.resize(length);
 
     int err = 0;
-    int fd = AcquireFd(path, flags, /*create_if_missing=*/false, 0, err);
-    if (fd < 0) {
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/false, 0, h, err)) {
         r.bytes = -1;
         r.err = err;
         out.clear();
         return r;
     }
 
-    ssize_t n = ::pread(fd, out.data(), length, static_cast<off_t>(offset));
-    if (n < 0) {
-        r.bytes = -1;
-        r.err = errno;
+    r = PreadFd(chunk_id, h.fd, out.data(), length, offset);
+    if (r.bytes < 0) {
         out.clear();
-        ReleaseFd(path, flags);
-        return r;
+    } else {
+        out.resize(static_cast<size_t>(r.bytes));
     }
-    r.bytes = n;
-    out.resize(static_cast<size_t>(n));
-    ReleaseFd(path, flags);
+    ReleaseFd(h);
     return r;
 }
 
-IOEngine::Result IOEngine::Truncate(const std::string& path,
+IOEngine::Result IOEngine::Truncate(uint64_t chunk_id,
+                                    const std::string& path,
                                     uint64_t size,
                                     int flags,
                                     int mode) {
     Result r{};
     int err = 0;
-    int fd = AcquireFd(path, flags, /*create_if_missing=*/true, mode, err);
-    if (fd < 0) {
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/true, mode, h, err)) {
         r.bytes = -1;
         r.err = err;
         return r;
     }
-    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    if (::ftruncate(h.fd, static_cast<off_t>(size)) != 0) {
         r.bytes = -1;
         r.err = errno;
-        ReleaseFd(path, flags);
+        ReleaseFd(h);
         return r;
     }
     r.bytes = 0;
-    ReleaseFd(path, flags);
+    ReleaseFd(h);
+    return r;
+}
+
+IOEngine::Result IOEngine::PwriteFd(uint64_t chunk_id, int fd, const void* data, size_t size, uint64_t offset) const {
+    if (direct_pool_) {
+        iovec iov{const_cast<void*>(data), size};
+        return DirectWrite(chunk_id, fd, &iov, 1, offset);
+    }
+    Result r{};
+    ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (n < 0) {
+        r.bytes = -1;
+        r.err = errno;
+        return r;
+    }
+    r.bytes = n;
+    if (opts_.drop_behind) {
+        DropBehind(fd, offset, static_cast<size_t>(n));
+    }
+    if (opts_.sync_on_write && ::fdatasync(fd) != 0) {
+        r.err = errno;
+    }
+    return r;
+}
+
+IOEngine::Result IOEngine::PwritevFd(uint64_t chunk_id, int fd, const iovec* iov, int iovcnt, uint64_t offset) const {
+    if (direct_pool_) {
+        return DirectWrite(chunk_id, fd, iov, iovcnt, offset);
+    }
+    Result r{};
+    ssize_t n = ::pwritev(fd, iov, iovcnt, static_cast<off_t>(offset));
+    if (n < 0) {
+        r.bytes = -1;
+        r.err = errno;
+        return r;
+    }
+    r.bytes = n;
+    if (opts_.drop_behind) {
+        DropBehind(fd, offset, static_cast<size_t>(n));
+    }
+    if (opts_.sync_on_write && ::fdatasync(fd) != 0) {
+        r.err = errno;
+    }
+    return r;
+}
+
+IOEngine::Result IOEngine::PreadFd(uint64_t chunk_id, int fd, char* dst, size_t length,
+                                   uint64_t offset) const {
+    if (direct_pool_) {
+        return DirectRead(chunk_id, fd, dst, length, offset);
+    }
+    Result r{};
+    ssize_t n = ::pread(fd, dst, length, static_cast<off_t>(offset));
+    if (n < 0) {
+        r.bytes = -1;
+        r.err = errno;
+        return r;
+    }
+    r.bytes = n;
     return r;
 }
+
+IOEngine::Result IOEngine::DirectWrite(uint64_t chunk_id, int fd, const iovec* iov, int iovcnt,
+                                       uint64_t offset) const {
+    Result r{};
+    const uint64_t a = direct_pool_->alignment();
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+    if (total == 0) {
+        return r;
+    }
+
+    // Stripes are keyed by chunk so every fd of a chunk (cached or overflow) shares one.
+    // Aligned writes hold it shared and never overlap a read-modify-write in progress.
+    std::shared_mutex& stripe = rmw_mu_[Mix64(chunk_id) % kRmwStripes];
+
+    // Already aligned: hand the caller's buffer to the kernel as-is.
+    if (iovcnt == 1 && IsAligned(iov[0].iov_base, a) && offset % a == 0 && total % a == 0) {
+        std::shared_lock<std::shared_mutex> aligned_lock(stripe);
+        ssize_t n = PwriteFull(fd, static_cast<const char*>(iov[0].iov_base), total, offset);
+        if (n < 0) {
+            r.bytes = -1;
+            r.err = errno;
+            return r;
+        }
+        r.bytes = n;
+        if (opts_.sync_on_write && ::fdatasync(fd) != 0) {
+            r.err = errno;
+        }
+        return r;
+    }
+
+    const uint64_t end = offset + total;
+    const uint64_t astart = AlignDown(offset, a);
+    const uint64_t aend = AlignUp(end, a);
+    const bool partial = astart != offset || aend != end;
+
+    std::shared_lock<std::shared_mutex> aligned_lock;
+    std::unique_lock<std::shared_mutex> rmw_lock;
+    off_t size_before = 0;
+    if (!partial) {
+        aligned_lock = std::shared_lock<std::shared_mutex>(stripe);
+    } else {
+        rmw_lock = std::unique_lock<std::shared_mutex>(stripe);
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            r.bytes = -1;
+            r.err = errno;
+            return r;
+        }
+        size_before = st.st_size;
+    }
+
+    IovCursor cursor(iov, iovcnt);
+    const size_t window = direct_pool_->buffer_size();
+    char* buf = direct_pool_->Acquire();
+    for (uint64_t ws = astart; ws < aend;) {
+        const size_t len = static_cast<size_t>(std::min<uint64_t>(window, aend - ws));
+        const uint64_t we = ws + len;
+        bool ok = true;
+        if (ws < offset) {
+            ok = LoadBlock(fd, buf, a, ws);
+        }
+        if (ok && we > end && (we - a > ws || ws >= offset)) {
+            ok = LoadBlock(fd, buf + (we - a - ws), a, we - a);
+        }
+        if (!ok) {
+            r.bytes = -1;
+            r.err = errno;
+            break;
+        }
+        const uint64_t ds = std::max(ws, offset);
+        const uint64_t de = std::min(we, end);
+        cursor.CopyTo(buf + (ds - ws), static_cast<size_t>(de - ds));
+        if (PwriteFull(fd, buf, len, ws) < 0) {
+            r.bytes = -1;
+            r.err = errno;
+            break;
+        }
+        ws = we;
+    }
+    direct_pool_->Release(buf);
+    if (r.bytes < 0) {
+        return r;
+    }
+
+    // The padded tail must not become part of the chunk.
+    const uint64_t logical_size = std::max<uint64_t>(static_cast<uint64_t>(size_before), end);
+    if (aend > logical_size && ::ftruncate(fd, static_cast<off_t>(logical_size)) != 0) {
+        r.bytes = -1;
+        r.err = errno;
+        return r;
+    }
+    r.bytes = static_cast<ssize_t>(total);
+    if (opts_.sync_on_write && ::fdatasync(fd) != 0) {
+        r.err = errno;
+    }
+    return r;
+}
+
+IOEngine::Result IOEngine::DirectRead(uint64_t chunk_id, int fd, char* dst, size_t length,
+                                      uint64_t offset) const {
+    Result r{};
+    const uint64_t a = direct_pool_->alignment();
+    if (length == 0) {
+        return r;
+    }
+    // Same stripe as DirectWrite, held shared: a read never observes a read-modify-write
+    // of the blocks it covers half done, nor its padded tail before the truncate.
+    std::shared_lock<std::shared_mutex> stripe_lock(rmw_mu_[Mix64(chunk_id) % kRmwStripes]);
+    if (IsAligned(dst, a) && offset % a == 0 && length % a == 0) {
+        ssize_t n = PreadFull(fd, dst, length, offset);
+        if (n < 0) {
+            r.bytes = -1;
+            r.err = errno;
+            return r;
+        }
+        r.bytes = n;
+        return r;
+    }
+
+    const uint64_t end = offset + length;
+    const uint64_t aend = AlignUp(end, a);
+    const size_t window = direct_pool_->buffer_size();
+    size_t copied = 0;
+    char* buf = direct_pool_->Acquire();
+    for (uint64_t ws = AlignDown(offset, a); ws < aend;) {
+        const size_t len = static_cast<size_t>(std::min<uint64_t>(window, aend - ws));
+        ssize_t n = PreadFull(fd, buf, len, ws);
+        if (n < 0) {
+            r.bytes = -1;
+            r.err = errno;
+            break;
+        }
+        const uint64_t got_end = ws + static_cast<uint64_t>(n);
+        const uint64_t ds = std::max(ws, offset);
+        const uint64_t de = std::min(got_end, end);
+        if (de > ds) {
+            std::memcpy(dst + (ds - offset), buf + (ds - ws), static_cast<size_t>(de - ds));
+            copied += static_cast<size_t>(de - ds);
+        }
+        if (static_cast<size_t>(n) < len) {
+            break;  // EOF
+        }
+        ws += len;
+    }
+    direct_pool_->Release(buf);
+    if (r.bytes < 0) {
+        return r;
+    }
+    r.bytes = static_cast<ssize_t>(copied);
+    return r;
+}
+
+void IOEngine::DropBehind(int fd, uint64_t offset, size_t length) const {
+    if (length == 0) {
+        return;
+    }
+    // Kick off writeback of what was just written so dirty pages never pile up...
+    ::sync_file_range(fd, static_cast<off_t>(offset), static_cast<off_t>(length),
+                      SYNC_FILE_RANGE_WRITE);
+    // ...and evict the range written drop_behind_lag bytes ago, which is clean by now
+    // for a sequential writer, so the wait below is normally a no-op.
+    if (offset < opts_.drop_behind_lag) {
+        return;
+    }
+    const off_t old_off = static_cast<off_t>(offset - opts_.drop_behind_lag);
+    ::sync_file_range(fd, old_off, static_cast<off_t>(length),
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                          SYNC_FILE_RANGE_WAIT_AFTER);
+    ::posix_fadvise(fd, old_off, static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+}
+
+bool IOEngine::AsyncEnabled() const {
+    return opts_.use_io_uring;
+}
+
+namespace {
+
+IOEngine::Result FromCqe(int res) {
+    IOEngine::Result r{};
+    if (res < 0) {
+        r.bytes = -1;
+        r.err = -res;
+    } else {
+        r.bytes = res;
+    }
+    return r;
+}
+
+} // namespace
+
+void IOEngine::WriteAsync(uint64_t chunk_id,
+                          const std::string& path,
+                          const void* data,
+                          size_t size,
+                          uint64_t offset,
+                          int flags,
+                          int mode,
+                          Completion done) {
+    if (!opts_.use_io_uring) {
+        done(Write(chunk_id, path, data, size, offset, flags, mode));
+        return;
+    }
+    int err = 0;
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/true, mode, h, err)) {
+        Result r{};
+        r.bytes = -1;
+        r.err = err;
+        done(r);
+        return;
+    }
+    UringBackend* ring = h.ring;
+    // Beyond the device ring's CQ budget, serve inline rather than risk completion overflow.
+    if (!ring || ring->inflight() >= opts_.io_uring_entries) {
+        Result r = PwriteFd(chunk_id, h.fd, data, size, offset);
+        ReleaseFd(h);
+        done(r);
+        return;
+    }
+    // Payloads that fit a registered buffer are staged there so the ring can use write_fixed.
+    char* staged = AcquireStaging(ring, size);
+    if (staged) {
+        std::memcpy(staged, data, size);
+        data = staged;
+    }
+    UringBackend::Completion cb = [this, h, offset, staged, done = std::move(done)](int res) {
+        if (opts_.drop_behind && res > 0) {
+            DropBehind(h.fd, offset, static_cast<size_t>(res));
+        }
+        h.ring->ReleaseBuffer(staged);
+        ReleaseFd(h);
+        done(FromCqe(res));
+    };
+    const bool fixed = h.reg_slot >= 0;
+    if (!ring->SubmitWrite(fixed ? h.reg_slot : h.fd, fixed, data, size, offset,
+                             opts_.sync_on_write, std::move(cb))) {
+        Result r = PwriteFd(chunk_id, h.fd, data, size, offset);
+        cb(r.bytes < 0 ? -r.err : static_cast<int>(r.bytes));
+    }
+}
+
+void IOEngine::WritevAsync(uint64_t chunk_id,
+                           const std::string& path,
+                           std::vector<iovec> iov,
+                           uint64_t offset,
+                           int flags,
+                           int mode,
+                           Completion done) {
+    if (iov.size() == 1) {
+        WriteAsync(chunk_id, path, iov[0].iov_base, iov[0].iov_len, offset, flags, mode,
+                   std::move(done));
+        return;
+    }
+    int err = 0;
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/true, mode, h, err)) {
+        Result r{};
+        r.bytes = -1;
+        r.err = err;
+        done(r);
+        return;
+    }
+    const int iovcnt = static_cast<int>(iov.size());
+    UringBackend* ring = h.ring;
+    if (!ring || ring->inflight() >= opts_.io_uring_entries) {
+        Result r = PwritevFd(chunk_id, h.fd, iov.data(), iovcnt, offset);
+        ReleaseFd(h);
+        done(r);
+        return;
+    }
+    // A payload that fits one registered buffer is flattened into it and written with write_fixed.
+    size_t total = 0;
+    for (const auto& v : iov) {
+        total += v.iov_len;
+    }
+    if (char* staged = AcquireStaging(ring, total)) {
+        char* p = staged;
+        for (const auto& v : iov) {
+            std::memcpy(p, v.iov_base, v.iov_len);
+            p += v.iov_len;
+        }
+        UringBackend::Completion cb = [this, h, offset, staged, done = std::move(done)](int res) {
+            if (opts_.drop_behind && res > 0) {
+                DropBehind(h.fd, offset, static_cast<size_t>(res));
+            }
+            h.ring->ReleaseBuffer(staged);
+            ReleaseFd(h);
+            done(FromCqe(res));
+        };
+        const bool fixed = h.reg_slot >= 0;
+        if (!ring->SubmitWrite(fixed ? h.reg_slot : h.fd, fixed, staged, total, offset,
+                                 opts_.sync_on_write, std::move(cb))) {
+            Result r = PwriteFd(chunk_id, h.fd, staged, total, offset);
+            cb(r.bytes < 0 ? -r.err : static_cast<int>(r.bytes));
+        }
+        return;
+    }
+    // The kernel may read the iovec array after submission, so the completion owns it.
+    auto owned = std::make_shared<std::vector<iovec>>(std::move(iov));
+    UringBackend::Completion cb = [this, h, offset, owned, done = std::move(done)](int res) {
+        if (opts_.drop_behind && res > 0) {
+            DropBehind(h.fd, offset, static_cast<size_t>(res));
+        }
+        ReleaseFd(h);
+        done(FromCqe(res));
+    };
+    const bool fixed = h.reg_slot >= 0;
+    if (!ring->SubmitWritev(fixed ? h.reg_slot : h.fd, fixed, owned->data(), iovcnt, offset,
+                              opts_.sync_on_write, std::move(cb))) {
+        Result r = PwritevFd(chunk_id, h.fd, owned->data(), iovcnt, offset);
+        cb(r.bytes < 0 ? -r.err : static_cast<int>(r.bytes));
+    }
+}
+
+void IOEngine::ReadAsync(uint64_t chunk_id,
+                         const std::string& path,
+                         uint64_t offset,
+                         size_t length,
+                         char* dst,
+                         int flags,
+                         Completion done) {
+    int err = 0;
+    FdHandle h;
+    if (!AcquireFd(chunk_id, path, flags, /*create_if_missing=*/false, 0, h, err)) {
+        Result r{};
+        r.bytes = -1;
+        r.err = err;
+        done(r);
+        return;
+    }
+    UringBackend* ring = h.ring;
+    if (!ring || ring->inflight() >= opts_.io_uring_entries) {
+        Result r = PreadFd(chunk_id, h.fd, dst, length, offset);
+        ReleaseFd(h);
+        done(r);
+        return;
+    }
+    // Reads that fit a registered buffer land there (read_fixed) and are copied out on completion.
+    char* staged = AcquireStaging(ring, length);
+    char* target = staged ? staged : dst;
+    UringBackend::Completion cb = [this, h, dst, staged, done = std::move(done)](int res) {
+        if (staged) {
+            if (res > 0) {
+                std::memcpy(dst, staged, static_cast<size_t>(res));
+            }
+            h.ring->ReleaseBuffer(staged);
+        }
+        ReleaseFd(h);
+        done(FromCqe(res));
+    };
+    const bool fixed = h.reg_slot >= 0;
+    if (!ring->SubmitRead(fixed ? h.reg_slot : h.fd, fixed, target, length, offset, std::move(cb))) {
+        Result r = PreadFd(chunk_id, h.fd, target, length, offset);
+        cb(r.bytes < 0 ? -r.err : static_cast<int>(r.bytes));
+    }
+}
+
+char* IOEngine::AcquireStaging(UringBackend* ring, size_t length) const {
+    if (!ring || length == 0 || length > ring->buffer_size()) {
+        return nullptr;
+    }
+    return ring->AcquireBuffer();
+}
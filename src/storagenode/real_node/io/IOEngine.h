@@ -2,10 +2,17 @@
 
 #include <cstdint>
 #include <sys/types.h>
-#include <list>
+#include <sys/uio.h>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+class AlignedBufferPool;
+class UringBackend;
 
 class IOEngine {
 public:
@@ -17,33 +24,100 @@ public:
     struct Options {
         Options();
         size_t max_open_files;
+        // fd cache is split into this many shards by chunk id hash.
+        size_t fd_cache_shards;
         bool sync_on_write;
+        // io_uring backend, one ring per device holding chunk files; silently falls
+        // back to pread/pwrite when unavailable.
+        bool use_io_uring;
+        unsigned io_uring_entries;
+        // Async payloads up to registered_buffer_size are copied through a registered
+        // buffer (read_fixed/write_fixed); larger ones go straight from caller memory.
+        size_t registered_buffer_count;
+        size_t registered_buffer_size;
+        // O_DIRECT chunk I/O through a pool of aligned buffers; unaligned heads/tails
+        // are read-modify-written. Takes precedence over io_uring.
+        bool direct_io;
+        size_t direct_io_alignment;
+        size_t aligned_buffer_count;
+        size_t aligned_buffer_size;
+        // Buffered mode only: start writeback right after each write and drop pages
+        // drop_behind_lag bytes behind the write position from the page cache.
+        bool drop_behind;
+        size_t drop_behind_lag;
     };
 
+    using Completion = std::function<void(const Result&)>;
+
     IOEngine(std::string base_path, Options opts = Options());
     ~IOEngine();
 
-    Result Write(const std::string& path, const void* data, size_t size, uint64_t offset, int flags, int mode);
-    Result Read(const std::string& path, uint64_t offset, size_t length, std::string& out, int flags);
-    Result Truncate(const std::string& path, uint64_t size, int flags, int mode);
+    // fds are cached by chunk id; path is only used to open the file on a cache miss.
+    Result Write(uint64_t chunk_id, const std::string& path, const void* data, size_t size,
+                 uint64_t offset, int flags, int mode);
+    Result Read(uint64_t chunk_id, const std::string& path, uint64_t offset, size_t length,
+                std::string& out, int flags);
+    Result Truncate(uint64_t chunk_id, const std::string& path, uint64_t size, int flags, int mode);
+
+    // Asynchronous variants. With io_uring active, done runs on the completion thread;
+    // otherwise the I/O is performed inline and done runs before the call returns.
+    // data/dst must stay valid until done is invoked.
+    void WriteAsync(uint64_t chunk_id, const std::string& path, const void* data, size_t size,
+                    uint64_t offset, int flags, int mode, Completion done);
+    void ReadAsync(uint64_t chunk_id, const std::string& path, uint64_t offset, size_t length,
+                   char* dst, int flags, Completion done);
+    // Gathered write of a scattered payload (e.g. IOBuf blocks) without flattening it first.
+    // The iovec array is kept by the engine; the memory it points at must outlive done.
+    void WritevAsync(uint64_t chunk_id, const std::string& path, std::vector<iovec> iov,
+                     uint64_t offset, int flags, int mode, Completion done);
+
+    bool AsyncEnabled() const;
 
 private:
-    int AcquireFd(const std::string& path, int flags, bool create_if_missing, int mode, int& err);
-    void ReleaseFd(const std::string& path, int flags);
-    void EvictIfNeeded();
-    int NormalizeFlags(int flags, bool write_access) const;
+    struct FdSlot;
+    struct FdShard;
 
-    struct FDEntry {
+    // A pinned fd. slot is null for an overflow fd (every cached slot pinned),
+    // which is closed on release instead of being returned to the cache.
+    struct FdHandle {
         int fd{-1};
-        bool writable{false};
-        std::list<std::string>::iterator lru_it;
-        size_t ref_count{0};
+        int reg_slot{-1};  // registered file index in ring's table, -1 if none
+        FdSlot* slot{nullptr};
+        UringBackend* ring{nullptr};  // ring of the device the file lives on
     };
 
-    std::mutex fd_mu_;
-    std::list<std::string> lru_;
-    std::unordered_map<std::string, FDEntry> fd_cache_;
+    bool AcquireFd(uint64_t chunk_id, const std::string& path, int flags, bool create_if_missing,
+                   int mode, FdHandle& handle, int& err);
+    void ReleaseFd(const FdHandle& handle);
+    int TakeSlotLocked(FdShard& shard);
+    FdShard& ShardFor(uint64_t chunk_id);
+    // Ring serving the device fd lives on, created on first use; null without io_uring.
+    UringBackend* RingFor(int fd);
+    std::unique_ptr<UringBackend> MakeRing() const;
+    int NormalizeFlags(int flags, bool write_access) const;
+    Result PwriteFd(uint64_t chunk_id, int fd, const void* data, size_t size, uint64_t offset) const;
+    Result PwritevFd(uint64_t chunk_id, int fd, const iovec* iov, int iovcnt, uint64_t offset) const;
+    Result PreadFd(uint64_t chunk_id, int fd, char* dst, size_t length, uint64_t offset) const;
+    Result DirectWrite(uint64_t chunk_id, int fd, const iovec* iov, int iovcnt, uint64_t offset) const;
+    Result DirectRead(uint64_t chunk_id, int fd, char* dst, size_t length, uint64_t offset) const;
+    void DropBehind(int fd, uint64_t offset, size_t length) const;
+    // Registered buffer of ring for an async payload of length bytes; null when the pool
+    // is disabled, exhausted or the payload does not fit one buffer.
+    char* AcquireStaging(UringBackend* ring, size_t length) const;
+
+    std::vector<std::unique_ptr<FdShard>> shards_;
 
     std::string base_path_;
     Options opts_;
+
+    // One ring per st_dev, so disks do not share a submission queue or a reaper thread.
+    // Rings are never removed before shutdown; FdSlot/FdHandle keep raw pointers to them.
+    std::mutex rings_mu_;
+    std::unordered_map<dev_t, std::unique_ptr<UringBackend>> rings_;
+    unsigned ring_file_slots_{0};
+    std::unique_ptr<AlignedBufferPool> direct_pool_;
+    // Direct-I/O locks striped by chunk: partial-block read-modify-write takes a
+    // stripe exclusively, aligned writes and all reads take it shared.
+    static constexpr size_t kRmwStripes = 16;
+    mutable std::shared_mutex rmw_mu_[kRmwStripes];
 };
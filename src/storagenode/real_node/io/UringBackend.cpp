@@ -0,0 +1,405 @@
+#include "UringBackend.h"
+
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#ifdef ZB_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace {
+
+// Low bit of user_data marks the linked fsync cqe of a write; 0 is the stop sentinel.
+constexpr uintptr_t kSyncTag = 1;
+constexpr unsigned kReapBatch = 64;
+
+} // namespace
+
+struct UringBackend::Op {
+    Completion done;
+    int remaining{1};
+    int io_res{0};
+    int sync_res{0};
+};
+
+struct UringBackend::Impl {
+#ifdef ZB_HAVE_LIBURING
+    io_uring ring{};
+#endif
+    std::mutex sq_mu;
+    std::condition_variable doorbell_cv;
+    unsigned queued{0};  // SQEs prepared but not yet submitted, guarded by sq_mu
+    std::mutex buf_mu;
+    char* slab{nullptr};
+    std::vector<char*> free_buffers;
+    bool buffers_registered{false};
+    bool stopping{false};
+};
+
+UringBackend::UringBackend(const Options& opts)
+    : opts_(opts), impl_(std::make_unique<Impl>()) {
+#ifdef ZB_HAVE_LIBURING
+    int rc = io_uring_queue_init(opts_.entries, &impl_->ring, 0);
+    if (rc < 0) {
+        std::cerr << "[UringBackend] io_uring_queue_init failed: " << -rc
+                  << ", falling back to blocking I/O" << std::endl;
+        return;
+    }
+
+    if (opts_.file_slots > 0) {
+        std::vector<int> empty(opts_.file_slots, -1);
+        rc = io_uring_register_files(&impl_->ring, empty.data(), opts_.file_slots);
+        if (rc < 0) {
+            std::cerr << "[UringBackend] register_files failed: " << -rc
+                      << ", using plain fds" << std::endl;
+            opts_.file_slots = 0;
+        }
+    }
+
+    if (opts_.buffer_count > 0 && opts_.buffer_size > 0) {
+        void* slab = nullptr;
+        if (::posix_memalign(&slab, opts_.buffer_alignment,
+                             opts_.buffer_count * opts_.buffer_size) == 0) {
+            impl_->slab = static_cast<char*>(slab);
+            std::vector<iovec> iovs(opts_.buffer_count);
+            impl_->free_buffers.reserve(opts_.buffer_count);
+            for (size_t i = 0; i < opts_.buffer_count; ++i) {
+                char* p = impl_->slab + i * opts_.buffer_size;
+                iovs[i].iov_base = p;
+                iovs[i].iov_len = opts_.buffer_size;
+                impl_->free_buffers.push_back(p);
+            }
+            rc = io_uring_register_buffers(&impl_->ring, iovs.data(),
+                                           static_cast<unsigned>(iovs.size()));
+            if (rc < 0) {
+                // Buffers stay usable as an aligned pool, just not as fixed buffers.
+                std::cerr << "[UringBackend] register_buffers failed: " << -rc << std::endl;
+            } else {
+                impl_->buffers_registered = true;
+            }
+        } else {
+            opts_.buffer_count = 0;
+        }
+    }
+
+    ready_ = true;
+    reaper_ = std::thread([this] { ReapLoop(); });
+    if (opts_.submit_batch > 1) {
+        doorbell_ = std::thread([this] { DoorbellLoop(); });
+    }
+#else
+    (void)opts_;
+#endif
+}
+
+UringBackend::~UringBackend() {
+    Shutdown();
+#ifdef ZB_HAVE_LIBURING
+    if (ready_) {
+        io_uring_queue_exit(&impl_->ring);
+    }
+#endif
+    std::free(impl_->slab);
+}
+
+void UringBackend::Shutdown() {
+#ifdef ZB_HAVE_LIBURING
+    if (!ready_) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk(impl_->sq_mu);
+        if (!impl_->stopping) {
+            impl_->stopping = true;
+            io_uring_sqe* sqe = io_uring_get_sqe(&impl_->ring);
+            while (!sqe) {
+                io_uring_submit(&impl_->ring);
+                sqe = io_uring_get_sqe(&impl_->ring);
+            }
+            io_uring_prep_nop(sqe);
+            io_uring_sqe_set_data(sqe, nullptr);
+            io_uring_submit(&impl_->ring);
+            impl_->queued = 0;
+        }
+    }
+    impl_->doorbell_cv.notify_all();
+    if (doorbell_.joinable()) {
+        doorbell_.join();
+    }
+    if (reaper_.joinable()) {
+        reaper_.join();
+    }
+#endif
+}
+
+bool UringBackend::UpdateFileSlot(int slot, int fd) {
+#ifdef ZB_HAVE_LIBURING
+    if (!ready_ || slot < 0 || static_cast<unsigned>(slot) >= opts_.file_slots) {
+        return false;
+    }
+    int rc = io_uring_register_files_update(&impl_->ring, static_cast<unsigned>(slot), &fd, 1);
+    return rc >= 0;
+#else
+    (void)slot;
+    (void)fd;
+    return false;
+#endif
+}
+
+int UringBackend::BufferIndex(const void* p, size_t len) const {
+    if (!impl_->buffers_registered) {
+        return -1;
+    }
+    const char* c = static_cast<const char*>(p);
+    if (c < impl_->slab || c >= impl_->slab + opts_.buffer_count * opts_.buffer_size) {
+        return -1;
+    }
+    size_t idx = static_cast<size_t>(c - impl_->slab) / opts_.buffer_size;
+    if (c + len > impl_->slab + (idx + 1) * opts_.buffer_size) {
+        return -1;
+    }
+    return static_cast<int>(idx);
+}
+
+bool UringBackend::SubmitWrite(int fd_or_slot, bool fixed_file, const void* data, size_t size,
+                               uint64_t offset, bool link_fsync, Completion&& done) {
+#ifdef ZB_HAVE_LIBURING
+    int buf_index = BufferIndex(data, size);
+    return QueueWrite(fd_or_slot, fixed_file, link_fsync, std::move(done), [&](void* p) {
+        auto* sqe = static_cast<io_uring_sqe*>(p);
+        if (buf_index >= 0) {
+            io_uring_prep_write_fixed(sqe, fd_or_slot, data, static_cast<unsigned>(size), offset, buf_index);
+        } else {
+            io_uring_prep_write(sqe, fd_or_slot, data, static_cast<unsigned>(size), offset);
+        }
+    });
+#else
+    (void)fd_or_slot; (void)fixed_file; (void)data; (void)size;
+    (void)offset; (void)link_fsync; (void)done;
+    return false;
+#endif
+}
+
+bool UringBackend::SubmitWritev(int fd_or_slot, bool fixed_file, const iovec* iov, int iovcnt,
+                                uint64_t offset, bool link_fsync, Completion&& done) {
+#ifdef ZB_HAVE_LIBURING
+    return QueueWrite(fd_or_slot, fixed_file, link_fsync, std::move(done), [&](void* p) {
+        io_uring_prep_writev(static_cast<io_uring_sqe*>(p), fd_or_slot, iov,
+                             static_cast<unsigned>(iovcnt), offset);
+    });
+#else
+    (void)fd_or_slot; (void)fixed_file; (void)iov; (void)iovcnt;
+    (void)offset; (void)link_fsync; (void)done;
+    return false;
+#endif
+}
+
+bool UringBackend::QueueWrite(int fd_or_slot, bool fixed_file, bool link_fsync, Completion&& done,
+                              const std::function<void(void* sqe)>& prep) {
+#ifdef ZB_HAVE_LIBURING
+    if (!ready_) {
+        return false;
+    }
+    const unsigned needed = link_fsync ? 2 : 1;
+    std::unique_lock<std::mutex> lk(impl_->sq_mu);
+    if (impl_->stopping) {
+        return false;
+    }
+    if (io_uring_sq_space_left(&impl_->ring) < needed) {
+        io_uring_submit(&impl_->ring);
+        impl_->queued = 0;
+        if (io_uring_sq_space_left(&impl_->ring) < needed) {
+            return false;
+        }
+    }
+
+    auto* op = new Op();
+    op->done = std::move(done);
+    op->remaining = static_cast<int>(needed);
+
+    io_uring_sqe* sqe = io_uring_get_sqe(&impl_->ring);
+    prep(sqe);
+    if (fixed_file) {
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    io_uring_sqe_set_data(sqe, op);
+
+    if (link_fsync) {
+        sqe->flags |= IOSQE_IO_LINK;
+        io_uring_sqe* sync_sqe = io_uring_get_sqe(&impl_->ring);
+        io_uring_prep_fsync(sync_sqe, fd_or_slot, IORING_FSYNC_DATASYNC);
+        if (fixed_file) {
+            sync_sqe->flags |= IOSQE_FIXED_FILE;
+        }
+        io_uring_sqe_set_data(sync_sqe,
+                              reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(op) | kSyncTag));
+    }
+
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+    const bool wake = KickLocked(needed);
+    lk.unlock();
+    if (wake) {
+        impl_->doorbell_cv.notify_one();
+    }
+    return true;
+#else
+    (void)fd_or_slot; (void)fixed_file; (void)link_fsync; (void)done; (void)prep;
+    return false;
+#endif
+}
+
+bool UringBackend::SubmitRead(int fd_or_slot, bool fixed_file, void* dst, size_t length,
+                              uint64_t offset, Completion&& done) {
+#ifdef ZB_HAVE_LIBURING
+    if (!ready_) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lk(impl_->sq_mu);
+    if (impl_->stopping) {
+        return false;
+    }
+    if (io_uring_sq_space_left(&impl_->ring) < 1) {
+        io_uring_submit(&impl_->ring);
+        impl_->queued = 0;
+        if (io_uring_sq_space_left(&impl_->ring) < 1) {
+            return false;
+        }
+    }
+
+    auto* op = new Op();
+    op->done = std::move(done);
+
+    io_uring_sqe* sqe = io_uring_get_sqe(&impl_->ring);
+    int buf_index = BufferIndex(dst, length);
+    if (buf_index >= 0) {
+        io_uring_prep_read_fixed(sqe, fd_or_slot, dst, static_cast<unsigned>(length), offset, buf_index);
+    } else {
+        io_uring_prep_read(sqe, fd_or_slot, dst, static_cast<unsigned>(length), offset);
+    }
+    if (fixed_file) {
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+    io_uring_sqe_set_data(sqe, op);
+
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+    const bool wake = KickLocked(1);
+    lk.unlock();
+    if (wake) {
+        impl_->doorbell_cv.notify_one();
+    }
+    return true;
+#else
+    (void)fd_or_slot; (void)fixed_file; (void)dst; (void)length; (void)offset; (void)done;
+    return false;
+#endif
+}
+
+bool UringBackend::KickLocked(unsigned queued) {
+#ifdef ZB_HAVE_LIBURING
+    impl_->queued += queued;
+    if (opts_.submit_batch <= 1 || impl_->queued >= opts_.submit_batch) {
+        io_uring_submit(&impl_->ring);
+        impl_->queued = 0;
+        return false;
+    }
+    // Only the first SQE of a partial batch rings; later ones ride the same wakeup.
+    return impl_->queued == queued;
+#else
+    (void)queued;
+    return false;
+#endif
+}
+
+void UringBackend::DoorbellLoop() {
+#ifdef ZB_HAVE_LIBURING
+    std::unique_lock<std::mutex> lk(impl_->sq_mu);
+    while (true) {
+        impl_->doorbell_cv.wait(lk, [this] { return impl_->queued > 0 || impl_->stopping; });
+        // Everything queued while this thread was being scheduled goes in one submit.
+        if (impl_->queued > 0) {
+            io_uring_submit(&impl_->ring);
+            impl_->queued = 0;
+        }
+        if (impl_->stopping) {
+            break;
+        }
+    }
+#endif
+}
+
+char* UringBackend::AcquireBuffer() {
+    std::lock_guard<std::mutex> lk(impl_->buf_mu);
+    if (impl_->free_buffers.empty()) {
+        return nullptr;
+    }
+    char* p = impl_->free_buffers.back();
+    impl_->free_buffers.pop_back();
+    return p;
+}
+
+void UringBackend::ReleaseBuffer(char* buf) {
+    if (!buf) {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(impl_->buf_mu);
+    impl_->free_buffers.push_back(buf);
+}
+
+void UringBackend::ReapLoop() {
+#ifdef ZB_HAVE_LIBURING
+    bool stop_seen = false;
+    std::vector<Op*> finished;
+    finished.reserve(kReapBatch);
+    while (!(stop_seen && inflight_.load(std::memory_order_relaxed) == 0)) {
+        io_uring_cqe* cqe = nullptr;
+        int rc = io_uring_wait_cqe(&impl_->ring, &cqe);
+        if (rc == -EINTR) {
+            continue;
+        }
+        if (rc < 0) {
+            std::cerr << "[UringBackend] wait_cqe failed: " << -rc << std::endl;
+            break;
+        }
+
+        io_uring_cqe* batch[kReapBatch];
+        unsigned n = io_uring_peek_batch_cqe(&impl_->ring, batch, kReapBatch);
+        for (unsigned i = 0; i < n; ++i) {
+            uintptr_t tag = static_cast<uintptr_t>(batch[i]->user_data);
+            if (tag == 0) {
+                stop_seen = true;
+                continue;
+            }
+            Op* op = reinterpret_cast<Op*>(tag & ~kSyncTag);
+            if (tag & kSyncTag) {
+                op->sync_res = batch[i]->res;
+            } else {
+                op->io_res = batch[i]->res;
+            }
+            if (--op->remaining == 0) {
+                finished.push_back(op);
+            }
+        }
+        io_uring_cq_advance(&impl_->ring, n);
+
+        // Completions run after the CQ slots are returned so they may resubmit freely.
+        for (Op* op : finished) {
+            int res = op->io_res;
+            if (res >= 0 && op->sync_res < 0) {
+                res = op->sync_res;
+            }
+            if (op->done) {
+                op->done(res);
+            }
+            delete op;
+            inflight_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        finished.clear();
+    }
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Thin io_uring wrapper owned by IOEngine, which keeps one per device holding chunk
+// files so disks never share a submission queue: a submission ring, a sparse registered-file
+// table mirrored from the fd cache, an optional pool of registered buffers that
+// IOEngine stages small async payloads through, a doorbell thread that submits
+// queued SQEs in batches, and a reaper thread that runs completions.
+// Built as a no-op (Available() == false) when liburing is not present.
+class UringBackend {
+public:
+    struct Options {
+        unsigned entries{256};
+        unsigned file_slots{0};
+        size_t buffer_count{0};
+        size_t buffer_size{0};
+        size_t buffer_alignment{4096};
+        // SQEs are queued and handed to the kernel once submit_batch of them are pending,
+        // or when the doorbell thread wakes up, whichever comes first. <= 1 submits inline.
+        unsigned submit_batch{16};
+    };
+
+    // res is the raw cqe result: bytes on success, -errno on failure.
+    using Completion = std::function<void(int res)>;
+
+    explicit UringBackend(const Options& opts);
+    ~UringBackend();
+
+    UringBackend(const UringBackend&) = delete;
+    UringBackend& operator=(const UringBackend&) = delete;
+
+    // True when the ring was created and the reaper thread is running.
+    bool Available() const { return ready_; }
+
+    // Refuses new submissions, flushes queued SQEs and joins the doorbell and reaper
+    // threads once every in-flight completion has run. Idempotent; the destructor calls it.
+    void Shutdown();
+
+    // Installs fd into registered slot (fd == -1 clears it). Returns false on failure.
+    bool UpdateFileSlot(int slot, int fd);
+
+    // Queues a write (optionally linked with fdatasync) or a read; false means the
+    // request was not queued (ring full or backend unavailable) and done is left untouched.
+    // fd_or_slot is a registered slot when fixed_file is true.
+    bool SubmitWrite(int fd_or_slot, bool fixed_file, const void* data, size_t size,
+                     uint64_t offset, bool link_fsync, Completion&& done);
+    bool SubmitRead(int fd_or_slot, bool fixed_file, void* dst, size_t length,
+                    uint64_t offset, Completion&& done);
+    // Gathered write; iov must stay valid until done runs.
+    bool SubmitWritev(int fd_or_slot, bool fixed_file, const iovec* iov, int iovcnt,
+                      uint64_t offset, bool link_fsync, Completion&& done);
+
+    // Registered buffer pool; Acquire returns nullptr when exhausted. Reads and writes
+    // whose memory lies inside one pool buffer are submitted as read_fixed/write_fixed.
+    char* AcquireBuffer();
+    void ReleaseBuffer(char* buf);
+    size_t buffer_size() const { return opts_.buffer_size; }
+
+    size_t inflight() const { return inflight_.load(std::memory_order_relaxed); }
+
+private:
+    struct Impl;
+    struct Op;
+
+    int BufferIndex(const void* p, size_t len) const;
+    // Shared by SubmitWrite/SubmitWritev; prep fills the write sqe (an io_uring_sqe*).
+    bool QueueWrite(int fd_or_slot, bool fixed_file, bool link_fsync, Completion&& done,
+                    const std::function<void(void* sqe)>& prep);
+    // Caller holds sq_mu; counts the queued SQEs and submits when the batch is full.
+    // Returns true when the doorbell thread must be woken for a partial batch.
+    bool KickLocked(unsigned queued);
+    void DoorbellLoop();
+    void ReapLoop();
+
+    Options opts_;
+    std::unique_ptr<Impl> impl_;
+    bool ready_{false};
+    std::atomic<size_t> inflight_{0};
+    std::thread doorbell_;
+    std::thread reaper_;
+};
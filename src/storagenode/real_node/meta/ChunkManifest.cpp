@@ -0,0 +1,736 @@
+#include "ChunkManifest.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "common/Crc32c.h"
+#include "common/FileUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// All on-disk integers are in host byte order (little-endian everywhere we run).
+// The header is followed by the data root list: roots_bytes of NUL-terminated
+// paths, covered by the header CRC.
+struct SnapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t crc;      // CRC32C of the header with crc = 0, then the root list
+    uint64_t wal_gen;  // first WAL generation not covered by the snapshot
+    uint64_t entries;
+    uint64_t blocks;
+    uint32_t roots;
+    uint32_t roots_bytes;
+};
+static_assert(sizeof(SnapHeader) == 48, "snapshot header layout");
+constexpr uint32_t kMaxRootsBytes = 1u << 20;
+
+// Followed by count chunk ids (8 bytes each), then count root bytes.
+struct BlockHeader {
+    uint32_t count;
+    uint32_t crc;  // CRC32C of the payload
+};
+static_assert(sizeof(BlockHeader) == 8, "snapshot block header layout");
+
+constexpr char kSnapMagic[8] = {'Z', 'B', 'C', 'M', 'S', 'N', 'P', '1'};
+constexpr uint32_t kSnapVersion = 1;
+// Every block but the last is full, so block i starts at a computable offset.
+constexpr size_t kBlockEntries = 64 * 1024;
+constexpr size_t kBlockBytes = sizeof(BlockHeader) + kBlockEntries * 9;
+
+constexpr uint8_t kOpAdd = 1;
+constexpr uint8_t kOpDel = 2;
+
+bool ReadAt(int fd, void* data, size_t n, off_t off) {
+    auto* p = static_cast<char*>(data);
+    while (n > 0) {
+        ssize_t r = ::pread(fd, p, n, off);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        p += r;
+        n -= static_cast<size_t>(r);
+        off += r;
+    }
+    return true;
+}
+
+template <typename F>
+void RunParallel(unsigned threads, F&& fn) {
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&fn, t]() { fn(t); });
+    }
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+} // namespace
+
+struct ChunkManifest::Record {
+    uint64_t chunk_id;
+    uint8_t op;
+    uint8_t root;
+    uint16_t reserved;
+    uint32_t crc;  // CRC32C of the first 12 bytes
+};
+
+// Linear-probing table: keys plus one tag byte per slot holding the root,
+// kEmpty or kTomb. Callers hold mu.
+class ChunkManifest::Shard {
+public:
+    mutable std::shared_mutex mu;
+
+    uint8_t Find(uint64_t key, uint64_t hash) const {
+        if (keys_.empty()) {
+            return kNoRoot;
+        }
+        const size_t mask = keys_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (tags_[i] == kEmpty) {
+                return kNoRoot;
+            }
+            if (tags_[i] != kTomb && keys_[i] == key) {
+                return tags_[i];
+            }
+        }
+    }
+
+    // Returns the previous root (kNoRoot if the key was new). An existing
+    // entry only changes when overwrite is set.
+    uint8_t Put(uint64_t key, uint64_t hash, uint8_t root, bool overwrite) {
+        if ((used_ + 1) * 10 > keys_.size() * 7) {
+            Rehash(CapacityFor(live_ + 1));
+        }
+        const size_t mask = keys_.size() - 1;
+        size_t tomb = keys_.size();
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (tags_[i] == kEmpty) {
+                if (tomb == keys_.size()) {
+                    tomb = i;
+                    ++used_;
+                }
+                keys_[tomb] = key;
+                tags_[tomb] = root;
+                ++live_;
+                return kNoRoot;
+            }
+            if (tags_[i] == kTomb) {
+                if (tomb == keys_.size()) {
+                    tomb = i;
+                }
+                continue;
+            }
+            if (keys_[i] == key) {
+                const uint8_t old = tags_[i];
+                if (overwrite) {
+                    tags_[i] = root;
+                }
+                return old;
+            }
+        }
+    }
+
+    bool Remove(uint64_t key, uint64_t hash) {
+        if (keys_.empty()) {
+            return false;
+        }
+        const size_t mask = keys_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (tags_[i] == kEmpty) {
+                return false;
+            }
+            if (tags_[i] != kTomb && keys_[i] == key) {
+                tags_[i] = kTomb;
+                --live_;
+                return true;
+            }
+        }
+    }
+
+    void Reserve(size_t n) {
+        if (n * 10 > keys_.size() * 7) {
+            Rehash(CapacityFor(n));
+        }
+    }
+
+    template <typename F>
+    void ForEach(F&& fn) const {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (tags_[i] != kEmpty && tags_[i] != kTomb) {
+                fn(keys_[i], tags_[i]);
+            }
+        }
+    }
+
+    // Replaces every root r by to[r]; entries mapped to kNoRoot are dropped.
+    void Remap(const std::vector<uint8_t>& to) {
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (tags_[i] == kEmpty || tags_[i] == kTomb) {
+                continue;
+            }
+            const uint8_t root = tags_[i] < to.size() ? to[tags_[i]] : kNoRoot;
+            if (root == kNoRoot) {
+                tags_[i] = kTomb;
+                --live_;
+            } else {
+                tags_[i] = root;
+            }
+        }
+    }
+
+    size_t live() const { return live_; }
+
+private:
+    static constexpr uint8_t kEmpty = 0xFF;
+    static constexpr uint8_t kTomb = 0xFE;
+
+    // Power of two keeping n entries at most half full.
+    static size_t CapacityFor(size_t n) {
+        size_t cap = 16;
+        while (cap < n * 2) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+
+    void Rehash(size_t cap) {
+        std::vector<uint64_t> keys(cap);
+        std::vector<uint8_t> tags(cap, kEmpty);
+        const size_t mask = cap - 1;
+        for (size_t i = 0; i < keys_.size(); ++i) {
+            if (tags_[i] == kEmpty || tags_[i] == kTomb) {
+                continue;
+            }
+            size_t j = Mix64(keys_[i]) & mask;
+            while (tags[j] != kEmpty) {
+                j = (j + 1) & mask;
+            }
+            keys[j] = keys_[i];
+            tags[j] = tags_[i];
+        }
+        keys_.swap(keys);
+        tags_.swap(tags);
+        used_ = live_;
+    }
+
+    std::vector<uint64_t> keys_;
+    std::vector<uint8_t> tags_;
+    size_t used_{0};  // live + tombstones
+    size_t live_{0};
+};
+
+ChunkManifest::ChunkManifest(std::string base) : ChunkManifest(std::move(base), Options{}) {}
+
+ChunkManifest::ChunkManifest(std::string base, Options opts)
+    : base_(std::move(base)), opts_(opts) {
+    const size_t n = std::max<size_t>(1, opts_.shards);
+    shards_.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+ChunkManifest::~ChunkManifest() {
+    {
+        std::lock_guard<std::mutex> lk(loop_mu_);
+        stop_ = true;
+    }
+    loop_cv_.notify_all();
+    if (loop_.joinable()) {
+        loop_.join();
+    }
+    std::lock_guard<std::mutex> lk(wal_mu_);
+    if (wal_fd_ >= 0) {
+        ::close(wal_fd_);
+        wal_fd_ = -1;
+    }
+}
+
+size_t ChunkManifest::ShardOf(uint64_t hash) const {
+    // The low bits pick the slot inside the shard.
+    return static_cast<size_t>(hash >> 40) % shards_.size();
+}
+
+std::string ChunkManifest::WalPath(uint64_t gen) const {
+    return base_ + "." + std::to_string(gen) + ".wal";
+}
+
+std::vector<uint64_t> ChunkManifest::ListWalGens() const {
+    const fs::path base(base_);
+    std::error_code ec;
+    return ListNumberedFiles(base.parent_path().string(), base.filename().string() + ".", ".wal", ec);
+}
+
+bool ChunkManifest::Load() {
+    unsigned threads = opts_.replay_threads;
+    if (threads == 0) {
+        threads = std::min(16u, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t gen = 0;
+    bool ok = LoadSnapshot(gen, threads);
+    ok = ReplayWal(gen, threads) && ok;
+    size_t live = 0;
+    for (const auto& shard : shards_) {
+        live += shard->live();
+    }
+    live_.store(live, std::memory_order_relaxed);
+    if (!OpenWal(wal_gen_)) {
+        ok = false;
+    }
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "ChunkManifest: loaded " << live << " chunks from " << base_
+              << " (wal records " << wal_records_ << ") in " << ms << " ms" << std::endl;
+    if (opts_.checkpoint_records > 0) {
+        loop_ = std::thread([this]() { CheckpointLoop(); });
+    }
+    return ok;
+}
+
+bool ChunkManifest::LoadSnapshot(uint64_t& gen, unsigned threads) {
+    const std::string path = base_ + ".snap";
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        std::cerr << "ChunkManifest: failed to open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    empty_on_disk_ = false;
+    SnapHeader hdr{};
+    std::string root_bytes;
+    bool ok = ReadAt(fd, &hdr, sizeof(hdr), 0) && std::memcmp(hdr.magic, kSnapMagic, sizeof(kSnapMagic)) == 0 &&
+              hdr.version == kSnapVersion && hdr.roots_bytes <= kMaxRootsBytes;
+    if (ok) {
+        root_bytes.resize(hdr.roots_bytes);
+        ok = ReadAt(fd, &root_bytes[0], root_bytes.size(), sizeof(hdr));
+    }
+    if (ok) {
+        SnapHeader check = hdr;
+        check.crc = 0;
+        ok = Crc32cExtend(Crc32c(&check, sizeof(check)), root_bytes.data(), root_bytes.size()) == hdr.crc;
+    }
+    const size_t data_start = sizeof(hdr) + root_bytes.size();
+    std::vector<std::string> roots;
+    for (size_t pos = 0; ok && pos < root_bytes.size();) {
+        const size_t end = root_bytes.find('\0', pos);
+        if (end == std::string::npos) {
+            ok = false;
+            break;
+        }
+        roots.push_back(root_bytes.substr(pos, end - pos));
+        pos = end + 1;
+    }
+    if (!ok || roots.size() != hdr.roots) {
+        std::cerr << "ChunkManifest: bad snapshot header in " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lk(checkpoint_mu_);
+        roots_ = std::move(roots);
+    }
+
+    // Phase 1: blocks are read, verified and split by shard on every thread.
+    const size_t nshards = shards_.size();
+    threads = static_cast<unsigned>(std::max<uint64_t>(1, std::min<uint64_t>(threads, hdr.blocks)));
+    std::vector<std::vector<std::vector<uint64_t>>> parts(threads, std::vector<std::vector<uint64_t>>(nshards));
+    std::vector<std::vector<std::vector<uint8_t>>> part_roots(threads, std::vector<std::vector<uint8_t>>(nshards));
+    std::atomic<bool> bad{false};
+    RunParallel(threads, [&](unsigned t) {
+        std::vector<uint8_t> buf(kBlockEntries * 9);
+        for (uint64_t b = t; b < hdr.blocks; b += threads) {
+            const off_t off = static_cast<off_t>(data_start + b * kBlockBytes);
+            BlockHeader bh{};
+            if (!ReadAt(fd, &bh, sizeof(bh), off) || bh.count > kBlockEntries ||
+                (b + 1 < hdr.blocks && bh.count != kBlockEntries) ||
+                !ReadAt(fd, buf.data(), static_cast<size_t>(bh.count) * 9, off + sizeof(bh)) ||
+                Crc32c(buf.data(), static_cast<size_t>(bh.count) * 9) != bh.crc) {
+                std::cerr << "ChunkManifest: snapshot block " << b << " is corrupt" << std::endl;
+                bad = true;
+                continue;
+            }
+            const uint8_t* roots = buf.data() + static_cast<size_t>(bh.count) * 8;
+            for (uint32_t i = 0; i < bh.count; ++i) {
+                uint64_t id;
+                std::memcpy(&id, buf.data() + static_cast<size_t>(i) * 8, 8);
+                const size_t s = ShardOf(Mix64(id));
+                parts[t][s].push_back(id);
+                part_roots[t][s].push_back(roots[i]);
+            }
+        }
+    });
+    ::close(fd);
+
+    // Phase 2: each shard is filled by one thread.
+    RunParallel(threads, [&](unsigned t) {
+        for (size_t s = t; s < nshards; s += threads) {
+            size_t n = 0;
+            for (unsigned p = 0; p < threads; ++p) {
+                n += parts[p][s].size();
+            }
+            Shard& shard = *shards_[s];
+            std::unique_lock<std::shared_mutex> lk(shard.mu);
+            shard.Reserve(n);
+            for (unsigned p = 0; p < threads; ++p) {
+                for (size_t i = 0; i < parts[p][s].size(); ++i) {
+                    const uint64_t id = parts[p][s][i];
+                    shard.Put(id, Mix64(id), part_roots[p][s][i], true);
+                }
+                std::vector<uint64_t>().swap(parts[p][s]);
+                std::vector<uint8_t>().swap(part_roots[p][s]);
+            }
+        }
+    });
+    gen = hdr.wal_gen;
+    wal_gen_ = gen;
+    return !bad;
+}
+
+bool ChunkManifest::ReplayWal(uint64_t from_gen, unsigned threads) {
+    // Records are split by shard in log order, then shards replay in parallel.
+    std::vector<std::vector<Record>> ops(shards_.size());
+    uint64_t total = 0;
+    auto gens = ListWalGens();
+    size_t replayed_files = 0;
+    for (uint64_t g : gens) {
+        const std::string path = WalPath(g);
+        if (g < from_gen) {
+            // Covered by the snapshot; left behind by a crash during checkpoint.
+            std::remove(path.c_str());
+            continue;
+        }
+        empty_on_disk_ = false;
+        ++replayed_files;
+        wal_gen_ = std::max(wal_gen_, g);
+        int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "ChunkManifest: failed to open " << path << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        struct stat st {};
+        std::vector<Record> records;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            records.resize(static_cast<size_t>(st.st_size) / sizeof(Record));
+            if (!records.empty() && !ReadAt(fd, records.data(), records.size() * sizeof(Record), 0)) {
+                records.clear();
+            }
+        }
+        size_t good = 0;
+        for (; good < records.size(); ++good) {
+            const Record& r = records[good];
+            if (Crc32c(&r, offsetof(Record, crc)) != r.crc || (r.op != kOpAdd && r.op != kOpDel)) {
+                break;
+            }
+            ops[ShardOf(Mix64(r.chunk_id))].push_back(r);
+        }
+        if (static_cast<off_t>(good * sizeof(Record)) != st.st_size) {
+            // Torn or corrupt tail: everything from the first bad record on is dropped.
+            std::cerr << "ChunkManifest: truncating " << path << " at record " << good << std::endl;
+            if (::ftruncate(fd, static_cast<off_t>(good * sizeof(Record))) != 0) {
+                std::cerr << "ChunkManifest: truncate failed: " << std::strerror(errno) << std::endl;
+            }
+        }
+        ::close(fd);
+        total += good;
+    }
+
+    const size_t nshards = shards_.size();
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, nshards)));
+    RunParallel(threads, [&](unsigned t) {
+        for (size_t s = t; s < nshards; s += threads) {
+            Shard& shard = *shards_[s];
+            std::unique_lock<std::shared_mutex> lk(shard.mu);
+            for (const Record& r : ops[s]) {
+                if (r.op == kOpAdd) {
+                    shard.Put(r.chunk_id, Mix64(r.chunk_id), r.root, true);
+                } else {
+                    shard.Remove(r.chunk_id, Mix64(r.chunk_id));
+                }
+            }
+        }
+    });
+    wal_records_ = total;
+    if (replayed_files > 1 ||
+        (opts_.checkpoint_records > 0 && total >= opts_.checkpoint_records)) {
+        want_checkpoint_ = true;
+    }
+    return true;
+}
+
+bool ChunkManifest::OpenWal(uint64_t gen) {
+    const std::string path = WalPath(gen);
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "ChunkManifest: failed to open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (opts_.sync_on_write) {
+        SyncDir();
+    }
+    std::lock_guard<std::mutex> lk(wal_mu_);
+    if (wal_fd_ >= 0) {
+        ::close(wal_fd_);
+    }
+    wal_fd_ = fd;
+    wal_gen_ = gen;
+    return true;
+}
+
+void ChunkManifest::SyncDir() const {
+    const std::string dir = fs::path(base_).parent_path().string();
+    int dfd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dfd >= 0) {
+        ::fsync(dfd);
+        ::close(dfd);
+    }
+}
+
+uint8_t ChunkManifest::Find(uint64_t chunk_id) const {
+    const uint64_t h = Mix64(chunk_id);
+    const Shard& shard = *shards_[ShardOf(h)];
+    std::shared_lock<std::shared_mutex> lk(shard.mu);
+    return shard.Find(chunk_id, h);
+}
+
+uint8_t ChunkManifest::Insert(uint64_t chunk_id, uint8_t root) {
+    const uint64_t h = Mix64(chunk_id);
+    Shard& shard = *shards_[ShardOf(h)];
+    std::unique_lock<std::shared_mutex> lk(shard.mu);
+    const uint8_t old = shard.Put(chunk_id, h, root, false);
+    if (old != kNoRoot) {
+        return old;
+    }
+    live_.fetch_add(1, std::memory_order_relaxed);
+    // Logged under the shard lock so records of one chunk keep their order.
+    Append(kOpAdd, chunk_id, root);
+    return root;
+}
+
+bool ChunkManifest::Erase(uint64_t chunk_id) {
+    const uint64_t h = Mix64(chunk_id);
+    Shard& shard = *shards_[ShardOf(h)];
+    std::unique_lock<std::shared_mutex> lk(shard.mu);
+    if (!shard.Remove(chunk_id, h)) {
+        return false;
+    }
+    live_.fetch_sub(1, std::memory_order_relaxed);
+    Append(kOpDel, chunk_id, kNoRoot);
+    return true;
+}
+
+void ChunkManifest::Import(uint64_t chunk_id, uint8_t root) {
+    const uint64_t h = Mix64(chunk_id);
+    Shard& shard = *shards_[ShardOf(h)];
+    std::unique_lock<std::shared_mutex> lk(shard.mu);
+    if (shard.Put(chunk_id, h, root, true) == kNoRoot) {
+        live_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ChunkManifest::Append(uint8_t op, uint64_t chunk_id, uint8_t root) {
+    static_assert(sizeof(Record) == 16, "WAL record layout");
+    Record r{};
+    r.chunk_id = chunk_id;
+    r.op = op;
+    r.root = root;
+    r.crc = Crc32c(&r, offsetof(Record, crc));
+    bool trigger = false;
+    {
+        std::lock_guard<std::mutex> lk(wal_mu_);
+        if (wal_fd_ >= 0 && (!WriteAll(wal_fd_, &r, sizeof(r)) ||
+                             (opts_.sync_on_write && ::fdatasync(wal_fd_) != 0))) {
+            std::cerr << "ChunkManifest: WAL write failed: " << std::strerror(errno) << std::endl;
+        }
+        ++wal_records_;
+        trigger = opts_.checkpoint_records > 0 && wal_records_ == opts_.checkpoint_records;
+    }
+    if (trigger) {
+        {
+            std::lock_guard<std::mutex> lk(loop_mu_);
+            want_checkpoint_ = true;
+        }
+        loop_cv_.notify_one();
+    }
+}
+
+std::vector<std::string> ChunkManifest::roots() const {
+    std::lock_guard<std::mutex> cp(checkpoint_mu_);
+    return roots_;
+}
+
+bool ChunkManifest::BindRoots(const std::vector<std::string>& roots) {
+    {
+        std::lock_guard<std::mutex> cp(checkpoint_mu_);
+        if (roots_ == roots) {
+            return true;
+        }
+        if (roots.size() > kMaxRoots) {
+            std::cerr << "ChunkManifest: " << roots.size() << " data roots, at most "
+                      << static_cast<int>(kMaxRoots) << " are supported" << std::endl;
+            return false;
+        }
+        if (!roots_.empty()) {
+            // Stored index i moves to the position of the same path in roots.
+            std::vector<uint8_t> to(roots_.size(), kNoRoot);
+            for (size_t i = 0; i < roots_.size(); ++i) {
+                auto it = std::find(roots.begin(), roots.end(), roots_[i]);
+                if (it == roots.end()) {
+                    std::cerr << "ChunkManifest: data root " << roots_[i] << " recorded in " << base_
+                              << " is no longer configured" << std::endl;
+                    return false;
+                }
+                to[i] = static_cast<uint8_t>(it - roots.begin());
+            }
+            size_t live = 0;
+            for (const auto& shard : shards_) {
+                std::unique_lock<std::shared_mutex> lk(shard->mu);
+                shard->Remap(to);
+                live += shard->live();
+            }
+            live_.store(live, std::memory_order_relaxed);
+            std::cout << "ChunkManifest: remapped " << roots_.size() << " data roots of " << base_ << std::endl;
+        }
+        roots_ = roots;
+    }
+    // WAL records carry root indexes, so the new list is checkpointed before
+    // anything is logged against it.
+    return Checkpoint();
+}
+
+bool ChunkManifest::Checkpoint() {
+    std::lock_guard<std::mutex> cp(checkpoint_mu_);
+    const auto start = std::chrono::steady_clock::now();
+
+    // 1. Rotate: from here on every change lands in the new generation, which
+    //    is replayed on top of the snapshot. Changes the snapshot also happens
+    //    to include are replayed again, which is harmless.
+    uint64_t gen = 0;
+    {
+        std::lock_guard<std::mutex> lk(wal_mu_);
+        gen = wal_gen_ + 1;
+        const std::string path = WalPath(gen);
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "ChunkManifest: failed to open " << path << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (wal_fd_ >= 0) {
+            ::close(wal_fd_);
+        }
+        wal_fd_ = fd;
+        wal_gen_ = gen;
+        wal_records_ = 0;
+        if (opts_.sync_on_write) {
+            SyncDir();
+        }
+    }
+
+    // 2. Snapshot, one shard at a time.
+    const std::string tmp = base_ + ".snap.tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "ChunkManifest: failed to create " << tmp << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    SnapHeader hdr{};
+    std::string root_bytes;
+    for (const auto& root : roots_) {
+        root_bytes.append(root);
+        root_bytes.push_back('\0');
+    }
+    hdr.roots = static_cast<uint32_t>(roots_.size());
+    hdr.roots_bytes = static_cast<uint32_t>(root_bytes.size());
+    bool ok = WriteAll(fd, &hdr, sizeof(hdr)) && WriteAll(fd, root_bytes.data(), root_bytes.size());
+    std::vector<uint8_t> block(kBlockEntries * 9);
+    size_t fill = 0;
+    auto flush = [&]() {
+        if (fill == 0 || !ok) {
+            return;
+        }
+        // Ids were packed at the front; move the roots right after them.
+        std::memmove(block.data() + fill * 8, block.data() + kBlockEntries * 8, fill);
+        BlockHeader bh{static_cast<uint32_t>(fill), Crc32c(block.data(), fill * 9)};
+        ok = WriteAll(fd, &bh, sizeof(bh)) && WriteAll(fd, block.data(), fill * 9);
+        hdr.entries += fill;
+        ++hdr.blocks;
+        fill = 0;
+    };
+    std::vector<std::pair<uint64_t, uint8_t>> copy;
+    for (const auto& shard : shards_) {
+        copy.clear();
+        {
+            std::shared_lock<std::shared_mutex> lk(shard->mu);
+            copy.reserve(shard->live());
+            shard->ForEach([&copy](uint64_t id, uint8_t root) { copy.emplace_back(id, root); });
+        }
+        for (const auto& e : copy) {
+            std::memcpy(block.data() + fill * 8, &e.first, 8);
+            block[kBlockEntries * 8 + fill] = e.second;
+            if (++fill == kBlockEntries) {
+                flush();
+            }
+        }
+    }
+    flush();
+    std::memcpy(hdr.magic, kSnapMagic, sizeof(kSnapMagic));
+    hdr.version = kSnapVersion;
+    hdr.wal_gen = gen;
+    hdr.crc = 0;
+    hdr.crc = Crc32cExtend(Crc32c(&hdr, sizeof(hdr)), root_bytes.data(), root_bytes.size());
+    ok = ok && ::pwrite(fd, &hdr, sizeof(hdr), 0) == static_cast<ssize_t>(sizeof(hdr)) && ::fsync(fd) == 0;
+    ::close(fd);
+    const std::string snap = base_ + ".snap";
+    if (!ok || std::rename(tmp.c_str(), snap.c_str()) != 0) {
+        std::cerr << "ChunkManifest: failed to write snapshot " << snap << std::endl;
+        std::remove(tmp.c_str());
+        return false;
+    }
+    SyncDir();
+
+    // 3. The WAL generations before gen are now covered.
+    for (uint64_t g : ListWalGens()) {
+        if (g < gen) {
+            std::remove(WalPath(g).c_str());
+        }
+    }
+    empty_on_disk_ = false;
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "ChunkManifest: checkpoint gen=" << gen << " entries=" << hdr.entries
+              << " in " << ms << " ms" << std::endl;
+    return true;
+}
+
+void ChunkManifest::CheckpointLoop() {
+    std::unique_lock<std::mutex> lk(loop_mu_);
+    while (true) {
+        loop_cv_.wait(lk, [this]() { return stop_ || want_checkpoint_; });
+        if (stop_) {
+            return;
+        }
+        want_checkpoint_ = false;
+        lk.unlock();
+        Checkpoint();
+        lk.lock();
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Persistent chunk_id -> data root index map of a storage node. Only the root
+// index is kept per chunk (the path is derived from it), in sharded
+// open-addressing tables of 9 bytes per slot. The root paths the indexes refer
+// to are stored once, in the snapshot header.
+//
+// On disk, next to `base`:
+//   <base>.snap       checkpoint: header with the data root list, plus
+//                     CRC32C-protected blocks of (chunk_id, root) entries
+//   <base>.<gen>.wal  16-byte CRC32C-protected ADD/DEL records logged since
+//                     checkpoint generation gen started
+// Load() decodes snapshot blocks on several threads, then replays the WAL
+// generations >= the snapshot's, partitioned by shard so that shards replay
+// in parallel. A torn WAL tail is cut at the first bad record. A background
+// thread checkpoints every checkpoint_records logged records; it rotates the
+// WAL first and copies one shard at a time, so writers are never blocked for
+// the whole snapshot.
+class ChunkManifest {
+public:
+    static constexpr uint8_t kNoRoot = 0xFF;
+    static constexpr uint8_t kMaxRoots = 0xFE;
+
+    struct Options {
+        size_t shards{64};
+        uint64_t checkpoint_records{1u << 20};  // 0 disables automatic checkpoints
+        unsigned replay_threads{0};             // 0 = hardware concurrency, at most 16
+        // fdatasync the WAL after every record, matching the data path's
+        // sync_on_write; otherwise records reach disk with the page cache.
+        bool sync_on_write{false};
+    };
+
+    explicit ChunkManifest(std::string base);
+    ChunkManifest(std::string base, Options opts);
+    ~ChunkManifest();
+
+    ChunkManifest(const ChunkManifest&) = delete;
+    ChunkManifest& operator=(const ChunkManifest&) = delete;
+
+    // Rebuilds the map from disk and opens the WAL. Returns false if a
+    // snapshot block failed its CRC (the verified part is still loaded) or
+    // the WAL cannot be opened.
+    bool Load();
+
+    // Root of chunk_id, or kNoRoot.
+    uint8_t Find(uint64_t chunk_id) const;
+    // Adds chunk_id on root unless present; returns the root it is on.
+    uint8_t Insert(uint64_t chunk_id, uint8_t root);
+    bool Erase(uint64_t chunk_id);
+    // Adds or moves an entry without logging it; for bulk imports that are
+    // followed by Checkpoint().
+    void Import(uint64_t chunk_id, uint8_t root);
+
+    size_t size() const { return live_.load(std::memory_order_relaxed); }
+    // True when neither a snapshot nor a WAL exists yet.
+    bool empty_on_disk() const { return empty_on_disk_; }
+
+    // Writes a snapshot of the current map and drops the WAL it covers.
+    bool Checkpoint();
+
+    // Data root paths the stored indexes refer to; empty for a fresh manifest.
+    std::vector<std::string> roots() const;
+    // Binds the manifest to the configured data roots after Load(). An
+    // unbound manifest adopts them; stored roots that moved to another
+    // position are remapped. Fails, leaving the map unchanged, if a stored
+    // root is missing from roots. A changed list is checkpointed at once.
+    bool BindRoots(const std::vector<std::string>& roots);
+
+private:
+    class Shard;
+    struct Record;
+
+    size_t ShardOf(uint64_t hash) const;
+    std::vector<uint64_t> ListWalGens() const;
+    std::string WalPath(uint64_t gen) const;
+    bool LoadSnapshot(uint64_t& gen, unsigned threads);
+    bool ReplayWal(uint64_t from_gen, unsigned threads);
+    bool OpenWal(uint64_t gen);
+    // Makes a newly created WAL or snapshot name durable.
+    void SyncDir() const;
+    void Append(uint8_t op, uint64_t chunk_id, uint8_t root);
+    void CheckpointLoop();
+
+    std::string base_;
+    Options opts_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<size_t> live_{0};
+    bool empty_on_disk_{true};
+
+    std::mutex wal_mu_;  // taken inside a shard lock, never the other way round
+    int wal_fd_{-1};
+    uint64_t wal_gen_{0};
+    uint64_t wal_records_{0};
+
+    mutable std::mutex checkpoint_mu_;  // one checkpoint at a time; guards roots_
+    std::vector<std::string> roots_;
+    std::mutex loop_mu_;
+    std::condition_variable loop_cv_;
+    bool stop_{false};
+    bool want_checkpoint_{false};
+    std::thread loop_;
+};
@@ -1,12 +1,11 @@
 #include "LocalMetadataManager.h"
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <mutex>
 #include <sstream>
-#include <shared_mutex>
 
 namespace fs = std::filesystem;
 
@@ -19,9 +18,14 @@ std::string EnsureTrailingSlash(const std::string& s) {
     return s;
 }
 
+bool EndsWith(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
 } // namespace
 
-LocalMetadataManager::LocalMetadataManager(std::vector<std::string> data_roots, std::string manifest_path)
+LocalMetadataManager::LocalMetadataManager(std::vector<std::string> data_roots, std::string manifest_path,
+                                           bool sync_on_write)
     : data_roots_(std::move(data_roots)) {
     for (auto& root : data_roots_) {
         root = EnsureTrailingSlash(root);
@@ -32,96 +36,142 @@ LocalMetadataManager::LocalMetadataManager(std::vector<std::string> data_roots,
         std::cerr << "LocalMetadataManager: no data roots configured" << std::endl;
         return;
     }
-    if (manifest_path.empty()) {
-        manifest_path_ = data_roots_[0] + "/chunk_manifest.log";
-    } else {
-        manifest_path_ = manifest_path;
+    if (data_roots_.size() > ChunkManifest::kMaxRoots) {
+        std::cerr << "LocalMetadataManager: only the first " << static_cast<int>(ChunkManifest::kMaxRoots)
+                  << " of " << data_roots_.size() << " data roots are used" << std::endl;
+        data_roots_.resize(ChunkManifest::kMaxRoots);
     }
-    LoadManifest();
-    manifest_out_.open(manifest_path_, std::ios::out | std::ios::app);
-    if (!manifest_out_.is_open()) {
-        std::cerr << "LocalMetadataManager: failed to open manifest " << manifest_path_ << std::endl;
+    std::string base = manifest_path.empty() ? data_roots_[0] + "/chunk_manifest" : manifest_path;
+    if (EndsWith(base, ".log")) {
+        base.resize(base.size() - 4);
     }
-}
 
-LocalMetadataManager::~LocalMetadataManager() {
-    if (manifest_out_.is_open()) {
-        manifest_out_.flush();
-        manifest_out_.close();
+    const auto start = std::chrono::steady_clock::now();
+    ChunkManifest::Options opts;
+    opts.sync_on_write = sync_on_write;
+    manifest_ = std::make_unique<ChunkManifest>(base, opts);
+    if (!manifest_->Load()) {
+        std::cerr << "LocalMetadataManager: manifest " << base << " loaded with errors" << std::endl;
     }
-}
-
-bool LocalMetadataManager::LoadManifest() {
+    const bool fresh = manifest_->empty_on_disk();
+    if (!manifest_->BindRoots(data_roots_)) {
+        // Serving with the wrong roots would hand out paths of other chunks.
+        std::cerr << "LocalMetadataManager: data roots do not match manifest " << base << std::endl;
+        manifest_.reset();
+        return;
+    }
+    const std::string legacy = base + ".log";
     std::error_code ec;
-    if (!fs::exists(manifest_path_, ec)) {
-        return true;
+    if (fresh && fs::exists(legacy, ec)) {
+        ImportLegacy(legacy);
     }
-    std::ifstream in(manifest_path_);
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "LocalMetadataManager: " << manifest_->size() << " chunks ready in " << ms << " ms" << std::endl;
+}
+
+LocalMetadataManager::~LocalMetadataManager() = default;
+
+bool LocalMetadataManager::ImportLegacy(const std::string& legacy) {
+    std::ifstream in(legacy);
     if (!in.is_open()) {
-        std::cerr << "LocalMetadataManager: failed to read manifest " << manifest_path_ << std::endl;
+        std::cerr << "LocalMetadataManager: failed to read manifest " << legacy << std::endl;
         return false;
     }
-    std::string op;
-    uint64_t chunk_id = 0;
-    std::string path;
-    while (in >> op >> chunk_id >> path) {
-        if (op == "ADD") {
-            path_map_[chunk_id] = path;
-        } else if (op == "DEL") {
-            path_map_.erase(chunk_id);
+    // Line based: DEL records carry an empty path, which a plain >> chain
+    // would read as the next line's op.
+    std::string line;
+    size_t imported = 0;
+    size_t skipped = 0;
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string op;
+        uint64_t chunk_id = 0;
+        std::string path;
+        if (!(ls >> op >> chunk_id)) {
+            continue;
+        }
+        ls >> path;
+        if (op == "DEL") {
+            manifest_->Erase(chunk_id);
+            continue;
+        }
+        if (op != "ADD") {
+            continue;
+        }
+        uint8_t root = ChunkManifest::kNoRoot;
+        for (size_t r = 0; r < data_roots_.size(); ++r) {
+            if (PathFor(static_cast<uint8_t>(r), chunk_id) == path) {
+                root = static_cast<uint8_t>(r);
+                break;
+            }
         }
+        if (root == ChunkManifest::kNoRoot) {
+            // Not under a configured root: the file cannot be addressed anymore.
+            ++skipped;
+            continue;
+        }
+        manifest_->Import(chunk_id, root);
+        ++imported;
+    }
+    if (!manifest_->Checkpoint()) {
+        return false;
     }
+    std::error_code ec;
+    fs::rename(legacy, legacy + ".imported", ec);
+    std::cout << "LocalMetadataManager: imported " << imported << " records from " << legacy
+              << " (" << skipped << " outside the data roots)" << std::endl;
     return true;
 }
 
 std::string LocalMetadataManager::GetPath(uint64_t chunk_id) const {
-    std::shared_lock<std::shared_mutex> lk(mu_);
-    auto it = path_map_.find(chunk_id);
-    if (it != path_map_.end()) {
-        return it->second;
+    if (!manifest_) {
+        return {};
+    }
+    const uint8_t root = manifest_->Find(chunk_id);
+    if (root >= data_roots_.size()) {
+        return {};
     }
-    return {};
+    return PathFor(root, chunk_id);
 }
 
 std::string LocalMetadataManager::AllocPath(uint64_t chunk_id) {
-    std::unique_lock<std::shared_mutex> lk(mu_);
-    auto it = path_map_.find(chunk_id);
-    if (it != path_map_.end()) {
-        return it->second;
+    if (!manifest_) {
+        return {};
     }
-    if (data_roots_.empty()) {
+    uint8_t root = manifest_->Find(chunk_id);
+    if (root == ChunkManifest::kNoRoot) {
+        const size_t pick = next_root_.fetch_add(1, std::memory_order_relaxed) % data_roots_.size();
+        std::string full_path = PathFor(static_cast<uint8_t>(pick), chunk_id);
+        std::error_code ec;
+        fs::create_directories(fs::path(full_path).parent_path(), ec);
+        // A concurrent AllocPath may have won; its root is returned then.
+        root = manifest_->Insert(chunk_id, static_cast<uint8_t>(pick));
+        if (root == pick) {
+            return full_path;
+        }
+    }
+    if (root >= data_roots_.size()) {
         return {};
     }
-    const std::string& root = data_roots_[next_root_ % data_roots_.size()];
-    ++next_root_;
-    std::string rel = ShardedRelativePath(chunk_id);
-    std::string full_path = root + "/" + rel;
-
-    std::error_code ec;
-    fs::create_directories(fs::path(full_path).parent_path(), ec);
-
-    path_map_[chunk_id] = full_path;
-    AppendRecord("ADD", chunk_id, full_path);
-    return full_path;
+    return PathFor(root, chunk_id);
 }
 
 void LocalMetadataManager::DeletePath(uint64_t chunk_id) {
-    std::unique_lock<std::shared_mutex> lk(mu_);
-    auto it = path_map_.find(chunk_id);
-    if (it == path_map_.end()) {
-        return;
+    if (manifest_) {
+        manifest_->Erase(chunk_id);
     }
-    path_map_.erase(it);
-    AppendRecord("DEL", chunk_id, "");
 }
 
-bool LocalMetadataManager::AppendRecord(const std::string& op, uint64_t chunk_id, const std::string& path) {
-    if (!manifest_out_.is_open()) {
-        return false;
-    }
-    manifest_out_ << op << ' ' << chunk_id << ' ' << path << '\n';
-    manifest_out_.flush();
-    return true;
+size_t LocalMetadataManager::ChunkCount() const {
+    return manifest_ ? manifest_->size() : 0;
+}
+
+std::string LocalMetadataManager::PathFor(uint8_t root, uint64_t chunk_id) const {
+    std::string path = data_roots_[root];
+    path.push_back('/');
+    path.append(ShardedRelativePath(chunk_id));
+    return path;
 }
 
 std::string LocalMetadataManager::ShardedRelativePath(uint64_t chunk_id) const {
@@ -1,16 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
-#include <fstream>
-#include <shared_mutex>
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-// Manages chunk_id -> local path mapping with a simple manifest log for persistence.
+#include "ChunkManifest.h"
+
+// Manages chunk_id -> local path mapping. Only the data root index is stored
+// per chunk (see ChunkManifest); the path is root + ShardedRelativePath(id).
+// The manifest records the root paths, so reordered or added roots are
+// remapped on start and a removed one is refused.
 class LocalMetadataManager {
 public:
-    LocalMetadataManager(std::vector<std::string> data_roots, std::string manifest_path = "");
+    // manifest_path is the manifest base name; a trailing ".log" (the old text
+    // manifest) is stripped. Defaults to <first root>/chunk_manifest.
+    // sync_on_write makes every manifest change durable before it returns.
+    LocalMetadataManager(std::vector<std::string> data_roots, std::string manifest_path = "",
+                         bool sync_on_write = false);
     ~LocalMetadataManager();
 
     // Returns the full path if present, otherwise empty.
@@ -20,15 +28,19 @@ public:
     // Removes mapping (best-effort) and records a delete marker.
     void DeletePath(uint64_t chunk_id);
 
+    size_t ChunkCount() const;
+    // False when no root is configured or the roots do not match the ones
+    // recorded in the manifest; every lookup fails then.
+    bool ok() const { return manifest_ != nullptr; }
+
 private:
-    bool LoadManifest();
-    bool AppendRecord(const std::string& op, uint64_t chunk_id, const std::string& path);
+    // Replays a text manifest ("ADD <id> <path>" / "DEL <id>") into the
+    // binary one, then renames it to <legacy>.imported.
+    bool ImportLegacy(const std::string& legacy);
+    std::string PathFor(uint8_t root, uint64_t chunk_id) const;
     std::string ShardedRelativePath(uint64_t chunk_id) const;
 
     std::vector<std::string> data_roots_;
-    std::string manifest_path_;
-    mutable std::shared_mutex mu_;
-    std::unordered_map<uint64_t, std::string> path_map_;
-    size_t next_root_{0};
-    std::ofstream manifest_out_;
+    std::unique_ptr<ChunkManifest> manifest_;
+    std::atomic<size_t> next_root_{0};
 };
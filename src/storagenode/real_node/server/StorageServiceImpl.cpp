@@ -3,13 +3,20 @@
 #include <brpc/closure_guard.h>
 #include <brpc/controller.h>
 #include <butil/crc32c.h>
+#include <google/protobuf/stubs/callback.h>
 
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <climits>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <iostream>
 #include <utility>
+#include <vector>
 
 namespace {
 
@@ -18,14 +25,104 @@ rpc::Status* Ok(rpc::Status* status) {
     return status;
 }
 
+class InFlightClosure : public google::protobuf::Closure {
+public:
+    InFlightClosure(std::atomic<uint64_t>* counter, google::protobuf::Closure* done)
+        : counter_(counter), done_(done) {
+        counter_->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Run() override {
+        counter_->fetch_sub(1, std::memory_order_relaxed);
+        if (done_) done_->Run();
+        delete this;
+    }
+
+private:
+    std::atomic<uint64_t>* counter_;
+    google::protobuf::Closure* done_;
+};
+
+// A replicated write: the local copy and the forward to the next node of the
+// chain run concurrently, and the caller is answered once both have finished.
+class ChainWrite {
+public:
+    ChainWrite(storagenode::WriteReply* response, google::protobuf::Closure* done)
+        : response_(response), done_(done) {}
+
+    brpc::Controller cntl;
+    storagenode::WriteRequest req;
+    storagenode::WriteReply resp;
+
+    void LocalDone(rpc::StatusCode code, std::string msg, uint64_t bytes) {
+        local_code_ = code;
+        local_msg_ = std::move(msg);
+        local_bytes_ = bytes;
+        Arrive();
+    }
+
+    // The forward could not be sent at all.
+    void ForwardFailed(std::string msg) {
+        forward_error_ = std::move(msg);
+        Arrive();
+    }
+
+    void Arrive() {
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Finish();
+        }
+    }
+
+private:
+    void Finish() {
+        auto* status = response_->mutable_status();
+        const std::string& next = req.node_id();
+        if (local_code_ != rpc::STATUS_SUCCESS) {
+            StatusUtils::SetStatus(status, local_code_, local_msg_);
+        } else if (!forward_error_.empty()) {
+            StatusUtils::SetStatus(status, rpc::STATUS_NETWORK_ERROR,
+                                   "replica " + next + ": " + forward_error_);
+            response_->set_replicas(1);
+        } else if (cntl.Failed()) {
+            StatusUtils::SetStatus(status, rpc::STATUS_NETWORK_ERROR,
+                                   "replica " + next + ": " + cntl.ErrorText());
+            response_->set_replicas(1);
+        } else if (StatusUtils::NormalizeCode(resp.status().code()) != rpc::STATUS_SUCCESS) {
+            StatusUtils::SetStatus(status, StatusUtils::NormalizeCode(resp.status().code()),
+                                   "replica " + next + ": " + resp.status().message());
+            response_->set_replicas(1);
+        } else {
+            // A node without chain support reports no replica count; it still wrote one copy.
+            response_->set_bytes_written(std::min<uint64_t>(local_bytes_, resp.bytes_written()));
+            response_->set_replicas(1 + std::max<uint32_t>(1, resp.replicas()));
+            Ok(status);
+        }
+        std::cout << "[RealNode] WriteResp(chain) chunk=" << req.chunk_id()
+                  << " replicas=" << response_->replicas()
+                  << " code=" << response_->status().code() << std::endl;
+        if (done_) done_->Run();
+        delete this;
+    }
+
+    storagenode::WriteReply* response_;
+    google::protobuf::Closure* done_;
+    std::atomic<int> pending_{2};
+    rpc::StatusCode local_code_{rpc::STATUS_UNKNOWN_ERROR};
+    std::string local_msg_;
+    uint64_t local_bytes_{0};
+    std::string forward_error_;
+};
+
 } // namespace
 
 StorageServiceImpl::StorageServiceImpl(std::shared_ptr<DiskManager> disk_manager,
                                        std::shared_ptr<LocalMetadataManager> metadata_mgr,
-                                       std::shared_ptr<IOEngine> io_engine)
+                                       std::shared_ptr<IOEngine> io_engine,
+                                       std::shared_ptr<ContainerStore> container_store)
     : disk_manager_(std::move(disk_manager)),
       metadata_mgr_(std::move(metadata_mgr)),
-      io_engine_(std::move(io_engine)) {
+      io_engine_(std::move(io_engine)),
+      container_store_(std::move(container_store)) {
     if (disk_manager_) {
         ready_ = disk_manager_->Prepare();
     } else {
@@ -37,37 +134,47 @@ void StorageServiceImpl::Write(::google::protobuf::RpcController* controller,
                                const storagenode::WriteRequest* request,
                                storagenode::WriteReply* response,
                                ::google::protobuf::Closure* done) {
-    (void)controller;
-    brpc::ClosureGuard guard(done);
+    auto* cntl = static_cast<brpc::Controller*>(controller);
+    brpc::ClosureGuard guard(Track(done));
     auto* status = response->mutable_status();
     if (!ready_) {
         StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "disk not ready");
         return;
     }
-    if (!metadata_mgr_) {
+    if (!container_store_ && !metadata_mgr_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "metadata manager is null");
         return;
     }
-    if (!io_engine_) {
+    if (!container_store_ && !io_engine_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "io engine is null");
         return;
     }
+    // Payload comes from the attachment when present, otherwise from the inline data field.
+    const butil::IOBuf& attachment = cntl->request_attachment();
+    const bool use_attachment = !attachment.empty();
+    const size_t payload_size = use_attachment ? attachment.size() : request->data().size();
     std::cout << "[RealNode] WriteReq chunk=" << request->chunk_id()
               << " offset=" << request->offset()
-              << " size=" << request->data().size() << std::endl;
+              << " size=" << payload_size
+              << " chain=" << request->chain_size() << std::endl;
     if (request->checksum() != 0) {
-        uint64_t actual = ComputeChecksum(request->data().data(), request->data().size());
+        uint64_t actual = use_attachment
+                              ? ComputeChecksum(attachment)
+                              : ComputeChecksum(request->data().data(), request->data().size());
         if (actual != request->checksum()) {
             StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "payload checksum mismatch");
             return;
         }
     }
-    std::string path = metadata_mgr_->GetPath(request->chunk_id());
-    if (path.empty()) {
-        path = metadata_mgr_->AllocPath(request->chunk_id());
+    std::string path;
+    if (!container_store_) {
+        path = metadata_mgr_->GetPath(request->chunk_id());
         if (path.empty()) {
-            StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "failed to allocate path");
-            return;
+            path = metadata_mgr_->AllocPath(request->chunk_id());
+            if (path.empty()) {
+                StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "failed to allocate path");
+                return;
+            }
         }
     }
 
@@ -80,41 +187,106 @@ void StorageServiceImpl::Write(::google::protobuf::RpcController* controller,
     }
     int mode = request->mode() == 0 ? 0644 : request->mode();
 
-    auto res = io_engine_->Write(path,
-                                 request->data().data(),
-                                 request->data().size(),
-                                 request->offset(),
-                                 flags,
-                                 mode);
-    if (res.bytes < 0 || res.err != 0) {
-        int err = res.err != 0 ? res.err : EIO;
-        StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
-                               res.err != 0 ? std::strerror(err) : "write failed");
+    // Write the attachment's blocks in place. Only a payload scattered over more
+    // than IOV_MAX blocks is flattened first.
+    std::vector<iovec> iov;
+    std::shared_ptr<std::string> flat;
+    if (use_attachment && attachment.backing_block_num() <= IOV_MAX) {
+        iov.reserve(attachment.backing_block_num());
+        for (size_t i = 0; i < attachment.backing_block_num(); ++i) {
+            auto block = attachment.backing_block(i);
+            iov.push_back(iovec{const_cast<char*>(block.data()), block.size()});
+        }
+    } else if (use_attachment) {
+        flat = std::make_shared<std::string>();
+        attachment.copy_to(flat.get());
+        iov.push_back(iovec{&(*flat)[0], flat->size()});
+    } else {
+        iov.push_back(iovec{const_cast<char*>(request->data().data()), request->data().size()});
+    }
+
+    // Replicated write: hand the payload to the next node before touching the
+    // local disk, so the copies are written concurrently and the chain costs
+    // about one extra hop rather than one per replica.
+    ChainWrite* chain = nullptr;
+    if (request->chain_size() > 0) {
+        chain = new ChainWrite(response, guard.release());
+        const auto& next = request->chain(0);
+        chain->req.CopyFrom(*request);
+        chain->req.set_node_id(next.node_id());
+        chain->req.clear_chain();
+        for (int i = 1; i < request->chain_size(); ++i) {
+            chain->req.add_chain()->CopyFrom(request->chain(i));
+        }
+        auto peer = next.addr().empty() ? nullptr : PeerFor(next.addr());
+        if (!peer) {
+            chain->ForwardFailed(next.addr().empty() ? "no address" : "failed to connect " + next.addr());
+        } else {
+            if (use_attachment) {
+                // Shares the received blocks; nothing is copied.
+                chain->cntl.request_attachment() = attachment;
+                chain->req.clear_data();
+            }
+            peer->stub->Write(&chain->cntl, &chain->req, &chain->resp,
+                              google::protobuf::NewCallback(chain, &ChainWrite::Arrive));
+        }
+    }
+
+    // Completion may run on the io_uring reaper thread; request/response and the
+    // controller's attachment stay alive until done->Run().
+    google::protobuf::Closure* raw_done = chain ? nullptr : guard.release();
+    auto on_written = [request, response, flat, chain, raw_done](const IOEngine::Result& res) {
+        if (chain) {
+            if (res.bytes < 0 || res.err != 0) {
+                int err = res.err != 0 ? res.err : EIO;
+                chain->LocalDone(StatusUtils::FromErrno(err),
+                                 res.err != 0 ? std::strerror(err) : "write failed", 0);
+            } else {
+                chain->LocalDone(rpc::STATUS_SUCCESS, "", static_cast<uint64_t>(res.bytes));
+            }
+            return;
+        }
+        brpc::ClosureGuard done_guard(raw_done);
+        auto* status = response->mutable_status();
+        if (res.bytes < 0 || res.err != 0) {
+            int err = res.err != 0 ? res.err : EIO;
+            StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
+                                   res.err != 0 ? std::strerror(err) : "write failed");
+            return;
+        }
+        response->set_bytes_written(static_cast<uint64_t>(res.bytes));
+        response->set_replicas(1);
+        Ok(status);
+        std::cout << "[RealNode] WriteResp chunk=" << request->chunk_id()
+                  << " bytes=" << response->bytes_written()
+                  << " code=" << response->status().code() << std::endl;
+    };
+    if (container_store_) {
+        // One append to the active container; there is no chunk file to open.
+        on_written(container_store_->Write(request->chunk_id(), iov.data(),
+                                           static_cast<int>(iov.size()), request->offset()));
         return;
     }
-    response->set_bytes_written(static_cast<uint64_t>(res.bytes));
-    Ok(status);
-    std::cout << "[RealNode] WriteResp chunk=" << request->chunk_id()
-              << " bytes=" << response->bytes_written()
-              << " code=" << response->status().code() << std::endl;
+    io_engine_->WritevAsync(request->chunk_id(), path, std::move(iov), request->offset(), flags, mode,
+                            std::move(on_written));
 }
 
 void StorageServiceImpl::Read(::google::protobuf::RpcController* controller,
                               const storagenode::ReadRequest* request,
                               storagenode::ReadReply* response,
                               ::google::protobuf::Closure* done) {
-    (void)controller;
-    brpc::ClosureGuard guard(done);
+    auto* cntl = static_cast<brpc::Controller*>(controller);
+    brpc::ClosureGuard guard(Track(done));
     auto* status = response->mutable_status();
     if (!ready_) {
         StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "disk not ready");
         return;
     }
-    if (!metadata_mgr_) {
+    if (!container_store_ && !metadata_mgr_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "metadata manager is null");
         return;
     }
-    if (!io_engine_) {
+    if (!container_store_ && !io_engine_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "io engine is null");
         return;
     }
@@ -122,8 +294,15 @@ void StorageServiceImpl::Read(::google::protobuf::RpcController* controller,
               << " offset=" << request->offset()
               << " length=" << request->length() << std::endl;
 
-    std::string path = metadata_mgr_->GetPath(request->chunk_id());
-    if (path.empty()) {
+    std::string path;
+    bool found = false;
+    if (container_store_) {
+        found = container_store_->Contains(request->chunk_id());
+    } else {
+        path = metadata_mgr_->GetPath(request->chunk_id());
+        found = !path.empty();
+    }
+    if (!found) {
         StatusUtils::SetStatus(status, rpc::STATUS_NODE_NOT_FOUND, "chunk not found");
         return;
     }
@@ -138,27 +317,78 @@ void StorageServiceImpl::Read(::google::protobuf::RpcController* controller,
         flags |= O_RDONLY;
     }
 
-    std::string buffer;
-    auto res = io_engine_->Read(path,
-                                request->offset(),
-                                static_cast<size_t>(request->length()),
-                                buffer,
-                                flags);
-    if (res.bytes < 0 || res.err != 0) {
-        int err = res.err != 0 ? res.err : EIO;
-        StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
-                               res.err != 0 ? std::strerror(err) : "read failed");
+    const size_t length = static_cast<size_t>(request->length());
+    if (request->attachment() && length > 0) {
+        // Read into a heap block that is handed to the response attachment as-is;
+        // brpc frees it once the reply has been written to the socket.
+        char* block = static_cast<char*>(std::malloc(length));
+        if (!block) {
+            StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "out of memory");
+            return;
+        }
+        google::protobuf::Closure* raw_done = guard.release();
+        auto on_read = [this, cntl, request, response, block, raw_done](const IOEngine::Result& res) {
+            brpc::ClosureGuard done_guard(raw_done);
+            auto* status = response->mutable_status();
+            if (res.bytes < 0 || res.err != 0) {
+                int err = res.err != 0 ? res.err : EIO;
+                std::free(block);
+                StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
+                                       res.err != 0 ? std::strerror(err) : "read failed");
+                return;
+            }
+            const size_t n = static_cast<size_t>(res.bytes);
+            response->set_bytes_read(static_cast<uint64_t>(n));
+            response->set_checksum(ComputeChecksum(block, n));
+            if (n > 0) {
+                cntl->response_attachment().append_user_data(block, n, std::free);
+            } else {
+                std::free(block);
+            }
+            Ok(status);
+            std::cout << "[RealNode] ReadResp chunk=" << request->chunk_id()
+                      << " bytes=" << response->bytes_read()
+                      << " code=" << response->status().code() << std::endl;
+        };
+        if (container_store_) {
+            on_read(container_store_->Read(request->chunk_id(), request->offset(), length, block));
+        } else {
+            io_engine_->ReadAsync(request->chunk_id(), path, request->offset(), length, block, flags,
+                                  std::move(on_read));
+        }
         return;
     }
-    response->set_bytes_read(static_cast<uint64_t>(res.bytes));
-    // avoid extra copy inside protobuf by swapping buffers
-    response->mutable_data()->swap(buffer);
-    response->set_checksum(ComputeChecksum(response->data().data(),
-                                           static_cast<size_t>(res.bytes)));
-    Ok(status);
-    std::cout << "[RealNode] ReadResp chunk=" << request->chunk_id()
-              << " bytes=" << response->bytes_read()
-              << " code=" << response->status().code() << std::endl;
+
+    // Legacy inline path: read straight into the response payload; it is trimmed to
+    // the bytes actually read.
+    std::string* buffer = response->mutable_data();
+    buffer->resize(length);
+    google::protobuf::Closure* raw_done = guard.release();
+    auto on_read = [this, request, response, raw_done](const IOEngine::Result& res) {
+        brpc::ClosureGuard done_guard(raw_done);
+        auto* status = response->mutable_status();
+        if (res.bytes < 0 || res.err != 0) {
+            int err = res.err != 0 ? res.err : EIO;
+            response->clear_data();
+            StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
+                                   res.err != 0 ? std::strerror(err) : "read failed");
+            return;
+        }
+        response->mutable_data()->resize(static_cast<size_t>(res.bytes));
+        response->set_bytes_read(static_cast<uint64_t>(res.bytes));
+        response->set_checksum(ComputeChecksum(response->data().data(),
+                                               static_cast<size_t>(res.bytes)));
+        Ok(status);
+        std::cout << "[RealNode] ReadResp chunk=" << request->chunk_id()
+                  << " bytes=" << response->bytes_read()
+                  << " code=" << response->status().code() << std::endl;
+    };
+    if (container_store_) {
+        on_read(container_store_->Read(request->chunk_id(), request->offset(), length, &(*buffer)[0]));
+        return;
+    }
+    io_engine_->ReadAsync(request->chunk_id(), path, request->offset(), length, &(*buffer)[0], flags,
+                          std::move(on_read));
 }
 
 void StorageServiceImpl::Truncate(::google::protobuf::RpcController* controller,
@@ -172,28 +402,32 @@ void StorageServiceImpl::Truncate(::google::protobuf::RpcController* controller,
         StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "disk not ready");
         return;
     }
-    if (!metadata_mgr_) {
+    if (!container_store_ && !metadata_mgr_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "metadata manager is null");
         return;
     }
-    if (!io_engine_) {
+    if (!container_store_ && !io_engine_) {
         StatusUtils::SetStatus(status, rpc::STATUS_INVALID_ARGUMENT, "io engine is null");
         return;
     }
     std::cout << "[RealNode] TruncateReq chunk=" << request->chunk_id()
               << " size=" << request->size() << std::endl;
 
-    std::string path = metadata_mgr_->GetPath(request->chunk_id());
-    if (path.empty()) {
-        path = metadata_mgr_->AllocPath(request->chunk_id());
+    IOEngine::Result res;
+    if (container_store_) {
+        res = container_store_->Truncate(request->chunk_id(), request->size());
+    } else {
+        std::string path = metadata_mgr_->GetPath(request->chunk_id());
         if (path.empty()) {
-            StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "failed to allocate path");
-            return;
+            path = metadata_mgr_->AllocPath(request->chunk_id());
+            if (path.empty()) {
+                StatusUtils::SetStatus(status, rpc::STATUS_IO_ERROR, "failed to allocate path");
+                return;
+            }
         }
+        int flags = O_WRONLY | O_CREAT;
+        res = io_engine_->Truncate(request->chunk_id(), path, request->size(), flags, 0644);
     }
-
-    int flags = O_WRONLY | O_CREAT;
-    auto res = io_engine_->Truncate(path, request->size(), flags, 0644);
     if (res.bytes < 0 || res.err != 0) {
         int err = res.err != 0 ? res.err : EIO;
         StatusUtils::SetStatus(status, StatusUtils::FromErrno(err),
@@ -227,3 +461,38 @@ void StorageServiceImpl::UnmountDisk(::google::protobuf::RpcController* controll
 uint64_t StorageServiceImpl::ComputeChecksum(const void* data, size_t len) const {
     return butil::crc32c::Value(static_cast<const char*>(data), len);
 }
+
+uint64_t StorageServiceImpl::ComputeChecksum(const butil::IOBuf& buf) const {
+    uint32_t crc = 0;
+    for (size_t i = 0; i < buf.backing_block_num(); ++i) {
+        auto block = buf.backing_block(i);
+        crc = butil::crc32c::Extend(crc, block.data(), block.size());
+    }
+    return crc;
+}
+
+google::protobuf::Closure* StorageServiceImpl::Track(google::protobuf::Closure* done) {
+    return new InFlightClosure(&in_flight_, done);
+}
+
+std::shared_ptr<StorageServiceImpl::Peer> StorageServiceImpl::PeerFor(const std::string& addr) {
+    std::lock_guard<std::mutex> lk(peers_mu_);
+    auto it = peers_.find(addr);
+    if (it != peers_.end()) {
+        return it->second;
+    }
+    auto peer = std::make_shared<Peer>();
+    peer->channel = std::make_unique<brpc::Channel>();
+    brpc::ChannelOptions opts;
+    opts.protocol = "baidu_std";
+    opts.timeout_ms = 3000;
+    // The client decides whether to retry the whole chain.
+    opts.max_retry = 0;
+    if (peer->channel->Init(addr.c_str(), &opts) != 0) {
+        std::cerr << "[RealNode] failed to init channel to replica " << addr << std::endl;
+        return nullptr;
+    }
+    peer->stub = std::make_unique<storagenode::StorageService_Stub>(peer->channel.get());
+    peers_.emplace(addr, peer);
+    return peer;
+}
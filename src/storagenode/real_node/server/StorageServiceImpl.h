@@ -1,11 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+#include <brpc/channel.h>
+#include <butil/iobuf.h>
 
 #include "storage_node.pb.h"
 #include "common/StatusUtils.h"
+#include "../io/ContainerStore.h"
 #include "../io/DiskManager.h"
 #include "../io/IOEngine.h"
 #include "../meta/LocalMetadataManager.h"
@@ -14,7 +21,8 @@ class StorageServiceImpl : public storagenode::StorageService {
 public:
     StorageServiceImpl(std::shared_ptr<DiskManager> disk_manager,
                        std::shared_ptr<LocalMetadataManager> metadata_mgr,
-                       std::shared_ptr<IOEngine> io_engine);
+                       std::shared_ptr<IOEngine> io_engine,
+                       std::shared_ptr<ContainerStore> container_store = nullptr);
 
     void Write(::google::protobuf::RpcController* controller,
                const storagenode::WriteRequest* request,
@@ -36,11 +44,29 @@ public:
                      storagenode::UnmountReply* response,
                      ::google::protobuf::Closure* done) override;
 
+    // Write/Read requests accepted and not yet answered; reported to SRM as load.
+    uint64_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+
 private:
+    struct Peer {
+        std::unique_ptr<brpc::Channel> channel;
+        std::unique_ptr<storagenode::StorageService_Stub> stub;
+    };
+
     uint64_t ComputeChecksum(const void* data, size_t len) const;
+    uint64_t ComputeChecksum(const butil::IOBuf& buf) const;
+    // Counts the request in in_flight_ until done runs.
+    google::protobuf::Closure* Track(google::protobuf::Closure* done);
+    // Stub for the next node of a replication chain, cached by address.
+    std::shared_ptr<Peer> PeerFor(const std::string& addr);
 
     std::shared_ptr<DiskManager> disk_manager_;
     std::shared_ptr<LocalMetadataManager> metadata_mgr_;
     std::shared_ptr<IOEngine> io_engine_;
+    // When set, chunks live in container files and metadata_mgr_/io_engine_ are unused.
+    std::shared_ptr<ContainerStore> container_store_;
     bool ready_{false};
+    std::atomic<uint64_t> in_flight_{0};
+    std::mutex peers_mu_;
+    std::unordered_map<std::string, std::shared_ptr<Peer>> peers_;
 };
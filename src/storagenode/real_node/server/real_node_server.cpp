@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "StorageServiceImpl.h"
+#include "../io/ContainerStore.h"
 #include "../io/DiskManager.h"
 #include "../io/IOEngine.h"
 #include "../meta/LocalMetadataManager.h"
@@ -18,6 +19,21 @@ DEFINE_string(mount_point, "/tmp/realnode_disk", "Mount point or existing data d
 DEFINE_string(fs_type, "ext4", "Filesystem type used when auto-mounting");
 DEFINE_bool(auto_mount, false, "Whether to auto-mount device_path to mount_point");
 DEFINE_bool(sync_on_write, false, "Whether to fsync after writes");
+DEFINE_bool(use_io_uring, false, "Use the io_uring I/O backend (falls back to pread/pwrite if unavailable)");
+DEFINE_int32(io_uring_entries, 256, "Submission queue depth of the io_uring ring");
+DEFINE_int32(io_uring_buffers, 0, "Number of registered io_uring buffers (0 disables)");
+DEFINE_int32(max_open_files, 128, "Size of the chunk fd cache");
+DEFINE_int32(fd_cache_shards, 16, "Number of chunk fd cache shards");
+DEFINE_bool(direct_io, false, "Open chunk files with O_DIRECT and stage I/O through aligned buffers");
+DEFINE_int32(direct_io_buffers, 16, "Number of aligned buffers for direct I/O");
+DEFINE_int32(direct_io_buffer_kb, 1024, "Size of each aligned direct I/O buffer in KiB");
+DEFINE_bool(drop_behind, false, "Buffered mode: write back early and drop written pages from the page cache");
+DEFINE_bool(container_store, false,
+            "Pack chunks into append-only container files instead of one file per chunk "
+            "(a data root uses one layout; existing chunk files are not migrated). "
+            "Containers do their own I/O, so the per-chunk-file I/O flags cannot be combined with it");
+DEFINE_int32(container_mb, 256, "Size of each preallocated chunk container in MiB");
+DEFINE_double(container_gc_ratio, 0.5, "Collect sealed containers with at least this share of dead bytes");
 DEFINE_bool(skip_mount, false, "Skip mounting/device checks and use mount_point/base_path directly");
 DEFINE_string(base_path, "", "Data root; default uses mount_point if empty");
 DEFINE_string(srm_addr, "", "SRM ClusterManagerService address host:port for registration/heartbeat");
@@ -44,11 +60,54 @@ int main(int argc, char** argv) {
     auto disk_mgr = std::make_shared<DiskManager>(cfg);
     IOEngine::Options io_opts;
     io_opts.sync_on_write = FLAGS_sync_on_write;
+    io_opts.max_open_files = static_cast<size_t>(FLAGS_max_open_files);
+    io_opts.fd_cache_shards = static_cast<size_t>(FLAGS_fd_cache_shards);
+    io_opts.use_io_uring = FLAGS_use_io_uring;
+    io_opts.io_uring_entries = static_cast<unsigned>(FLAGS_io_uring_entries);
+    io_opts.registered_buffer_count = static_cast<size_t>(FLAGS_io_uring_buffers);
+    io_opts.direct_io = FLAGS_direct_io;
+    io_opts.aligned_buffer_count = static_cast<size_t>(FLAGS_direct_io_buffers);
+    io_opts.aligned_buffer_size = static_cast<size_t>(FLAGS_direct_io_buffer_kb) * 1024;
+    io_opts.drop_behind = FLAGS_drop_behind;
     std::string data_root = FLAGS_base_path.empty() ? FLAGS_mount_point : FLAGS_base_path;
-    auto io_engine = std::make_shared<IOEngine>(data_root, io_opts);
-    auto metadata_mgr = std::make_shared<LocalMetadataManager>(std::vector<std::string>{data_root});
+    std::shared_ptr<IOEngine> io_engine;
+    std::shared_ptr<LocalMetadataManager> metadata_mgr;
+    std::shared_ptr<ContainerStore> container_store;
+    if (FLAGS_container_store) {
+        // ContainerStore does not go through IOEngine: refuse its flags instead of dropping them.
+        bool conflict = false;
+        for (const char* name : {"use_io_uring", "io_uring_entries", "io_uring_buffers", "max_open_files",
+                                 "fd_cache_shards", "direct_io", "direct_io_buffers",
+                                 "direct_io_buffer_kb", "drop_behind"}) {
+            if (!gflags::GetCommandLineFlagInfoOrDie(name).is_default) {
+                std::cerr << "--" << name << " only applies to per-chunk files and cannot be used with "
+                          << "--container_store" << std::endl;
+                conflict = true;
+            }
+        }
+        if (conflict) {
+            return -1;
+        }
+        ContainerStore::Options store_opts;
+        store_opts.container_bytes = static_cast<uint64_t>(FLAGS_container_mb) << 20;
+        store_opts.gc_garbage_ratio = FLAGS_container_gc_ratio;
+        store_opts.sync_on_write = FLAGS_sync_on_write;
+        container_store = std::make_shared<ContainerStore>(data_root + "/containers", store_opts);
+        if (!container_store->Open()) {
+            std::cerr << "Failed to open chunk containers under " << data_root << std::endl;
+            return -1;
+        }
+    } else {
+        io_engine = std::make_shared<IOEngine>(data_root, io_opts);
+        metadata_mgr = std::make_shared<LocalMetadataManager>(std::vector<std::string>{data_root}, "",
+                                                              FLAGS_sync_on_write);
+        if (!metadata_mgr->ok()) {
+            std::cerr << "Failed to open the chunk manifest under " << data_root << std::endl;
+            return -1;
+        }
+    }
 
-    StorageServiceImpl service(disk_mgr, metadata_mgr, io_engine);
+    StorageServiceImpl service(disk_mgr, metadata_mgr, io_engine, container_store);
     std::unique_ptr<NodeAgent> agent;
     if (!FLAGS_srm_addr.empty()) {
         agent = std::make_unique<NodeAgent>(FLAGS_srm_addr,
@@ -58,6 +117,7 @@ int main(int argc, char** argv) {
                                             FLAGS_agent_hostname,
                                             FLAGS_agent_heartbeat_ms,
                                             FLAGS_agent_register_backoff_ms);
+        agent->SetInFlightProbe([&service]() { return service.in_flight(); });
     }
 
     brpc::Server server;
@@ -81,6 +141,7 @@ int main(int argc, char** argv) {
     std::cout << "Storage real node server started at port " << FLAGS_port
               << ", base_path=" << (FLAGS_base_path.empty() ? FLAGS_mount_point : FLAGS_base_path)
               << ", skip_mount=" << (FLAGS_skip_mount ? "true" : "false")
+              << ", layout=" << (FLAGS_container_store ? "containers" : "files")
               << ", srm_addr=" << (FLAGS_srm_addr.empty() ? "<disabled>" : FLAGS_srm_addr)
               << std::endl;
     server.RunUntilAskedToQuit();
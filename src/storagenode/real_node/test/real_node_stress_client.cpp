@@ -82,7 +82,7 @@ int main(int argc, char** argv) {
             brpc::Controller cntl;
             req.set_chunk_id(chunk_id);
             req.set_offset(offset);
-            req.set_data(payload);
+            cntl.request_attachment().append(payload);
             req.set_checksum(0);
             req.set_flags(FLAGS_flags);
             req.set_mode(FLAGS_mode);
@@ -109,6 +109,7 @@ int main(int argc, char** argv) {
             req.set_offset(offset);
             req.set_length(static_cast<uint64_t>(payload_size));
             req.set_flags(FLAGS_flags == 0 ? O_RDONLY : FLAGS_flags);
+            req.set_attachment(true);
 
             stub.Read(&cntl, &req, &resp, nullptr);
             ++stats.reads;
@@ -120,11 +121,12 @@ int main(int argc, char** argv) {
             } else {
                 if (FLAGS_verify_read) {
                     const auto it = last_written.find(MakeKey(chunk_id, offset));
-                    if (it != last_written.end() && resp.data() != it->second) {
+                    const std::string got = cntl.response_attachment().to_string();
+                    if (it != last_written.end() && got != it->second) {
                         ++stats.verify_failures;
                         std::cerr << "[VERIFY] chunk=" << chunk_id << " offset=" << offset
                                   << " mismatch: expected " << it->second.size()
-                                  << " bytes, got " << resp.data().size() << std::endl;
+                                  << " bytes, got " << got.size() << std::endl;
                     }
                 }
                 stats.total_latency_us += cntl.latency_us();
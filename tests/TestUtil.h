@@ -0,0 +1,93 @@
+#pragma once
+
+// 单元测试共用的断言、临时目录与用例表。每个测试是独立的可执行文件：
+// 用例函数返回 bool，main 里交给 RunTests / RunDirTests 依次运行。
+
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+
+#include "../src/storagenode/optical/OpticalDiscLibrary.h"
+
+// 条件不成立时打印行号，当前用例返回 false
+#define CHECK(cond)                                                                      \
+    do {                                                                                 \
+        if (!(cond)) {                                                                   \
+            std::cerr << "CHECK failed at line " << __LINE__ << ": " #cond << std::endl; \
+            return false;                                                                \
+        }                                                                                \
+    } while (0)
+
+// <tmp>/zb_<name>_<pid> 下的空目录，析构时删除；带 pid 以免并行运行的测试互相覆盖
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string& name)
+        : path_(std::filesystem::temp_directory_path() / ("zb_" + name + "_" + std::to_string(::getpid()))) {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+        std::filesystem::create_directories(path_, ec);
+    }
+    ~ScratchDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    std::filesystem::path path_;
+};
+
+struct TestCase {
+    const char* name;
+    bool (*fn)();
+};
+
+// 每个用例拿到一个单独的空目录
+struct DirTestCase {
+    const char* name;
+    bool (*fn)(const std::filesystem::path&);
+};
+
+// 依次运行，遇到第一个失败的用例即停止；返回值作为 main 的退出码
+inline int RunTests(const char* suite, std::initializer_list<TestCase> cases) {
+    for (const auto& c : cases) {
+        if (!c.fn()) {
+            std::cerr << "Test failed: " << c.name << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Test passed: " << suite << std::endl;
+    return 0;
+}
+
+inline int RunDirTests(const char* suite, const std::string& dir_name, std::initializer_list<DirTestCase> cases) {
+    ScratchDir base(dir_name);
+    int idx = 0;
+    for (const auto& c : cases) {
+        const std::filesystem::path dir = base.path() / std::to_string(idx++);
+        std::filesystem::create_directories(dir);
+        if (!c.fn(dir)) {
+            std::cerr << "Test failed: " << c.name << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Test passed: " << suite << std::endl;
+    return 0;
+}
+
+// 编号为 idx 的光盘库（lib_%05d），默认盘位数和装卸时间
+inline std::shared_ptr<OpticalDiscLibrary> MakeLibrary(int idx, uint32_t drives) {
+    char id[16];
+    std::snprintf(id, sizeof(id), "lib_%05d", idx);
+    return std::make_shared<OpticalDiscLibrary>(id, OPTICAL_LIBRARY_DISC_NUM, drives, OPTICAL_LIBRARY_LOAD_TIME);
+}
@@ -0,0 +1,129 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "../src/srm/simulation/CapacitySimulator.h"
+
+// 容量规划命令行：读配置 JSON，回放 inode 批量文件（写入流）和/或回调 trace，输出报告 JSON
+
+namespace {
+
+struct Options {
+    std::string config;
+    std::string inode_dir;
+    double files_per_sec{1000};
+    std::string trace;
+    size_t threads{0};
+    std::string output;
+};
+
+void PrintUsage(const char* prog) {
+    std::cout << "Usage: " << prog
+              << " --config <json> [--inode-dir DIR] [--files-per-sec R] [--trace FILE] [--threads N] [--output FILE]\n"
+              << "  --config         simulator config (keys as CapacitySimConfig fields, missing keys use defaults)\n"
+              << "  --inode-dir      inode batch directory replayed as the ingest stream\n"
+              << "  --files-per-sec  ingest arrival rate (default 1000)\n"
+              << "  --trace          recall trace, one \"<seconds> <disc> <bytes>\" per line\n"
+              << "  --threads        inode decode threads, 0 = hardware concurrency (default 0)\n"
+              << "  --output         report path (default stdout)\n";
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            opts.config = argv[++i];
+        } else if (arg == "--inode-dir" && i + 1 < argc) {
+            opts.inode_dir = argv[++i];
+        } else if (arg == "--files-per-sec" && i + 1 < argc) {
+            opts.files_per_sec = std::stod(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            opts.trace = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opts.threads = std::stoull(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            opts.output = argv[++i];
+        } else if (arg == "--help") {
+            PrintUsage(argv[0]);
+            return false;
+        } else {
+            std::cerr << "Unknown arg: " << arg << "\n";
+            return false;
+        }
+    }
+    if (opts.config.empty()) {
+        std::cerr << "--config is required\n";
+        return false;
+    }
+    if (opts.inode_dir.empty() && opts.trace.empty()) {
+        std::cerr << "--inode-dir or --trace is required\n";
+        return false;
+    }
+    if (opts.files_per_sec <= 0) {
+        std::cerr << "--files-per-sec must be positive\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    CapacitySimConfig cfg;
+    {
+        std::ifstream in(opts.config);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open config: " << opts.config << "\n";
+            return 1;
+        }
+        try {
+            cfg = CapacitySimConfig::fromJson(nlohmann::json::parse(in));
+        } catch (const nlohmann::json::exception& e) {
+            std::cerr << "Bad config " << opts.config << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<InodeBatchIngestSource> ingest;
+    if (!opts.inode_dir.empty()) {
+        InodeBatchReader::Options reader_opts;
+        reader_opts.threads = opts.threads;
+        ingest = std::make_unique<InodeBatchIngestSource>(opts.inode_dir, opts.files_per_sec, reader_opts);
+    }
+    std::unique_ptr<TraceRecallSource> trace;
+    if (!opts.trace.empty()) {
+        trace = std::make_unique<TraceRecallSource>(opts.trace);
+        if (!trace->ok()) {
+            std::cerr << "Failed to open trace: " << opts.trace << "\n";
+            return 1;
+        }
+    }
+
+    CapacitySimulator sim(cfg);
+    nlohmann::json report = sim.run(ingest.get(), trace.get()).to_json();
+    if (trace) {
+        report["recall"]["trace_malformed"] = trace->malformed();
+    }
+
+    if (opts.output.empty()) {
+        std::cout << report.dump(2) << "\n";
+        return 0;
+    }
+    std::ofstream out(opts.output);
+    out << report.dump(2) << "\n";
+    if (!out) {
+        std::cerr << "Failed to write report: " << opts.output << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,16 +1,21 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
-#include <unordered_map>
 #include <vector>
 
+#include "../src/mds/inode/InodeBatchReader.h"
 #include "../src/mds/inode/InodeStorage.h"
 
 namespace fs = std::filesystem;
@@ -33,21 +38,91 @@ struct Options {
     uint32_t report_interval_sec{1};
     uint32_t print_limit_nodes{0};
     uint32_t max_inodes_per_sec{0};
+    uint32_t threads{1};
+    uint32_t chunk_slots{8192};
+    uint32_t prefetch_chunks{8};
 };
 
 struct DeviceState {
     std::string device_id;
     uint64_t capacity{0};
-    uint64_t used{0};
 };
 
 struct NodeState {
     std::string node_id;
     uint8_t type{0};
-    std::vector<DeviceState> ssd_devices;
-    std::vector<DeviceState> hdd_devices;
+    std::vector<uint32_t> ssd_devices;  // Cluster::devices 下标
+    std::vector<uint32_t> hdd_devices;
 };
 
+// 节点号是 inode 里 14 位的 node_id，按 (类型, 节点号) 直接查表得到节点下标
+constexpr uint32_t kNodeIdSpace = 1u << 14;
+
+uint32_t NodeKey(uint8_t type, uint16_t node_id) {
+    const uint32_t table = (type & 0x03) >= 2 ? 2 : (type & 0x03);  // 类型 3 与原来一样按 Mix 处理
+    return table * kNodeIdSpace + (node_id & (kNodeIdSpace - 1));
+}
+
+const char* NodePrefix(uint32_t table) {
+    static const char* prefixes[] = {"node_ssd_", "node_hdd_", "node_mix_"};
+    return prefixes[table];
+}
+
+std::string NodeName(uint32_t key) {
+    return NodePrefix(key / kNodeIdSpace) + std::to_string(key % kNodeIdSpace);
+}
+
+struct Cluster {
+    std::vector<NodeState> nodes;
+    std::vector<DeviceState> devices;
+    // 每个节点只由一个线程写，读写都用 relaxed 的 load/store，报告线程随时可以读
+    std::vector<std::atomic<uint64_t>> used;
+    std::vector<int32_t> node_index = std::vector<int32_t>(3 * kNodeIdSpace, -1);
+
+    // ordinal 为同类型节点中的序号，与 inode 中的 node_id 对应
+    void AddNode(uint8_t type, uint32_t ordinal, uint32_t ssd, uint32_t hdd, const Options& opts) {
+        const uint32_t table = NodeKey(type, 0) / kNodeIdSpace;
+        NodeState node;
+        node.node_id = NodePrefix(table) + std::to_string(ordinal);
+        node.type = type;
+        for (uint32_t d = 0; d < ssd; ++d) {
+            node.ssd_devices.push_back(static_cast<uint32_t>(devices.size()));
+            devices.push_back(DeviceState{node.node_id + "_SSD_" + std::to_string(d), opts.ssd_capacity_bytes});
+        }
+        for (uint32_t d = 0; d < hdd; ++d) {
+            node.hdd_devices.push_back(static_cast<uint32_t>(devices.size()));
+            devices.push_back(DeviceState{node.node_id + "_HDD_" + std::to_string(d), opts.hdd_capacity_bytes});
+        }
+        // 序号超出 14 位的节点永远不会被 inode 映射到，与原来按名字查找的行为一致
+        if (ordinal < kNodeIdSpace) {
+            node_index[table * kNodeIdSpace + ordinal] = static_cast<int32_t>(nodes.size());
+        }
+        nodes.push_back(std::move(node));
+    }
+
+    int32_t Find(uint32_t key) const { return node_index[key]; }
+};
+
+// 单个回放线程的计数。只有所属线程写（relaxed load + store，不用 RMW），报告线程随时读取
+struct alignas(64) WorkerStats {
+    std::atomic<uint64_t> inodes{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> missing_node{0};
+    std::atomic<uint64_t> position{0};   // (文件下标 + 1) << 40 | 槽号，0 表示尚未开始
+    std::atomic<uint64_t> last_node{0};  // NodeKey + 1，0 表示尚无
+};
+
+void Bump(std::atomic<uint64_t>& counter, uint64_t delta = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+constexpr uint64_t kPositionShift = 40;
+
+uint64_t PackPosition(size_t file_idx, uint64_t slot) {
+    return (static_cast<uint64_t>(file_idx + 1) << kPositionShift) | slot;
+}
+
 struct Stats {
     uint64_t inodes{0};
     uint64_t bytes{0};
@@ -73,7 +148,11 @@ void PrintUsage(const char* prog) {
               << "  --max_inodes <N>           max inodes to process (0 = all)\n"
               << "  --print_limit_nodes <N>    limit node prints per report (0 = all)\n  --max_inodes_per_sec <N>  max inodes to process per second (0 = unlimited)\n"
               << "  --start_file <name>        start from this inode file (name or full path)\n"
-              << "  --start_index <N>          start inode index within start_file (default 0)\n";
+              << "  --start_index <N>          start inode index within start_file (default 0)\n"
+              << "  --threads <N>              replay threads, nodes are sharded across them (default 1)\n"
+              << "  --chunk_slots <N>          inode slots per prefetched chunk in parallel mode (default 8192)\n"
+              << "  --prefetch_chunks <N>      chunks the reader thread may run ahead (default 8)\n"
+              << "  In parallel mode --max_inodes_per_sec limits inode slots read per second.\n";
 }
 
 bool ParseArgs(int argc, char** argv, Options& opts) {
@@ -109,6 +188,12 @@ bool ParseArgs(int argc, char** argv, Options& opts) {
             opts.start_file = argv[++i];
         } else if (arg == "--start_index" && i + 1 < argc) {
             opts.start_index = std::stoull(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opts.threads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--chunk_slots" && i + 1 < argc) {
+            opts.chunk_slots = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--prefetch_chunks" && i + 1 < argc) {
+            opts.prefetch_chunks = static_cast<uint32_t>(std::stoul(argv[++i]));
         } else if (arg == "--help") {
             PrintUsage(argv[0]);
             return false;
@@ -125,6 +210,9 @@ bool ParseArgs(int argc, char** argv, Options& opts) {
         std::cerr << "--ssd_capacity_bytes and --hdd_capacity_bytes are required\n";
         return false;
     }
+    opts.threads = std::max<uint32_t>(opts.threads, 1);
+    opts.chunk_slots = std::max<uint32_t>(opts.chunk_slots, 1);
+    opts.prefetch_chunks = std::max<uint32_t>(opts.prefetch_chunks, 1);
     return true;
 }
 
@@ -183,10 +271,11 @@ std::string FormatBytesSigned(int64_t bytes) {
     return "+" + FormatBytes(static_cast<uint64_t>(bytes));
 }
 
-void PrintReport(const std::vector<NodeState>& nodes,
+void PrintReport(const Cluster& cluster,
+                 const std::vector<uint64_t>& used,
                  const Stats& stats,
                  uint32_t limit_nodes,
-                 std::unordered_map<std::string, uint64_t>& last_used) {
+                 std::vector<uint64_t>& last_used) {
     std::cout << u8"[\u8fdb\u5ea6] \u5df2\u5904\u7406inode=" << stats.inodes
               << u8" \u603b\u6a21\u62df\u5199\u5165=" << FormatBytes(stats.bytes)
               << u8" \u5931\u8d25=" << stats.failed
@@ -197,13 +286,14 @@ void PrintReport(const std::vector<NodeState>& nodes,
 
     uint32_t printed_nodes = 0;
     uint32_t printed_devices = 0;
-    for (const auto& node : nodes) {
+    for (const auto& node : cluster.nodes) {
         bool node_printed = false;
-        auto handle_device = [&](const DeviceState& dev) {
-            const uint64_t free = dev.capacity > dev.used ? dev.capacity - dev.used : 0;
-            const auto it = last_used.find(dev.device_id);
-            const uint64_t prev = it == last_used.end() ? 0 : it->second;
-            if (dev.used == prev) {
+        auto handle_device = [&](uint32_t idx) {
+            const DeviceState& dev = cluster.devices[idx];
+            const uint64_t dev_used = used[idx];
+            const uint64_t free = dev.capacity > dev_used ? dev.capacity - dev_used : 0;
+            const uint64_t prev = last_used[idx];
+            if (dev_used == prev) {
                 return;
             }
             if (!node_printed) {
@@ -215,18 +305,18 @@ void PrintReport(const std::vector<NodeState>& nodes,
                 node_printed = true;
                 ++printed_nodes;
             }
-            const int64_t delta = static_cast<int64_t>(dev.used) - static_cast<int64_t>(prev);
+            const int64_t delta = static_cast<int64_t>(dev_used) - static_cast<int64_t>(prev);
             std::cout << u8"  \u8bbe\u5907 " << dev.device_id
-                      << u8" \u5f53\u524d\u5df2\u7528=" << FormatBytes(dev.used)
+                      << u8" \u5f53\u524d\u5df2\u7528=" << FormatBytes(dev_used)
                       << u8"\uff0c\u672c\u5468\u671f\u589e\u52a0=" << FormatBytesSigned(delta)
                       << u8"\uff0c\u5269\u4f59\u53ef\u7528=" << FormatBytes(free)
                       << u8"\n";
-            last_used[dev.device_id] = dev.used;
+            last_used[idx] = dev_used;
             ++printed_devices;
         };
 
-        for (const auto& dev : node.ssd_devices) {
-            handle_device(dev);
+        for (uint32_t idx : node.ssd_devices) {
+            handle_device(idx);
             if (limit_nodes > 0 && printed_nodes >= limit_nodes && node_printed) {
                 break;
             }
@@ -234,8 +324,8 @@ void PrintReport(const std::vector<NodeState>& nodes,
         if (limit_nodes > 0 && printed_nodes >= limit_nodes && node_printed) {
             continue;
         }
-        for (const auto& dev : node.hdd_devices) {
-            handle_device(dev);
+        for (uint32_t idx : node.hdd_devices) {
+            handle_device(idx);
             if (limit_nodes > 0 && printed_nodes >= limit_nodes && node_printed) {
                 break;
             }
@@ -246,10 +336,15 @@ void PrintReport(const std::vector<NodeState>& nodes,
     }
 }
 
-void WriteJsonReport(const std::string& path, const std::vector<NodeState>& nodes, const Stats& stats) {
+// 先写临时文件再改名，读日志的一方不会看到写了一半的快照
+void WriteJsonReport(const std::string& path,
+                     const Cluster& cluster,
+                     const std::vector<uint64_t>& used,
+                     const Stats& stats) {
     auto now = std::chrono::system_clock::now();
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    std::ofstream out(path, std::ios::trunc);
+    const std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::trunc);
     if (!out.is_open()) {
         return;
     }
@@ -263,160 +358,162 @@ void WriteJsonReport(const std::string& path, const std::vector<NodeState>& node
     out << "\"current_index\":" << stats.current_index << ",";
     out << "\"current_node\":\"" << JsonEscape(stats.current_node) << "\",";
     out << "\"nodes\":[";
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        const auto& node = nodes[i];
+    for (size_t i = 0; i < cluster.nodes.size(); ++i) {
+        const auto& node = cluster.nodes[i];
         out << "{";
         out << "\"node_id\":\"" << JsonEscape(node.node_id) << "\",";
         out << "\"type\":" << static_cast<int>(node.type) << ",";
         out << "\"devices\":[";
         bool first_dev = true;
-        for (const auto& dev : node.ssd_devices) {
-            if (!first_dev) out << ",";
-            first_dev = false;
-            uint64_t free = dev.capacity > dev.used ? dev.capacity - dev.used : 0;
-            out << "{\"device_id\":\"" << JsonEscape(dev.device_id) << "\",";
-            out << "\"used\":" << dev.used << ",";
-            out << "\"free\":" << free << ",";
-            out << "\"capacity\":" << dev.capacity << "}";
-        }
-        for (const auto& dev : node.hdd_devices) {
+        auto write_device = [&](uint32_t idx) {
+            const DeviceState& dev = cluster.devices[idx];
             if (!first_dev) out << ",";
             first_dev = false;
-            uint64_t free = dev.capacity > dev.used ? dev.capacity - dev.used : 0;
+            uint64_t free = dev.capacity > used[idx] ? dev.capacity - used[idx] : 0;
             out << "{\"device_id\":\"" << JsonEscape(dev.device_id) << "\",";
-            out << "\"used\":" << dev.used << ",";
+            out << "\"used\":" << used[idx] << ",";
             out << "\"free\":" << free << ",";
             out << "\"capacity\":" << dev.capacity << "}";
-        }
+        };
+        for (uint32_t idx : node.ssd_devices) write_device(idx);
+        for (uint32_t idx : node.hdd_devices) write_device(idx);
         out << "]}";
-        if (i + 1 < nodes.size()) out << ",";
+        if (i + 1 < cluster.nodes.size()) out << ",";
     }
     out << "]}\n";
+    out.close();
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
 }
 
-void Consume(std::vector<DeviceState>& devices, uint64_t& remaining) {
-    for (auto& dev : devices) {
+void Consume(Cluster& cluster, const std::vector<uint32_t>& devices, uint64_t& remaining) {
+    for (uint32_t idx : devices) {
         if (remaining == 0) return;
-        uint64_t free = dev.capacity > dev.used ? dev.capacity - dev.used : 0;
+        auto& used = cluster.used[idx];
+        const uint64_t cur = used.load(std::memory_order_relaxed);
+        const uint64_t capacity = cluster.devices[idx].capacity;
+        uint64_t free = capacity > cur ? capacity - cur : 0;
         if (free == 0) continue;
         uint64_t take = free < remaining ? free : remaining;
-        dev.used += take;
+        used.store(cur + take, std::memory_order_relaxed);
         remaining -= take;
     }
 }
 
-} // namespace
-
-int main(int argc, char** argv) {
-    Options opts;
-    if (!ParseArgs(argc, argv, opts)) {
-        PrintUsage(argv[0]);
-        return 1;
+// 把一个槽计入所属节点；槽无法解析时返回 false（计入 failed）
+bool ApplySlot(const InodeSlotView& slot, uint32_t key, int32_t node_idx, Cluster& cluster, WorkerStats& stats) {
+    if (!slot.valid()) {
+        Bump(stats.failed);
+        return false;
     }
-
-    std::vector<NodeState> nodes;
-    nodes.reserve(opts.ssd_nodes + opts.hdd_nodes + opts.mix_nodes);
-
-    for (uint32_t i = 0; i < opts.ssd_nodes; ++i) {
-        NodeState node;
-        node.node_id = "node_ssd_" + std::to_string(i);
-        node.type = 0;
-        for (uint32_t d = 0; d < opts.ssd_devices_per_node; ++d) {
-            DeviceState dev;
-            dev.device_id = node.node_id + "_SSD_" + std::to_string(d);
-            dev.capacity = opts.ssd_capacity_bytes;
-            node.ssd_devices.push_back(std::move(dev));
-        }
-        nodes.push_back(std::move(node));
+    Bump(stats.inodes);
+    const uint64_t bytes = slot.file_size();
+    Bump(stats.bytes, bytes);
+    stats.last_node.store(key + 1, std::memory_order_relaxed);
+
+    if (node_idx < 0) {
+        Bump(stats.missing_node);
+        return true;
     }
-
-    for (uint32_t i = 0; i < opts.hdd_nodes; ++i) {
-        NodeState node;
-        node.node_id = "node_hdd_" + std::to_string(i);
-        node.type = 1;
-        for (uint32_t d = 0; d < opts.hdd_devices_per_node; ++d) {
-            DeviceState dev;
-            dev.device_id = node.node_id + "_HDD_" + std::to_string(d);
-            dev.capacity = opts.hdd_capacity_bytes;
-            node.hdd_devices.push_back(std::move(dev));
+    auto& node = cluster.nodes[static_cast<size_t>(node_idx)];
+    uint64_t remaining = bytes;
+    if (node.type == 0) {
+        Consume(cluster, node.ssd_devices, remaining);
+    } else if (node.type == 1) {
+        Consume(cluster, node.hdd_devices, remaining);
+    } else {
+        Consume(cluster, node.ssd_devices, remaining);
+        if (remaining > 0) {
+            Consume(cluster, node.hdd_devices, remaining);
         }
-        nodes.push_back(std::move(node));
     }
+    if (remaining > 0) {
+        Bump(stats.failed);
+    }
+    return true;
+}
 
-    for (uint32_t i = 0; i < opts.mix_nodes; ++i) {
-        NodeState node;
-        node.node_id = "node_mix_" + std::to_string(i);
-        node.type = 2;
-        for (uint32_t d = 0; d < opts.ssd_devices_per_node; ++d) {
-            DeviceState dev;
-            dev.device_id = node.node_id + "_SSD_" + std::to_string(d);
-            dev.capacity = opts.ssd_capacity_bytes;
-            node.ssd_devices.push_back(std::move(dev));
-        }
-        for (uint32_t d = 0; d < opts.hdd_devices_per_node; ++d) {
-            DeviceState dev;
-            dev.device_id = node.node_id + "_HDD_" + std::to_string(d);
-            dev.capacity = opts.hdd_capacity_bytes;
-            node.hdd_devices.push_back(std::move(dev));
+// 汇总各线程计数；进度取最慢线程的位置。读的是 relaxed 原子量，回放线程不需要停下来
+Stats CollectStats(const std::vector<WorkerStats>& workers, const std::vector<fs::path>& files) {
+    Stats stats;
+    uint64_t position = 0;
+    uint64_t node = 0;
+    for (const auto& w : workers) {
+        stats.inodes += w.inodes.load(std::memory_order_relaxed);
+        stats.bytes += w.bytes.load(std::memory_order_relaxed);
+        stats.failed += w.failed.load(std::memory_order_relaxed);
+        stats.missing_node += w.missing_node.load(std::memory_order_relaxed);
+        const uint64_t pos = w.position.load(std::memory_order_relaxed);
+        if (pos != 0 && (position == 0 || pos < position)) {
+            position = pos;
+            node = w.last_node.load(std::memory_order_relaxed);
         }
-        nodes.push_back(std::move(node));
     }
-
-    std::unordered_map<std::string, size_t> node_index;
-    node_index.reserve(nodes.size());
-    for (size_t i = 0; i < nodes.size(); ++i) {
-        node_index[nodes[i].node_id] = i;
+    if (position != 0) {
+        stats.current_file = files[(position >> kPositionShift) - 1].filename().string();
+        stats.current_index = position & ((1ULL << kPositionShift) - 1);
     }
-
-    std::vector<fs::path> files;
-    for (const auto& entry : fs::directory_iterator(opts.inode_dir)) {
-        if (!entry.is_regular_file()) continue;
-        if (entry.path().extension() == ".bin") {
-            files.push_back(entry.path());
-        }
+    if (node != 0) {
+        stats.current_node = NodeName(static_cast<uint32_t>(node - 1));
     }
-    std::sort(files.begin(), files.end());
-    if (!opts.start_file.empty()) {
-        bool found = false;
-        for (const auto& path : files) {
-            if (MatchesStartFile(path, opts.start_file)) {
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            std::cerr << "Start file not found: " << opts.start_file << "\n";
-            return 1;
-        }
+    return stats;
+}
+
+std::vector<uint64_t> SnapshotUsed(const Cluster& cluster) {
+    std::vector<uint64_t> used(cluster.devices.size());
+    for (size_t i = 0; i < used.size(); ++i) {
+        used[i] = cluster.used[i].load(std::memory_order_relaxed);
     }
-    if (files.empty()) {
-        std::cerr << "No inode batch files found in " << opts.inode_dir << "\n";
-        return 1;
+    return used;
+}
+
+struct Reporter {
+    const Options& opts;
+    const Cluster& cluster;
+    const std::vector<WorkerStats>& workers;
+    const std::vector<fs::path>& files;
+    std::vector<uint64_t> last_used;
+
+    void Report() {
+        const Stats stats = CollectStats(workers, files);
+        const auto used = SnapshotUsed(cluster);
+        PrintReport(cluster, used, stats, opts.print_limit_nodes, last_used);
+        WriteJsonReport(opts.json_log, cluster, used, stats);
     }
+};
 
-    {
-        std::ofstream json_out(opts.json_log, std::ios::trunc);
-        if (!json_out.is_open()) {
-            std::cerr << "Failed to open json log: " << opts.json_log << "\n";
-            return 1;
-        }
+// 按文件顺序确定回放的 (文件下标, 起始槽号)；start_index 越界时返回 false
+bool StartPosition(const std::vector<fs::path>& files, const Options& opts, size_t& file_idx, uint64_t& slot) {
+    file_idx = 0;
+    slot = 0;
+    if (opts.start_file.empty()) return true;
+    while (!MatchesStartFile(files[file_idx], opts.start_file)) ++file_idx;
+    std::error_code ec;
+    const uint64_t total_slots = fs::file_size(files[file_idx], ec) / InodeStorage::INODE_DISK_SLOT_SIZE;
+    if (ec || opts.start_index >= total_slots) {
+        std::cerr << "Start index out of range for file: " << files[file_idx].string() << "\n";
+        return false;
     }
+    slot = opts.start_index;
+    return true;
+}
 
-    Stats stats;
-    std::unordered_map<std::string, uint64_t> last_used;
+int RunSequential(const Options& opts, const std::vector<fs::path>& files, Cluster& cluster) {
+    std::vector<WorkerStats> workers(1);
+    WorkerStats& stats = workers[0];
+    Reporter reporter{opts, cluster, workers, files, std::vector<uint64_t>(cluster.devices.size(), 0)};
     auto last_report = std::chrono::steady_clock::now();
     auto window_start = std::chrono::steady_clock::now();
     uint32_t window_count = 0;
     const uint64_t slot_size = InodeStorage::INODE_DISK_SLOT_SIZE;
 
-    bool started = opts.start_file.empty();
-    for (const auto& path : files) {
-        if (!started) {
-            if (!MatchesStartFile(path, opts.start_file)) {
-                continue;
-            }
-            started = true;
-        }
+    size_t first_file = 0;
+    uint64_t first_slot = 0;
+    if (!StartPosition(files, opts, first_file, first_slot)) {
+        return 1;
+    }
+    for (size_t file_idx = first_file; file_idx < files.size(); ++file_idx) {
+        const auto& path = files[file_idx];
         std::ifstream in(path, std::ios::binary);
         if (!in.is_open()) {
             std::cerr << "Failed to open inode file: " << path.string() << "\n";
@@ -427,17 +524,9 @@ int main(int argc, char** argv) {
         if (total_bytes <= 0) {
             continue;
         }
-        in.seekg(0, std::ios::beg);
         const uint64_t total_slots = static_cast<uint64_t>(total_bytes) / slot_size;
-
-        uint64_t start_offset = 0;
-        if (!opts.start_file.empty() && MatchesStartFile(path, opts.start_file)) {
-            start_offset = opts.start_index;
-            if (start_offset >= total_slots) {
-                std::cerr << "Start index out of range for file: " << path.string() << "\n";
-                return 1;
-            }
-        }
+        const uint64_t start_offset = file_idx == first_file ? first_slot : 0;
+        in.seekg(static_cast<std::streamoff>(start_offset * slot_size), std::ios::beg);
 
         std::vector<uint8_t> slot(static_cast<size_t>(slot_size));
         for (uint64_t idx = start_offset; idx < total_slots; ++idx) {
@@ -445,13 +534,12 @@ int main(int argc, char** argv) {
             if (in.gcount() != static_cast<std::streamsize>(slot_size)) {
                 break;
             }
-            size_t off = 0;
-            Inode inode;
-            if (!Inode::deserialize(slot.data(), off, inode, slot_size)) {
-                ++stats.failed;
+            InodeSlotView view(slot.data(), idx * slot_size);
+            const uint32_t key = NodeKey(view.node_type(), view.node_id());
+            if (!ApplySlot(view, key, cluster.Find(key), cluster, stats)) {
                 continue;
             }
-            ++stats.inodes;
+            stats.position.store(PackPosition(file_idx, idx), std::memory_order_relaxed);
 
             if (opts.max_inodes_per_sec > 0) {
                 ++window_count;
@@ -466,63 +554,289 @@ int main(int argc, char** argv) {
                 }
             }
 
-            const uint64_t bytes = inode.getFileSize();
-            stats.bytes += bytes;
-            stats.current_file = path.filename().string();
-            stats.current_index = idx;
-
-            const uint8_t type = static_cast<uint8_t>(inode.location_id.fields.node_type & 0x03);
-            const uint16_t node_id = inode.location_id.fields.node_id;
-            std::string node_name;
-            if (type == 0) {
-                node_name = "node_ssd_" + std::to_string(node_id);
-            } else if (type == 1) {
-                node_name = "node_hdd_" + std::to_string(node_id);
-            } else {
-                node_name = "node_mix_" + std::to_string(node_id);
+            auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration_cast<std::chrono::seconds>(now - last_report).count() >= opts.report_interval_sec) {
+                reporter.Report();
+                last_report = now;
+            }
+
+            if (opts.max_inodes > 0 && stats.inodes.load(std::memory_order_relaxed) >= opts.max_inodes) {
+                break;
             }
+        }
+
+        if (opts.max_inodes > 0 && stats.inodes.load(std::memory_order_relaxed) >= opts.max_inodes) {
+            break;
+        }
+    }
+
+    reporter.Report();
+    return 0;
+}
+
+// 读线程预取的一段连续槽
+struct Chunk {
+    size_t file_idx{0};
+    uint64_t first_slot{0};
+    uint64_t slots{0};
+    std::vector<uint8_t> data;
+    std::vector<std::vector<uint32_t>> owned;  // owned[w]：归回放线程 w 的槽在块内的下标，按文件顺序
+};
+
+// 读线程向所有回放线程广播数据块。每个线程按顺序消费全部数据块，只处理属于自己的节点；
+// 读线程最多领先最慢的回放线程 depth 块。
+class ChunkQueue {
+public:
+    ChunkQueue(size_t consumers, size_t depth) : next_(consumers, 0), depth_(depth) {}
+
+    void Push(std::shared_ptr<const Chunk> chunk) {
+        std::unique_lock<std::mutex> lock(mu_);
+        space_cv_.wait(lock, [&] { return produced_ - MinConsumedLocked() < depth_; });
+        window_.push_back(std::move(chunk));
+        ++produced_;
+        data_cv_.notify_all();
+    }
 
-            stats.current_node = node_name;
-
-            auto it = node_index.find(node_name);
-            if (it == node_index.end()) {
-                ++stats.missing_node;
-            } else {
-                auto& node = nodes[it->second];
-                uint64_t remaining = bytes;
-                if (node.type == 0) {
-                    Consume(node.ssd_devices, remaining);
-                } else if (node.type == 1) {
-                    Consume(node.hdd_devices, remaining);
-                } else {
-                    Consume(node.ssd_devices, remaining);
-                    if (remaining > 0) {
-                        Consume(node.hdd_devices, remaining);
+    void Close() {
+        std::lock_guard<std::mutex> lock(mu_);
+        closed_ = true;
+        data_cv_.notify_all();
+    }
+
+    // 没有更多数据块时返回空
+    std::shared_ptr<const Chunk> Pop(size_t consumer) {
+        std::unique_lock<std::mutex> lock(mu_);
+        data_cv_.wait(lock, [&] { return next_[consumer] < produced_ || closed_; });
+        if (next_[consumer] >= produced_) {
+            return nullptr;
+        }
+        auto chunk = window_[next_[consumer] - base_];
+        ++next_[consumer];
+        const uint64_t min_next = MinConsumedLocked();
+        while (base_ < min_next) {
+            window_.pop_front();
+            ++base_;
+        }
+        space_cv_.notify_one();
+        return chunk;
+    }
+
+private:
+    uint64_t MinConsumedLocked() const { return *std::min_element(next_.begin(), next_.end()); }
+
+    std::mutex mu_;
+    std::condition_variable data_cv_;
+    std::condition_variable space_cv_;
+    std::deque<std::shared_ptr<const Chunk>> window_;
+    uint64_t base_{0};      // window_.front() 的序号
+    uint64_t produced_{0};
+    std::vector<uint64_t> next_;
+    size_t depth_;
+    bool closed_{false};
+};
+
+// 槽的归属线程：节点下标 % threads；缺失节点按查表键分片，保证每个槽恰好被一个线程计数
+uint32_t SlotOwner(const InodeSlotView& view, const Cluster& cluster, uint32_t threads) {
+    const uint32_t key = NodeKey(view.node_type(), view.node_id());
+    const int32_t node_idx = cluster.Find(key);
+    return (node_idx >= 0 ? static_cast<uint32_t>(node_idx) : key) % threads;
+}
+
+// 读线程：顺序读批文件、按速率限流、在 max_inodes 处截断，按归属线程分好槽后交给回放线程
+void ReadChunks(const Options& opts,
+                const std::vector<fs::path>& files,
+                size_t first_file,
+                uint64_t first_slot,
+                const Cluster& cluster,
+                uint32_t threads,
+                ChunkQueue& queue) {
+    const uint64_t slot_size = InodeStorage::INODE_DISK_SLOT_SIZE;
+    uint64_t chunk_slots = opts.chunk_slots;
+    if (opts.max_inodes_per_sec > 0) {
+        // 限速时每块不超过 0.1 秒的额度，避免一次性放出一整块造成突发
+        chunk_slots = std::min<uint64_t>(chunk_slots, std::max<uint32_t>(opts.max_inodes_per_sec / 10, 1));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t read_slots = 0;
+    uint64_t valid_inodes = 0;
+    bool stop = false;
+
+    for (size_t file_idx = first_file; file_idx < files.size() && !stop; ++file_idx) {
+        const auto& path = files[file_idx];
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "Failed to open inode file: " << path.string() << "\n";
+            continue;
+        }
+        in.seekg(0, std::ios::end);
+        const std::streamoff total_bytes = in.tellg();
+        if (total_bytes <= 0) {
+            continue;
+        }
+        const uint64_t total_slots = static_cast<uint64_t>(total_bytes) / slot_size;
+        uint64_t idx = file_idx == first_file ? first_slot : 0;
+        in.seekg(static_cast<std::streamoff>(idx * slot_size), std::ios::beg);
+
+        while (idx < total_slots && !stop) {
+            auto chunk = std::make_shared<Chunk>();
+            chunk->file_idx = file_idx;
+            chunk->first_slot = idx;
+            chunk->slots = std::min(chunk_slots, total_slots - idx);
+            chunk->data.resize(static_cast<size_t>(chunk->slots * slot_size));
+            in.read(reinterpret_cast<char*>(chunk->data.data()), static_cast<std::streamsize>(chunk->data.size()));
+            chunk->slots = static_cast<uint64_t>(in.gcount()) / slot_size;
+            if (chunk->slots == 0) {
+                break;
+            }
+            if (opts.max_inodes > 0) {
+                // 与单线程模式一致：只数能解析的 inode，到数后截断
+                for (uint64_t s = 0; s < chunk->slots; ++s) {
+                    if (InodeSlotView(chunk->data.data() + s * slot_size, 0).valid() && ++valid_inodes >= opts.max_inodes) {
+                        chunk->slots = s + 1;
+                        stop = true;
+                        break;
                     }
                 }
-                if (remaining > 0) {
-                    ++stats.failed;
-                }
             }
+            chunk->owned.resize(threads);
+            for (uint32_t s = 0; s < chunk->slots; ++s) {
+                const InodeSlotView view(chunk->data.data() + static_cast<uint64_t>(s) * slot_size, 0);
+                chunk->owned[SlotOwner(view, cluster, threads)].push_back(s);
+            }
+            idx += chunk->slots;
+            read_slots += chunk->slots;
+            queue.Push(std::move(chunk));
 
-            auto now = std::chrono::steady_clock::now();
-            if (std::chrono::duration_cast<std::chrono::seconds>(now - last_report).count() >= opts.report_interval_sec) {
-                PrintReport(nodes, stats, opts.print_limit_nodes, last_used);
-                WriteJsonReport(opts.json_log, nodes, stats);
-                last_report = now;
+            if (opts.max_inodes_per_sec > 0) {
+                const auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                             std::chrono::duration<double>(static_cast<double>(read_slots) /
+                                                                           opts.max_inodes_per_sec));
+                std::this_thread::sleep_until(due);
             }
+        }
+    }
+    queue.Close();
+}
 
-            if (opts.max_inodes > 0 && stats.inodes >= opts.max_inodes) {
+// 回放线程：只处理读线程分给本线程的槽，同一节点的 inode 仍按文件顺序处理
+void ReplayChunks(uint32_t worker, ChunkQueue& queue, Cluster& cluster, WorkerStats& stats) {
+    const uint64_t slot_size = InodeStorage::INODE_DISK_SLOT_SIZE;
+    while (auto chunk = queue.Pop(worker)) {
+        const uint8_t* base = chunk->data.data();
+        for (const uint32_t s : chunk->owned[worker]) {
+            InodeSlotView view(base + s * slot_size, (chunk->first_slot + s) * slot_size);
+            const uint32_t key = NodeKey(view.node_type(), view.node_id());
+            ApplySlot(view, key, cluster.Find(key), cluster, stats);
+        }
+        // 进度按块推进：所有线程看到的是同一块，报告的映射节点取块内最后一个槽
+        const InodeSlotView last(base + (chunk->slots - 1) * slot_size, 0);
+        stats.last_node.store(NodeKey(last.node_type(), last.node_id()) + 1, std::memory_order_relaxed);
+        stats.position.store(PackPosition(chunk->file_idx, chunk->first_slot + chunk->slots - 1),
+                             std::memory_order_relaxed);
+    }
+}
+
+int RunParallel(const Options& opts, const std::vector<fs::path>& files, Cluster& cluster) {
+    size_t first_file = 0;
+    uint64_t first_slot = 0;
+    if (!StartPosition(files, opts, first_file, first_slot)) {
+        return 1;
+    }
+    const uint32_t threads = opts.threads;
+    std::vector<WorkerStats> workers(threads);
+    Reporter reporter{opts, cluster, workers, files, std::vector<uint64_t>(cluster.devices.size(), 0)};
+    ChunkQueue queue(threads, opts.prefetch_chunks);
+
+    std::mutex done_mu;
+    std::condition_variable done_cv;
+    uint32_t running = threads;
+
+    std::thread reader(ReadChunks, std::cref(opts), std::cref(files), first_file, first_slot, std::cref(cluster), threads,
+                       std::ref(queue));
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (uint32_t w = 0; w < threads; ++w) {
+        pool.emplace_back([&, w] {
+            ReplayChunks(w, queue, cluster, workers[w]);
+            std::lock_guard<std::mutex> lock(done_mu);
+            if (--running == 0) done_cv.notify_all();
+        });
+    }
+
+    // 主线程只负责定期出快照
+    const auto interval = std::chrono::seconds(std::max<uint32_t>(opts.report_interval_sec, 1));
+    {
+        std::unique_lock<std::mutex> lock(done_mu);
+        while (!done_cv.wait_for(lock, interval, [&] { return running == 0; })) {
+            lock.unlock();
+            reporter.Report();
+            lock.lock();
+        }
+    }
+    reader.join();
+    for (auto& t : pool) t.join();
+
+    reporter.Report();
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Cluster cluster;
+    for (uint32_t i = 0; i < opts.ssd_nodes; ++i) {
+        cluster.AddNode(0, i, opts.ssd_devices_per_node, 0, opts);
+    }
+    for (uint32_t i = 0; i < opts.hdd_nodes; ++i) {
+        cluster.AddNode(1, i, 0, opts.hdd_devices_per_node, opts);
+    }
+    for (uint32_t i = 0; i < opts.mix_nodes; ++i) {
+        cluster.AddNode(2, i, opts.ssd_devices_per_node, opts.hdd_devices_per_node, opts);
+    }
+    cluster.used = std::vector<std::atomic<uint64_t>>(cluster.devices.size());
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(opts.inode_dir)) {
+        if (!entry.is_regular_file()) continue;
+        if (entry.path().extension() == ".bin") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (!opts.start_file.empty()) {
+        bool found = false;
+        for (const auto& path : files) {
+            if (MatchesStartFile(path, opts.start_file)) {
+                found = true;
                 break;
             }
         }
+        if (!found) {
+            std::cerr << "Start file not found: " << opts.start_file << "\n";
+            return 1;
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "No inode batch files found in " << opts.inode_dir << "\n";
+        return 1;
+    }
 
-        if (opts.max_inodes > 0 && stats.inodes >= opts.max_inodes) {
-            break;
+    {
+        std::ofstream json_out(opts.json_log, std::ios::trunc);
+        if (!json_out.is_open()) {
+            std::cerr << "Failed to open json log: " << opts.json_log << "\n";
+            return 1;
         }
     }
 
-    PrintReport(nodes, stats, opts.print_limit_nodes, last_used);
-    WriteJsonReport(opts.json_log, nodes, stats);
-    return 0;
+    if (opts.threads > 1) {
+        return RunParallel(opts, files, cluster);
+    }
+    return RunSequential(opts, files, cluster);
 }
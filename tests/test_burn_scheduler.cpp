@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/srm/optical_manager/BurnScheduler.h"
+#include "TestUtil.h"
+
+static BurnScheduler::Options FastOptions() {
+    BurnScheduler::Options opts;
+    opts.time_scale = 0;  // 只推进模拟时钟
+    opts.staging_budget_bytes = 1000 * OPTICAL_DISC_CAPACITY;
+    return opts;
+}
+
+// 所有光驱持续工作：每个库的写入带宽接近 drive_count × 单盘写速；
+// 同一光驱上一张盘刻完下一张立即开刻（装盘与刻录重叠），同库机械手装盘不重叠
+static bool TestAllDrivesBusy() {
+    auto libs = std::vector<std::shared_ptr<OpticalDiscLibrary>>{MakeLibrary(0, 4), MakeLibrary(1, 6)};
+    BurnScheduler sched(libs, FastOptions());
+    std::mutex mu;
+    std::vector<BurnScheduler::BurnResult> results;
+    sched.setCompletionCallback([&](const BurnScheduler::BurnResult& r) {
+        std::lock_guard<std::mutex> lock(mu);
+        results.push_back(r);
+    });
+    const uint64_t image_bytes = OPTICAL_DISC_CAPACITY / 100 * 99;
+    for (uint64_t id = 1; id <= 60; ++id) {
+        CHECK(sched.trySubmit({id, image_bytes, ""}));
+    }
+    sched.start();
+    sched.drain();
+
+    auto stats = sched.getStats();
+    CHECK(stats.burned_images == 60 && stats.failed_images == 0);
+    CHECK(stats.staged_bytes == 0 && stats.queued_images == 0);
+    for (const auto& lib : stats.libraries) {
+        const double limit = lib.drive_count * OPTICAL_DISC_WRITE_MBPS;
+        CHECK(lib.throughputMBps() <= limit * 1.0001);
+        CHECK(lib.throughputMBps() >= limit * 0.97);
+    }
+
+    CHECK(results.size() == 60);
+    std::set<std::string> discs;
+    std::map<std::pair<std::string, uint32_t>, std::vector<BurnScheduler::BurnResult>> by_drive;
+    std::map<std::string, std::vector<std::pair<double, double>>> loads;
+    for (const auto& r : results) {
+        CHECK(r.ok);
+        CHECK(discs.insert(r.disc_id).second);
+        by_drive[{r.library_id, r.drive}].push_back(r);
+        loads[r.library_id].emplace_back(r.load_start, r.load_start + OPTICAL_LIBRARY_LOAD_TIME);
+    }
+    CHECK(by_drive.size() == 10);
+    for (auto& kv : by_drive) {
+        auto& v = kv.second;
+        std::sort(v.begin(), v.end(), [](const auto& a, const auto& b) { return a.burn_start < b.burn_start; });
+        for (size_t i = 1; i < v.size(); ++i) {
+            CHECK(v[i].burn_start == v[i - 1].burn_end);
+            // 下一张盘在上一张刻录期间装好
+            CHECK(v[i].load_start + OPTICAL_LIBRARY_LOAD_TIME <= v[i - 1].burn_end);
+        }
+    }
+    for (auto& kv : loads) {
+        auto& v = kv.second;
+        std::sort(v.begin(), v.end());
+        for (size_t i = 1; i < v.size(); ++i) {
+            CHECK(v[i].first >= v[i - 1].second);
+        }
+    }
+    return true;
+}
+
+// 暂存空间满时 submit 阻塞，刻录推进后放行
+static bool TestBackPressure() {
+    auto opts = FastOptions();
+    opts.staging_budget_bytes = 3 * OPTICAL_DISC_CAPACITY;
+    BurnScheduler sched({MakeLibrary(2, 2)}, opts);
+    for (uint64_t id = 1; id <= 3; ++id) {
+        CHECK(sched.trySubmit({id, OPTICAL_DISC_CAPACITY, ""}));
+    }
+    CHECK(!sched.hasCapacity(OPTICAL_DISC_CAPACITY));
+    CHECK(!sched.trySubmit({4, OPTICAL_DISC_CAPACITY, ""}));
+
+    std::atomic<bool> accepted{false};
+    std::thread producer([&] {
+        accepted = sched.submit({4, OPTICAL_DISC_CAPACITY, ""});
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!accepted.load());
+    sched.start();
+    producer.join();
+    CHECK(accepted.load());
+    sched.drain();
+    CHECK(sched.getStats().burned_images == 4);
+    CHECK(sched.hasCapacity(OPTICAL_DISC_CAPACITY));
+
+    sched.stop();
+    CHECK(!sched.trySubmit({5, OPTICAL_DISC_CAPACITY, ""}));
+    return true;
+}
+
+// 没有空白盘或镜像超过光盘容量时刻录失败并回调
+static bool TestFailures() {
+    BurnScheduler sched({MakeLibrary(3, 2)}, FastOptions());
+    int handed_out = 0;
+    sched.setDiscAllocator([&](OpticalDiscLibrary&) -> std::string {
+        if (handed_out >= 2) return "";
+        char id[32];
+        std::snprintf(id, sizeof(id), "disc_%010d", 3 * OPTICAL_LIBRARY_DISC_NUM + handed_out++);
+        return id;
+    });
+    std::atomic<int> ok{0};
+    std::atomic<int> failed{0};
+    sched.setCompletionCallback([&](const BurnScheduler::BurnResult& r) { (r.ok ? ok : failed)++; });
+    CHECK(sched.trySubmit({1, OPTICAL_DISC_CAPACITY + 1, ""}));
+    for (uint64_t id = 2; id <= 5; ++id) {
+        CHECK(sched.trySubmit({id, OPTICAL_DISC_CAPACITY / 2, ""}));
+    }
+    sched.start();
+    sched.drain();
+    CHECK(ok == 2 && failed == 3);
+    auto stats = sched.getStats();
+    CHECK(stats.burned_images == 2 && stats.failed_images == 3);
+    CHECK(stats.staged_bytes == 0);
+    return true;
+}
+
+int main() {
+    return RunTests("burn scheduler", {
+        {"all drives busy", TestAllDrivesBusy},
+        {"back pressure", TestBackPressure},
+        {"failures", TestFailures},
+    });
+}
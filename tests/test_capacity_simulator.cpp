@@ -0,0 +1,263 @@
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/srm/simulation/CapacitySimulator.h"
+#include "../src/storagenode/hard_disc/HDD.h"
+#include "../src/storagenode/hard_disc/SSD.h"
+#include "../src/storagenode/optical/OpticalDiscLibrary.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t kMiB = 1ULL << 20;
+
+bool Near(double a, double b, double eps = 1e-3) { return std::fabs(a - b) <= eps; }
+
+// 单库、单光驱，装卸 10s，读 36MB/s：36MiB 读 1s
+CapacitySimConfig SmallLibrary(uint32_t drives) {
+    CapacitySimConfig cfg;
+    cfg.libraries = 1;
+    cfg.drives_per_library = drives;
+    cfg.robots_per_library = 1;
+    cfg.load_unload_seconds = 10;
+    cfg.disc_read_MBps = 36;
+    cfg.disc_write_MBps = 36;
+    cfg.discs_per_library = 1000;
+    // SSD/HDD 足够快，写入路径的耗时可忽略
+    cfg.ssd_write_MBps = 1e9;
+    cfg.hdd_write_MBps = 1e9;
+    return cfg;
+}
+
+// 两张不同的盘抢一个光驱：第二个请求排队等第一个读完再换盘
+bool TestRecallQueueing() {
+    CapacitySimulator sim(SmallLibrary(1));
+    VectorRecallSource recalls({{0, 0, 36 * kMiB}, {0, 1, 36 * kMiB}});
+    auto report = sim.run(nullptr, &recalls);
+    CHECK(report.recalls == 2 && report.mounts == 2);
+    CHECK(Near(report.recall_latency.max(), 22));
+    CHECK(Near(report.recall_latency.mean(), (11 + 22) / 2.0));
+    CHECK(Near(report.recall_queue_delay.max(), 11));
+    CHECK(Near(report.makespan, 22));
+    CHECK(Near(report.drive_utilization, 1.0));
+    CHECK(Near(report.robot_utilization, 20.0 / 22));
+    return true;
+}
+
+// 同一张盘上的请求一次装盘顺序读完；盘还在空闲光驱里时新请求不再换盘
+bool TestSameDiscBatch() {
+    CapacitySimulator sim(SmallLibrary(2));
+    VectorRecallSource recalls({
+        {0, 5, 36 * kMiB},
+        {0, 6, 36 * kMiB},
+        {0, 5, 36 * kMiB},
+        {0, 5, 36 * kMiB},
+        {100, 5, 36 * kMiB},
+    });
+    auto report = sim.run(nullptr, &recalls);
+    CHECK(report.recalls == 5);
+    CHECK(report.mounts == 2);
+    // 盘 5 第一个请求直接装盘，11s 读完；后两个在光驱忙时到达，读完后不换盘接着读：12, 13.05；
+    // 盘 6 在另一光驱，但要等唯一的机械手装完盘 5：21；最后一个命中仍装在空闲光驱里的盘 5：1
+    CHECK(Near(report.recall_latency.max(), 21));
+    CHECK(Near(report.recall_latency.mean(), (11 + 21 + 12 + 13.05 + 1) / 5));
+    CHECK(Near(report.recall_queue_delay.max(), 11));
+    return true;
+}
+
+// 写入流凑满镜像后刻录；结束时余量也刻上，积压清零
+bool TestIngestBurn() {
+    auto cfg = SmallLibrary(2);
+    cfg.image_bytes = 100 * kMiB;
+    std::vector<IngestItem> files;
+    for (int i = 0; i < 11; ++i) files.push_back({0, 50 * kMiB});
+    {
+        CapacitySimulator sim(cfg);
+        VectorIngestSource ingest(files);
+        auto report = sim.run(&ingest, nullptr);
+        CHECK(report.ingest_files == 11 && report.ingest_bytes == 550 * kMiB);
+        CHECK(report.sealed_images == 6 && report.burned_images == 6);
+        CHECK(report.burned_bytes == 550 * kMiB && report.unburned_bytes == 0);
+        CHECK(report.peak_backlog_bytes == 550 * kMiB);
+        CHECK(report.mean_backlog_bytes > 0 && report.mean_backlog_bytes < 550.0 * kMiB);
+        // 两个光驱轮流刻 6 张，后 4 张要排队
+        CHECK(report.burn_queue_delay.count() == 6 && report.burn_queue_delay.max() > 0);
+        CHECK(report.drive_utilization > 0.5 && report.drive_utilization <= 1.0 + 1e-9);
+    }
+    {
+        // 空白盘只剩 2 张：其余镜像留在暂存里
+        cfg.discs_per_library = 2;
+        cfg.hdd_staging_bytes = 300 * kMiB;
+        CapacitySimulator sim(cfg);
+        VectorIngestSource ingest(files);
+        auto report = sim.run(&ingest, nullptr);
+        CHECK(report.burned_images == 2 && report.unburned_bytes == 350 * kMiB);
+        CHECK(report.peak_staging_bytes == 550 * kMiB);
+        CHECK(report.staging_overflow_seconds > 0);
+    }
+    return true;
+}
+
+// 光驱空闲后先服务回调，再刻下一张镜像
+bool TestRecallBeforeBurn() {
+    auto cfg = SmallLibrary(1);
+    cfg.image_bytes = 36 * kMiB;
+    CapacitySimulator sim(cfg);
+    VectorIngestSource ingest({{0, 36 * kMiB}, {0, 36 * kMiB}});
+    VectorRecallSource recalls({{5, 100, 36 * kMiB}});
+    auto report = sim.run(&ingest, &recalls);
+    CHECK(report.burned_images == 2 && report.recalls == 1);
+    // 第一张刻到约 11s，回调装盘 + 读到约 22s
+    CHECK(Near(report.recall_latency.max(), 17, 1e-2));
+    CHECK(Near(report.makespan, 33, 1e-2));
+    CHECK(report.mounts == 3);
+    return true;
+}
+
+bool TestInodeBatchAndTrace() {
+    ScratchDir scratch("capacity_sim");
+    const fs::path& dir = scratch.path();
+    fs::create_directories(dir / "inode");
+    {
+        std::ofstream out(dir / "inode" / "inode_chunk_0.bin", std::ios::binary);
+        for (uint64_t ino = 1; ino <= 300; ++ino) {
+            Inode inode;
+            inode.inode = ino;
+            inode.setFilename("f" + std::to_string(ino));
+            inode.setFileType(static_cast<uint8_t>(ino % 3 == 0 ? FileType::Directory : FileType::Regular));
+            inode.setSizeUnit(2);  // MB
+            inode.setFileSize(10);
+            auto bytes = inode.serialize();
+            bytes.resize(InodeSlotView::kSlotSize, 0);
+            out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        }
+    }
+    {
+        std::ofstream out(dir / "trace.txt");
+        out << "# time disc bytes\n"
+            << "1.0 3 1048576\n"
+            << "\n"
+            << "2.5 disc_0000000004 1048576\n"
+            << "bogus line\n"
+            << "3.0 999999 1048576\n"
+            << "4.0 99999999999999999999999 1048576\n";
+    }
+
+    auto cfg = SmallLibrary(2);
+    cfg.image_bytes = 1000 * kMiB;
+    InodeBatchReader::Options reader_opts;
+    reader_opts.threads = 2;
+    InodeBatchIngestSource ingest((dir / "inode").string(), 100, reader_opts);
+    TraceRecallSource trace((dir / "trace.txt").string());
+    CHECK(trace.ok());
+    CapacitySimulator sim(cfg);
+    auto report = sim.run(&ingest, &trace);
+    CHECK(ingest.files() == 200);
+    CHECK(report.ingest_files == 200);
+    Inode probe;
+    probe.setSizeUnit(2);
+    probe.setFileSize(10);
+    CHECK(report.ingest_bytes == 200 * probe.getFileSize());
+    CHECK(report.burned_bytes == report.ingest_bytes);
+    CHECK(report.recalls == 2 && report.recall_failed == 1);
+    CHECK(trace.malformed() == 2);
+    CHECK(report.makespan >= 199.0 / 100);
+    CHECK(report.to_json()["ingest"]["files"] == 200);
+    return true;
+}
+
+bool TestFromModels() {
+    OpticalDiscLibrary lib("lib_0", OPTICAL_LIBRARY_DISC_NUM, 4, 7.5);
+    HardDiskDrive hdd("hdd-0", 123 * kMiB, 150, 160);
+    SolidStateDrive ssd("ssd-0", 456 * kMiB, 400, 500);
+    auto cfg = CapacitySimConfig::fromModels(lib, hdd, ssd);
+    CHECK(cfg.drives_per_library == 4 && cfg.load_unload_seconds == 7.5);
+    CHECK(cfg.hdd_write_MBps == 150 && cfg.ssd_write_MBps == 400);
+    CHECK(cfg.hdd_staging_bytes == 123 * kMiB);
+    return true;
+}
+
+// 缺省的键保留默认值
+bool TestFromJson() {
+    auto cfg = CapacitySimConfig::fromJson(nlohmann::json::parse(R"({
+        "libraries": 4, "drives_per_library": 6, "load_unload_seconds": 12.5,
+        "image_bytes": 1048576, "flush_partial_image": false
+    })"));
+    const CapacitySimConfig defaults;
+    CHECK(cfg.libraries == 4 && cfg.drives_per_library == 6 && cfg.load_unload_seconds == 12.5);
+    CHECK(cfg.image_bytes == kMiB && !cfg.flush_partial_image);
+    CHECK(cfg.robots_per_library == defaults.robots_per_library && cfg.seek_seconds == defaults.seek_seconds);
+    CHECK(cfg.hdd_staging_bytes == defaults.hdd_staging_bytes);
+    bool threw = false;
+    try {
+        CapacitySimConfig::fromJson(nlohmann::json::parse(R"({"libraries": "four"})"));
+    } catch (const nlohmann::json::exception&) {
+        threw = true;
+    }
+    CHECK(threw);
+    return true;
+}
+
+// 泊松到达的合成回调，不落盘
+class PoissonRecalls : public RecallSource {
+public:
+    PoissonRecalls(uint64_t count, double rate, uint64_t discs) : left_(count), gap_(rate), disc_(0, discs - 1) {}
+    bool next(RecallItem& item) override {
+        if (left_ == 0) return false;
+        --left_;
+        t_ += gap_(rng_);
+        item.at = t_;
+        item.disc = disc_(rng_);
+        item.bytes = 4 * kMiB;
+        return true;
+    }
+
+private:
+    uint64_t left_;
+    double t_ = 0;
+    std::mt19937_64 rng_{42};
+    std::exponential_distribution<double> gap_;
+    std::uniform_int_distribution<uint64_t> disc_;
+};
+
+// 大规模回放：结果自洽，并输出事件吞吐
+bool TestLargeReplay() {
+    CapacitySimConfig cfg;
+    cfg.libraries = 8;
+    const uint64_t n = 500000;
+    PoissonRecalls recalls(n, 0.5, static_cast<uint64_t>(cfg.libraries) * cfg.discs_per_library);
+    CapacitySimulator sim(cfg);
+    auto report = sim.run(nullptr, &recalls);
+    CHECK(report.recalls == n && report.recall_failed == 0);
+    CHECK(report.events > n && report.mounts > 0);
+    CHECK(report.recall_latency.quantile(0.5) <= report.recall_latency.quantile(0.99));
+    CHECK(report.recall_latency.quantile(0.99) <= report.recall_latency.max());
+    CHECK(report.drive_utilization > 0 && report.drive_utilization < 1);
+    std::cout << "large replay: " << report.events << " events in " << report.wall_seconds << "s, p99 latency "
+              << report.recall_latency.quantile(0.99) << "s, drive utilization " << report.drive_utilization
+              << std::endl;
+    return true;
+}
+
+} // namespace
+
+int main() {
+    return RunTests("capacity simulator", {
+        {"recall queueing", TestRecallQueueing},
+        {"same disc batch", TestSameDiscBatch},
+        {"ingest burn", TestIngestBurn},
+        {"recall before burn", TestRecallBeforeBurn},
+        {"inode batch and trace", TestInodeBatchAndTrace},
+        {"from models", TestFromModels},
+        {"from json", TestFromJson},
+        {"large replay", TestLargeReplay},
+    });
+}
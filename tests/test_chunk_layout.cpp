@@ -0,0 +1,269 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/client/mount/ChunkLayout.h"
+#include "../src/mds/server/LayoutStore.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+static ChunkLayout Striped(uint64_t chunk_size, size_t width) {
+    ChunkLayout layout;
+    layout.chunk_size = chunk_size;
+    for (size_t i = 0; i < width; ++i) {
+        layout.node_ids.push_back("node-" + std::to_string(i));
+    }
+    return layout;
+}
+
+// 旧式文件：整段落在一个 chunk 上，chunk id 即 inode
+static bool TestSplitLegacy(const fs::path&) {
+    ChunkLayout layout;
+    auto pieces = layout.Split(42, 100, 5000, "node-x");
+    CHECK(pieces.size() == 1);
+    CHECK(pieces[0].chunk_id == 42 && pieces[0].chunk_offset == 100);
+    CHECK(pieces[0].file_offset == 100 && pieces[0].length == 5000);
+    CHECK(pieces[0].node_id == "node-x");
+    CHECK(layout.Split(42, 0, 0, "node-x").empty());
+    return true;
+}
+
+// 条带化文件：按 chunk 边界切分，chunk i 在 node_ids[i % width] 上
+static bool TestSplitStriped(const fs::path&) {
+    const ChunkLayout layout = Striped(1000, 3);
+    auto pieces = layout.Split(7, 900, 2300, "unused");
+    CHECK(pieces.size() == 4);
+    const uint64_t want_index[] = {0, 1, 2, 3};
+    const uint64_t want_off[] = {900, 0, 0, 0};
+    const size_t want_len[] = {100, 1000, 1000, 200};
+    uint64_t pos = 900;
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        const auto& p = pieces[i];
+        CHECK(p.chunk_index == want_index[i]);
+        CHECK(p.chunk_id == ChunkLayout::ChunkId(7, want_index[i]));
+        CHECK((p.chunk_id & ChunkLayout::kStripedTag) != 0);
+        CHECK(p.chunk_offset == want_off[i] && p.length == want_len[i]);
+        CHECK(p.file_offset == pos);
+        CHECK(p.node_id == layout.node_ids[want_index[i] % 3]);
+        pos += p.length;
+    }
+    // 不同 inode 的同号 chunk 不冲突
+    CHECK(ChunkLayout::ChunkId(7, 1) != ChunkLayout::ChunkId(8, 1));
+    return true;
+}
+
+// 纠删码文件：每个数据单元一个分片，校验分片随 chunk 组轮转
+static bool TestSplitErasureCoded(const fs::path&) {
+    ChunkLayout layout = Striped(4096, 5);
+    layout.ec_data = 2;
+    layout.ec_parity = 1;
+    layout.ec_cell = 1024;
+    CHECK(layout.erasure_coded());
+    CHECK(layout.RowBytes() == 2048 && layout.RowsPerChunk() == 4);
+
+    auto pieces = layout.Split(9, 512, 2048, "unused");
+    CHECK(pieces.size() == 3);
+    CHECK(pieces[0].chunk_index == 0 && pieces[0].chunk_offset == 512 && pieces[0].length == 512);
+    CHECK(pieces[1].chunk_index == 1 && pieces[1].chunk_offset == 0 && pieces[1].length == 1024);
+    CHECK(pieces[2].chunk_index == 0 && pieces[2].chunk_offset == 1024 && pieces[2].length == 512);
+
+    // 第 4 行进入第二个 chunk 组：分片号从 k + m 开始，节点整体后移一位
+    auto next = layout.Split(9, 4 * 2048, 1, "unused");
+    CHECK(next.size() == 1);
+    CHECK(next[0].chunk_index == 3 && next[0].chunk_offset == 0);
+    CHECK(next[0].node_id == layout.node_ids[1]);
+    CHECK(layout.Fragment(9, 4, 2).node_id == layout.node_ids[3]);
+    return true;
+}
+
+// chunk id 放不下 inode 或 chunk 序号时不切分
+static bool TestChunkIdBounds(const fs::path&) {
+    const ChunkLayout layout = Striped(1000, 2);
+    const uint64_t max_inode = (1ULL << ChunkLayout::kInodeBits) - 1;
+    const uint64_t max_index = (1ULL << ChunkLayout::kIndexBits) - 1;
+    CHECK(ChunkLayout::ChunkIdFits(max_inode, max_index));
+    CHECK(!ChunkLayout::ChunkIdFits(max_inode + 1, 0));
+    CHECK(!ChunkLayout::ChunkIdFits(1, max_index + 1));
+
+    CHECK(layout.Split(max_inode, 0, 10, "unused").size() == 1);
+    CHECK(layout.Split(max_inode + 1, 0, 10, "unused").empty());
+    // 最后一个可寻址 chunk 可以写，越过它就拒绝
+    const uint64_t last_byte = (max_index + 1) * 1000 - 1;
+    CHECK(layout.Split(5, last_byte, 1, "unused").size() == 1);
+    CHECK(layout.Split(5, last_byte, 2, "unused").empty());
+    CHECK(layout.Addressable(5, last_byte + 1));
+    CHECK(!layout.Addressable(5, last_byte + 2));
+    // 旧式文件不受限制
+    CHECK(ChunkLayout{}.Split(max_inode + 1, 0, 10, "n").size() == 1);
+    return true;
+}
+
+// 布局日志重放：覆盖写、删除、纠删码与副本字段都能恢复；截断的尾部记录被丢弃
+static bool TestLayoutStoreReplay(const fs::path& dir) {
+    const std::string log = (dir / "layouts.log").string();
+    FileLayout plain;
+    plain.chunk_size = 64 << 20;
+    plain.node_ids = {"a", "b", "c"};
+    FileLayout ec = plain;
+    ec.node_ids = {"a", "b", "c", "d"};
+    ec.ec_data = 2;
+    ec.ec_parity = 1;
+    ec.ec_cell_size = 1 << 20;
+    FileLayout rep = plain;
+    rep.replicas = 3;
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        CHECK(store.set(1, plain));
+        CHECK(store.set(2, ec));
+        CHECK(store.set(3, rep));
+        CHECK(store.set(4, plain));
+        CHECK(store.erase(4));
+        CHECK(!store.erase(4));
+        FileLayout empty;
+        CHECK(!store.set(5, empty));
+        plain.node_ids.push_back("d");
+        CHECK(store.set(1, plain));  // 覆盖旧记录
+    }
+    {
+        // 崩溃时写了一半的记录
+        std::ofstream out(log, std::ios::app);
+        out << "SET 6 1048576 3 a b";
+    }
+    LayoutStore store(log);
+    CHECK(store.load());
+    FileLayout got;
+    CHECK(store.get(1, got) && got.chunk_size == plain.chunk_size && got.node_ids == plain.node_ids);
+    CHECK(store.get(2, got) && got.erasure_coded() && got.ec_data == 2 && got.ec_parity == 1 &&
+          got.ec_cell_size == ec.ec_cell_size && got.node_ids == ec.node_ids);
+    CHECK(store.get(3, got) && got.replicas == 3 && !got.erasure_coded());
+    CHECK(!store.get(4, got));
+    CHECK(!store.get(5, got));
+    CHECK(!store.get(6, got));
+
+    CHECK(store.reset());
+    CHECK(!store.get(1, got));
+    LayoutStore reopened(log);
+    CHECK(reopened.load());
+    CHECK(!reopened.get(2, got));
+    return true;
+}
+
+static size_t CountLines(const std::string& path) {
+    std::ifstream in(path);
+    size_t n = 0;
+    for (std::string line; std::getline(in, line);) {
+        ++n;
+    }
+    return n;
+}
+
+// 记录带 CRC：尾部校验不符的记录丢弃并截掉，中间记录损坏则 load 失败；
+// 旧格式日志可读并被重写；失效记录过多时压缩
+static bool TestLayoutStoreFraming(const fs::path& dir) {
+    const std::string log = (dir / "layouts.log").string();
+    FileLayout plain;
+    plain.chunk_size = 1 << 20;
+    plain.node_ids = {"a", "b"};
+    {
+        std::ofstream out(log);
+        out << "SET 9 1048576 1 a\n";  // 旧格式，无校验
+    }
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        FileLayout got;
+        CHECK(store.get(9, got) && got.node_ids.size() == 1);
+        CHECK(store.set(1, plain));
+    }
+    {
+        std::ifstream in(log);
+        std::string line;
+        CHECK(std::getline(in, line) && line.find(" #") != std::string::npos);
+    }
+    {
+        // 字段截断但带换行的尾部记录：校验不符
+        std::ofstream out(log, std::ios::app);
+        out << "SET 7 1048576 2 a b EC 2 #00000000\n";
+    }
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        FileLayout got;
+        CHECK(!store.get(7, got));
+        CHECK(store.set(8, plain));
+    }
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        FileLayout got;
+        CHECK(store.get(1, got) && store.get(8, got) && store.get(9, got) && !store.get(7, got));
+    }
+    {
+        // 校验不符的尾部记录之后又追加了新记录
+        std::ofstream out(log, std::ios::app);
+        out << "SET 7 1048576 2 a b #00000000\n";
+    }
+    {
+        LayoutStore store(log);
+        CHECK(store.load());  // 尾部残留被截掉，新记录接在完整记录之后
+        CHECK(store.set(10, plain));
+    }
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        FileLayout got;
+        CHECK(store.get(10, got) && !store.get(7, got));
+    }
+    {
+        std::string data;
+        {
+            std::ifstream in(log);
+            std::ostringstream ss;
+            ss << in.rdbuf();
+            data = ss.str();
+        }
+        const size_t at = data.find("SET 8");
+        CHECK(at != std::string::npos);
+        data[at + 4] = '6';  // 中间记录内容被改：不是崩溃残留，拒绝启动
+        std::ofstream out(log, std::ios::trunc);
+        out << data;
+    }
+    {
+        LayoutStore store(log);
+        CHECK(!store.load());
+    }
+
+    // 反复覆盖同一 inode：日志被压缩，不会无限增长
+    CHECK(LayoutStore(log).reset());
+    {
+        LayoutStore store(log);
+        CHECK(store.load());
+        for (int i = 0; i < 3000; ++i) {
+            plain.chunk_size = static_cast<uint64_t>(i + 1) << 10;
+            CHECK(store.set(5, plain));
+        }
+    }
+    CHECK(CountLines(log) <= 1025);
+    LayoutStore store(log);
+    CHECK(store.load());
+    FileLayout got;
+    CHECK(store.get(5, got) && got.chunk_size == plain.chunk_size);
+    return true;
+}
+
+int main() {
+    return RunDirTests("chunk layout", "chunk_layout", {
+        {"split legacy", TestSplitLegacy},
+        {"split striped", TestSplitStriped},
+        {"split erasure coded", TestSplitErasureCoded},
+        {"chunk id bounds", TestChunkIdBounds},
+        {"layout store replay", TestLayoutStoreReplay},
+        {"layout store framing", TestLayoutStoreFraming},
+    });
+}
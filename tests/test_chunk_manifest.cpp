@@ -0,0 +1,236 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/storagenode/real_node/meta/ChunkManifest.h"
+#include "../src/storagenode/real_node/meta/LocalMetadataManager.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+static std::vector<fs::path> WalFiles(const fs::path& dir) {
+    std::vector<fs::path> out;
+    for (const auto& e : fs::directory_iterator(dir)) {
+        if (e.path().extension() == ".wal") {
+            out.push_back(e.path());
+        }
+    }
+    return out;
+}
+
+// 写入、删除后重新打开，映射应与关闭前一致
+static bool TestReopen(const fs::path& dir) {
+    const std::string base = (dir / "m").string();
+    {
+        ChunkManifest m(base);
+        CHECK(m.Load());
+        CHECK(m.empty_on_disk());
+        for (uint64_t id = 1; id <= 10000; ++id) {
+            CHECK(m.Insert(id, static_cast<uint8_t>(id % 3)) == id % 3);
+        }
+        // 已存在的 chunk 保持原来的 root
+        CHECK(m.Insert(5, 2) == 5 % 3);
+        for (uint64_t id = 1; id <= 10000; id += 2) {
+            CHECK(m.Erase(id));
+        }
+        CHECK(!m.Erase(1));
+        CHECK(m.size() == 5000);
+    }
+    ChunkManifest m(base);
+    CHECK(m.Load());
+    CHECK(!m.empty_on_disk());
+    CHECK(m.size() == 5000);
+    for (uint64_t id = 1; id <= 10000; ++id) {
+        const uint8_t want = id % 2 ? ChunkManifest::kNoRoot : static_cast<uint8_t>(id % 3);
+        CHECK(m.Find(id) == want);
+    }
+    return true;
+}
+
+// sync_on_write 时每条 WAL 记录都落盘，重新打开后内容一致
+static bool TestSyncOnWrite(const fs::path& dir) {
+    const std::string base = (dir / "m").string();
+    ChunkManifest::Options opts;
+    opts.sync_on_write = true;
+    {
+        ChunkManifest m(base, opts);
+        CHECK(m.Load());
+        for (uint64_t id = 1; id <= 200; ++id) {
+            CHECK(m.Insert(id, 0) == 0);
+        }
+        CHECK(m.Erase(7));
+    }
+    ChunkManifest m(base, opts);
+    CHECK(m.Load());
+    CHECK(m.size() == 199);
+    CHECK(m.Find(7) == ChunkManifest::kNoRoot && m.Find(8) == 0);
+    return true;
+}
+
+// 记录数达到阈值后后台自动做 checkpoint，旧的 WAL 被清理
+static bool TestCheckpoint(const fs::path& dir) {
+    const std::string base = (dir / "m").string();
+    ChunkManifest::Options opts;
+    opts.shards = 8;
+    opts.checkpoint_records = 1000;
+    {
+        ChunkManifest m(base, opts);
+        CHECK(m.Load());
+        for (uint64_t id = 0; id < 200000; ++id) {
+            m.Insert(id * 7919, static_cast<uint8_t>(id % 5));
+        }
+        CHECK(m.Checkpoint());
+        for (uint64_t id = 0; id < 100; ++id) {
+            m.Erase(id * 7919);
+        }
+    }
+    CHECK(fs::exists(base + ".snap"));
+    CHECK(WalFiles(dir).size() == 1);
+    ChunkManifest m(base, opts);
+    CHECK(m.Load());
+    CHECK(m.size() == 200000 - 100);
+    CHECK(m.Find(0) == ChunkManifest::kNoRoot);
+    CHECK(m.Find(199999ull * 7919) == 199999 % 5);
+    return true;
+}
+
+// WAL 尾部被截断（写到一半崩溃）时，丢弃残缺记录并继续使用
+static bool TestTornTail(const fs::path& dir) {
+    const std::string base = (dir / "m").string();
+    ChunkManifest::Options opts;
+    opts.checkpoint_records = 0;
+    {
+        ChunkManifest m(base, opts);
+        CHECK(m.Load());
+        for (uint64_t id = 1; id <= 100; ++id) {
+            m.Insert(id, 1);
+        }
+    }
+    auto wals = WalFiles(dir);
+    CHECK(wals.size() == 1);
+    fs::resize_file(wals[0], fs::file_size(wals[0]) - 5);
+    {
+        ChunkManifest m(base, opts);
+        CHECK(m.Load());
+        CHECK(m.size() == 99);
+        CHECK(m.Find(100) == ChunkManifest::kNoRoot);
+        m.Insert(100, 0);
+    }
+    ChunkManifest m(base, opts);
+    CHECK(m.Load());
+    CHECK(m.size() == 100);
+    CHECK(m.Find(100) == 0);
+    return true;
+}
+
+// 旧的文本 manifest 在首次启动时被导入并改名
+static bool TestLegacyImport(const fs::path& dir) {
+    const std::string r0 = (dir / "r0").string();
+    const std::string r1 = (dir / "r1").string();
+    std::string p1;
+    std::string p2;
+    {
+        LocalMetadataManager tmp({r0, r1}, (dir / "scratch").string());
+        p1 = tmp.AllocPath(1);
+        p2 = tmp.AllocPath(2);
+    }
+    {
+        std::ofstream out(r0 + "/chunk_manifest.log");
+        out << "ADD 1 " << p1 << "\n";
+        out << "ADD 2 " << p2 << "\n";
+        out << "ADD 3 /elsewhere/chunk_3\n";
+        out << "DEL 1 \n";
+        out << "ADD 4 " << r1 << "/00/00/chunk_4\n";
+    }
+    {
+        LocalMetadataManager mgr({r0, r1});
+        CHECK(mgr.ChunkCount() == 2);
+        CHECK(mgr.GetPath(1).empty());
+        CHECK(mgr.GetPath(2) == p2);
+        CHECK(mgr.GetPath(3).empty());
+        CHECK(mgr.GetPath(4) == r1 + "/00/00/chunk_4");
+        CHECK(mgr.AllocPath(2) == p2);
+    }
+    CHECK(!fs::exists(r0 + "/chunk_manifest.log"));
+    CHECK(fs::exists(r0 + "/chunk_manifest.log.imported"));
+    LocalMetadataManager mgr({r0, r1});
+    CHECK(mgr.ChunkCount() == 2);
+    CHECK(mgr.GetPath(4) == r1 + "/00/00/chunk_4");
+    return true;
+}
+
+// manifest 记录数据根路径：根顺序变化或新增时按路径重映射，缺了已记录的根则拒绝打开
+static bool TestDataRoots(const fs::path& dir) {
+    const std::string r0 = (dir / "r0").string();
+    const std::string r1 = (dir / "r1").string();
+    const std::string r2 = (dir / "r2").string();
+    const std::string base = (dir / "m").string();
+    std::vector<std::string> paths;
+    {
+        LocalMetadataManager mgr({r0, r1}, base);
+        CHECK(mgr.ok());
+        for (uint64_t id = 1; id <= 100; ++id) {
+            paths.push_back(mgr.AllocPath(id));
+            CHECK(!paths.back().empty());
+        }
+    }
+    {
+        ChunkManifest m(base);
+        CHECK(m.Load());
+        CHECK(m.roots() == std::vector<std::string>({r0, r1}));
+    }
+    {
+        LocalMetadataManager mgr({r2, r1, r0}, base);
+        CHECK(mgr.ok());
+        for (uint64_t id = 1; id <= 100; ++id) {
+            CHECK(mgr.GetPath(id) == paths[id - 1]);
+        }
+    }
+    {
+        LocalMetadataManager mgr({r0, r2}, base);
+        CHECK(!mgr.ok());
+        CHECK(mgr.GetPath(1).empty());
+    }
+    LocalMetadataManager mgr({r1, r0, r2}, base);
+    CHECK(mgr.ok());
+    CHECK(mgr.ChunkCount() == 100);
+    for (uint64_t id = 1; id <= 100; ++id) {
+        CHECK(mgr.GetPath(id) == paths[id - 1]);
+    }
+    return true;
+}
+
+// 快照损坏时 Load 返回 false
+static bool TestCorruptSnapshot(const fs::path& dir) {
+    const std::string base = (dir / "m").string();
+    {
+        ChunkManifest m(base);
+        CHECK(m.Load());
+        for (uint64_t id = 1; id <= 1000; ++id) {
+            m.Insert(id, 0);
+        }
+        CHECK(m.Checkpoint());
+    }
+    {
+        std::fstream f(base + ".snap", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp(100);
+        f.put('\x5a');
+    }
+    ChunkManifest m(base);
+    CHECK(!m.Load());
+    return true;
+}
+
+int main() {
+    return RunDirTests("chunk manifest", "chunk_manifest", {
+        {"reopen", TestReopen},
+        {"sync on write", TestSyncOnWrite},
+        {"checkpoint", TestCheckpoint},
+        {"torn tail", TestTornTail},
+        {"legacy import", TestLegacyImport},
+        {"data roots", TestDataRoots},
+        {"corrupt snapshot", TestCorruptSnapshot},
+    });
+}
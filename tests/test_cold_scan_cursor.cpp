@@ -0,0 +1,216 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/mds/collector/collector.h"
+#include "../src/mds/inode/InodeStorage.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 所有 inode 都足够冷，结果里的 inode 号就是本轮扫过的 inode
+class AllColdSelector : public IColdInodeSelector {
+public:
+	bool is_cold(const Inode&, const ColdCollectorConfig&) const override { return true; }
+};
+
+// 记录调用 is_cold 的线程；每次稍作停顿，让各解码线程都能领到分片
+class ThreadRecordingSelector : public IColdInodeSelector {
+public:
+	bool is_cold(const Inode&, const ColdCollectorConfig&) const override {
+		std::this_thread::sleep_for(std::chrono::microseconds(20));
+		std::lock_guard<std::mutex> lock(mu_);
+		threads_.insert(std::this_thread::get_id());
+		return true;
+	}
+	size_t thread_count() const {
+		std::lock_guard<std::mutex> lock(mu_);
+		return threads_.size();
+	}
+
+private:
+	mutable std::mutex mu_;
+	mutable std::set<std::thread::id> threads_;
+};
+
+// 写一个批文件，inode 号为 [first, first + count)
+void write_batch(const fs::path& file, uint64_t first, size_t count) {
+	std::ofstream out(file, std::ios::binary | std::ios::trunc);
+	for (size_t i = 0; i < count; ++i) {
+		Inode inode;
+		inode.inode = first + i;
+		inode.setFilename("f" + std::to_string(first + i));
+		inode.setFileType(static_cast<uint8_t>(FileType::Regular));
+		inode.setVolumeId("vol-test");
+		auto bytes = inode.serialize();
+		bytes.resize(InodeStorage::INODE_DISK_SLOT_SIZE, 0);
+		out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+}
+
+struct Fixture {
+	ScratchDir scratch;
+	fs::path dir;
+	ColdCollectorConfig cfg;
+
+	explicit Fixture(const std::string& name) : scratch("scan_cursor_" + name), dir(scratch.path()) {
+		fs::create_directories(dir / "inode");
+		// 3 个批文件，共 15 个 inode：1-5, 6-10, 11-15
+		write_batch(dir / "inode" / "inode_chunk_0.bin", 1, 5);
+		write_batch(dir / "inode" / "inode_chunk_1.bin", 6, 5);
+		write_batch(dir / "inode" / "inode_chunk_2.bin", 11, 5);
+		cfg.inode_directory = (dir / "inode").string();
+		cfg.max_inodes_per_round = 4;
+		cfg.max_batch_size = 100;
+	}
+
+	std::unique_ptr<ColdDataCollectorService> make_service() const {
+		auto svc = std::make_unique<ColdDataCollectorService>(nullptr, nullptr, cfg);
+		svc->set_selector(std::make_shared<AllColdSelector>());
+		return svc;
+	}
+};
+
+std::vector<uint64_t> range(uint64_t first, uint64_t last) {
+	std::vector<uint64_t> out;
+	for (uint64_t i = first; i <= last; ++i) {
+		out.push_back(i);
+	}
+	return out;
+}
+
+// 每轮从上一轮停下的位置继续，跨文件推进，扫完一遍后回到开头
+bool TestAdvanceAndWrap() {
+	Fixture f("wrap");
+	auto svc = f.make_service();
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(1, 4));
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(5, 8));
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(9, 12));
+	CHECK(svc->scan_cursor().passes == 0);
+	// 最后一轮只剩 3 个，扫完即结束这一遍
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(13, 15));
+	CHECK(svc->scan_cursor().passes == 1);
+	CHECK(svc->scan_cursor().file.empty());
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(1, 4));
+	return true;
+}
+
+// 额度恰好在文件末尾用完时，游标直接指向下一个文件
+bool TestLimitAtFileBoundary() {
+	Fixture f("boundary");
+	f.cfg.max_inodes_per_round = 5;
+	auto svc = f.make_service();
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(1, 5));
+	auto cursor = svc->scan_cursor();
+	CHECK(cursor.file == "inode_chunk_1.bin" && cursor.offset == 0);
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(6, 10));
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(11, 15));
+	CHECK(svc->scan_cursor().passes == 1);
+	return true;
+}
+
+// 一批冷 inode 装满提前返回时，游标停在最后一个已处理的 inode 之后
+bool TestBatchFullKeepsPosition() {
+	Fixture f("batch");
+	f.cfg.max_inodes_per_round = 100;
+	f.cfg.max_batch_size = 3;
+	auto svc = f.make_service();
+	std::set<uint64_t> seen;
+	for (int round = 0; round < 5; ++round) {
+		auto result = svc->run_single_scan_for_test();
+		CHECK(result.cold_inodes.size() == 3);
+		for (uint64_t ino : result.cold_inodes) {
+			CHECK(seen.insert(ino).second);
+		}
+	}
+	CHECK(seen.size() == 15);
+	return true;
+}
+
+// 检查点持久化：新的服务实例从检查点继续
+bool TestCheckpointResume() {
+	Fixture f("checkpoint");
+	f.cfg.cursor_checkpoint_path = (f.dir / "state" / "cursor.json").string();
+	{
+		auto svc = f.make_service();
+		CHECK(svc->run_single_scan_for_test().cold_inodes == range(1, 4));
+		CHECK(svc->run_single_scan_for_test().cold_inodes == range(5, 8));
+	}
+	CHECK(fs::exists(f.cfg.cursor_checkpoint_path));
+	auto svc = f.make_service();
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(9, 12));
+
+	// 损坏的检查点被忽略，从头开始
+	{
+		std::ofstream out(f.cfg.cursor_checkpoint_path, std::ios::trunc);
+		out << "{not json";
+	}
+	auto fresh = f.make_service();
+	CHECK(fresh->run_single_scan_for_test().cold_inodes == range(1, 4));
+	return true;
+}
+
+// 游标所在的批文件被删除后，从其后的第一个文件继续
+bool TestCursorFileRemoved() {
+	Fixture f("removed");
+	auto svc = f.make_service();
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(1, 4));
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(5, 8));
+	CHECK(svc->scan_cursor().file == "inode_chunk_1.bin");
+	fs::remove(f.dir / "inode" / "inode_chunk_1.bin");
+	CHECK(svc->run_single_scan_for_test().cold_inodes == range(11, 14));
+	return true;
+}
+
+// 多线程解码时每轮结果与游标和单线程完全一致。分片取 32 个槽，每轮窗口跨越多个分片，
+// 确认确实有多个线程参与解码
+bool TestThreadsMatchSequential() {
+	Fixture f("threads");
+	write_batch(f.dir / "inode" / "inode_chunk_3.bin", 16, 3000);
+	f.cfg.max_inodes_per_round = 700;
+	f.cfg.max_batch_size = 10000;
+	f.cfg.scan_range = ColdScanRange{3, 2900};
+	f.cfg.scan_chunk_bytes = 32 * InodeStorage::INODE_DISK_SLOT_SIZE;
+	f.cfg.scan_threads = 1;
+	auto single = f.make_service();
+	f.cfg.scan_threads = 8;
+	auto multi = f.make_service();
+	auto recorder = std::make_shared<ThreadRecordingSelector>();
+	multi->set_selector(recorder);
+	for (int round = 0; round < 6; ++round) {
+		auto a = single->run_single_scan_for_test();
+		auto b = multi->run_single_scan_for_test();
+		CHECK(a.cold_inodes == b.cold_inodes);
+		CHECK(a.cold_inodes.size() == (round == 4 ? 2898 - 4 * 700 : 700));
+		auto ca = single->scan_cursor();
+		auto cb = multi->scan_cursor();
+		CHECK(ca.file == cb.file && ca.offset == cb.offset && ca.passes == cb.passes);
+		if (round == 4) {
+			CHECK(ca.passes == 1);
+		}
+	}
+	CHECK(recorder->thread_count() > 1);
+	return true;
+}
+
+} // namespace
+
+int main() {
+	return RunTests("cold scan cursor", {
+		{"advance and wrap", TestAdvanceAndWrap},
+		{"limit at file boundary", TestLimitAtFileBoundary},
+		{"batch full keeps position", TestBatchFullKeepsPosition},
+		{"checkpoint resume", TestCheckpointResume},
+		{"cursor file removed", TestCursorFileRemoved},
+		{"threads match sequential", TestThreadsMatchSequential},
+	});
+}
@@ -0,0 +1,177 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/common/Crc32c.h"
+#include "../src/srm/optical_manager/DiscLocationCatalog.h"
+#include "../src/srm/optical_manager/RecallScheduler.h"
+#include "TestUtil.h"
+
+static std::vector<DiscLocationCatalog::FileExtent> MakeImage(uint64_t first_inode, size_t files) {
+    std::vector<DiscLocationCatalog::FileExtent> v;
+    uint64_t offset = 4096;
+    for (size_t i = 0; i < files; ++i) {
+        v.push_back({first_inode + i, offset, 1000 + i});
+        offset += 8192;
+    }
+    return v;
+}
+
+// 提交、查找、重新打开后数据仍在，且扩容（rehash）不丢记录
+static bool TestCommitFindReopen() {
+    ScratchDir dir("loccat_basic");
+    const std::string path = (dir.path() / "catalog").string();
+    {
+        DiscLocationCatalog cat(path, 16);
+        CHECK(cat.Open());
+        for (uint32_t img = 1; img <= 50; ++img) {
+            CHECK(cat.CommitImage(img, 100000 + img, img % 7, MakeImage(img * 1000, 200)));
+        }
+        CHECK(cat.size() == 50 * 200);
+        CHECK(cat.capacity() * 7 >= cat.size() * 10);
+        DiscLocationCatalog::Location loc;
+        CHECK(cat.FindInode(7 * 1000 + 3, &loc));
+        CHECK(loc.image_id == 7 && loc.disc == 100007 && loc.library == 0);
+        CHECK(loc.offset == 4096 + 3 * 8192 && loc.size == 1003);
+        CHECK(!cat.FindInode(999, &loc));
+        CHECK(!cat.FindInode(0, &loc));
+    }
+    DiscLocationCatalog cat(path, 16);
+    CHECK(cat.Open());
+    CHECK(cat.size() == 50 * 200);
+    for (uint32_t img = 1; img <= 50; ++img) {
+        for (uint64_t i = 0; i < 200; ++i) {
+            DiscLocationCatalog::Location loc;
+            CHECK(cat.FindInode(img * 1000 + i, &loc));
+            CHECK(loc.image_id == img && loc.size == 1000 + i);
+        }
+    }
+    // 重新归档覆盖旧位置，不增加条目
+    CHECK(cat.CommitImage(99, 5, 3, {{1000, 0, 1}}));
+    DiscLocationCatalog::Location loc;
+    CHECK(cat.FindInode(1000, &loc) && loc.image_id == 99 && loc.disc == 5);
+    CHECK(cat.size() == 50 * 200);
+    // 镜像号是 64 位的
+    const uint64_t wide = (1ULL << 40) + 5;
+    CHECK(cat.CommitImage(wide, 6, 1, {{1001, 0, 1}}));
+    CHECK(cat.FindInode(1001, &loc) && loc.image_id == wide);
+    return true;
+}
+
+// 删除后同一探测链上的其他记录仍然能找到
+static bool TestErase() {
+    ScratchDir dir("loccat_erase");
+    const std::string path = (dir.path() / "catalog").string();
+    DiscLocationCatalog cat(path, 1024);
+    CHECK(cat.Open());
+    std::mt19937_64 rng(44);
+    std::vector<DiscLocationCatalog::FileExtent> files;
+    for (int i = 0; i < 600; ++i) files.push_back({(rng() | 1), static_cast<uint64_t>(i), 1});
+    CHECK(cat.CommitImage(1, 1, 0, files));
+    for (size_t i = 0; i < files.size(); i += 2) CHECK(cat.Erase(files[i].inode));
+    CHECK(!cat.Erase(files[0].inode));
+    CHECK(cat.size() == files.size() / 2);
+    for (size_t i = 0; i < files.size(); ++i) {
+        DiscLocationCatalog::Location loc;
+        const bool found = cat.FindInode(files[i].inode, &loc);
+        CHECK(found == (i % 2 == 1));
+        if (found) CHECK(loc.offset == files[i].offset);
+    }
+    return true;
+}
+
+// 只写完 journal 就崩溃：重新打开时重放；journal 残缺时整批丢弃。
+// journal 按 DiscLocationCatalog.cpp 中的批次格式手工构造
+static bool TestJournalRecovery() {
+    ScratchDir dir("loccat_journal");
+    const std::string path = (dir.path() / "catalog").string();
+    const std::string journal = path + ".journal";
+    {
+        DiscLocationCatalog cat(path, 16);
+        CHECK(cat.Open());
+        CHECK(cat.CommitImage(1, 10, 1, MakeImage(100, 3)));
+    }
+    auto write_batch = [&](uint32_t image, uint32_t disc, uint64_t inode, bool torn) {
+        struct {
+            uint32_t op, count;
+            uint64_t image_id;
+            uint32_t disc, library, reserved, crc;
+        } h{1, 1, image, disc, 2, 0, 0};
+        uint64_t entry[3] = {inode, 4096, 77};
+        std::string batch(reinterpret_cast<const char*>(&h), sizeof(h));
+        batch.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+        uint32_t crc = Crc32c(batch.data(), 28);
+        crc = Crc32cExtend(crc, batch.data() + 32, batch.size() - 32);
+        std::memcpy(&batch[28], &crc, 4);
+        if (torn) batch.resize(batch.size() - 5);
+        std::ofstream(journal, std::ios::binary | std::ios::trunc).write(batch.data(), batch.size());
+    };
+
+    write_batch(2, 20, 555, false);
+    {
+        DiscLocationCatalog cat(path, 16);
+        CHECK(cat.Open());
+        DiscLocationCatalog::Location loc;
+        CHECK(cat.FindInode(555, &loc) && loc.disc == 20 && loc.size == 77);
+        CHECK(cat.FindInode(101, &loc) && loc.disc == 10);
+    }
+    write_batch(3, 30, 666, true);
+    {
+        DiscLocationCatalog cat(path, 16);
+        CHECK(cat.Open());
+        CHECK(!cat.FindInode(666, nullptr));
+        CHECK(cat.size() == 4);
+    }
+    std::ifstream j(journal, std::ios::binary | std::ios::ate);
+    CHECK(j.tellg() == 0);
+    return true;
+}
+
+// 回调调度器按 inode 提交：位置直接来自目录
+static bool TestRecallByInode() {
+    ScratchDir dir("loccat_recall");
+    const std::string path = (dir.path() / "catalog").string();
+    DiscLocationCatalog cat(path, 64);
+    CHECK(cat.Open());
+    const uint32_t disc = 3 * OPTICAL_LIBRARY_DISC_NUM + 12;
+    CHECK(cat.CommitImage(1, disc, 3, MakeImage(1, 10)));
+
+    auto lib = std::make_shared<OpticalDiscLibrary>(DiscLocationCatalog::FormatLibraryId(3), OPTICAL_LIBRARY_DISC_NUM,
+                                                    2, OPTICAL_LIBRARY_LOAD_TIME);
+    RecallScheduler::Options opts;
+    opts.time_scale = 0;
+    RecallScheduler sched({lib}, opts);
+    std::mutex mu;
+    std::vector<RecallScheduler::RecallResult> results;
+    sched.setCompletionCallback([&](const RecallScheduler::RecallResult& r) {
+        std::lock_guard<std::mutex> lock(mu);
+        results.push_back(r);
+    });
+    sched.start();
+    for (uint64_t ino = 1; ino <= 10; ++ino) CHECK(sched.submitInode(ino, ino, cat));
+    CHECK(!sched.submitInode(11, 12345, cat));
+    sched.drain();
+    CHECK(results.size() == 10);
+    for (const auto& r : results) {
+        CHECK(r.ok && r.library_id == "lib_00003");
+        CHECK(r.request.disc_id == DiscLocationCatalog::FormatDiscId(disc));
+        CHECK(r.request.length == 1000 + (r.request.request_id - 1));
+    }
+    CHECK(sched.getStats().mounts == 1);
+    sched.stop();
+    return true;
+}
+
+int main() {
+    return RunTests("disc location catalog", {
+        {"commit / find / reopen", TestCommitFindReopen},
+        {"erase", TestErase},
+        {"journal recovery", TestJournalRecovery},
+        {"recall by inode", TestRecallByInode},
+    });
+}
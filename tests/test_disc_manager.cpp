@@ -1,56 +1,162 @@
+#include <cstdio>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
+
 #include "../src/srm/optical_manager/DiscManager.h"
+#include "TestUtil.h"
+
+// 状态切换与各状态计数
+static bool TestStatusTransitions() {
+    DiscManager manager;
+    std::vector<std::shared_ptr<OpticalDisc>> discs;
+    discs.push_back(std::make_shared<OpticalDisc>("disc_0000000000", "lib_00000"));
+    discs.push_back(std::make_shared<OpticalDisc>("disc_0000000001", "lib_00000"));
+    discs.push_back(std::make_shared<OpticalDisc>("disc_0000020002", "lib_00001"));
+    for (const auto& disc : discs) {
+        manager.addDisc(disc, DiscStatus::Blank);
+    }
+    CHECK(manager.totalDiscCount() == 3 && manager.blankDiscCount() == 3);
+
+    manager.setDiscStatus(discs[1], DiscStatus::InUse);
+    CHECK(discs[1]->status == DiscStatus::InUse);
+    CHECK(manager.blankDiscCount() == 2 && manager.inuseDiscCount() == 1);
+
+    manager.setDiscStatus(discs[2], DiscStatus::Finalized);
+    CHECK(manager.finalizedDiscCount() == 1);
+
+    manager.recycleDisc(discs[0]->device_id);
+    CHECK(manager.recycledDiscCount() == 1 && manager.blankDiscCount() == 0);
+    CHECK(manager.nextBlankDisc() == DiscManager::kNoDisc);
+
+    auto found = manager.findDisc("disc_0000000001");
+    CHECK(found && found->status == DiscStatus::InUse);
+    CHECK(std::string(found->library_id) == "lib_00000");
+    found = manager.findDisc("disc_0000020002");
+    CHECK(found && std::string(found->library_id) == "lib_00001");
+    CHECK(manager.discSlot(20002) == 2);
+    CHECK(!manager.findDisc("disc_0000000007"));
+    CHECK(!manager.findDisc("bad_id"));
+    CHECK(manager.totalDiscCount() == 3);
+    return true;
+}
+
+// 空白盘按加入顺序分配，回到空白状态的盘排在队尾
+static bool TestAcquireBlank() {
+    DiscManager manager;
+    ScratchDir dir("disc_acquire");
+    manager.snapshot_file = (dir.path() / "disc_table.bin").string();
+    manager.generateBlankDiscs(50000);
+    CHECK(manager.totalDiscCount() == 50000 && manager.blankDiscCount() == 50000);
+    CHECK(manager.discLibrary(45000) == 2);
+    for (uint32_t i = 0; i < 100; ++i) {
+        CHECK(manager.acquireBlankDisc() == i);
+    }
+    CHECK(manager.inuseDiscCount() == 100);
+    CHECK(manager.setDiscStatus(5, DiscStatus::Blank));
+    CHECK(manager.nextBlankDisc() == 100);
+    CHECK(manager.addUsedBytes(100, OPTICAL_DISC_CAPACITY / 2));
+    CHECK(!manager.addUsedBytes(100, OPTICAL_DISC_CAPACITY));
+    CHECK(!manager.setDiscStatus(60000, DiscStatus::Lost));
+
+    // 按库取盘：跳过其他库的空白盘，库内仍按加入顺序
+    CHECK(manager.acquireBlankDisc(2) == 40000);
+    CHECK(manager.acquireBlankDisc(2) == 40001);
+    CHECK(manager.acquireBlankDisc(0) == 100);
+    CHECK(manager.acquireBlankDisc(3) == DiscManager::kNoDisc);
+    return true;
+}
+
+// 快照保存后重新加载，状态、已用字节和计数一致
+static bool TestSnapshot() {
+    ScratchDir dir("disc_snap");
+    const std::string path = (dir.path() / "disc_table.bin").string();
+    DiscManager a;
+    a.snapshot_file = path;
+    a.generateBlankDiscs(1000);
+    a.addDisc(30000, DiscStatus::Lost);  // 光盘号不连续
+    for (uint32_t i = 0; i < 10; ++i) a.acquireBlankDisc();
+    a.setDiscStatus(3, DiscStatus::Finalized);
+    a.addUsedBytes(3, 12345);
+    CHECK(a.saveSnapshot());
+
+    DiscManager b;
+    b.snapshot_file = path;
+    CHECK(b.loadSnapshot());
+    CHECK(b.totalDiscCount() == 1001);
+    CHECK(b.blankDiscCount() == 990 && b.inuseDiscCount() == 9);
+    CHECK(b.finalizedDiscCount() == 1 && b.lostDiscCount() == 1);
+    CHECK(b.discStatus(3) == DiscStatus::Finalized && b.discUsedBytes(3) == 12345);
+    CHECK(b.discLibrary(30000) == 1 && !b.hasDisc(29999));
+    CHECK(b.nextBlankDisc() == 10);
+    std::remove(path.c_str());
+
+    DiscManager c;
+    c.snapshot_file = path;
+    CHECK(!c.loadSnapshot());
+    return true;
+}
+
+// 空白盘重新排回队尾后保存，加载后分配顺序不变
+static bool TestSnapshotKeepsOrder() {
+    ScratchDir dir("disc_order");
+    const std::string path = (dir.path() / "disc_table.bin").string();
+    DiscManager a;
+    a.snapshot_file = path;
+    a.generateBlankDiscs(100);
+    for (uint32_t i = 0; i < 10; ++i) a.acquireBlankDisc();
+    CHECK(a.setDiscStatus(5, DiscStatus::Blank));
+    CHECK(a.setDiscStatus(2, DiscStatus::Blank));
+    CHECK(a.saveSnapshot());
+
+    DiscManager b;
+    b.snapshot_file = path;
+    CHECK(b.loadSnapshot());
+    for (uint32_t i = 10; i < 100; ++i) {
+        CHECK(b.acquireBlankDisc() == i);
+    }
+    CHECK(b.acquireBlankDisc() == 5);
+    CHECK(b.acquireBlankDisc() == 2);
+    CHECK(b.acquireBlankDisc() == DiscManager::kNoDisc);
+    return true;
+}
+
+// 光盘号很大或很稀疏时按实际盘数占用空间
+static bool TestSparseIds() {
+    ScratchDir dir("disc_sparse");
+    const std::string path = (dir.path() / "disc_table.bin").string();
+    DiscManager a;
+    a.snapshot_file = path;
+    a.addDisc(4000000000u, DiscStatus::Blank);
+    a.addDisc(7, DiscStatus::Blank);
+    a.addDisc(4000000001u, DiscStatus::Finalized);
+    a.addDisc(8, DiscStatus::Blank);
+    CHECK(a.totalDiscCount() == 4 && a.blankDiscCount() == 3);
+    CHECK(a.hasDisc(4000000000u) && a.hasDisc(4000000001u) && a.hasDisc(7) && a.hasDisc(8));
+    CHECK(!a.hasDisc(9) && !a.hasDisc(3999999999u) && !a.hasDisc(4000000002u));
+    CHECK(a.discLibrary(4000000000u) == 4000000000u / OPTICAL_LIBRARY_DISC_NUM);
+    CHECK(a.nextBlankDisc() == 4000000000u);
+    CHECK(a.saveSnapshot());
+
+    DiscManager b;
+    b.snapshot_file = path;
+    CHECK(b.loadSnapshot());
+    CHECK(b.totalDiscCount() == 4 && b.finalizedDiscCount() == 1);
+    CHECK(b.discStatus(4000000001u) == DiscStatus::Finalized);
+    CHECK(b.acquireBlankDisc() == 4000000000u);
+    CHECK(b.acquireBlankDisc() == 7);
+    b.addDisc(9, DiscStatus::Blank);
+    CHECK(b.hasDisc(9) && b.acquireBlankDisc() == 8 && b.acquireBlankDisc() == 9);
+    return true;
+}
 
 int main() {
-    // DiscManager manager;
-
-    // // 构造几张光盘并添加到管理器
-    // std::vector<std::shared_ptr<OpticalDisc>> discs;
-    // discs.push_back(std::make_shared<OpticalDisc>("disc_0000000000", "lib_00000", OPTICAL_DISC_CAPACITY, OPTICAL_DISC_WRITE_MBPS, OPTICAL_DISC_READ_MBPS));
-    // discs.push_back(std::make_shared<OpticalDisc>("disc_0000000001", "lib_00000", OPTICAL_DISC_CAPACITY, OPTICAL_DISC_WRITE_MBPS, OPTICAL_DISC_READ_MBPS));
-    // discs.push_back(std::make_shared<OpticalDisc>("disc_0000000002", "lib_00001", OPTICAL_DISC_CAPACITY, OPTICAL_DISC_WRITE_MBPS, OPTICAL_DISC_READ_MBPS));
-
-    // for (const auto& disc : discs) {
-    //     manager.addDisc(disc, DiscStatus::Blank);
-    //     std::cout << "[INFO] 添加光盘 " << disc->device_id
-    //               << " 当前空闲数量: " << manager.blankDiscCount()
-    //               << " 总数: " << manager.totalDiscCount() << std::endl;
-    // }
-
-    // // 将第二张光盘标记为使用中
-    // manager.setDiscStatus(discs[1], DiscStatus::InUse);
-    // std::cout << "[INFO] 设置 " << discs[1]->device_id << " 为 InUse"
-    //           << " | 空闲: " << manager.blankDiscCount()
-    //           << " | 使用中: " << manager.inuseDiscCount() << std::endl;
-
-    // // 将第三张光盘标记为已完成
-    // manager.setDiscStatus(discs[2], DiscStatus::Finalized);
-    // std::cout << "[INFO] 设置 " << discs[2]->device_id << " 为 Finalized"
-    //           << " | 已完成: " << manager.finalizedDiscCount() << std::endl;
-
-    // // 回收第一张光盘
-    // manager.recycleDisc(discs[0]->device_id);
-    // std::cout << "[INFO] 回收光盘 " << discs[0]->device_id
-    //           << " | 回收数量: " << manager.recycledDiscCount() << std::endl;
-
-    // // 尝试查找已添加的光盘
-    // auto found = manager.findDisc("disc_0000000001");
-    // if (found) {
-    //     std::cout << "[INFO] 查找到光盘: " << found->device_id
-    //               << " 状态: " << static_cast<int>(found->status) << std::endl;
-    // } else {
-    //     std::cout << "[WARN] 未找到指定光盘" << std::endl;
-    // }
-
-    // std::cout << "[RESULT] DiscManager 状态汇总 ->"
-    //           << " 总数: " << manager.totalDiscCount()
-    //           << " 空闲: " << manager.blankDiscCount()
-    //           << " 使用中: " << manager.inuseDiscCount()
-    //           << " 已完成: " << manager.finalizedDiscCount()
-    //           << " 回收: " << manager.recycledDiscCount()
-    //           << " 丢失: " << manager.lostDiscCount() << std::endl;
-
-    return 0;
+    return RunTests("disc manager", {
+        {"status transitions", TestStatusTransitions},
+        {"acquire blank", TestAcquireBlank},
+        {"snapshot", TestSnapshot},
+        {"snapshot keeps order", TestSnapshotKeepsOrder},
+        {"sparse ids", TestSparseIds},
+    });
 }
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/common/ErasureCode.h"
+
+// 对每种 RS(k, m) 配置：编码后任意丢失至多 m 个分片，都应能恢复出原始数据分片。
+static bool CheckConfig(int k, int m, size_t len, std::mt19937& rng) {
+    ErasureCode ec(k, m);
+    std::vector<std::vector<uint8_t>> frags(k + m, std::vector<uint8_t>(len));
+    for (int j = 0; j < k; ++j) {
+        for (auto& b : frags[j]) {
+            b = static_cast<uint8_t>(rng());
+        }
+    }
+    std::vector<const uint8_t*> data;
+    std::vector<uint8_t*> parity;
+    for (int j = 0; j < k; ++j) data.push_back(frags[j].data());
+    for (int i = 0; i < m; ++i) parity.push_back(frags[k + i].data());
+    ec.Encode(data.data(), parity.data(), len);
+
+    for (int trial = 0; trial < 50; ++trial) {
+        // 随机选择丢失的分片（至多 m 个）
+        std::vector<int> order(k + m);
+        for (int i = 0; i < k + m; ++i) order[i] = i;
+        std::shuffle(order.begin(), order.end(), rng);
+        const int lost = m == 0 ? 0 : 1 + static_cast<int>(rng() % m);
+        std::vector<const uint8_t*> present(k + m, nullptr);
+        for (int i = lost; i < k + m; ++i) present[order[i]] = frags[order[i]].data();
+
+        std::vector<std::vector<uint8_t>> rebuilt(k, std::vector<uint8_t>(len, 0xAA));
+        std::vector<uint8_t*> out;
+        for (int j = 0; j < k; ++j) out.push_back(rebuilt[j].data());
+        if (!ec.Reconstruct(present.data(), out.data(), len)) {
+            std::cerr << "Reconstruct failed k=" << k << " m=" << m << " lost=" << lost << std::endl;
+            return false;
+        }
+        for (int j = 0; j < k; ++j) {
+            if (std::memcmp(rebuilt[j].data(), frags[j].data(), len) != 0) {
+                std::cerr << "Mismatch k=" << k << " m=" << m << " fragment=" << j << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // 丢失 m + 1 个分片时必须报告失败
+    std::vector<const uint8_t*> too_few(k + m, nullptr);
+    for (int i = m + 1; i < k + m; ++i) too_few[i] = frags[i].data();
+    std::vector<std::vector<uint8_t>> scratch(k, std::vector<uint8_t>(len));
+    std::vector<uint8_t*> out;
+    for (int j = 0; j < k; ++j) out.push_back(scratch[j].data());
+    if (ec.Reconstruct(too_few.data(), out.data(), len)) {
+        std::cerr << "Reconstruct succeeded with too few fragments k=" << k << " m=" << m << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    std::cout << "GF kernel: " << ErasureCode::KernelName() << std::endl;
+    const int configs[][2] = {{1, 1}, {2, 1}, {4, 2}, {6, 3}, {10, 4}, {12, 4}};
+    // 长度覆盖 SIMD 主循环、尾部以及跨 16KB 分片的情况
+    const size_t lens[] = {1, 31, 4096, 40000};
+    for (const auto& c : configs) {
+        for (size_t len : lens) {
+            if (!CheckConfig(c[0], c[1], len, rng)) {
+                return 1;
+            }
+        }
+    }
+    std::cout << "Test passed: erasure code encode/reconstruct" << std::endl;
+    return 0;
+}
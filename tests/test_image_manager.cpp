@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/srm/image_manager/ImageManager.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+static Inode MakeInode(uint64_t id, const std::string& path, uint16_t size, uint16_t unit) {
+    Inode inode;
+    inode.inode = id;
+    inode.setFilename(path);
+    inode.setSizeUnit(unit);
+    inode.setFileSize(size);
+    return inode;
+}
+
+// 检查镜像内文件不重叠、不越界
+static bool CheckLayout(const DiscImage& image, uint64_t alignment) {
+    CHECK(image.image_bytes <= image.capacity);
+    uint64_t pos = image.data_offset;
+    for (const auto& f : image.files) {
+        CHECK(f.offset % alignment == 0);
+        CHECK(f.offset >= pos);
+        pos = f.offset + f.size;
+    }
+    CHECK(pos <= image.image_bytes);
+    return true;
+}
+
+// 模拟模式下按 100GB 光盘装箱：达标镜像填充率 >= 98%，每个文件恰好出现一次，
+// 目录尽量落在少数几张盘上
+static bool TestPackingFill(const fs::path&) {
+    ImageManager mgr;
+    std::mt19937_64 rng(41);
+    std::unordered_map<uint64_t, uint64_t> sizes;
+    std::unordered_map<std::string, uint64_t> dir_bytes;
+    uint64_t id = 1;
+    for (int d = 0; d < 400; ++d) {
+        const std::string dir = "/vol" + std::to_string(d % 7) + "/proj" + std::to_string(d);
+        const int files = 1 + static_cast<int>(rng() % 60);
+        for (int i = 0; i < files; ++i, ++id) {
+            // 大多数文件几十到几百 MB，少数几 GB
+            const uint16_t mb = static_cast<uint16_t>(rng() % 8 == 0 ? 1024 + rng() % 4096 : 1 + rng() % 400);
+            Inode inode = MakeInode(id, dir + "/f" + std::to_string(i), mb, 2);
+            CHECK(mgr.sim_image_write_file(inode) == IMAGE_OP_SUCCESS);
+            sizes[id] = inode.getFileSize();
+            dir_bytes[dir] += inode.getFileSize();
+        }
+    }
+    // 重复提交不会重复打包
+    CHECK(mgr.sim_image_write_file(MakeInode(1, "/vol0/proj0/f0", 1, 2)) == IMAGE_OP_SUCCESS);
+    CHECK(mgr.sim_image_write_file(MakeInode(id, "/big", 101, 3)) == IMAGE_OP_TOO_LARGE);
+
+    auto images = mgr.flush(false);
+    CHECK(images.size() >= 20);
+    std::set<uint64_t> seen;
+    for (const auto& image : images) {
+        CHECK(image.fill() >= 0.98);
+        CHECK(image.build_seconds > 0);
+        CHECK(CheckLayout(image, 4096));
+        for (const auto& f : image.files) {
+            CHECK(seen.insert(f.inode).second);
+            CHECK(f.size == sizes[f.inode]);
+            ImageLocation loc;
+            CHECK(mgr.locate(f.inode, &loc));
+            CHECK(loc.image_id == image.image_id && loc.offset == f.offset);
+        }
+    }
+    auto stats = mgr.get_stats();
+    CHECK(stats.mean_fill() >= 0.98);
+    CHECK(stats.files + stats.pending_files == sizes.size());
+    // 未打包的数据不足以再凑满几张盘
+    CHECK(stats.pending_bytes < 3 * OPTICAL_DISC_CAPACITY);
+
+    // 目录局部性：完全打包的目录平均占用的盘数接近理论下限
+    double discs = 0;
+    double lower = 0;
+    size_t dirs = 0;
+    for (const auto& kv : dir_bytes) {
+        auto ids = mgr.images_for_directory(kv.first);
+        if (ids.empty()) {
+            continue;
+        }
+        discs += ids.size();
+        lower += static_cast<double>((kv.second + OPTICAL_DISC_CAPACITY - 1) / OPTICAL_DISC_CAPACITY);
+        ++dirs;
+    }
+    CHECK(dirs > 0);
+    CHECK(discs <= lower * 1.25);
+
+    // force 时剩余文件全部生成
+    auto rest = mgr.flush(true);
+    CHECK(!rest.empty());
+    stats = mgr.get_stats();
+    CHECK(stats.pending_files == 0 && stats.pending_bytes == 0);
+    CHECK(stats.files == sizes.size());
+    return true;
+}
+
+// 文件内容由 inode 号和偏移决定，便于校验
+static char Byte(uint64_t inode, uint64_t off) {
+    return static_cast<char>((inode * 131 + off * 7) & 0xff);
+}
+
+// 真实写出小容量镜像，按索引读回的内容与源一致；重启后从 .idx 恢复位置目录
+static bool TestImageRoundTrip(const fs::path& dir) {
+    ImageManager::Options opts;
+    opts.image_capacity = 1 << 20;
+    opts.alignment = 512;
+    opts.output_dir = (dir / "images").string();
+    opts.io_buffer_bytes = 8192;  // 让文件跨越多个缓冲块
+    std::unordered_map<uint64_t, uint64_t> sizes;
+    {
+        ImageManager mgr(opts);
+        size_t reads = 0;
+        mgr.set_source_reader([&](const Inode& inode, uint64_t off, char* dst, size_t len) -> ssize_t {
+            ++reads;
+            // 每次最多返回 5000 字节，模拟短读
+            len = std::min<size_t>(len, 5000);
+            for (size_t i = 0; i < len; ++i) {
+                dst[i] = Byte(inode.inode, off + i);
+            }
+            return static_cast<ssize_t>(len);
+        });
+        std::mt19937_64 rng(7);
+        for (uint64_t id = 1; id <= 300; ++id) {
+            const std::string path = "/d" + std::to_string(id % 13) + "/file" + std::to_string(id);
+            Inode inode = MakeInode(id, path, static_cast<uint16_t>(rng() % 20000), 0);
+            CHECK(mgr.sim_image_write_file(inode) == IMAGE_OP_SUCCESS);
+            sizes[id] = inode.getFileSize();
+        }
+        auto images = mgr.flush(true);
+        CHECK(!images.empty());
+        CHECK(reads > 0);
+        for (const auto& image : images) {
+            CHECK(fs::exists(image.path));
+            CHECK(fs::file_size(image.path) == image.image_bytes);
+            DiscImage parsed;
+            CHECK(ImageManager::read_index(image.path, &parsed));
+            CHECK(parsed.image_id == image.image_id);
+            CHECK(parsed.files.size() == image.files.size());
+            std::ifstream in(image.path, std::ios::binary);
+            for (const auto& f : parsed.files) {
+                std::string data(f.size, '\0');
+                in.seekg(static_cast<std::streamoff>(f.offset));
+                in.read(&data[0], static_cast<std::streamsize>(data.size()));
+                for (uint64_t i = 0; i < f.size; ++i) {
+                    CHECK(data[i] == Byte(f.inode, i));
+                }
+            }
+        }
+        CHECK(mgr.get_stats().files == sizes.size());
+    }
+    ImageManager mgr(opts);
+    CHECK(mgr.load_catalog() > 0);
+    CHECK(mgr.get_stats().files == sizes.size());
+    for (const auto& kv : sizes) {
+        ImageLocation loc;
+        CHECK(mgr.locate(kv.first, &loc));
+        CHECK(loc.size == kv.second);
+    }
+    // 已打包的文件不会再次进入待打包池
+    CHECK(mgr.sim_image_write_file(MakeInode(1, "/d1/file1", 10, 0)) == IMAGE_OP_SUCCESS);
+    CHECK(mgr.get_stats().pending_files == 0);
+    return true;
+}
+
+// 读源失败时镜像不落盘，文件回到待打包池
+static bool TestReadFailure(const fs::path& dir) {
+    ImageManager::Options opts;
+    opts.image_capacity = 1 << 20;
+    opts.output_dir = (dir / "images").string();
+    ImageManager mgr(opts);
+    mgr.set_source_reader([](const Inode&, uint64_t, char*, size_t) -> ssize_t { return -1; });
+    for (uint64_t id = 1; id <= 10; ++id) {
+        CHECK(mgr.sim_image_write_file(MakeInode(id, "/d/f" + std::to_string(id), 1000, 0)) == IMAGE_OP_SUCCESS);
+    }
+    CHECK(mgr.flush(true).empty());
+    CHECK(mgr.get_stats().pending_files == 10);
+    // 只剩镜像号计数文件
+    for (const auto& entry : fs::directory_iterator(opts.output_dir)) {
+        CHECK(entry.path().filename() == "next_image_id");
+    }
+    return true;
+}
+
+// 模拟模式下镜像号计数落在 id_file 里：重启后的镜像号不与之前的重复；计数文件损坏时拒绝加载
+static bool TestImageIdsSurviveRestart(const fs::path& dir) {
+    ImageManager::Options opts;
+    opts.image_capacity = 1 << 20;
+    opts.id_file = (dir / "ids" / "next_image_id").string();
+    std::set<uint64_t> ids;
+    for (int run = 0; run < 3; ++run) {
+        ImageManager mgr(opts);
+        CHECK(mgr.load_catalog() == 0);
+        for (int i = 0; i < 5; ++i) {
+            const uint64_t ino = static_cast<uint64_t>(run * 100 + i + 1);
+            CHECK(mgr.sim_image_write_file(MakeInode(ino, "/d/f" + std::to_string(ino), 600, 1)) ==
+                  IMAGE_OP_SUCCESS);
+        }
+        auto images = mgr.flush(true);
+        CHECK(images.size() == 5);
+        for (const auto& image : images) {
+            CHECK(ids.insert(image.image_id).second);
+        }
+    }
+    {
+        std::ofstream out(opts.id_file, std::ios::trunc);
+        out << "garbage\n";
+    }
+    ImageManager mgr(opts);
+    CHECK(mgr.load_catalog() == -1);
+    return true;
+}
+
+int main() {
+    return RunDirTests("image manager", "image_manager", {
+        {"packing fill", TestPackingFill},
+        {"image round trip", TestImageRoundTrip},
+        {"read failure", TestReadFailure},
+        {"image ids survive restart", TestImageIdsSurviveRestart},
+    });
+}
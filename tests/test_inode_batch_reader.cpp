@@ -0,0 +1,184 @@
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/mds/inode/InodeBatchReader.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kSlot = InodeSlotView::kSlotSize;
+
+Inode MakeInode(uint64_t ino) {
+    Inode inode;
+    inode.inode = ino;
+    inode.setNodeId(static_cast<uint16_t>(ino % 1000));
+    inode.setNodeType(static_cast<uint8_t>(ino % 3));
+    inode.setFileType(static_cast<uint8_t>(ino % 2 ? FileType::Regular : FileType::Directory));
+    inode.setSizeUnit(static_cast<uint8_t>(ino % 4));
+    inode.setFileSize(static_cast<uint16_t>(ino % 16000));
+    inode.setFilename("file_" + std::to_string(ino));
+    inode.setVolumeId("vol-" + std::to_string(ino % 7));
+    inode.fa_time = InodeTimestamp(static_cast<std::time_t>(1'600'000'000 + ino * 60));
+    if (ino % 5 == 0) {
+        inode.appendBlocks({BlockSegment(0, ino, 3)});
+    }
+    return inode;
+}
+
+// 写 count 个 inode（号 1..count），末尾再追加 tail 字节的半个槽
+fs::path WriteBatch(const std::string& name, size_t count, size_t tail = 0) {
+    fs::path path = fs::temp_directory_path() / ("zb_batch_reader_" + name + ".bin");
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    for (uint64_t ino = 1; ino <= count; ++ino) {
+        auto bytes = MakeInode(ino).serialize();
+        bytes.resize(kSlot, 0);
+        out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    out.write(std::string(tail, '\x7f').data(), static_cast<std::streamsize>(tail));
+    return path;
+}
+
+InodeBatchReader MakeReader(size_t threads, size_t chunk_slots) {
+    InodeBatchReader::Options opts;
+    opts.threads = threads;
+    opts.chunk_bytes = chunk_slots * kSlot;
+    return InodeBatchReader(opts);
+}
+
+// 多线程解码后按文件顺序合并，结果与单线程一致；头部字段与完整反序列化一致
+bool TestOrderedMerge() {
+    const size_t n = 20000;
+    fs::path path = WriteBatch("order", n, 100);
+    for (size_t threads : {1, 2, 8}) {
+        auto reader = MakeReader(threads, 37);
+        std::vector<uint64_t> seen;
+        std::atomic<bool> fields_ok{true};
+        CHECK(reader.scan<std::vector<uint64_t>>(
+            path.string(), 0, UINT64_MAX,
+            [&](const InodeSlotView& slot, std::vector<uint64_t>& acc) {
+                Inode full;
+                const InodeTimestamp ts = slot.fa_time();
+                if (!slot.valid() || !slot.decode(full) || slot.file_offset() != (full.inode - 1) * kSlot ||
+                    slot.node_id() != full.location_id.fields.node_id ||
+                    slot.node_type() != full.location_id.fields.node_type ||
+                    slot.file_type() != full.file_mode.fields.file_type ||
+                    slot.file_size() != full.getFileSize() || std::memcmp(&ts, &full.fa_time, sizeof(ts)) != 0) {
+                    fields_ok = false;
+                }
+                acc.push_back(slot.inode());
+            },
+            [&](std::vector<uint64_t>&& acc) {
+                seen.insert(seen.end(), acc.begin(), acc.end());
+                return true;
+            }));
+        CHECK(fields_ok);
+        CHECK(seen.size() == n);
+        for (size_t i = 0; i < n; ++i) {
+            CHECK(seen[i] == i + 1);
+        }
+    }
+    fs::remove(path);
+    return true;
+}
+
+// 区间起点向下对齐到槽，终点截到文件末尾的整槽；merge 返回 false 后不再合并
+bool TestRangeAndEarlyStop() {
+    fs::path path = WriteBatch("range", 1000);
+    auto reader = MakeReader(4, 10);
+    std::vector<uint64_t> seen;
+    auto collect = [](const InodeSlotView& slot, std::vector<uint64_t>& acc) { acc.push_back(slot.inode()); };
+    CHECK(reader.scan<std::vector<uint64_t>>(path.string(), 100 * kSlot + 7, 200 * kSlot, collect,
+                                             [&](std::vector<uint64_t>&& acc) {
+                                                 seen.insert(seen.end(), acc.begin(), acc.end());
+                                                 return true;
+                                             }));
+    CHECK(seen.size() == 100 && seen.front() == 101 && seen.back() == 200);
+
+    size_t merged = 0;
+    seen.clear();
+    CHECK(reader.scan<std::vector<uint64_t>>(path.string(), 0, UINT64_MAX, collect,
+                                             [&](std::vector<uint64_t>&& acc) {
+                                                 seen.insert(seen.end(), acc.begin(), acc.end());
+                                                 return ++merged < 3;
+                                             }));
+    CHECK(merged == 3 && seen.size() == 30 && seen.back() == 30);
+
+    // 空区间与不存在的文件
+    CHECK(reader.scan<std::vector<uint64_t>>(path.string(), 5000 * kSlot, UINT64_MAX, collect,
+                                             [](std::vector<uint64_t>&&) { return true; }));
+    CHECK(!reader.scan<std::vector<uint64_t>>(path.string() + ".missing", 0, UINT64_MAX, collect,
+                                              [](std::vector<uint64_t>&&) { return true; }));
+    fs::remove(path);
+    return true;
+}
+
+// 变长部分越界的槽：valid/decode 都拒绝，且不会读出槽外
+bool TestCorruptSlot() {
+    std::vector<uint8_t> slot(kSlot, 0);
+    auto bytes = MakeInode(42).serialize();
+    std::copy(bytes.begin(), bytes.end(), slot.begin());
+    InodeSlotView good(slot.data(), 0);
+    Inode out;
+    CHECK(good.valid() && good.decode(out) && out.inode == 42);
+
+    // 块段数量超出槽
+    auto bad_segments = slot;
+    const size_t count_off = bytes.size() - sizeof(uint32_t) - sizeof(BlockSegment) * MakeInode(42).getBlocks().size();
+    uint32_t huge = 1000;
+    std::memcpy(&bad_segments[count_off], &huge, sizeof(huge));
+    CHECK(!InodeSlotView(bad_segments.data(), 0).valid());
+    CHECK(!InodeSlotView(bad_segments.data(), 0).decode(out));
+
+    // 文件名长度把卷 ID 长度字节挤到槽外
+    auto bad_name = slot;
+    bad_name[4] = 0xFF;
+    bad_name[5] = 0xFF;
+    CHECK(!InodeSlotView(bad_name.data(), 0).valid());
+
+    // 全零槽（空洞）与 Inode::deserialize 一样视为合法
+    std::vector<uint8_t> zero(kSlot, 0);
+    size_t off = 0;
+    Inode z;
+    CHECK(InodeSlotView(zero.data(), 0).valid() == Inode::deserialize(zero.data(), off, z, kSlot));
+    return true;
+}
+
+// 解码回调抛出的异常传回调用线程
+bool TestDecodeException() {
+    fs::path path = WriteBatch("throw", 500);
+    auto reader = MakeReader(4, 8);
+    bool caught = false;
+    try {
+        reader.scan<std::vector<uint64_t>>(
+            path.string(), 0, UINT64_MAX,
+            [](const InodeSlotView& slot, std::vector<uint64_t>&) {
+                if (slot.inode() == 333) {
+                    throw std::runtime_error("bad slot");
+                }
+            },
+            [](std::vector<uint64_t>&&) { return true; });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    CHECK(caught);
+    fs::remove(path);
+    return true;
+}
+
+} // namespace
+
+int main() {
+    return RunTests("inode batch reader", {
+        {"ordered merge", TestOrderedMerge},
+        {"range and early stop", TestRangeAndEarlyStop},
+        {"corrupt slot", TestCorruptSlot},
+        {"decode exception", TestDecodeException},
+    });
+}
@@ -0,0 +1,239 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/storagenode/real_node/io/IOEngine.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+// 当前进程打开的、位于 dir 下的文件数
+static size_t OpenFdsUnder(const fs::path& dir) {
+    const std::string prefix = fs::canonical(dir).string() + "/";
+    size_t n = 0;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator("/proc/self/fd", ec)) {
+        std::error_code lec;
+        auto target = fs::read_symlink(entry.path(), lec);
+        if (!lec && target.string().compare(0, prefix.size(), prefix) == 0) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+static std::string ChunkPath(const fs::path& dir, uint64_t id) {
+    return (dir / ("chunk_" + std::to_string(id))).string();
+}
+
+static std::string Payload(uint64_t id, size_t len) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i) {
+        s[i] = static_cast<char>('a' + (id * 7 + i) % 26);
+    }
+    return s;
+}
+
+static IOEngine::Options SmallCache(size_t max_open_files, size_t shards) {
+    IOEngine::Options opts;
+    opts.max_open_files = max_open_files;
+    opts.fd_cache_shards = shards;
+    return opts;
+}
+
+// 访问的 chunk 数远超 fd 上限：缓存的 fd 数不超过上限，被淘汰的 chunk 重新打开后内容不变
+static bool TestEvictionUnderLimit(const fs::path& dir) {
+    const size_t kMaxOpen = 8;
+    IOEngine engine(dir.string(), SmallCache(kMaxOpen, 2));
+    const uint64_t kChunks = 100;
+    for (uint64_t id = 0; id < kChunks; ++id) {
+        std::string data = Payload(id, 4096);
+        auto r = engine.Write(id, ChunkPath(dir, id), data.data(), data.size(), 0, O_RDWR, 0644);
+        CHECK(r.err == 0 && r.bytes == static_cast<ssize_t>(data.size()));
+        CHECK(OpenFdsUnder(dir) <= kMaxOpen);
+    }
+    for (uint64_t id = 0; id < kChunks; ++id) {
+        std::string out;
+        auto r = engine.Read(id, ChunkPath(dir, id), 0, 4096, out, O_RDWR);
+        CHECK(r.err == 0 && out == Payload(id, 4096));
+    }
+    CHECK(OpenFdsUnder(dir) <= kMaxOpen);
+
+    // 路径删除后仍可经缓存的 fd 读到数据；淘汰后再打开则报 ENOENT
+    const uint64_t victim = 1000;
+    std::string data = Payload(victim, 512);
+    CHECK(engine.Write(victim, ChunkPath(dir, victim), data.data(), data.size(), 0, O_RDWR, 0644).err == 0);
+    fs::remove(ChunkPath(dir, victim));
+    std::string out;
+    auto r = engine.Read(victim, ChunkPath(dir, victim), 0, data.size(), out, O_RDWR);
+    CHECK(r.err == 0 && out == data);
+    for (uint64_t id = 0; id < kChunks; ++id) {
+        CHECK(engine.Read(id, ChunkPath(dir, id), 0, 16, out, O_RDWR).err == 0);
+    }
+    r = engine.Read(victim, ChunkPath(dir, victim), 0, data.size(), out, O_RDWR);
+    CHECK(r.bytes < 0 && r.err == ENOENT);
+    return true;
+}
+
+// 多线程在各分片上并发读写重叠的 chunk 集合，缓存远小于工作集：
+// 每个线程写自己的偏移区间并立即读回，结束后逐个校验，且 fd 不泄漏
+static bool TestConcurrentAcrossShards(const fs::path& dir) {
+    const size_t kMaxOpen = 8;
+    const int kThreads = 8;
+    const uint64_t kChunks = 64;
+    const size_t kSlice = 256;
+    const int kRounds = 20;
+    std::atomic<int> failures{0};
+    {
+        IOEngine engine(dir.string(), SmallCache(kMaxOpen, 4));
+        std::vector<std::thread> workers;
+        for (int t = 0; t < kThreads; ++t) {
+            workers.emplace_back([&, t] {
+                std::string out;
+                for (int round = 0; round < kRounds; ++round) {
+                    for (uint64_t i = 0; i < kChunks; ++i) {
+                        uint64_t id = (i * 13 + static_cast<uint64_t>(t) * 5 + static_cast<uint64_t>(round)) % kChunks;
+                        std::string data = Payload(id + static_cast<uint64_t>(t), kSlice);
+                        uint64_t off = static_cast<uint64_t>(t) * kSlice;
+                        auto w = engine.Write(id, ChunkPath(dir, id), data.data(), data.size(), off, O_RDWR, 0644);
+                        auto r = engine.Read(id, ChunkPath(dir, id), off, kSlice, out, O_RDWR);
+                        if (w.err != 0 || r.err != 0 || out != data) {
+                            failures.fetch_add(1);
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        CHECK(failures.load() == 0);
+        CHECK(OpenFdsUnder(dir) <= kMaxOpen);
+
+        std::string out;
+        for (uint64_t id = 0; id < kChunks; ++id) {
+            auto r = engine.Read(id, ChunkPath(dir, id), 0, kSlice * kThreads, out, O_RDWR);
+            CHECK(r.err == 0 && out.size() == kSlice * kThreads);
+            for (int t = 0; t < kThreads; ++t) {
+                CHECK(out.compare(static_cast<size_t>(t) * kSlice, kSlice, Payload(id + static_cast<uint64_t>(t), kSlice)) == 0);
+            }
+        }
+    }
+    // 析构关闭全部缓存的 fd
+    CHECK(OpenFdsUnder(dir) == 0);
+    return true;
+}
+
+// O_DIRECT：同一块上并发的对齐写与部分写（读-改-写）。部分写持有整块锁，
+// 不会用读到的旧块覆盖对齐写；最终块内部分写之外的字节必为最后一次对齐写的内容
+static bool TestDirectAlignedVsPartial(const fs::path& dir) {
+    IOEngine::Options opts = SmallCache(8, 2);
+    opts.direct_io = true;
+    opts.aligned_buffer_count = 4;
+    opts.aligned_buffer_size = 64 * 1024;
+    IOEngine engine(dir.string(), opts);
+    const uint64_t id = 7;
+    const std::string path = ChunkPath(dir, id);
+    const size_t kBlock = 4096;
+    const int kRounds = 200;
+
+    void* mem = nullptr;
+    CHECK(::posix_memalign(&mem, kBlock, kBlock) == 0);
+    char* block = static_cast<char*>(mem);
+    std::memset(block, 0, kBlock);
+    CHECK(engine.Write(id, path, block, kBlock, 0, O_RDWR, 0644).err == 0);
+
+    std::atomic<int> failures{0};
+    std::thread aligned([&] {
+        for (int i = 0; i < kRounds; ++i) {
+            std::memset(block, 'A' + i % 2, kBlock);
+            if (engine.Write(id, path, block, kBlock, 0, O_RDWR, 0644).err != 0) {
+                failures.fetch_add(1);
+            }
+        }
+    });
+    std::thread partial([&] {
+        const std::string patch(100, 'p');
+        for (int i = 0; i < kRounds; ++i) {
+            if (engine.Write(id, path, patch.data(), patch.size(), 10, O_RDWR, 0644).err != 0) {
+                failures.fetch_add(1);
+            }
+        }
+    });
+    aligned.join();
+    partial.join();
+    const char last = static_cast<char>('A' + (kRounds - 1) % 2);
+    std::free(mem);
+    CHECK(failures.load() == 0);
+
+    std::string out;
+    auto r = engine.Read(id, path, 0, kBlock, out, O_RDWR);
+    CHECK(r.err == 0 && out.size() == kBlock);
+    for (size_t i = 0; i < kBlock; ++i) {
+        if (i >= 10 && i < 110) {
+            CHECK(out[i] == 'p' || out[i] == last);
+        } else {
+            CHECK(out[i] == last);
+        }
+    }
+    return true;
+}
+
+// O_DIRECT：非对齐读经弹跳缓冲区读取整块，与同一块上的部分写（读-改-写）并发时
+// 持有同一条带锁，读到的范围只能是某一次部分写的完整内容
+static bool TestDirectUnalignedReadVsPartial(const fs::path& dir) {
+    IOEngine::Options opts = SmallCache(8, 2);
+    opts.direct_io = true;
+    opts.aligned_buffer_count = 4;
+    opts.aligned_buffer_size = 64 * 1024;
+    IOEngine engine(dir.string(), opts);
+    const uint64_t id = 9;
+    const std::string path = ChunkPath(dir, id);
+    const size_t kLen = 4000;
+    const int kRounds = 200;
+
+    CHECK(engine.Write(id, path, std::string(kLen, 'A').data(), kLen, 1, O_RDWR, 0644).err == 0);
+
+    std::atomic<int> failures{0};
+    std::thread writer([&] {
+        const std::string a(kLen, 'A');
+        const std::string b(kLen, 'B');
+        for (int i = 0; i < kRounds; ++i) {
+            const std::string& src = i % 2 ? b : a;
+            if (engine.Write(id, path, src.data(), kLen, 1, O_RDWR, 0644).err != 0) {
+                failures.fetch_add(1);
+            }
+        }
+    });
+    std::thread reader([&] {
+        std::string out;
+        for (int i = 0; i < kRounds; ++i) {
+            auto r = engine.Read(id, path, 1, kLen, out, O_RDWR);
+            if (r.err != 0 || out.size() != kLen ||
+                out.find_first_not_of(out[0]) != std::string::npos) {
+                failures.fetch_add(1);
+            }
+        }
+    });
+    writer.join();
+    reader.join();
+    CHECK(failures.load() == 0);
+    return true;
+}
+
+int main() {
+    return RunDirTests("io engine fd cache", "io_engine", {
+        {"eviction under fd limit", TestEvictionUnderLimit},
+        {"concurrent get/release across shards", TestConcurrentAcrossShards},
+        {"direct aligned vs partial writes", TestDirectAlignedVsPartial},
+        {"direct unaligned read vs partial write", TestDirectUnalignedReadVsPartial},
+    });
+}
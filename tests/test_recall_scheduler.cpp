@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/srm/optical_manager/RecallScheduler.h"
+#include "TestUtil.h"
+
+static std::string DiscId(int lib, int slot) {
+    char id[32];
+    std::snprintf(id, sizeof(id), "disc_%010d", lib * OPTICAL_LIBRARY_DISC_NUM + slot);
+    return id;
+}
+
+static RecallScheduler::Options FastOptions() {
+    RecallScheduler::Options opts;
+    opts.time_scale = 0;  // 只推进模拟时钟
+    return opts;
+}
+
+struct Collected {
+    std::mutex mu;
+    std::vector<RecallScheduler::RecallResult> results;
+    void attach(RecallScheduler& sched) {
+        sched.setCompletionCallback([this](const RecallScheduler::RecallResult& r) {
+            std::lock_guard<std::mutex> lock(mu);
+            results.push_back(r);
+        });
+    }
+};
+
+// 大量分散请求按盘聚合：每张盘只装一次，盘内按偏移顺序读完，
+// 总耗时远小于逐个请求装盘读取；再次请求已读区间直接命中暂存缓存
+static bool TestBatchByDisc() {
+    RecallScheduler sched({MakeLibrary(0, 10)}, FastOptions());
+    Collected c;
+    c.attach(sched);
+    std::mt19937_64 rng(43);
+    const double mb = 1024.0 * 1024.0;
+    double naive = 0;  // 每个请求单独装盘读取所需的光驱时间
+    std::vector<RecallScheduler::RecallRequest> reqs;
+    for (uint64_t id = 1; id <= 5000; ++id) {
+        RecallScheduler::RecallRequest req;
+        req.request_id = id;
+        req.disc_id = DiscId(0, static_cast<int>(rng() % 40));
+        req.offset = (rng() % 90000) * 1024 * 1024;
+        req.length = (1 + rng() % 50) * 1024 * 1024;
+        naive += OPTICAL_LIBRARY_LOAD_TIME + req.length / (OPTICAL_DISC_READ_MBPS * mb);
+        reqs.push_back(req);
+        CHECK(sched.submit(req));
+    }
+    sched.start();
+    sched.drain();
+
+    auto stats = sched.getStats();
+    CHECK(stats.completed == 5000 && stats.failed == 0 && stats.pending == 0);
+    CHECK(stats.mounts == 40);
+    CHECK(stats.last_completion * 5 < naive / 10);
+
+    std::map<std::string, std::vector<RecallScheduler::RecallResult>> by_disc;
+    for (const auto& r : c.results) {
+        CHECK(r.ok && !r.from_cache);
+        by_disc[r.request.disc_id].push_back(r);
+    }
+    for (auto& kv : by_disc) {
+        auto& v = kv.second;
+        std::sort(v.begin(), v.end(), [](const auto& a, const auto& b) { return a.request.offset < b.request.offset; });
+        for (size_t i = 1; i < v.size(); ++i) {
+            CHECK(v[i].completed_at >= v[i - 1].completed_at);
+            CHECK(v[i].drive == v[0].drive);
+        }
+    }
+
+    c.results.clear();
+    CHECK(sched.submit(reqs[7]));
+    sched.drain();
+    CHECK(c.results.size() == 1 && c.results[0].from_cache);
+    CHECK(sched.getStats().mounts == 40);
+    CHECK(sched.getStats().cache_hits == 1);
+    return true;
+}
+
+// 单光驱时短作业优先：小请求所在的盘先于大批量回调的盘
+static bool TestShortJobFirst() {
+    RecallScheduler sched({MakeLibrary(1, 1)}, FastOptions());
+    Collected c;
+    c.attach(sched);
+    CHECK(sched.submit({1, DiscId(1, 0), 0, 50ULL << 30}));
+    CHECK(sched.submit({2, DiscId(1, 1), 0, 1 << 20}));
+    CHECK(sched.submit({3, DiscId(1, 2), 4096, 1 << 20}));
+    sched.start();
+    sched.drain();
+    CHECK(c.results.size() == 3);
+    CHECK(c.results.back().request.request_id == 1);
+    // 同一张盘上新到的请求由已装该盘的光驱直接读取，不再装盘
+    CHECK(sched.submit({4, DiscId(1, 0), 60ULL << 30, 1 << 20}));
+    sched.drain();
+    CHECK(sched.getStats().mounts == 3);
+    return true;
+}
+
+// 找不到的光盘直接失败
+static bool TestUnknownDisc() {
+    RecallScheduler sched({MakeLibrary(2, 2)}, FastOptions());
+    Collected c;
+    c.attach(sched);
+    sched.start();
+    CHECK(sched.submit({1, DiscId(5, 0), 0, 4096}));
+    sched.drain();
+    CHECK(c.results.size() == 1 && !c.results[0].ok);
+    CHECK(sched.getStats().failed == 1);
+    sched.stop();
+    CHECK(!sched.submit({2, DiscId(2, 0), 0, 4096}));
+    return true;
+}
+
+int main() {
+    return RunTests("recall scheduler", {
+        {"batch by disc", TestBatchByDisc},
+        {"short job first", TestShortJobFirst},
+        {"unknown disc", TestUnknownDisc},
+    });
+}
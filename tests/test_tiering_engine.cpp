@@ -0,0 +1,307 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+#include "../src/fs/io/IIOGateway.h"
+#include "../src/fs/volume/VolumeManager.h"
+#include "../src/fs/volume/VolumeRegistry.h"
+#include "../src/mds/server/Server.h"
+#include "../src/mds/tiering/TieringEngine.h"
+#include "../src/srm/image_manager/ImageManager.h"
+#include "TestUtil.h"
+
+namespace fs = std::filesystem;
+
+// 按 (卷, 块号) 保存数据的内存网关，用来校验迁移前后内容一致
+class MemoryGateway final : public IIOGateway {
+public:
+    double processIO(const IORequest& req) override {
+        std::lock_guard<std::mutex> lock(mu_);
+        char* buf = static_cast<char*>(req.buffer);
+        size_t block = req.start_block;
+        size_t inner = req.offset_in_block;
+        for (size_t done = 0; done < req.data_size;) {
+            auto& data = blocks_[{req.volume_id, block}];
+            data.resize(BLOCK_SIZE, '\0');
+            const size_t n = std::min(req.data_size - done, BLOCK_SIZE - inner);
+            if (req.type == IOType::Write) {
+                std::memcpy(&data[inner], buf + done, n);
+            } else {
+                std::memcpy(buf + done, &data[inner], n);
+            }
+            done += n;
+            inner = 0;
+            ++block;
+        }
+        return 0;
+    }
+    void processIOBatch(const std::vector<IORequest>& reqs) override {
+        for (const auto& req : reqs) processIO(req);
+    }
+
+private:
+    std::mutex mu_;
+    std::map<std::pair<std::string, size_t>, std::string> blocks_;
+};
+
+struct Fixture {
+    ScratchDir scratch;
+    fs::path dir;
+    std::shared_ptr<MdsServer> mds;
+    std::shared_ptr<IVolumeRegistry> registry;
+    std::shared_ptr<VolumeManager> volumes;
+    std::shared_ptr<Volume> ssd;
+    std::shared_ptr<Volume> hdd;
+
+    explicit Fixture(const std::string& name) : scratch("tiering_" + name), dir(scratch.path()) {
+        mds = std::make_shared<MdsServer>((dir / "inode.dat").string(), (dir / "bitmap.dat").string(),
+                                          (dir / "dir_store").string(), true, (dir / "kv").string());
+        mds->CreateRoot();
+        registry = make_file_volume_registry(dir.string());
+        volumes = std::make_shared<VolumeManager>();
+        auto gw = std::make_shared<MemoryGateway>();
+        ssd = std::make_shared<Volume>("ssd-1", "node-1", 256);
+        hdd = std::make_shared<Volume>("hdd-1", "node-2", 1024);
+        registry->register_volume(ssd, VolumeType::SSD);
+        registry->register_volume(hdd, VolumeType::HDD);
+        volumes->register_volume(ssd, gw);
+        volumes->register_volume(hdd, gw);
+        mds->set_volume_manager(volumes);
+    }
+
+    void enable_write_back() {
+        WriteBackOptions opts;
+        opts.enabled = true;
+        opts.max_dirty_age = std::chrono::hours(1);
+        volumes->set_write_back_options(opts);
+    }
+
+    // 在 SSD 上建一个写好数据的文件，访问时间设为 age_days 天前
+    uint64_t make_file(const std::string& name, size_t bytes, int age_days, std::string* content) {
+        const std::string path = "/" + name;
+        if (!mds->CreateFile(path, 0644)) return 0;
+        uint64_t ino = mds->LookupIno(path);
+        auto inode = std::make_shared<Inode>();
+        if (!mds->ReadInode(ino, *inode)) return 0;
+        inode->setVolumeId(ssd->uuid());
+        content->resize(bytes);
+        for (size_t i = 0; i < bytes; ++i) (*content)[i] = static_cast<char>((i * 131 + ino) & 0xFF);
+        if (volumes->write_file_direct(inode, 0, content->data(), bytes) != static_cast<ssize_t>(bytes)) return 0;
+        inode->setFaTime(InodeTimestamp(std::time(nullptr) - static_cast<std::time_t>(age_days) * 86400));
+        return mds->WriteInode(ino, *inode) ? ino : 0;
+    }
+
+    bool read_back(uint64_t ino, size_t bytes, std::string* out) {
+        auto inode = std::make_shared<Inode>();
+        if (!mds->ReadInode(ino, *inode)) return false;
+        out->assign(bytes, '\0');
+        return volumes->read_file(inode, 0, out->data(), out->size()) == static_cast<ssize_t>(out->size());
+    }
+};
+
+static TieringConfig Unthrottled() {
+    TieringConfig cfg;
+    cfg.warm_threshold = std::chrono::hours(24 * 7);
+    cfg.cold_threshold = std::chrono::hours(24 * 180);
+    cfg.ssd_read_bytes_per_sec = 0;
+    cfg.hdd_write_bytes_per_sec = 0;
+    cfg.node_bytes_per_sec = 0;
+    return cfg;
+}
+
+// 温文件降到 HDD，冷文件交给打包器并降到 HDD，热文件不动；数据内容不变，SSD 块被释放
+static bool TestDemoteByTemperature() {
+    Fixture f("demote");
+    ImageManager images;
+    std::string hot, warm, cold;
+    const uint64_t hot_ino = f.make_file("hot", 3 << 20, 0, &hot);
+    const uint64_t warm_ino = f.make_file("warm", (5 << 20) + 123, 30, &warm);
+    const uint64_t cold_ino = f.make_file("cold", 2 << 20, 400, &cold);
+    CHECK(hot_ino && warm_ino && cold_ino);
+    const size_t ssd_used = f.ssd->used_blocks();
+
+    TieringEngine engine(f.mds.get(), f.registry, f.volumes, &images, Unthrottled());
+    auto stats = engine.run_once();
+    CHECK(stats.demoted == 2 && stats.cold_submitted == 1);
+    CHECK(stats.failed == 0 && stats.skipped_busy == 0);
+    CHECK(images.get_stats().pending_files == 1);
+
+    Inode inode;
+    CHECK(f.mds->ReadInode(warm_ino, inode));
+    CHECK(inode.getVolumeUUID() == "hdd-1" && inode.location_id.fields.node_type == 1);
+    CHECK(f.mds->ReadInode(hot_ino, inode) && inode.getVolumeUUID() == "ssd-1");
+    std::string data;
+    CHECK(f.read_back(warm_ino, warm.size(), &data) && data == warm);
+    CHECK(f.read_back(cold_ino, cold.size(), &data) && data == cold);
+    CHECK(f.read_back(hot_ino, hot.size(), &data) && data == hot);
+    CHECK(f.ssd->used_blocks() == ssd_used - 6 - 2);
+
+    // 已在 HDD 上，下一轮不再迁移
+    stats = engine.run_once();
+    CHECK(stats.demoted == 0);
+    return true;
+}
+
+// 文件有未刷写的前台数据时不迁移
+static bool TestSkipDirty() {
+    Fixture f("dirty");
+    std::string warm;
+    const uint64_t ino = f.make_file("warm", 1 << 20, 30, &warm);
+    CHECK(ino);
+    f.enable_write_back();
+    auto inode = std::make_shared<Inode>();
+    CHECK(f.mds->ReadInode(ino, *inode));
+    CHECK(f.volumes->write_file(inode, 0, "x", 1) == 1);
+    CHECK(f.volumes->has_dirty(ino));
+
+    TieringEngine engine(f.mds.get(), f.registry, f.volumes, nullptr, Unthrottled());
+    auto stats = engine.run_once();
+    CHECK(stats.demoted == 0 && stats.skipped_busy == 1);
+    CHECK(f.hdd->used_blocks() == 0);
+    Inode current;
+    CHECK(f.mds->ReadInode(ino, current) && current.getVolumeUUID() == "ssd-1");
+    return true;
+}
+
+// 拷贝之后才出现的脏数据由 RelocateInode 在 inode 锁内拦下；提交期间的写入等栅栏解除
+static bool TestRelocateFencesWriteBack() {
+    Fixture f("fence");
+    std::string data;
+    const uint64_t ino = f.make_file("fence", 4096, 30, &data);
+    CHECK(ino);
+    f.enable_write_back();
+    Inode expected;
+    CHECK(f.mds->ReadInode(ino, expected));
+    auto inode = std::make_shared<Inode>(expected);
+    CHECK(f.volumes->write_file(inode, 0, "x", 1) == 1);
+    CHECK(!f.mds->RelocateInode(ino, expected, "hdd-1", expected.getBlocks(), 1));
+    CHECK(f.volumes->flush_inode(inode));
+    CHECK(f.mds->RelocateInode(ino, expected, expected.getVolumeUUID(), expected.getBlocks(),
+                               expected.location_id.fields.node_type));
+
+    CHECK(f.volumes->fence_writes(ino));
+    CHECK(!f.volumes->fence_writes(ino));
+    std::atomic<bool> written{false};
+    std::thread writer([&] {
+        f.volumes->write_file(inode, 1, "y", 1);
+        written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!written.load());
+    f.volumes->release_fence(ino);
+    writer.join();
+    CHECK(written.load() && f.volumes->has_dirty(ino));
+    return true;
+}
+
+// 单轮额度小于文件数时，游标让后续轮次接着检查剩下的文件；游标检查点跨引擎实例保留
+static bool TestResumeCursor() {
+    Fixture f("cursor");
+    std::string content;
+    std::vector<uint64_t> inos;
+    for (int i = 0; i < 3; ++i) {
+        inos.push_back(f.make_file("warm" + std::to_string(i), 4096, 30, &content));
+        CHECK(inos.back());
+    }
+    TieringConfig cfg = Unthrottled();
+    cfg.max_inodes_per_round = 1;
+    cfg.cursor_checkpoint_path = (f.dir / "tiering_cursor").string();
+    {
+        TieringEngine engine(f.mds.get(), f.registry, f.volumes, nullptr, cfg);
+        CHECK(engine.run_once().demoted == 1);
+        CHECK(engine.run_once().demoted == 1);
+        CHECK(engine.scan_cursor().next_ino == inos[1] + 1);
+    }
+    TieringEngine engine(f.mds.get(), f.registry, f.volumes, nullptr, cfg);
+    CHECK(engine.run_once().demoted == 1);
+    for (uint64_t ino : inos) {
+        Inode inode;
+        CHECK(f.mds->ReadInode(ino, inode) && inode.getVolumeUUID() == "hdd-1");
+    }
+    // 扫到末尾后回到起点
+    CHECK(engine.run_once().demoted == 0);
+    CHECK(engine.scan_cursor().passes == 1);
+    return true;
+}
+
+// 节点带宽预算限制迁移速度
+static bool TestBandwidthBudget() {
+    BandwidthBudget budget(100ULL << 20);
+    auto first = budget.reserve(10ULL << 20);
+    CHECK(first == std::chrono::steady_clock::duration::zero());
+    std::chrono::steady_clock::duration last{};
+    for (int i = 0; i < 4; ++i) last = budget.reserve(10ULL << 20);
+    CHECK(last >= std::chrono::milliseconds(350) && last <= std::chrono::milliseconds(410));
+
+    Fixture f("budget");
+    std::string warm;
+    CHECK(f.make_file("warm", 24 << 20, 30, &warm));
+    TieringConfig cfg = Unthrottled();
+    cfg.node_bytes_per_sec = 96ULL << 20;  // 源、目标节点各 96MB/s
+    cfg.copy_chunk_bytes = 4 << 20;
+    TieringEngine engine(f.mds.get(), f.registry, f.volumes, nullptr, cfg);
+    const auto start = std::chrono::steady_clock::now();
+    auto stats = engine.run_once();
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    CHECK(stats.demoted == 1);
+    // 24MB / 96MB/s = 0.25s，第一块不等待
+    CHECK(elapsed >= std::chrono::milliseconds(200));
+    return true;
+}
+
+// 迁移提交与前台写回并发：RelocateInode 的比较和写回之间不会插入 WriteInode，
+// 不会用迁移前读到的旧大小覆盖刚写入的大小
+static bool TestRelocateRacesWrite() {
+    Fixture f("race");
+    std::string data;
+    const uint64_t ino = f.make_file("race", 4096, 30, &data);
+    CHECK(ino);
+    const uint64_t kWrites = 2000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+        Inode inode;
+        f.mds->ReadInode(ino, inode);
+        for (uint64_t i = 1; i <= kWrites; ++i) {
+            inode.setSizeUnit(0);
+            inode.setFileSize(i);
+            f.mds->WriteInode(ino, inode);
+        }
+        done = true;
+    });
+    uint64_t relocated = 0;
+    while (!done) {
+        Inode expected;
+        if (!f.mds->ReadInode(ino, expected)) continue;
+        if (f.mds->RelocateInode(ino, expected, expected.getVolumeUUID(), expected.getBlocks(),
+                                 expected.location_id.fields.node_type)) {
+            ++relocated;
+        }
+    }
+    writer.join();
+    Inode final_inode;
+    CHECK(f.mds->ReadInode(ino, final_inode));
+    CHECK(final_inode.getFileSize() == kWrites);
+    CHECK(relocated > 0);
+    return true;
+}
+
+int main() {
+    return RunTests("tiering engine", {
+        {"demote by temperature", TestDemoteByTemperature},
+        {"skip dirty", TestSkipDirty},
+        {"relocate fences write back", TestRelocateFencesWriteBack},
+        {"resume cursor", TestResumeCursor},
+        {"bandwidth budget", TestBandwidthBudget},
+        {"relocate races write", TestRelocateRacesWrite},
+    });
+}
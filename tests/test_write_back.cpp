@@ -0,0 +1,198 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/fs/io/IIOGateway.h"
+#include "../src/fs/volume/VolumeManager.h"
+#include "TestUtil.h"
+
+// 按 (卷, 块号) 保存数据的内存网关；写回测试不落盘，也就不与其他测试共享任何目录
+class MemoryGateway final : public IIOGateway {
+public:
+    double processIO(const IORequest& req) override {
+        std::lock_guard<std::mutex> lock(mu_);
+        char* buf = static_cast<char*>(req.buffer);
+        size_t block = req.start_block;
+        size_t inner = req.offset_in_block;
+        for (size_t done = 0; done < req.data_size;) {
+            auto& data = blocks_[{req.volume_id, block}];
+            data.resize(BLOCK_SIZE, '\0');
+            const size_t n = std::min(req.data_size - done, BLOCK_SIZE - inner);
+            if (req.type == IOType::Write) {
+                std::memcpy(&data[inner], buf + done, n);
+            } else {
+                std::memcpy(buf + done, &data[inner], n);
+            }
+            done += n;
+            inner = 0;
+            ++block;
+        }
+        return 0;
+    }
+    void processIOBatch(const std::vector<IORequest>& reqs) override {
+        for (const auto& req : reqs) processIO(req);
+    }
+
+private:
+    std::mutex mu_;
+    std::map<std::pair<std::string, size_t>, std::string> blocks_;
+};
+
+struct Fixture {
+    std::shared_ptr<VolumeManager> volumes = std::make_shared<VolumeManager>();
+    std::shared_ptr<Volume> ssd = std::make_shared<Volume>("ssd-1", "node-1", 4096);
+
+    Fixture() { volumes->register_volume(ssd, std::make_shared<MemoryGateway>()); }
+
+    std::shared_ptr<Inode> make_inode(uint64_t ino) {
+        auto inode = std::make_shared<Inode>();
+        inode->inode = ino;
+        inode->setVolumeId(ssd->uuid());
+        return inode;
+    }
+
+    void enable(std::chrono::milliseconds max_age) {
+        WriteBackOptions opts;
+        opts.enabled = true;
+        opts.max_dirty_bytes = 64 << 20;
+        opts.max_dirty_age = max_age;
+        volumes->set_write_back_options(opts);
+    }
+};
+
+// 默认关闭写回：写入立即分配块并下发
+static bool TestDisabledByDefault() {
+    Fixture f;
+    CHECK(!f.volumes->write_back_options().enabled);
+    auto inode = f.make_inode(10);
+    const std::string data(8192, 'w');
+    CHECK(f.volumes->write_file(inode, 0, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    CHECK(!f.volumes->has_dirty(inode->inode));
+    CHECK(!inode->getBlocks().empty());
+    return true;
+}
+
+// 小块顺序追加在刷写前可读、可覆盖；flush 后一次性分配成一个连续块段
+static bool TestBufferedAppend() {
+    Fixture f;
+    f.enable(std::chrono::hours(1));
+    auto inode = f.make_inode(11);
+    const std::string chunk(4096, 'a');
+    for (int i = 0; i < 512; ++i) {
+        CHECK(f.volumes->write_file(inode, i * chunk.size(), chunk.data(), chunk.size()) ==
+              static_cast<ssize_t>(chunk.size()));
+    }
+    CHECK(inode->getBlocks().empty() && f.volumes->has_dirty(inode->inode));
+
+    std::string out(chunk.size(), '\0');
+    CHECK(f.volumes->read_file(inode, 4096 * 100, out.data(), out.size()) == static_cast<ssize_t>(out.size()));
+    CHECK(out == chunk);
+    const std::string patch = "zz";
+    CHECK(f.volumes->write_file(inode, 4096 * 100 + 10, patch.data(), patch.size()) == 2);
+    CHECK(f.volumes->read_file(inode, 4096 * 100, out.data(), out.size()) == static_cast<ssize_t>(out.size()));
+    CHECK(out.compare(10, 2, patch) == 0 && out[9] == 'a' && out[12] == 'a');
+
+    CHECK(f.volumes->flush_inode(inode));
+    CHECK(!f.volumes->has_dirty(inode->inode));
+    CHECK(inode->getBlocks().size() == 1);
+    CHECK(f.volumes->read_file(inode, 4096 * 100, out.data(), out.size()) == static_cast<ssize_t>(out.size()));
+    CHECK(out.compare(10, 2, patch) == 0 && out[0] == 'a');
+    return true;
+}
+
+// 没有后续写入时，后台线程也会刷写驻留超时的数据并通知调用方持久化块映射
+static bool TestBackgroundFlush() {
+    Fixture f;
+    std::mutex mu;
+    std::vector<uint64_t> flushed;
+    f.volumes->set_flush_listener([&](const std::shared_ptr<Inode>& inode) {
+        std::lock_guard<std::mutex> lk(mu);
+        flushed.push_back(inode->inode);
+    });
+    f.enable(std::chrono::milliseconds(20));
+    auto inode = f.make_inode(12);
+    const std::string data(10000, 'b');
+    CHECK(f.volumes->write_file(inode, 0, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto notified = [&] {
+        std::lock_guard<std::mutex> lk(mu);
+        return !flushed.empty();
+    };
+    while (!notified() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(!f.volumes->has_dirty(inode->inode));
+    CHECK(!inode->getBlocks().empty());
+    {
+        std::lock_guard<std::mutex> lk(mu);
+        CHECK(flushed.size() == 1 && flushed[0] == inode->inode);
+    }
+    std::string out(data.size(), '\0');
+    CHECK(f.volumes->read_file(inode, 0, out.data(), out.size()) == static_cast<ssize_t>(out.size()));
+    CHECK(out == data);
+
+    // 关闭写回后线程停止，之后的写入直接下发
+    WriteBackOptions off;
+    f.volumes->set_write_back_options(off);
+    CHECK(f.volumes->write_file(inode, data.size(), data.data(), 100) == 100);
+    CHECK(!f.volumes->has_dirty(inode->inode));
+    return true;
+}
+
+// 后台刷写分配块的同时前台持续读写和持久化同一 inode；刷写回调在 inode 锁下调用
+static bool TestFlushRacesForeground() {
+    Fixture f;
+    std::atomic<size_t> flushes{0};
+    auto inode = f.make_inode(13);
+    f.volumes->set_flush_listener([&](const std::shared_ptr<Inode>& flushed) {
+        (void)flushed->serialize();
+        ++flushes;
+    });
+    f.enable(std::chrono::milliseconds(2));
+
+    std::atomic<bool> stop{false};
+    std::thread reader([&] {
+        std::string out(4096, '\0');
+        while (!stop) {
+            f.volumes->read_file(inode, 0, out.data(), out.size());
+            auto guard = f.volumes->lock_inode(inode->inode);
+            (void)inode->serialize();
+        }
+    });
+    const std::string chunk(4096, 'c');
+    bool written = true;
+    for (int i = 0; i < 300; ++i) {
+        written = written && f.volumes->write_file(inode, i * chunk.size(), chunk.data(), chunk.size()) ==
+                                 static_cast<ssize_t>(chunk.size());
+        if (i % 50 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stop = true;
+    reader.join();
+    CHECK(written);
+    CHECK(f.volumes->flush_inode(inode));
+    CHECK(flushes > 0);
+    CHECK(!f.volumes->has_dirty(inode->inode));
+
+    std::string out(chunk.size(), '\0');
+    CHECK(f.volumes->read_file(inode, 299 * chunk.size(), out.data(), out.size()) ==
+          static_cast<ssize_t>(out.size()));
+    CHECK(out == chunk);
+    return true;
+}
+
+int main() {
+    return RunTests("write back", {
+        {"disabled by default", TestDisabledByDefault},
+        {"buffered append", TestBufferedAppend},
+        {"background flush", TestBackgroundFlush},
+        {"flush races foreground", TestFlushRacesForeground},
+    });
+}